@@ -62,6 +62,15 @@ static struct option long_options[] = { { "help", 0, 0, 'h' },
                                         { "errfile", 1, 0, 'e' },
                                         { "quiet", 0, 0, 'q' },
                                         { "with_checks", 1, 0, 'w' },
+                                        { "dyngeom_prefetch", 0, 0, 'g' },
+                                        { "exact_disk_cache", 1, 0, 'x' },
+                                        { "well_mixed", 1, 0, 'm' },
+                                        { "replicates", 1, 0, 'r' },
+                                        { "phase_timing", 1, 0, 'T' },
+                                        { "phase_timing_window", 1, 0, 'W' },
+                                        { "load_heatmap", 1, 0, 'L' },
+                                        { "load_heatmap_step", 1, 0, 'S' },
+                                        { "mem_report", 0, 0, 'M' },
                                         { NULL, 0, 0, 0 } };
 
 /* print_usage: Write the usage message for mcell to a file handle.
@@ -92,6 +101,29 @@ void print_usage(FILE *f, char const *argv0) {
       "for errors\n"
       "     [-with_checks ('yes'/'no', default 'yes')]   performs check of the "
       "geometry for coincident walls\n"
+      "     [-dyngeom_prefetch]      read dynamic geometry files ahead of "
+      "time in a helper thread\n"
+      "     [-exact_disk_cache tol]  reuse exact disk areas for collisions "
+      "within tol\n"
+      "                              (fraction of the interaction radius)\n"
+      "     [-well_mixed species]    count species in subvolumes without "
+      "walls instead\n"
+      "                              of tracking each molecule (may be "
+      "repeated)\n"
+      "     [-replicates n]          run n copies with consecutive random "
+      "sequences,\n"
+      "                              sharing the initialized model\n"
+      "     [-phase_timing file]     write the time spent in each phase of "
+      "the main loop\n"
+      "                              to file (CSV)\n"
+      "     [-phase_timing_window n] iterations per row of phase timing "
+      "(default: 100)\n"
+      "     [-load_heatmap prefix]   write the work done in each subvolume "
+      "to prefix.N.dat\n"
+      "     [-load_heatmap_step n]   iterations between load outputs "
+      "(default: 1000)\n"
+      "     [-mem_report]            report memory pool usage with each "
+      "iteration report\n"
       "\n");
 }
 
@@ -134,6 +166,10 @@ int argparse_init(int argc, char *const argv[], struct volume *vol) {
   FILE *fhandle = NULL;
   char *with_checks_option;
 
+  /* getopt keeps its position in globals; start over for each simulation.
+   * Resetting optind to 1 is the POSIX way to restart the scan. */
+  optind = 1;
+
   /* Loop over all arguments */
   while (1) {
 
@@ -159,6 +195,44 @@ int argparse_init(int argc, char *const argv[], struct volume *vol) {
       vol->quiet_flag = 1;
       break;
 
+    case 'g': /* -dyngeom_prefetch */
+      vol->dynamic_geometry_prefetch = 1;
+      break;
+
+    case 'M': /* -mem_report */
+      vol->mem_report = 1;
+      break;
+
+    case 'x': /* -exact_disk_cache */
+      vol->exd_cache_tolerance = strtod(optarg, &endptr);
+      if (endptr == optarg || *endptr != '\0') {
+        argerror("Exact disk cache tolerance must be a number: %s", optarg);
+        return 1;
+      }
+
+      if (vol->exd_cache_tolerance < 0 || vol->exd_cache_tolerance >= 1) {
+        argerror("Exact disk cache tolerance %g is not between 0 and 1",
+                 vol->exd_cache_tolerance);
+        return 1;
+      }
+      break;
+
+    case 'm': /* -well_mixed */
+    {
+      struct name_list *wm_name = malloc(sizeof(struct name_list));
+      if (wm_name == NULL || (wm_name->name = strdup(optarg)) == NULL) {
+        argerror("File '%s', Line %u: Out of memory while parsing "
+                 "command-line arguments: %s\n",
+                 __FILE__, __LINE__, optarg);
+        free(wm_name);
+        return 1;
+      }
+      wm_name->prev = NULL;
+      wm_name->next = vol->well_mixed_names;
+      vol->well_mixed_names = wm_name;
+      break;
+    }
+
     case 'w': /* walls coincidence check (maybe other checks in future) */
       with_checks_option = strdup(optarg);
       if (with_checks_option == NULL) {
@@ -189,6 +263,64 @@ int argparse_init(int argc, char *const argv[], struct volume *vol) {
       }
       break;
 
+    case 'r': /* -replicates */
+      vol->n_replicates = (int)strtol(optarg, &endptr, 0);
+      if (endptr == optarg || *endptr != '\0') {
+        argerror("Replicate count must be an integer: %s", optarg);
+        return 1;
+      }
+      if (vol->n_replicates < 1) {
+        argerror("Replicate count must be at least 1: %s", optarg);
+        return 1;
+      }
+      break;
+
+    case 'T': /* -phase_timing */
+      free(vol->phase_timing_file);
+      vol->phase_timing_file = strdup(optarg);
+      if (vol->phase_timing_file == NULL) {
+        argerror("File '%s', Line %u: Out of memory while parsing "
+                 "command-line arguments: %s\n",
+                 __FILE__, __LINE__, optarg);
+        return 1;
+      }
+      break;
+
+    case 'W': /* -phase_timing_window */
+      vol->phase_timing_window = strtoll(optarg, &endptr, 0);
+      if (endptr == optarg || *endptr != '\0') {
+        argerror("Phase timing window must be an integer: %s", optarg);
+        return 1;
+      }
+      if (vol->phase_timing_window < 1) {
+        argerror("Phase timing window must be at least 1: %s", optarg);
+        return 1;
+      }
+      break;
+
+    case 'L': /* -load_heatmap */
+      free(vol->load_heatmap_prefix);
+      vol->load_heatmap_prefix = strdup(optarg);
+      if (vol->load_heatmap_prefix == NULL) {
+        argerror("File '%s', Line %u: Out of memory while parsing "
+                 "command-line arguments: %s\n",
+                 __FILE__, __LINE__, optarg);
+        return 1;
+      }
+      break;
+
+    case 'S': /* -load_heatmap_step */
+      vol->load_heatmap_step = strtoll(optarg, &endptr, 0);
+      if (endptr == optarg || *endptr != '\0') {
+        argerror("Load output step must be an integer: %s", optarg);
+        return 1;
+      }
+      if (vol->load_heatmap_step < 1) {
+        argerror("Load output step must be at least 1: %s", optarg);
+        return 1;
+      }
+      break;
+
     case 'i': /* -iterations */
       vol->iterations = strtoll(optarg, &endptr, 0);
       if (endptr == optarg || *endptr != '\0') {
@@ -212,17 +344,8 @@ int argparse_init(int argc, char *const argv[], struct volume *vol) {
         return 1;
       }
 
-      if ((fhandle = fopen(vol->chkpt_infile, "rb")) == NULL) {
-        argerror("Cannot open input checkpoint file: %s", vol->chkpt_infile);
-        free(vol->chkpt_infile);
-        vol->chkpt_infile = NULL;
-        vol->chkpt_init = 1;
-        return 1;
-      }
-
       vol->chkpt_init = 0;
       vol->chkpt_flag = 1;
-      fclose(fhandle);
       break;
 
     case 'C': /* -checkpoint_outfile */
@@ -300,6 +423,19 @@ int argparse_init(int argc, char *const argv[], struct volume *vol) {
     }
   }
 
+  /* With -replicates, each replicate reads its own checkpoint file, which is
+   * only named once the replicate is started (see fork_replicates) */
+  if (vol->chkpt_infile != NULL && vol->n_replicates <= 1) {
+    if ((fhandle = fopen(vol->chkpt_infile, "rb")) == NULL) {
+      argerror("Cannot open input checkpoint file: %s", vol->chkpt_infile);
+      free(vol->chkpt_infile);
+      vol->chkpt_infile = NULL;
+      vol->chkpt_init = 1;
+      return 1;
+    }
+    fclose(fhandle);
+  }
+
   /* Handle any left-over arguments, which we assume to be MDL files. */
   if (optind < argc) {
     FILE *f;
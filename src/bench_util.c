@@ -0,0 +1,173 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+/* Helpers shared by the benchmark drivers to build small models through the
+ * libmcell API */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "bench_util.h"
+#include "logging.h"
+#include "mcell_misc.h"
+#include "mcell_objects.h"
+#include "mcell_reactions.h"
+#include "mcell_release.h"
+#include "mcell_species.h"
+#include "mcell_surfclass.h"
+#include "mem_util.h"
+
+mcell_symbol *bench_add_species(MCELL_STATE *state, char *name, double D,
+                                int is_2d) {
+  struct mcell_species_spec spec = { name, D, is_2d, 0.0, 0, 0.0, 0.0 };
+  mcell_symbol *sym = NULL;
+  if (mcell_create_species(state, &spec, &sym))
+    return NULL;
+  return sym;
+}
+
+/* Add reactants -> products at the given rate.  Volume molecules are listed
+ * with orient 0, surface molecules with orient 1 (all on the same side). */
+int bench_add_reaction(MCELL_STATE *state, mcell_symbol **reactants,
+                       int n_reactants, mcell_symbol **products,
+                       int n_products, int on_surface, double rate) {
+  short orient = on_surface ? 1 : 0;
+  struct mcell_species *reac = NULL, *prod = NULL;
+  for (int i = n_reactants - 1; i >= 0; --i)
+    reac = mcell_add_to_species_list(reactants[i], on_surface, orient, reac);
+  for (int i = n_products - 1; i >= 0; --i)
+    prod = mcell_add_to_species_list(products[i], on_surface, orient, prod);
+  struct mcell_species *surfs = mcell_add_to_species_list(NULL, false, 0, NULL);
+
+  struct reaction_arrow arrow = { REGULAR_ARROW, { NULL, NULL, 0, 0 } };
+  struct reaction_rates rates;
+  memset(&rates, 0, sizeof(rates));
+  rates.forward_rate.rate_type = RATE_CONSTANT;
+  rates.forward_rate.v.rate_constant = rate;
+  rates.backward_rate.rate_type = RATE_UNSET;
+
+  int failure = mcell_add_reaction(
+      state->notify, &state->r_step_release, state->rxn_sym_table,
+      state->radial_subdivisions, state->vacancy_search_dist2, reac, &arrow,
+      surfs, prod, NULL, &rates, NULL, NULL);
+
+  mcell_delete_species_list(reac);
+  mcell_delete_species_list(prod);
+  mcell_delete_species_list(surfs);
+  return failure;
+}
+
+/* Partition the cube [-half, half]^3 into subvolumes of the given size */
+int bench_set_partitions(MCELL_STATE *state, double half, double step) {
+  int const dims[3] = { X_PARTS, Y_PARTS, Z_PARTS };
+  for (int i = 0; i < 3; ++i) {
+    struct num_expr_list_head list = { NULL, NULL, 0, 1 };
+    if (mcell_generate_range(&list, -half, half, step))
+      return 1;
+    list.shared = 1;
+    if (mcell_set_partition(state, dims[i], &list))
+      return 1;
+  }
+  return 0;
+}
+
+/* Create a closed axis-aligned box with all faces in one region "sides" */
+struct object *bench_add_box(MCELL_STATE *state, struct object *parent,
+                             char const *name, struct vector3 const *llf,
+                             struct vector3 const *urb, struct region **sides) {
+  struct vertex_list *verts = NULL;
+  for (int i = 7; i >= 0; --i)
+    verts = mcell_add_to_vertex_list((i & 4) ? urb->x : llf->x,
+                                     (i & 2) ? urb->y : llf->y,
+                                     (i & 1) ? urb->z : llf->z, verts);
+
+  /* Two outward-facing triangles per face */
+  int const faces[12][3] = {
+    { 0, 1, 3 }, { 0, 3, 2 }, { 4, 6, 7 }, { 4, 7, 5 },
+    { 0, 4, 5 }, { 0, 5, 1 }, { 2, 3, 7 }, { 2, 7, 6 },
+    { 0, 2, 6 }, { 0, 6, 4 }, { 1, 5, 7 }, { 1, 7, 3 }
+  };
+  struct element_connection_list *elems = NULL;
+  for (int i = 11; i >= 0; --i)
+    elems = mcell_add_to_connection_list(faces[i][0], faces[i][1], faces[i][2],
+                                         elems);
+
+  struct poly_object polygon = { CHECKED_STRDUP(name, "object name"), verts, 8,
+                                 elems, 12 };
+  struct object *box = NULL;
+  if (mcell_create_poly_object(state, parent, &polygon, &box))
+    return NULL;
+
+  if (sides != NULL) {
+    *sides = mcell_create_region(state, box, "sides");
+    struct element_list *all = mcell_add_to_region_list(NULL, 0);
+    for (int i = 1; i < 12; ++i)
+      all = mcell_add_to_region_list(all, i);
+    if (*sides == NULL || mcell_set_region_elements(*sides, all, 1))
+      return NULL;
+  }
+  return box;
+}
+
+/* Release n volume molecules uniformly in a cube of the given size */
+int bench_release_in_cube(MCELL_STATE *state, struct object *parent,
+                          char const *name, mcell_symbol *species, double n,
+                          double size) {
+  /* The release site keeps the location, so it must outlive this call */
+  struct vector3 *position =
+      CHECKED_MALLOC_STRUCT(struct vector3, "release site location");
+  if (position == NULL)
+    return 1;
+  position->x = position->y = position->z = 0.0;
+  struct vector3 diameter = { size, size, size };
+  struct mcell_species *mol =
+      mcell_add_to_species_list(species, false, 0, NULL);
+  struct object *site = NULL;
+  int failure = mcell_create_geometrical_release_site(
+      state, parent, CHECKED_STRDUP(name, "release site name"), SHAPE_CUBIC,
+      position, &diameter, mol, (int)(n + 0.5), 1, NULL, &site);
+  mcell_delete_species_list(mol);
+  return failure;
+}
+
+/* Cover a region with the given densities (per square micron) of surface
+ * molecules */
+int bench_release_on_region(MCELL_STATE *state, struct region *rgn,
+                            char const *class_name, mcell_symbol **species,
+                            double const *density, int n_species) {
+  mcell_symbol *sc = NULL;
+  BUILD_CHECK(mcell_create_surf_class(
+      state, CHECKED_STRDUP(class_name, "surface class name"), &sc));
+  struct sm_dat *smd = NULL;
+  for (int i = 0; i < n_species; ++i) {
+    struct mcell_species *mol =
+        mcell_add_to_species_list(species[i], true, 1, NULL);
+    smd = mcell_add_mol_release_to_surf_class(state, sc, mol, density[i], 0,
+                                              smd);
+    mcell_delete_species_list(mol);
+    if (smd == NULL)
+      return 1;
+  }
+  return mcell_assign_surf_class_to_region(sc, rgn);
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include "mcell_init.h"
+#include "mcell_species.h"
+
+/* Model building helpers shared by mcell_bench, mcell_microbench and
+ * exd_cache_check.  All lengths are in microns; the helpers return nonzero
+ * (or NULL) on failure. */
+
+/* Return 1 from the enclosing function if the call fails */
+#define BUILD_CHECK(call)                                                      \
+  do {                                                                         \
+    if (call)                                                                  \
+      return 1;                                                                \
+  } while (0)
+
+mcell_symbol *bench_add_species(MCELL_STATE *state, char *name, double D,
+                                int is_2d);
+
+int bench_add_reaction(MCELL_STATE *state, mcell_symbol **reactants,
+                       int n_reactants, mcell_symbol **products,
+                       int n_products, int on_surface, double rate);
+
+int bench_set_partitions(MCELL_STATE *state, double half, double step);
+
+struct object *bench_add_box(MCELL_STATE *state, struct object *parent,
+                             char const *name, struct vector3 const *llf,
+                             struct vector3 const *urb, struct region **sides);
+
+int bench_release_in_cube(MCELL_STATE *state, struct object *parent,
+                          char const *name, mcell_symbol *species, double n,
+                          double size);
+
+int bench_release_on_region(MCELL_STATE *state, struct region *rgn,
+                            char const *class_name, mcell_symbol **species,
+                            double const *density, int n_species);
+
+#endif
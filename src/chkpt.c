@@ -38,6 +38,10 @@
 #include <sys/stat.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 #include "mcell_structs.h"
 #include "logging.h"
 #include "vol_util.h"
@@ -46,9 +50,12 @@
 #include "count_util.h"
 #include "react.h"
 #include "strfunc.h"
+#include "well_mixed.h"
 
-/* MCell checkpoint API version */
-#define CHECKPOINT_API 1
+/* MCell checkpoint API version
+ *   1: scheduler times are rescaled to the current time step on restore
+ *   2: adds the optional well-mixed counts section (WELL_MIXED_CMD) */
+#define CHECKPOINT_API 2
 
 /* Endian-ness markers */
 #define MCELL_BIG_ENDIAN 16
@@ -63,7 +70,8 @@
 #define SPECIES_TABLE_CMD 6
 #define MOL_SCHEDULER_STATE_CMD 7
 #define BYTE_ORDER_CMD 8
-#define NUM_CHKPT_CMDS 9
+#define WELL_MIXED_CMD 9
+#define NUM_CHKPT_CMDS 10
 #define CHECKPOINT_API_CMD 10
 
 /* Newbie flags */
@@ -73,10 +81,13 @@
 #define HAS_ACT_CHANGE 1
 #define HAS_NOT_ACT_CHANGE 0
 
-/* these are needed for the chkpt signal handler */
-int *chkpt_continue_after_checkpoint;
-char **chkpt_initialization_state;
-enum checkpoint_request_type_t *chkpt_checkpoint_requested;
+/* Simulations reached by the chkpt signal handler.  Signals are per process,
+ * so a checkpoint signal applies to every simulation in it.  The list is only
+ * touched while holding chkpt_worlds_lock (see lock_chkpt_worlds). */
+static struct volume *chkpt_worlds = NULL;
+#ifndef _WIN32
+static pthread_mutex_t chkpt_worlds_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /* ============================= */
 /* General error-checking macros */
@@ -220,6 +231,8 @@ static int read_species_table(struct volume *world, FILE *fs);
 static int read_mol_scheduler_state_real(struct volume *world, FILE *fs,
                                          struct chkpt_read_state *state,
                                          uint32_t api_version);
+static int read_well_mixed_counts(struct volume *world, FILE *fs,
+                                  struct chkpt_read_state *state);
 static int write_mcell_version(FILE *fs, const char *mcell_version);
 static int write_current_time_seconds(FILE *fs, double current_time_seconds);
 static int write_current_iteration(FILE *fs, long long current_iterations,
@@ -233,6 +246,7 @@ static int write_mol_scheduler_state_real(FILE *fs,
                                           double simulation_start_seconds,
                                           double start_iterations,
                                           double time_unit);
+static int write_well_mixed_counts(FILE *fs, struct well_mixed_data *wm);
 static int write_byte_order(FILE *fs);
 
 static int write_api_version(FILE *fs);
@@ -240,23 +254,80 @@ static int write_api_version(FILE *fs);
 static int create_molecule_scheduler(struct storage_list *storage_head,
                                      long long start_iterations);
 
+/***************************************************************************
+ lock_chkpt_worlds:
+ In:  saved - the caller's signal mask is stored here
+ Out: None.  chkpt_worlds_lock is held and the checkpoint signals are blocked
+      in the calling thread, so that the signal handler, which takes the same
+      lock, cannot interrupt the thread that holds it.
+***************************************************************************/
+static void lock_chkpt_worlds(sigset_t *saved) {
+#ifndef _WIN32
+  sigset_t block;
+  sigemptyset(&block);
+  sigaddset(&block, SIGUSR1);
+  sigaddset(&block, SIGUSR2);
+  sigaddset(&block, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &block, saved);
+  pthread_mutex_lock(&chkpt_worlds_lock);
+#else
+  UNUSED(saved);
+#endif
+}
+
+/***************************************************************************
+ unlock_chkpt_worlds:
+ In:  saved - the signal mask returned by lock_chkpt_worlds
+ Out: None.  chkpt_worlds_lock is released and the signal mask restored.
+***************************************************************************/
+static void unlock_chkpt_worlds(sigset_t const *saved) {
+#ifndef _WIN32
+  pthread_mutex_unlock(&chkpt_worlds_lock);
+  pthread_sigmask(SIG_SETMASK, saved, NULL);
+#else
+  UNUSED(saved);
+#endif
+}
+
 /********************************************************************
- * this function initializes to global variables
+ * this function adds world to the simulations whose
  *
- *     int chkpt_continue_after_checkpoint
- *     char *chkpt_initialization_state
- *     enum checkpoint_request_type_t chkpt_checkpoint_requested
+ *     continue_after_checkpoint
+ *     initialization_state
+ *     checkpoint_requested
  *
- * needed by the signal handler chkpt_signal_handler
+ * are used by the signal handler chkpt_signal_handler
 *********************************************************************/
 int set_checkpoint_state(struct volume *world) {
-  chkpt_continue_after_checkpoint = &world->continue_after_checkpoint;
-  chkpt_initialization_state = &world->initialization_state;
-  chkpt_checkpoint_requested = &world->checkpoint_requested;
+  sigset_t saved;
+  lock_chkpt_worlds(&saved);
+  world->next_chkpt_world = chkpt_worlds;
+  chkpt_worlds = world;
+  unlock_chkpt_worlds(&saved);
 
   return 0;
 }
 
+/***************************************************************************
+ clear_checkpoint_state:
+ In:  world - a simulation registered with set_checkpoint_state
+ Out: None.  world is removed from the simulations reached by checkpoint
+      signals and may be freed afterwards.
+***************************************************************************/
+void clear_checkpoint_state(struct volume *world) {
+  sigset_t saved;
+  lock_chkpt_worlds(&saved);
+  for (struct volume **wp = &chkpt_worlds; *wp != NULL;
+       wp = &(*wp)->next_chkpt_world) {
+    if (*wp == world) {
+      *wp = world->next_chkpt_world;
+      break;
+    }
+  }
+  world->next_chkpt_world = NULL;
+  unlock_chkpt_worlds(&saved);
+}
+
 /***************************************************************************
  chkpt_signal_handler:
  In:  signo - the signal number that triggered the checkpoint
@@ -264,30 +335,43 @@ int set_checkpoint_state(struct volume *world) {
 
  Note: This function is not to be called during normal program execution.  It is
  registered as a signal handler for SIGUSR1, SIGUSR2, and possibly SIGALRM
- signals.
+ signals, with all three blocked while it runs.
 ***************************************************************************/
 void chkpt_signal_handler(int signo) {
-  if (*chkpt_initialization_state) {
-    if (signo != SIGALRM || !*chkpt_continue_after_checkpoint) {
-      mcell_warn("Checkpoint requested while %s.  Exiting.",
-                 *chkpt_initialization_state);
-      exit(EXIT_FAILURE);
+#ifndef _WIN32
+  pthread_mutex_lock(&chkpt_worlds_lock);
+#endif
+  for (struct volume *world = chkpt_worlds; world != NULL;
+       world = world->next_chkpt_world) {
+    /* Only simulations with a CHECKPOINT_REALTIME set the alarm */
+    if (signo == SIGALRM && world->checkpoint_alarm_time == 0)
+      continue;
+
+    if (world->initialization_state) {
+      if (signo != SIGALRM || !world->continue_after_checkpoint) {
+        mcell_warn("Checkpoint requested while %s.  Exiting.",
+                   world->initialization_state);
+        exit(EXIT_FAILURE);
+      }
     }
-  }
 
 #ifndef _WIN32 /* fixme: Windows does not support USR signals */
-  if (signo == SIGUSR1)
-    *chkpt_checkpoint_requested = CHKPT_SIGNAL_CONT;
-  else if (signo == SIGUSR2)
-    *chkpt_checkpoint_requested = CHKPT_SIGNAL_EXIT;
-  else
-#endif
-      if (signo == SIGALRM) {
-    if (*chkpt_continue_after_checkpoint)
-      *chkpt_checkpoint_requested = CHKPT_ALARM_CONT;
+    if (signo == SIGUSR1)
+      world->checkpoint_requested = CHKPT_SIGNAL_CONT;
+    else if (signo == SIGUSR2)
+      world->checkpoint_requested = CHKPT_SIGNAL_EXIT;
     else
-      *chkpt_checkpoint_requested = CHKPT_ALARM_EXIT;
+#endif
+        if (signo == SIGALRM) {
+      if (world->continue_after_checkpoint)
+        world->checkpoint_requested = CHKPT_ALARM_CONT;
+      else
+        world->checkpoint_requested = CHKPT_ALARM_EXIT;
+    }
   }
+#ifndef _WIN32
+  pthread_mutex_unlock(&chkpt_worlds_lock);
+#endif
 }
 
 /***************************************************************************
@@ -505,7 +589,8 @@ int write_chkpt(struct volume *world, FILE *fs) {
           write_species_table(fs, world->n_species, world->species_list) ||
           write_mol_scheduler_state_real(fs, world->storage_head,
               world->simulation_start_seconds, world->start_iterations,
-              world->time_unit));
+              world->time_unit) ||
+          write_well_mixed_counts(fs, world->well_mixed));
 }
 
 /***************************************************************************
@@ -635,6 +720,17 @@ int read_chkpt(struct volume *world, FILE *fs) {
         return 1;
       break;
 
+    case WELL_MIXED_CMD:
+      DATACHECK(api_version < 2,
+                "Well-mixed counts command in a version %u checkpoint file.",
+                api_version);
+      DATACHECK(
+          !seen_section[SPECIES_TABLE_CMD],
+          "Species table command must precede well-mixed counts command.");
+      if (read_well_mixed_counts(world, fs, &state))
+        return 1;
+      break;
+
     case BYTE_ORDER_CMD:
     case MCELL_VERSION_CMD:
     default:
@@ -1320,7 +1416,7 @@ static int read_mol_scheduler_state_real(struct volume *world, FILE *fs,
       vmp->pos.x = x_coord;
       vmp->pos.y = y_coord;
       vmp->pos.z = z_coord;
-      amp->periodic_box = &periodic_box;
+      amp->periodic_box = periodic_box;
 
       /* Set molecule flags */
       amp->flags = TYPE_VOL | IN_VOLUME;
@@ -1356,7 +1452,7 @@ static int read_mol_scheduler_state_real(struct volume *world, FILE *fs,
 
       struct surface_molecule *smp = insert_surface_molecule(
           world, properties, &where, orient, CHKPT_GRID_TOLERANCE, sched_time,
-          NULL, NULL, NULL, &periodic_box);
+          0, NULL, NULL, &periodic_box);
 
       if (smp == NULL) {
         mcell_warn("Could not place molecule %s at (%f,%f,%f).",
@@ -1379,3 +1475,107 @@ static int read_mol_scheduler_state_real(struct volume *world, FILE *fs,
 
   return 0;
 }
+
+/***************************************************************************
+ write_well_mixed_counts:
+ In:  fs - checkpoint file to write to.
+      wm - well-mixed state, or NULL if no species are well-mixed
+ Out: Writes the counts of the well-mixed species (see well_mixed.c) to the
+        checkpoint file, so they don't have to be turned back into
+        individual molecules.  Nothing is written without well-mixed
+        species.
+      Returns 1 on error, and 0 - on success.
+***************************************************************************/
+static int write_well_mixed_counts(FILE *fs, struct well_mixed_data *wm) {
+  static const char SECTNAME[] = "well-mixed counts";
+  static const byte cmd = WELL_MIXED_CMD;
+
+  if (wm == NULL)
+    return 0;
+
+  WRITEFIELD(cmd);
+
+  /* Species without molecules are not in the species table */
+  unsigned int n_species = 0;
+  for (int i = 0; i < wm->n_species; i++) {
+    if (wm->species[i].spec->population > 0)
+      ++n_species;
+  }
+  WRITEUINT(n_species);
+
+  for (int i = 0; i < wm->n_species; i++) {
+    struct well_mixed_species *wms = &wm->species[i];
+    if (wms->spec->population == 0)
+      continue;
+
+    unsigned int n_cells = 0;
+    for (int c = 0; c < wm->n_cells; c++) {
+      int h = wm->cells[c];
+      if (wms->count[h] > 0)
+        ++n_cells;
+    }
+    WRITEUINT(wms->spec->chkpt_species_id);
+    WRITEUINT(n_cells);
+
+    for (int c = 0; c < wm->n_cells; c++) {
+      int h = wm->cells[c];
+      if (wms->count[h] == 0)
+        continue;
+
+      // Birthdays are real times (seconds), like those of the molecules
+      WRITEUINT((unsigned int)h);
+      WRITEUINT(wms->count[h]);
+      WRITEFIELD(wms->born[h]);
+    }
+  }
+
+  return 0;
+}
+
+/***************************************************************************
+ read_well_mixed_counts:
+ In:  fs - checkpoint file to read from.
+ Out: Reads the counts of the well-mixed species from the checkpoint file.
+      Returns 1 on error, and 0 - on success.
+***************************************************************************/
+static int read_well_mixed_counts(struct volume *world, FILE *fs,
+                                  struct chkpt_read_state *state) {
+  static const char SECTNAME[] = "well-mixed counts";
+  struct well_mixed_data *wm = world->well_mixed;
+
+  unsigned int n_species;
+  READUINT(n_species);
+
+  for (unsigned int i = 0; i < n_species; i++) {
+    unsigned int external_species_id, n_cells;
+    READUINT(external_species_id);
+    READUINT(n_cells);
+
+    /* Find this species by its external species id */
+    struct well_mixed_species *wms = NULL;
+    for (int j = 0; wm != NULL && j < wm->n_species; j++) {
+      if (wm->species[j].spec->chkpt_species_id == external_species_id) {
+        wms = &wm->species[j];
+        break;
+      }
+    }
+    DATACHECK(wms == NULL,
+              "Found well-mixed counts of species id %u, which is not "
+              "well-mixed in this simulation (see -well_mixed).",
+              external_species_id);
+
+    for (unsigned int c = 0; c < n_cells; c++) {
+      unsigned int h, count;
+      double born;
+      READUINT(h);
+      READUINT(count);
+      READFIELD(born);
+      DATACHECK(well_mixed_restore_counts(world, wms, (int)h, count, born),
+                "Found well-mixed counts in subvolume %u, which is not a "
+                "well-mixed compartment in this simulation.",
+                h);
+    }
+  }
+
+  return 0;
+}
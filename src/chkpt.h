@@ -35,6 +35,7 @@ int read_chkpt(struct volume *world, FILE *fs);
 void chkpt_signal_handler(int signo);
 
 int set_checkpoint_state(struct volume *world);
+void clear_checkpoint_state(struct volume *world);
 
 double compute_scaled_time(struct volume *world, double real_time);
 
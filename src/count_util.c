@@ -42,11 +42,13 @@
 #include "grid_util.h"
 #include "wall_util.h"
 #include "vol_util.h"
+#include "init.h"
 #include "count_util.h"
 #include "react_output.h"
 //#include "util.h"
 #include "sym_table.h"
 #include "dyngeom_parse_extras.h"
+#include "region_query.h"
 
 /* Instantiate a request to track a particular quantity */
 static int instantiate_count_request(
@@ -70,14 +72,22 @@ static void clean_region_lists(struct subvolume *my_sv,
 /*static int is_object_instantiated(struct sym_entry *entry,*/
 /*                                  struct object *root_instance);*/
 
-/* Find the list of regions enclosing a particular point. given a particular
- * starting point and starting region list. */
+/* Find the list of regions enclosing a particular point. */
 static int find_enclosing_regions(struct volume *world, struct vector3 *loc,
-                                  struct vector3 *start,
                                   struct region_list **rlp,
                                   struct region_list **arlp,
                                   struct mem_helper *rmem);
 
+/* Find the list of regions enclosing a point from those of the waypoint
+ * below it. */
+static int follow_enclosing_regions(struct volume *world, struct vector3 *loc,
+                                    struct waypoint *below,
+                                    struct subvolume *below_sv,
+                                    struct subvolume *sv,
+                                    struct region_list **rlp,
+                                    struct region_list **arlp,
+                                    struct mem_helper *rmem);
+
 void count_region_list(
     struct volume *world,
     struct region_list *regions,
@@ -464,7 +474,7 @@ void count_region_from_scratch(struct volume *world,
               if ((c->orientation == ORIENT_NOT_SET) ||
                   (c->orientation == orient) || (c->orientation == 0)) {
                 // count only in the relevant periodic box
-                if (periodic_boxes_are_identical(am->periodic_box, c->periodic_box)) {
+                if (periodic_boxes_are_identical(&am->periodic_box, c->periodic_box)) {
                   c->data.move.n_at += n;
                 }
               }
@@ -496,7 +506,7 @@ void count_region_from_scratch(struct volume *world,
     const int this_sv =
         pz + (world->nz_parts - 1) * (py + (world->ny_parts - 1) * px);
     struct waypoint *wp = &(world->waypoints[this_sv]);
-    struct subvolume *my_sv = &(world->subvol[this_sv]);
+    struct subvolume *my_sv = get_subvol(world, this_sv);
 
     struct vector3 here = {.x = wp->loc.x, .y = wp->loc.y, .z = wp->loc.z};
 
@@ -532,10 +542,8 @@ void count_region_from_scratch(struct volume *world,
     }
 
     /* Raytrace across any walls from waypoint to us and add to region lists */
-    for (struct subvolume *sv = &(world->subvol[this_sv]); sv != NULL;
-         sv = next_subvol(&here, &delta, sv, world->x_fineparts,
-                          world->y_fineparts, world->z_fineparts,
-                          world->ny_parts, world->nz_parts)) {
+    for (struct subvolume *sv = my_sv; sv != NULL;
+         sv = next_subvol(world, &here, &delta, sv)) {
       delta.x = loc->x - here.x;
       delta.y = loc->y - here.y;
       delta.z = loc->z - here.z;
@@ -787,7 +795,7 @@ void count_moved_surface_mol(
   uv2xyz(&(sm->s_pos), sm->grid->surface, &origin);
   uv2xyz(loc, sg->surface, &target);
   if ((sm->properties->flags & COUNT_ENCLOSED) &&
-      (periodic_boxes_are_identical(previous_box, sm->periodic_box))) {
+      (periodic_boxes_are_identical(previous_box, &sm->periodic_box))) {
 
     pos_regs = neg_regs = NULL;
     struct vector3 delta = {target.x - origin.x, target.y - origin.y, target.z - origin.z};
@@ -795,8 +803,7 @@ void count_moved_surface_mol(
 
     /* Collect all the relevant regions we pass through */
     for (struct subvolume *sv = find_subvolume(world, &origin, NULL); sv != NULL;
-         sv = next_subvol(&here, &delta, sv, world->x_fineparts, world->y_fineparts,
-          world->z_fineparts, world->ny_parts, world->nz_parts)) {
+         sv = next_subvol(world, &here, &delta, sv)) {
 
       int j = 0;
       for (struct wall_list *wl = sv->wall_head; wl != NULL; wl = wl->next) {
@@ -904,7 +911,7 @@ void count_moved_surface_mol(
                      (c->orientation == sm->orient) ||
                      (c->orientation == 0)) {
             /*c->data.move.n_enclosed += n;*/
-            if (periodic_boxes_are_identical(c->periodic_box, sm->periodic_box)) {
+            if (periodic_boxes_are_identical(c->periodic_box, &sm->periodic_box)) {
               c->data.move.n_enclosed += n;
             }
           }
@@ -918,9 +925,9 @@ void count_moved_surface_mol(
       mem_put_list(stor->regl, neg_regs);
   }
   else if ((sm->properties->flags & COUNT_ENCLOSED) &&
-      (!periodic_boxes_are_identical(previous_box, sm->periodic_box))) {
+      (!periodic_boxes_are_identical(previous_box, &sm->periodic_box))) {
     // Increment count of where we are going now (target)
-    count_region_from_scratch(world, (struct abstract_molecule *)sm, NULL, 1, &target, NULL, 1.0, sm->periodic_box);
+    count_region_from_scratch(world, (struct abstract_molecule *)sm, NULL, 1, &target, NULL, 1.0, &sm->periodic_box);
     // Decrement count of where we were before (origin)
     count_region_from_scratch(world, (struct abstract_molecule *)sm, NULL, -1, &origin, NULL, 1.0, previous_box);
   }
@@ -982,196 +989,201 @@ void fire_count_event(struct volume *world, struct counter *event, int n,
   }
 }
 
+/*************************************************************************
+cross_counted_wall:
+   In: w: wall that a containment ray crosses
+       sign: +1 if the ray leaves through the front of the wall, -1 if it
+             leaves through the back
+       rl: list of regions we're inside
+       arl: list of inside-out regions we're "outside"
+       rmem: memory handler to store lists of regions
+   Out: No return value.  The counted regions of the wall are moved into or
+        out of the lists.  Leaving a region through the back cancels out
+        leaving it through the front.
+*************************************************************************/
+static void cross_counted_wall(struct wall *w, int sign,
+                               struct region_list **rl,
+                               struct region_list **arl,
+                               struct mem_helper *rmem) {
+  for (struct region_list *xrl = w->counting_regions; xrl != NULL;
+       xrl = xrl->next) {
+    if ((xrl->reg->flags & (COUNT_CONTENTS | COUNT_RXNS | COUNT_ENCLOSED)) == 0)
+      continue;
+
+    struct region_list **from = (sign > 0) ? arl : rl;
+    struct region_list **to = (sign > 0) ? rl : arl;
+    struct region_list *yrl, *nrl = NULL;
+    for (yrl = *from; yrl != NULL; nrl = yrl, yrl = yrl->next) {
+      if (yrl->reg == xrl->reg)
+        break;
+    }
+    if (yrl != NULL) {
+      if (nrl == NULL)
+        *from = yrl->next;
+      else
+        nrl->next = yrl->next;
+      mem_put(rmem, yrl);
+      continue;
+    }
+
+    nrl = (struct region_list *)CHECKED_MEM_GET(rmem, "region list entry");
+    nrl->reg = xrl->reg;
+    nrl->next = *to;
+    *to = nrl;
+  }
+}
+
 /*************************************************************************
 find_enclosing_regions:
    In: world: simulation state 
-       loc: location we want to end up
-       start: starting position
-       rlp: list of regions we're inside at the starting position
-       arlp: list of inside-out regions we're "outside" at the starting position
+       loc: location we want the regions of
+       rlp: list of regions we're inside is stored here
+       arlp: list of inside-out regions we're "outside" is stored here
        rmem: memory handler to store lists of regions
-   Out: 0 on success, 1 on memory allocation error.  The region and
-        inside-out region lists are updated to be correct at the ending
-        position.
+   Out: 0 on success, 1 on memory allocation error. A ray is cast from loc
+        straight down out of the world (see region_query.c) and every
+        counted region it leaves through the front of a wall more often
+        than through the back is added to the region list, and vice versa.
 *************************************************************************/
 static int find_enclosing_regions(struct volume *world,
                                   struct vector3 *loc,
-                                  struct vector3 *start,
                                   struct region_list **rlp,
                                   struct region_list **arlp,
                                   struct mem_helper *rmem) {
-  struct vector3 outside, delta, hit;
-  struct wall_list *wl;
-  struct region_list *rl, *arl;
-  struct region_list *trl, *tarl, *xrl, *yrl, *nrl;
-  struct wall_list dummy;
-
-  rl = *rlp;
-  arl = *arlp;
-
-  if (start == NULL || (distinguishable(loc->x, start->x, EPS_C)) ||
-      (distinguishable(loc->y, start->y, EPS_C)) || loc->z < start->z) {
-    outside.x = loc->x;
-    outside.y = loc->y;
-    outside.z = (world->z_partitions[0] + world->z_partitions[1]) / 2;
-  } else {
-    outside.x = start->x;
-    outside.y = start->y;
-    outside.z = start->z;
-  }
+  struct region_list *rl = NULL, *arl = NULL;
+  struct wall_crossing_list wcl;
+  init_wall_crossing_list(&wcl);
+
+  int n_objects;
+  struct object **objects = get_wall_objects(world, &n_objects);
+  for (int i = 0; i < n_objects; i++) {
+    struct wall_bvh *bvh = get_object_bvh(world, objects[i]);
+
+    /* Only rays that graze a counted wall need to be cast again */
+    for (int attempt = 0; attempt < N_CONTAINMENT_DIRECTIONS; attempt++) {
+      struct vector3 dir;
+      containment_direction(attempt, &dir);
+      wcl.n_crossings = 0;
+      object_ray_crossings(bvh, loc, &dir, &wcl);
+
+      int grazed = 0;
+      for (int k = 0; k < wcl.n_crossings; k++) {
+        if (wcl.crossings[k].sign == 0 &&
+            (wcl.crossings[k].w->flags &
+             (COUNT_CONTENTS | COUNT_RXNS | COUNT_ENCLOSED)) != 0) {
+          grazed = 1;
+          break;
+        }
+      }
+      if (!grazed)
+        break;
+    }
 
-  delta.x = 0.0;
-  delta.y = 0.0;
-  delta.z = loc->z - outside.z;
+    for (int k = 0; k < wcl.n_crossings; k++) {
+      struct wall_crossing *c = &wcl.crossings[k];
+      if (c->sign == 0 ||
+          (c->w->flags & (COUNT_CONTENTS | COUNT_RXNS | COUNT_ENCLOSED)) == 0)
+        continue;
 
-  struct subvolume *sv = find_subvolume(world, &outside, NULL);
-  struct subvolume *svt = find_subvolume(world, loc, NULL);
-  int traveling = 1;
+      cross_counted_wall(c->w, c->sign, &rl, &arl, rmem);
+    }
+  }
 
-  double t;
-  while (traveling) {
-    tarl = trl = NULL;
-    double t_hit_sv = collide_sv_time(&outside, &delta, sv, world->x_fineparts,
-                                      world->y_fineparts, world->z_fineparts);
+  free_wall_crossing_list(&wcl);
+  *rlp = rl;
+  *arlp = arl;
 
-    for (wl = sv->wall_head; wl != NULL; wl = wl->next) {
-      int hit_code =
-          collide_wall(&outside, &delta, wl->this_wall, &t, &hit, 0, world->rng,
-                       world->notify, &(world->ray_polygon_tests));
+  return 0;
+}
 
-      if ((hit_code != COLLIDE_MISS) &&
-          (world->notify->final_summary == NOTIFY_FULL)) {
-        world->ray_polygon_colls++;
-      }
+/*************************************************************************
+follow_enclosing_regions:
+   In: world: simulation state
+       loc: location we want the regions of
+       below: waypoint of the subvolume below the one loc is in
+       below_sv: subvolume of that waypoint
+       sv: subvolume loc is in
+       rlp: list of regions we're inside is stored here
+       arlp: list of inside-out regions we're "outside" is stored here
+       rmem: memory handler to store lists of regions
+   Out: 0 on success, 1 on memory allocation error, -1 if the regions
+        have to be found with find_enclosing_regions instead.  The ray that
+        find_enclosing_regions casts straight down from loc passes through
+        the waypoint below if the two are lined up, so only the walls of
+        the two subvolumes between them need to be tested.  This keeps
+        placing the waypoints linear in the number of subvolumes.
+*************************************************************************/
+static int follow_enclosing_regions(struct volume *world, struct vector3 *loc,
+                                    struct waypoint *below,
+                                    struct subvolume *below_sv,
+                                    struct subvolume *sv,
+                                    struct region_list **rlp,
+                                    struct region_list **arlp,
+                                    struct mem_helper *rmem) {
+  if (distinguishable(loc->x, below->loc.x, EPS_C) ||
+      distinguishable(loc->y, below->loc.y, EPS_C) || loc->z < below->loc.z)
+    return -1;
+
+  struct vector3 down;
+  containment_direction(0, &down);
+  double length = loc->z - below->loc.z;
+  double z_split = world->z_fineparts[sv->llf.z];
+
+  /* A wall in both subvolumes is counted in the one the ray crosses it in */
+  struct wall_crossing_list wcl;
+  init_wall_crossing_list(&wcl);
+  int grazed = 0;
+  for (int upper = 0; upper < 2 && !grazed; upper++) {
+    struct wall_list *wl = upper ? sv->wall_head : below_sv->wall_head;
+    for (; wl != NULL; wl = wl->next) {
+      struct wall *w = wl->this_wall;
+      if ((w->flags & (COUNT_CONTENTS | COUNT_RXNS | COUNT_ENCLOSED)) == 0)
+        continue;
 
-      if (hit_code == COLLIDE_REDO) {
-        while (trl != NULL) {
-          xrl = trl->next;
-          mem_put(rmem, trl);
-          trl = xrl;
-        }
-        while (tarl != NULL) {
-          xrl = tarl->next;
-          mem_put(rmem, tarl);
-          tarl = xrl;
-        }
-        dummy.next = sv->wall_head;
-        wl = &dummy;
-        continue; /* Trick to restart for loop */
-      } else if (hit_code == COLLIDE_MISS || !(t >= 0 && t < 1.0) ||
-                 t > t_hit_sv ||
-                 (wl->this_wall->flags &
-                  (COUNT_CONTENTS | COUNT_RXNS | COUNT_ENCLOSED)) == 0 ||
-                 (hit.x - outside.x) * delta.x + (hit.y - outside.y) * delta.y +
-                         (hit.z - outside.z) * delta.z <
-                     0)
+      struct wall_bvh *bvh = get_object_bvh(world, w->parent_object);
+      struct wall_crossing c;
+      if (!ray_wall_crossing(loc, &down, w, bvh->eps, &c) ||
+          c.t > length + bvh->eps)
         continue;
-      else {
-        for (xrl = wl->this_wall->counting_regions; xrl != NULL;
-             xrl = xrl->next) {
-          if ((xrl->reg->flags &
-               (COUNT_CONTENTS | COUNT_RXNS | COUNT_ENCLOSED)) != 0) {
-            nrl = (struct region_list *)CHECKED_MEM_GET(rmem,
-                                                        "region list entry");
-            nrl->reg = xrl->reg;
-
-            if (hit_code == COLLIDE_BACK) {
-              nrl->next = tarl;
-              tarl = nrl;
-            } else {
-              nrl->next = trl;
-              trl = nrl;
-            }
-          }
-        }
+      if ((loc->z - c.t >= z_split) != upper)
+        continue;
+      if (c.sign == 0 || c.t > length - bvh->eps) {
+        grazed = 1;
+        break;
       }
-    }
 
-    xrl = trl;
-    while (trl != NULL) {
-      nrl = NULL;
-      yrl = arl;
-      while (yrl != NULL) {
-        if (xrl->reg == yrl->reg) {
-          if (nrl == NULL) {
-            arl = yrl->next;
-            mem_put(rmem, yrl);
-          } else {
-            nrl->next = yrl->next;
-            mem_put(rmem, yrl);
-          }
-          trl = trl->next;
-          mem_put(rmem, xrl);
-          xrl = NULL;
-          break;
-        } else {
-          nrl = yrl;
-          yrl = yrl->next;
-        }
+      if (wcl.n_crossings == wcl.max_crossings) {
+        int new_max = (wcl.max_crossings == 0) ? 16 : 2 * wcl.max_crossings;
+        struct wall_crossing *bigger = CHECKED_MALLOC_ARRAY(
+            struct wall_crossing, new_max, "wall crossings");
+        if (wcl.n_crossings > 0)
+          memcpy(bigger, wcl.crossings,
+                 wcl.n_crossings * sizeof(struct wall_crossing));
+        free(wcl.crossings);
+        wcl.crossings = bigger;
+        wcl.max_crossings = new_max;
       }
-      if (xrl != NULL) {
-        trl = trl->next;
-        xrl->next = rl;
-        rl = xrl;
-        xrl = trl;
-      } else
-        xrl = trl;
+      wcl.crossings[wcl.n_crossings++] = c;
     }
+  }
 
-    xrl = tarl;
-    while (tarl != NULL) {
-      nrl = NULL;
-      yrl = rl;
-      while (yrl != NULL) {
-        if (xrl->reg == yrl->reg) {
-          if (nrl == NULL) {
-            rl = yrl->next;
-            mem_put(rmem, yrl);
-          } else {
-            nrl->next = yrl->next;
-            mem_put(rmem, yrl);
-          }
-          tarl = tarl->next;
-          mem_put(rmem, xrl);
-          xrl = NULL;
-          break;
-        } else {
-          nrl = yrl;
-          yrl = yrl->next;
-        }
-      }
-      if (xrl != NULL) {
-        tarl = tarl->next;
-        xrl->next = arl;
-        arl = xrl;
-        xrl = tarl;
-      } else
-        xrl = tarl;
-    }
+  if (grazed) {
+    free_wall_crossing_list(&wcl);
+    return -1;
+  }
 
-    if (sv == svt)
-      traveling = 0;
-    else {
-      sv = next_subvol(&outside, &delta, sv, world->x_fineparts,
-                       world->y_fineparts, world->z_fineparts, world->ny_parts,
-                       world->nz_parts);
-      delta.x = loc->x - outside.x;
-      delta.y = loc->y - outside.y;
-      delta.z = loc->z - outside.z;
-
-      if (sv == NULL) {
-        if ((delta.x * delta.x + delta.y * delta.y + delta.z * delta.z) <
-            EPS_C * EPS_C) {
-          mcell_log("Didn't quite reach waypoint target, fudging.");
-          traveling = 0;
-        } else {
-          mcell_log("Couldn't reach waypoint target.");
-          sv = find_subvolume(world, &outside, NULL);
-        }
-      }
-    }
+  struct region_list *rl = dup_region_list(below->regions, rmem);
+  struct region_list *arl = dup_region_list(below->antiregions, rmem);
+  if ((rl == NULL && below->regions != NULL) ||
+      (arl == NULL && below->antiregions != NULL)) {
+    free_wall_crossing_list(&wcl);
+    return 1;
   }
+  for (int k = 0; k < wcl.n_crossings; k++)
+    cross_counted_wall(wcl.crossings[k].w, wcl.crossings[k].sign, &rl, &arl,
+                       rmem);
 
+  free_wall_crossing_list(&wcl);
   *rlp = rl;
   *arlp = arl;
 
@@ -1184,6 +1196,10 @@ place_waypoints:
    Out: Returns 1 if malloc fails, 0 otherwise.
         Allocates waypoints to SSVs, if any are needed.
    Note: you must have initialized SSVs before calling this routine!
+         Unlike the subvolume records, waypoints are kept for every
+         subvolume: each one's regions are found from its neighbor's.
+         Placing them on demand would reorder the random numbers drawn
+         to move waypoints off walls, so results would change.
 *************************************************************************/
 int place_waypoints(struct volume *world) {
   int waypoint_in_wall = 0;
@@ -1213,7 +1229,13 @@ int place_waypoints(struct volume *world) {
             pz + (world->nz_parts - 1) * (py + (world->ny_parts - 1) * px);
         struct waypoint *wp = &(world->waypoints[this_sv]);
 
-        struct subvolume *sv = &(world->subvol[this_sv]);
+        /* Empty subvolumes have no walls, so a scratch record will do */
+        struct subvolume *sv = world->subvol[this_sv];
+        struct subvolume empty_sv;
+        if (sv == &world->empty_subvol) {
+          init_subvolume(world, &empty_sv, this_sv);
+          sv = &empty_sv;
+        }
 
         /* Place waypoint near center of subvolume (W_#a=W_#b=0.5 gives center)
          */
@@ -1242,36 +1264,18 @@ int place_waypoints(struct volume *world) {
           }
         } while (waypoint_in_wall);
 
-        if (pz > 0) {
-          if (world->waypoints[this_sv - 1].regions != NULL) {
-            wp->regions = dup_region_list(world->waypoints[this_sv - 1].regions,
-                                          sv->local_storage->regl);
-            if (wp->regions == NULL)
-              return 1;
-          } else
-            wp->regions = NULL;
-
-          if (world->waypoints[this_sv - 1].antiregions != NULL) {
-            wp->antiregions =
-                dup_region_list(world->waypoints[this_sv - 1].antiregions,
-                                sv->local_storage->regl);
-            if (wp->antiregions == NULL)
-              return 1;
-          } else
-            wp->antiregions = NULL;
-
-          if (find_enclosing_regions(
-                  world, &(wp->loc), &(world->waypoints[this_sv - 1].loc),
-                  &(wp->regions), &(wp->antiregions), sv->local_storage->regl))
-            return 1;
-        } else {
-          wp->regions = NULL;
-          wp->antiregions = NULL;
-          if (find_enclosing_regions(world, &(wp->loc), NULL, &(wp->regions),
-                                     &(wp->antiregions),
-                                     sv->local_storage->regl))
-            return 1;
-        }
+        int found = -1;
+        if (pz > 0)
+          found = follow_enclosing_regions(
+              world, &(wp->loc), &(world->waypoints[this_sv - 1]),
+              world->subvol[this_sv - 1], sv, &(wp->regions),
+              &(wp->antiregions), sv->local_storage->regl);
+        if (found == -1)
+          found = find_enclosing_regions(world, &(wp->loc), &(wp->regions),
+                                         &(wp->antiregions),
+                                         sv->local_storage->regl);
+        if (found)
+          return 1;
       }
     }
   }
@@ -2053,7 +2057,7 @@ void count_region_list(
         else if ((c->orientation == ORIENT_NOT_SET) ||
                  (c->orientation == sm->orient) || (c->orientation == 0)) {
           if ((inc == 1) && (periodic_boxes_are_identical(
-              sm->periodic_box, c->periodic_box))) {
+              &sm->periodic_box, c->periodic_box))) {
             c->data.move.n_at++;
           }
           else if ((inc == -1) && (previous_box != NULL) &&
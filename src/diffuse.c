@@ -27,6 +27,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "diffuse.h"
 #include "logging.h"
@@ -36,12 +37,14 @@
 #include "vol_util.h"
 #include "wall_util.h"
 #include "react.h"
+#include "well_mixed.h"
+#include "phase_timing.h"
+#include "volume_output.h"
 
 
 #define FREE_COLLISION_LISTS()                                                 \
   do {                                                                         \
-    if (shead2 != NULL)                                                        \
-      mem_put_list(sv->local_storage->coll, shead2);                           \
+    collision_buffer_clear(&hits);                                             \
     if (shead != NULL)                                                         \
       mem_put_list(sv->local_storage->coll, shead);                            \
   } while (0)
@@ -61,6 +64,7 @@ int move_sm_on_same_triangle(
 
 static void redo_collision_list(struct volume* world, struct collision** shead,
   struct collision** stail, struct collision** shead_exp,
+  struct vector3* exp_llf, struct vector3* exp_urb,
   struct volume_molecule* m, struct vector3* displacement, struct subvolume* sv);
 
 static int collide_and_react_with_vol_mol(
@@ -377,10 +381,7 @@ struct vector3* reflect_periodic_2D(
   struct vector3 updated_xyz = *origin_xyz;
   // Go through all the subvolumes between where we are to where we want to be
   for (struct subvolume *sv = find_subvolume(state, origin_xyz, NULL);
-       sv != NULL; sv = next_subvol(
-          &updated_xyz, &delta_xyz, sv, state->x_fineparts, state->y_fineparts,
-          state->z_fineparts, state->ny_parts,
-          state->nz_parts)) {
+       sv != NULL; sv = next_subvol(state, &updated_xyz, &delta_xyz, sv)) {
 
     // Check all the walls in this subvolume
     for (struct wall_list *wl = sv->wall_head; wl != NULL; wl = wl->next) {
@@ -447,9 +448,9 @@ void change_boxes_2D(
   double llz = sb->z[0];
   double urz = sb->z[1];
 
-  int x_inc = (sm->periodic_box->x % 2 == 0) ? 1 : -1;
-  int y_inc = (sm->periodic_box->y % 2 == 0) ? 1 : -1;
-  int z_inc = (sm->periodic_box->z % 2 == 0) ? 1 : -1;
+  int x_inc = (sm->periodic_box.x % 2 == 0) ? 1 : -1;
+  int y_inc = (sm->periodic_box.y % 2 == 0) ? 1 : -1;
+  int z_inc = (sm->periodic_box.z % 2 == 0) ? 1 : -1;
   int box_inc_x = 0;
   int box_inc_y = 0;
   int box_inc_z = 0;
@@ -494,9 +495,9 @@ void change_boxes_2D(
   }
 
   if (!(periodic_traditional) && (box_inc_x || box_inc_y || box_inc_z)) {
-    sm->periodic_box->x += box_inc_x;
-    sm->periodic_box->y += box_inc_y;
-    sm->periodic_box->z += box_inc_z;
+    sm->periodic_box.x += box_inc_x;
+    sm->periodic_box.y += box_inc_y;
+    sm->periodic_box.z += box_inc_z;
   }
 }
 
@@ -721,9 +722,9 @@ struct wall *ray_trace_2D(
   struct vector2 this_disp = { .u = disp->u,
                                .v = disp->v
                              };
-  struct periodic_image orig_box = { .x = sm->periodic_box->x,
-                                     .y = sm->periodic_box->y,
-                                     .z = sm->periodic_box->z
+  struct periodic_image orig_box = { .x = sm->periodic_box.x,
+                                     .y = sm->periodic_box.y,
+                                     .z = sm->periodic_box.z
                                    };
   struct vector3 origin_xyz;
   uv2xyz(&this_pos, this_wall, &origin_xyz);
@@ -782,7 +783,7 @@ struct wall *ray_trace_2D(
           struct wall *prev_wall = this_wall;
           // this_pos is also being updated here.
           this_wall = find_closest_wall(
-            world, &teleport_xyz, 0.0, &this_pos, grid_index_p, sm->properties, NULL, NULL, NULL);
+            world, &teleport_xyz, 0.0, &this_pos, grid_index_p, sm->properties, 0, NULL, NULL);
           // Try again if we can't find a place
           if ((this_wall == NULL) ||
               (this_wall->parent_object != prev_wall->parent_object) ) {
@@ -809,9 +810,9 @@ struct wall *ray_trace_2D(
     if (index_edge_was_hit == -2) {
       sm->s_pos.u = orig_pos.u;
       sm->s_pos.v = orig_pos.v;
-      sm->periodic_box->x = orig_box.x;
-      sm->periodic_box->y = orig_box.y;
-      sm->periodic_box->z = orig_box.z;
+      sm->periodic_box.x = orig_box.x;
+      sm->periodic_box.y = orig_box.y;
+      sm->periodic_box.z = orig_box.z;
       *hit_data_info = hit_data_head;
       return NULL;
     }
@@ -948,6 +949,58 @@ struct wall *ray_trace_2D(
   return NULL;
 }
 
+/*************************************************************************
+collision_buffer_get:
+  In: collision buffer
+  Out: an unlinked collision belonging to the buffer.  The caller fills it
+       in and hands it to collision_buffer_insert right away.
+*************************************************************************/
+static struct collision *collision_buffer_get(struct collision_buffer *cb) {
+  if (cb->n_coll++ < COLLISION_BUFFER_INLINE)
+    return &cb->inline_coll[cb->n_coll - 1];
+  return (struct collision *)CHECKED_MEM_GET(cb->spill, "collision structure");
+}
+
+/*************************************************************************
+collision_buffer_insert:
+  In: collision buffer
+      collision from collision_buffer_get, with its time set
+  Out: No return value.  Inline collisions are inserted in time order.
+       Once the buffer has spilled, collisions are pushed on the front
+       and the caller sorts the list once it is complete.
+*************************************************************************/
+static void collision_buffer_insert(struct collision_buffer *cb,
+                                    struct collision *c) {
+  if (cb->n_coll <= COLLISION_BUFFER_INLINE) {
+    ae_list_insert_sorted((struct abstract_element **)&cb->head,
+                          (struct abstract_element *)c);
+  } else {
+    c->next = cb->head;
+    cb->head = c;
+  }
+}
+
+/*************************************************************************
+collision_buffer_clear:
+  In: collision buffer filled by ray_trace
+  Out: No return value.  Collisions taken from the spill pool are returned
+       to it and the buffer is empty.
+*************************************************************************/
+void collision_buffer_clear(struct collision_buffer *cb) {
+  if (cb->n_coll > COLLISION_BUFFER_INLINE) {
+    struct collision *first = &cb->inline_coll[0];
+    struct collision *last = &cb->inline_coll[COLLISION_BUFFER_INLINE];
+    struct collision *next;
+    for (struct collision *c = cb->head; c != NULL; c = next) {
+      next = c->next;
+      if (c < first || c >= last)
+        mem_put(cb->spill, c);
+    }
+  }
+  cb->head = NULL;
+  cb->n_coll = 0;
+}
+
 /*************************************************************************
 ray_trace:
   In: world: simulation state
@@ -956,23 +1009,29 @@ ray_trace:
       sv: subvolume that we start in
       v: displacement vector from current to new location
       reflectee: wall we have reflected off of and should not hit again
+      hits: buffer to store the collisions in
   Out: collision list of walls and molecules we intersected along our ray
-       (current subvolume only), plus the subvolume wall.  Will always
-       return at least the subvolume wall--NULL indicates an out of
-       memory error.
+       (current subvolume only), plus the subvolume wall, sorted by time.
+       Will always return at least the subvolume wall.  The list belongs
+       to hits; release it with collision_buffer_clear.
 *************************************************************************/
 struct collision *ray_trace(struct volume *world, struct vector3 *init_pos,
                             struct collision *c, struct subvolume *sv,
-                            struct vector3 *v, struct wall *reflectee) {
+                            struct vector3 *v, struct wall *reflectee,
+                            struct collision_buffer *hits) {
   /* time, in units of of the molecule's time step, at which molecule
      will cross the x,y,z partitions, respectively. */
   double tx, ty, tz;
 
   world->ray_voxel_tests++;
 
-  struct collision *shead = NULL;
-  struct collision *smash = (struct collision *)CHECKED_MEM_GET(
-      sv->local_storage->coll, "collision structure");
+  hits->head = NULL;
+  hits->spill = sv->local_storage->coll;
+  hits->n_coll = 0;
+
+  struct collision *smash;
+  double t_hit;
+  struct vector3 loc_hit;
 
   struct wall_list fake_wlp;
   fake_wlp.next = sv->wall_head;
@@ -982,26 +1041,27 @@ struct collision *ray_trace(struct volume *world, struct vector3 *init_pos,
     if (wlp->this_wall == reflectee)
       continue;
 
-    int i = collide_wall(init_pos, v, wlp->this_wall, &(smash->t), &(smash->loc),
+    int i = collide_wall(init_pos, v, wlp->this_wall, &t_hit, &loc_hit,
                      1, world->rng, world->notify, &(world->ray_polygon_tests));
+    COUNT_SUBVOL_LOAD(world, sv, wall_collisions, 1);
     if (i == COLLIDE_REDO) {
-      if (shead != NULL)
-        mem_put_list(sv->local_storage->coll, shead);
-      shead = NULL;
+      collision_buffer_clear(hits);
       wlp = &fake_wlp;
       continue;
     } else if (i != COLLIDE_MISS) {
       world->ray_polygon_colls++;
 
+      smash = collision_buffer_get(hits);
+      smash->t = t_hit;
+      smash->loc = loc_hit;
       smash->what = COLLIDE_WALL + i;
       smash->target = (void *)wlp->this_wall;
-      smash->next = shead;
-      shead = smash;
-      smash = (struct collision *)CHECKED_MEM_GET(sv->local_storage->coll,
-                                                  "collision structure");
+      collision_buffer_insert(hits, smash);
     }
   }
 
+  smash = collision_buffer_get(hits);
+
   double dx, dy, dz;
   dx = dy = dz = 0.0;
   int i = -10;
@@ -1117,8 +1177,7 @@ struct collision *ray_trace(struct volume *world, struct vector3 *init_pos,
   smash->loc.z = init_pos->z + smash->t * v->z;
 
   smash->target = sv;
-  smash->next = shead;
-  shead = smash;
+  collision_buffer_insert(hits, smash);
 
   // Check molecule collisions
   for (; c != NULL; c = c->next) {
@@ -1128,18 +1187,19 @@ struct collision *ray_trace(struct volume *world, struct vector3 *init_pos,
 
     i = collide_mol(init_pos, v, a, &(c->t), &(c->loc), world->rx_radius_3d);
     if (i != COLLIDE_MISS) {
-      smash = (struct collision *)CHECKED_MEM_GET(sv->local_storage->coll,
-                                                  "collision structure");
+      smash = collision_buffer_get(hits);
       memcpy(smash, c, sizeof(struct collision));
 
       smash->what = COLLIDE_VOL + i;
-
-      smash->next = shead;
-      shead = smash;
+      collision_buffer_insert(hits, smash);
     }
   }
 
-  return shead;
+  if (hits->n_coll > COLLISION_BUFFER_INLINE) {
+    hits->head = (struct collision *)ae_list_sort(
+        (struct abstract_element *)hits->head);
+  }
+  return hits->head;
 }
 
 /******************************/
@@ -1303,6 +1363,411 @@ enum {
 /* Note: TARGET_OCCLUDED is assumed for any negative number not defined here */
 #define TARGET_OCCLUDED -1
 
+/* Results of the per-wall test in 'exact_disk()' */
+enum {
+  EXD_WALL_MISS,  /* Wall doesn't cut the disk */
+  EXD_WALL_EDGE,  /* Wall cuts the disk along an edge */
+  EXD_WALL_BLOCKS /* Wall blocks the target, or we can't tell */
+};
+
+/* Coordinate system of one interaction disk */
+struct exd_frame {
+  struct vector3 *loc;     /* Location of moving molecule at collision */
+  struct vector3 *mv;      /* Movement vector of moving molecule */
+  double R2;               /* Square of the interaction radius */
+  double m2_i;             /* 1/|mv|^2 */
+  struct vector3 m, u, v;  /* Disk normal and in-plane basis vectors */
+  struct exd_vector3 Lmuv; /* loc in m,u,v coordinates */
+  struct exd_vertex sm;    /* Target, relative to loc, in u,v coordinates */
+};
+
+/* Exact disk cache: direct-mapped table keyed by subvolume, species and the
+ * quantized location and direction of the collision */
+#define EXD_CACHE_SIZE 32768 /* Number of entries, must be a power of 2 */
+
+struct exd_cache_entry {
+  struct subvolume *sv; /* Subvolume of the collision, NULL if unused */
+  struct species *spec; /* Species of the moving molecule */
+  long long key[6];     /* Quantized location and direction */
+  double factor;        /* Accessible fraction of the disk */
+  int n_walls;          /* Walls that cut the disk */
+};
+
+struct exd_cache {
+  double R;         /* Interaction radius the entries were computed for */
+  double r_quantum; /* Reciprocal of the location quantum */
+  double r_angle;   /* Reciprocal of the direction quantum */
+  struct exd_cache_entry *entries;
+};
+
+/*************************************************************************
+exd_wall_edge:
+  In: world: simulation state
+      fr: coordinate system of the interaction disk
+      moving: the moving molecule
+      w: the wall to test
+      ppa: place to store the first endpoint of the edge
+      ppb: place to store the second endpoint of the edge
+  Out: EXD_WALL_MISS if the wall doesn't occlude the disk, EXD_WALL_EDGE
+       if it does (ppa and ppb are set, ppa earlier ccw than ppb), or
+       EXD_WALL_BLOCKS if it lies between the moving molecule and the
+       target or we can't tell which side of the wall we're on.
+  Note: This is a utility function for 'exact_disk()'.  Only u, v, r2 and
+        zeta are set in the endpoints.
+*************************************************************************/
+static int exd_wall_edge(struct volume *world, struct exd_frame *fr,
+                         struct volume_molecule *moving, struct wall *w,
+                         struct exd_vertex *ppa, struct exd_vertex *ppb) {
+  struct vector3 *loc = fr->loc;
+  struct vector3 *mv = fr->mv;
+  struct vector3 *m = &fr->m, *u = &fr->u, *v = &fr->v;
+  struct exd_vector3 *Lmuv = &fr->Lmuv;
+  struct exd_vertex *sm = &fr->sm;
+  double R2 = fr->R2;
+  double m2_i = fr->m2_i;
+
+  struct vector3 llf, urb;
+  struct exd_vector3 v0muv, v1muv, v2muv;
+  struct exd_vertex pa, pb, tmp;
+  double pa_pb;
+  double l_n, m_n;
+  double a, b, c, d, s, t;
+  int i;
+  int num_matching_rxns = 0;
+  struct rxn *matching_rxns[MAX_MATCHING_RXNS];
+
+  /* Ignore this wall if it is too far away! */
+
+  /* Find distance from plane of wall to molecule */
+  l_n = loc->x * w->normal.x + loc->y * w->normal.y + loc->z * w->normal.z;
+  d = w->d - l_n;
+
+  /* See if we're within interaction distance of wall */
+  m_n = mv->x * w->normal.x + mv->y * w->normal.y + mv->z * w->normal.z;
+
+  if (d * d >= R2 * (1 - m2_i * m_n * m_n))
+    return EXD_WALL_MISS;
+
+  /* Ignore this wall if no overlap between wall & disk bounding boxes */
+
+  /* Find wall bounding box */
+  urb.x = llf.x = w->vert[0]->x;
+  if (w->vert[1]->x < llf.x)
+    llf.x = w->vert[1]->x;
+  else
+    urb.x = w->vert[1]->x;
+  if (w->vert[2]->x < llf.x)
+    llf.x = w->vert[2]->x;
+  else if (w->vert[2]->x > urb.x)
+    urb.x = w->vert[2]->x;
+
+  urb.y = llf.y = w->vert[0]->y;
+  if (w->vert[1]->y < llf.y)
+    llf.y = w->vert[1]->y;
+  else
+    urb.y = w->vert[1]->y;
+  if (w->vert[2]->y < llf.y)
+    llf.y = w->vert[2]->y;
+  else if (w->vert[2]->y > urb.y)
+    urb.y = w->vert[2]->y;
+
+  urb.z = llf.z = w->vert[0]->z;
+  if (w->vert[1]->z < llf.z)
+    llf.z = w->vert[1]->z;
+  else
+    urb.z = w->vert[1]->z;
+  if (w->vert[2]->z < llf.z)
+    llf.z = w->vert[2]->z;
+  else if (w->vert[2]->z > urb.z)
+    urb.z = w->vert[2]->z;
+
+  /* Reject those without overlapping bounding boxes */
+  b = R2 * (1.0 - mv->x * mv->x * m2_i);
+  a = llf.x - loc->x;
+  if (a > 0 && a * a >= b)
+    return EXD_WALL_MISS;
+  a = loc->x - urb.x;
+  if (a > 0 && a * a >= b)
+    return EXD_WALL_MISS;
+
+  b = R2 * (1.0 - mv->y * mv->y * m2_i);
+  a = llf.y - loc->y;
+  if (a > 0 && a * a >= b)
+    return EXD_WALL_MISS;
+  a = loc->y - urb.y;
+  if (a > 0 && a * a >= b)
+    return EXD_WALL_MISS;
+
+  b = R2 * (1.0 - mv->z * mv->z * m2_i);
+  a = llf.z - loc->z;
+  if (a > 0 && a * a >= b)
+    return EXD_WALL_MISS;
+  a = loc->z - urb.z;
+  if (a > 0 && a * a >= b)
+    return EXD_WALL_MISS;
+
+  /* Ignore this wall if moving molecule can travel through it */
+
+  /* Reject those that the moving particle can travel through */
+  if ((moving->properties->flags & CAN_VOLWALL) != 0) {
+    num_matching_rxns = trigger_intersect(
+        world->reaction_hash, world->rx_hashsize, world->all_mols,
+        world->all_volume_mols, world->all_surface_mols,
+        moving->properties->hashval, (struct abstract_molecule *)moving, 0, w,
+        matching_rxns, 1, 1, 0);
+    if (num_matching_rxns == 0)
+      return EXD_WALL_MISS;
+    int blocked = 0;
+    for (i = 0; i < num_matching_rxns; i++) {
+      if (matching_rxns[i]->n_pathways == RX_REFLEC) {
+        blocked = 1;
+      }
+    }
+    if (!blocked) {
+      return EXD_WALL_MISS;
+    }
+  }
+
+  /* Find line of intersection between wall and disk */
+  v0muv.m = w->vert[0]->x * m->x + w->vert[0]->y * m->y + w->vert[0]->z * m->z -
+            Lmuv->m;
+  v0muv.u = w->vert[0]->x * u->x + w->vert[0]->y * u->y + w->vert[0]->z * u->z -
+            Lmuv->u;
+  v0muv.v = w->vert[0]->x * v->x + w->vert[0]->y * v->y + w->vert[0]->z * v->z -
+            Lmuv->v;
+
+  v1muv.m = w->vert[1]->x * m->x + w->vert[1]->y * m->y + w->vert[1]->z * m->z -
+            Lmuv->m;
+  v1muv.u = w->vert[1]->x * u->x + w->vert[1]->y * u->y + w->vert[1]->z * u->z -
+            Lmuv->u;
+  v1muv.v = w->vert[1]->x * v->x + w->vert[1]->y * v->y + w->vert[1]->z * v->z -
+            Lmuv->v;
+
+  v2muv.m = w->vert[2]->x * m->x + w->vert[2]->y * m->y + w->vert[2]->z * m->z -
+            Lmuv->m;
+  v2muv.u = w->vert[2]->x * u->x + w->vert[2]->y * u->y + w->vert[2]->z * u->z -
+            Lmuv->u;
+  v2muv.v = w->vert[2]->x * v->x + w->vert[2]->y * v->y + w->vert[2]->z * v->z -
+            Lmuv->v;
+
+  /* Draw lines between points and pick intersections with plane of m=0 */
+  if ((v0muv.m < 0) == (v1muv.m < 0)) /* v0,v1 on same side */
+  {
+    if ((v2muv.m < 0) == (v1muv.m < 0))
+      return EXD_WALL_MISS;
+    t = v0muv.m / (v0muv.m - v2muv.m);
+    pa.u = v0muv.u + (v2muv.u - v0muv.u) * t;
+    pa.v = v0muv.v + (v2muv.v - v0muv.v) * t;
+    t = v1muv.m / (v1muv.m - v2muv.m);
+    pb.u = v1muv.u + (v2muv.u - v1muv.u) * t;
+    pb.v = v1muv.v + (v2muv.v - v1muv.v) * t;
+  } else if ((v0muv.m < 0) == (v2muv.m < 0)) /* v0,v2 on same side */
+  {
+    t = v0muv.m / (v0muv.m - v1muv.m);
+    pa.u = v0muv.u + (v1muv.u - v0muv.u) * t;
+    pa.v = v0muv.v + (v1muv.v - v0muv.v) * t;
+    t = v2muv.m / (v2muv.m - v1muv.m);
+    pb.u = v2muv.u + (v1muv.u - v2muv.u) * t;
+    pb.v = v2muv.v + (v1muv.v - v2muv.v) * t;
+  } else /* v1, v2 on same side */
+  {
+    t = v1muv.m / (v1muv.m - v0muv.m);
+    pa.u = v1muv.u + (v0muv.u - v1muv.u) * t;
+    pa.v = v1muv.v + (v0muv.v - v1muv.v) * t;
+    t = v2muv.m / (v2muv.m - v0muv.m);
+    pb.u = v2muv.u + (v0muv.u - v2muv.u) * t;
+    pb.v = v2muv.v + (v0muv.v - v2muv.v) * t;
+  }
+
+  /* Check to make sure endpoints are sensible */
+  pa.r2 = pa.u * pa.u + pa.v * pa.v;
+  pb.r2 = pb.u * pb.u + pb.v * pb.v;
+  if (pa.r2 < EPS_C * R2 ||
+      pb.r2 < EPS_C * R2) /* Can't tell where origin is relative to wall
+                             endpoints */
+  {
+    return EXD_WALL_BLOCKS;
+  }
+  if (!distinguishable(pa.u * pb.v, pb.u * pa.v, EPS_C) &&
+      pa.u * pb.u + pa.v * pb.v <
+          0) /* Antiparallel, can't tell which side of wall origin is on */
+  {
+    return EXD_WALL_BLOCKS;
+  }
+
+  /* Intersect line with circle; skip this wall if no intersection */
+  t = 0;
+  s = 1;
+  if (pa.r2 > R2 || pb.r2 > R2) {
+    pa_pb = pa.u * pb.u + pa.v * pb.v;
+    if (!distinguishable(pa.r2 + pb.r2, 2 * pa_pb,
+                         EPS_C)) /* Wall endpoints are basically on top of
+                                    each other */
+    {
+      /* Might this tiny bit of wall block the target?  If not, continue,
+       * otherwise return TARGET_OCCLUDED */
+      /* Safe if we're clearly closer; in danger if we're even remotely
+       * parallel, otherwise surely safe */
+      /* Note: use SQRT_EPS_C for cross products since previous test vs. EPS_C
+       * was on squared values (linear difference term cancels) */
+      if (sm->r2 < pa.r2 && sm->r2 < pb.r2 &&
+          distinguishable(sm->r2, pa.r2, EPS_C) &&
+          distinguishable(sm->r2, pa.r2, EPS_C))
+        return EXD_WALL_MISS;
+      if (!distinguishable(sm->u * pa.v, sm->v * pa.u, SQRT_EPS_C) ||
+          !distinguishable(sm->u * pb.v, sm->v * pb.u, SQRT_EPS_C)) {
+        return EXD_WALL_BLOCKS;
+      }
+      return EXD_WALL_MISS;
+    }
+    a = 1.0 / (pa.r2 + pb.r2 - 2 * pa_pb);
+    b = (pa_pb - pa.r2) * a;
+    c = (R2 - pa.r2) * a;
+    d = b * b + c;
+    if (d <= 0)
+      return EXD_WALL_MISS;
+    d = sqrt(d);
+    t = -b - d;
+    if (t >= 1)
+      return EXD_WALL_MISS;
+    if (t < 0)
+      t = 0;
+    s = -b + d;
+    if (s <= 0)
+      return EXD_WALL_MISS;
+    if (s > 1)
+      s = 1;
+  }
+
+  /* Construct final endpoints */
+  if (t > 0) {
+    ppa->u = pa.u + t * (pb.u - pa.u);
+    ppa->v = pa.v + t * (pb.v - pa.v);
+    ppa->r2 = ppa->u * ppa->u + ppa->v * ppa->v;
+    ppa->zeta = exd_zetize(ppa->v, ppa->u);
+  } else {
+    ppa->u = pa.u;
+    ppa->v = pa.v;
+    ppa->r2 = pa.r2;
+    ppa->zeta = exd_zetize(pa.v, pa.u);
+  }
+  if (s < 1) {
+    ppb->u = pa.u + s * (pb.u - pa.u);
+    ppb->v = pa.v + s * (pb.v - pa.v);
+    ppb->r2 = ppb->u * ppb->u + ppb->v * ppb->v;
+    ppb->zeta = exd_zetize(ppb->v, ppb->u);
+  } else {
+    ppb->u = pb.u;
+    ppb->v = pb.v;
+    ppb->r2 = pb.r2;
+    ppb->zeta = exd_zetize(pb.v, pb.u);
+  }
+
+  /* It's convenient if ppa is earlier, ccw, than ppb */
+  a = (ppb->zeta - ppa->zeta);
+  if (a < 0)
+    a += 4.0;
+  if (a >= 2.0) {
+    tmp = *ppb;
+    *ppb = *ppa;
+    *ppa = tmp;
+    a = 4.0 - a;
+  }
+
+  /* Detect a blocked reaction: line is between origin and target */
+  b = (sm->zeta - ppa->zeta);
+  if (b < 0)
+    b += 4.0;
+
+  if (b < a) {
+    c = (ppa->u - sm->u) * (ppb->v - sm->v) - (ppa->v - sm->v) * (ppb->u - sm->u);
+    if (c < 0 || !distinguishable((ppa->u - sm->u) * (ppb->v - sm->v),
+                                  (ppa->v - sm->v) * (ppb->u - sm->u),
+                                  EPS_C)) /* Blocked! */
+    {
+      return EXD_WALL_BLOCKS;
+    }
+  }
+
+  return EXD_WALL_EDGE;
+}
+
+/*************************************************************************
+exd_cache_slot:
+  In: cache: the exact disk cache
+      fr: coordinate system of the interaction disk
+      sv: subvolume the moving molecule is in
+      spec: species of the moving molecule
+      key: place to store the quantized location and direction
+  Out: The cache entry the disk maps to.  It holds this disk only if its
+       subvolume, species and key all match.
+*************************************************************************/
+static struct exd_cache_entry *exd_cache_slot(struct exd_cache *cache,
+                                              struct exd_frame *fr,
+                                              struct subvolume *sv,
+                                              struct species *spec,
+                                              long long *key) {
+  unsigned long long h;
+  int i;
+
+  key[0] = (long long)floor(fr->loc->x * cache->r_quantum);
+  key[1] = (long long)floor(fr->loc->y * cache->r_quantum);
+  key[2] = (long long)floor(fr->loc->z * cache->r_quantum);
+  key[3] = (long long)floor(fr->m.x * cache->r_angle);
+  key[4] = (long long)floor(fr->m.y * cache->r_angle);
+  key[5] = (long long)floor(fr->m.z * cache->r_angle);
+
+  h = (unsigned long long)(intptr_t)sv * 0x9E3779B97F4A7C15ULL;
+  h ^= (unsigned long long)(intptr_t)spec;
+  for (i = 0; i < 6; i++)
+    h = (h ^ (unsigned long long)key[i]) * 0x100000001B3ULL;
+  h ^= h >> 29;
+
+  return &cache->entries[h & (EXD_CACHE_SIZE - 1)];
+}
+
+/*************************************************************************
+create_exd_cache:
+  In: R: interaction radius
+      tolerance: size of the location and direction quanta, as a fraction
+                 of the interaction radius
+  Out: A new, empty exact disk cache.
+*************************************************************************/
+static struct exd_cache *create_exd_cache(double R, double tolerance) {
+  struct exd_cache *cache;
+  int i;
+
+  cache = CHECKED_MALLOC_STRUCT(struct exd_cache, "exact disk cache");
+  cache->R = R;
+  cache->r_quantum = 1.0 / (tolerance * R);
+  cache->r_angle = 1.0 / tolerance;
+  cache->entries = CHECKED_MALLOC_ARRAY(
+      struct exd_cache_entry, EXD_CACHE_SIZE, "exact disk cache entries");
+  for (i = 0; i < EXD_CACHE_SIZE; i++)
+    cache->entries[i].sv = NULL;
+  return cache;
+}
+
+/*************************************************************************
+delete_exd_cache:
+  In: cache: exact disk cache to free, or NULL
+  Out: No return value.  The cache holds wall and subvolume pointers, so it
+       must be deleted whenever the geometry changes.
+*************************************************************************/
+void delete_exd_cache(struct exd_cache *cache) {
+  if (cache == NULL)
+    return;
+  free(cache->entries);
+  free(cache);
+}
+
+static double exd_disk_area(struct volume *world, struct exd_frame *fr,
+                            double R, struct subvolume *sv,
+                            struct volume_molecule *moving,
+                            int use_expanded_list, double *x_fineparts,
+                            double *y_fineparts, double *z_fineparts,
+                            int *n_cut_walls);
+
 /*************************************************************************
 exact_disk:
   In: world: simulation state
@@ -1320,6 +1785,11 @@ exact_disk:
        accessible to the moving molecule, computed exactly from the
        geometry, or TARGET_OCCLUDED if the path to the target molecule is
        blocked.
+  Note: If world->exd_cache_tolerance is set, the accessible fraction is
+        looked up by quantized location and direction.  Every wall in the
+        subvolume is still tested on each call, so the target is never
+        reported reachable through a wall, and the fraction is recomputed
+        if a different number of walls cuts this disk.
 *************************************************************************/
 double exact_disk(struct volume *world, struct vector3 *loc, struct vector3 *mv,
                   double R, struct subvolume *sv,
@@ -1327,361 +1797,151 @@ double exact_disk(struct volume *world, struct vector3 *loc, struct vector3 *mv,
                   struct volume_molecule *target, int use_expanded_list,
                   double *x_fineparts, double *y_fineparts,
                   double *z_fineparts) {
+  struct exd_frame fr;
+  struct exd_vertex pa, pb;
+  struct exd_cache_entry *ce = NULL;
+  struct wall_list *wl;
+  int n_cut_walls = 0;
+  long long key[6];
+  double factor;
+
+  /* Partially set up coordinate systems for first pass */
+  fr.loc = loc;
+  fr.mv = mv;
+  fr.R2 = R * R;
+  fr.m2_i = 1.0 / (mv->x * mv->x + mv->y * mv->y + mv->z * mv->z);
+
+  /* Set up coordinate system and convert vertices */
+  exd_coordize(mv, &fr.m, &fr.u, &fr.v);
+
+  fr.Lmuv.m = loc->x * fr.m.x + loc->y * fr.m.y + loc->z * fr.m.z;
+  fr.Lmuv.u = loc->x * fr.u.x + loc->y * fr.u.y + loc->z * fr.u.z;
+  fr.Lmuv.v = loc->x * fr.v.x + loc->y * fr.v.y + loc->z * fr.v.z;
+
+  if (!distinguishable_vec3(loc, &(target->pos), EPS_C)) { /* Hit target exactly! */
+    fr.sm.u = fr.sm.v = fr.sm.r2 = fr.sm.zeta = 0.0;
+  } else { /* Find location of target in moving-molecule-centric coords */
+    fr.sm.u = (target->pos.x - loc->x) * fr.u.x +
+              (target->pos.y - loc->y) * fr.u.y +
+              (target->pos.z - loc->z) * fr.u.z;
+    fr.sm.v = (target->pos.x - loc->x) * fr.v.x +
+              (target->pos.y - loc->y) * fr.v.y +
+              (target->pos.z - loc->z) * fr.v.z;
+    fr.sm.r2 = fr.sm.u * fr.sm.u + fr.sm.v * fr.sm.v;
+    fr.sm.zeta = exd_zetize(fr.sm.v, fr.sm.u);
+  }
+
+  if (world->exd_cache_tolerance > 0) {
+    if (world->exd_cache == NULL)
+      world->exd_cache = create_exd_cache(R, world->exd_cache_tolerance);
+    if (world->exd_cache->R == R) {
+      ce = exd_cache_slot(world->exd_cache, &fr, sv, moving->properties, key);
+      if (ce->sv == sv && ce->spec == moving->properties &&
+          memcmp(ce->key, key, sizeof(key)) == 0) {
+        /* Close to the cached disk, but walls may cut only this one and
+           the target may be elsewhere */
+        for (wl = sv->wall_head; wl != NULL; wl = wl->next) {
+          switch (exd_wall_edge(world, &fr, moving, wl->this_wall, &pa, &pb)) {
+          case EXD_WALL_MISS:
+            break;
+          case EXD_WALL_BLOCKS:
+            return TARGET_OCCLUDED;
+          default:
+            n_cut_walls++;
+            break;
+          }
+        }
+        if (n_cut_walls == ce->n_walls)
+          return ce->factor;
+      }
+    }
+  }
+
+  factor = exd_disk_area(world, &fr, R, sv, moving, use_expanded_list,
+                         x_fineparts, y_fineparts, z_fineparts,
+                         &n_cut_walls);
+
+  if (ce != NULL && factor >= 0) {
+    ce->sv = sv;
+    ce->spec = moving->properties;
+    memcpy(ce->key, key, sizeof(key));
+    ce->factor = factor;
+    ce->n_walls = n_cut_walls;
+  }
+  return factor;
+}
+
+/*************************************************************************
+exd_disk_area:
+  In: world: simulation state
+      fr: coordinate system of the interaction disk
+      R: interaction radius
+      sv:  subvolume the moving molecule is in
+      moving: the moving molecule
+      use_expanded_list:
+      x_fineparts:
+      y_fineparts:
+      z_fineparts:
+      n_cut_walls: place to store the number of walls that cut the disk
+  Out: The fraction of a full interaction disk that is accessible to the
+       moving molecule, or TARGET_OCCLUDED if the path to the target
+       molecule is blocked.
+  Note: This is the computation behind 'exact_disk()'.
+*************************************************************************/
+static double exd_disk_area(struct volume *world, struct exd_frame *fr,
+                            double R, struct subvolume *sv,
+                            struct volume_molecule *moving,
+                            int use_expanded_list, double *x_fineparts,
+                            double *y_fineparts, double *z_fineparts,
+                            int *n_cut_walls) {
 #define EXD_SPAN_CALC(v1, v2, p)                                               \
   ((v1)->u - (p)->u) * ((v2)->v - (p)->v) -                                    \
       ((v2)->u - (p)->u) * ((v1)->v - (p)->v)
 #define EXD_TIME_CALC(v1, v2, p)                                               \
   ((p)->u *(v1)->v - (p)->v *(v1)->u) /                                        \
       ((p)->v *((v2)->u - (v1)->u) - (p)->u *((v2)->v - (v1)->v))
+  struct vector3 *loc = fr->loc;
+  struct vector3 *mv = fr->mv;
+  struct vector3 u = fr->u, v = fr->v;
   struct wall_list *wl;
-  struct wall *w;
-  struct vector3 llf, urb;
 
-  struct exd_vector3 v0muv, v1muv, v2muv;
   struct exd_vertex pa, pb;
   struct exd_vertex *ppa, *ppb, *pqa, *pqb, *vertex_head, *vp, *vq, *vr, *vs;
-  double pa_pb;
   int n_verts, n_edges;
   int p_flags;
 
-  double R2;
-  struct vector3 m, u, v;
-  struct exd_vector3 Lmuv;
-  struct exd_vertex sm;
-  double m2_i;
-  double l_n, m_n;
+  double R2 = fr->R2;
+  double m2_i = fr->m2_i;
   double a, b, c, d, r, s, t, A, zeta, last_zeta;
   int i;
-  int num_matching_rxns = 0;
-  struct rxn *matching_rxns[MAX_MATCHING_RXNS];
 
   /* Initialize */
   vertex_head = NULL;
   n_verts = 0;
   n_edges = 0;
-
-  /* Partially set up coordinate systems for first pass */
-  R2 = R * R;
-  m2_i = 1.0 / (mv->x * mv->x + mv->y * mv->y + mv->z * mv->z);
-  Lmuv.m = Lmuv.u = Lmuv.v = 0.0;      /* Keep compiler happy */
-  sm.u = sm.v = sm.r2 = sm.zeta = 0.0; /* More compiler happiness */
-
-  /* Set up coordinate system and convert vertices */
-  exd_coordize(mv, &m, &u, &v);
-
-  Lmuv.m = loc->x * m.x + loc->y * m.y + loc->z * m.z;
-  Lmuv.u = loc->x * u.x + loc->y * u.y + loc->z * u.z;
-  Lmuv.v = loc->x * v.x + loc->y * v.y + loc->z * v.z;
-
-  if (!distinguishable_vec3(loc, &(target->pos), EPS_C)) { /* Hit target exactly! */
-    sm.u = sm.v = sm.r2 = sm.zeta = 0.0;
-  } else { /* Find location of target in moving-molecule-centric coords */
-    sm.u = (target->pos.x - loc->x) * u.x + (target->pos.y - loc->y) * u.y +
-           (target->pos.z - loc->z) * u.z;
-    sm.v = (target->pos.x - loc->x) * v.x + (target->pos.y - loc->y) * v.y +
-           (target->pos.z - loc->z) * v.z;
-    sm.r2 = sm.u * sm.u + sm.v * sm.v;
-    sm.zeta = exd_zetize(sm.v, sm.u);
-  }
+  *n_cut_walls = 0;
 
   /* Find walls that occlude the interaction disk (or block the reaction) */
   for (wl = sv->wall_head; wl != NULL; wl = wl->next) {
-    w = wl->this_wall;
-
-    /* Ignore this wall if it is too far away! */
-
-    /* Find distance from plane of wall to molecule */
-    l_n = loc->x * w->normal.x + loc->y * w->normal.y + loc->z * w->normal.z;
-    d = w->d - l_n;
-
-    /* See if we're within interaction distance of wall */
-    m_n = mv->x * w->normal.x + mv->y * w->normal.y + mv->z * w->normal.z;
-
-    if (d * d >= R2 * (1 - m2_i * m_n * m_n))
-      continue;
-
-    /* Ignore this wall if no overlap between wall & disk bounding boxes */
-
-    /* Find wall bounding box */
-    urb.x = llf.x = w->vert[0]->x;
-    if (w->vert[1]->x < llf.x)
-      llf.x = w->vert[1]->x;
-    else
-      urb.x = w->vert[1]->x;
-    if (w->vert[2]->x < llf.x)
-      llf.x = w->vert[2]->x;
-    else if (w->vert[2]->x > urb.x)
-      urb.x = w->vert[2]->x;
-
-    urb.y = llf.y = w->vert[0]->y;
-    if (w->vert[1]->y < llf.y)
-      llf.y = w->vert[1]->y;
-    else
-      urb.y = w->vert[1]->y;
-    if (w->vert[2]->y < llf.y)
-      llf.y = w->vert[2]->y;
-    else if (w->vert[2]->y > urb.y)
-      urb.y = w->vert[2]->y;
-
-    urb.z = llf.z = w->vert[0]->z;
-    if (w->vert[1]->z < llf.z)
-      llf.z = w->vert[1]->z;
-    else
-      urb.z = w->vert[1]->z;
-    if (w->vert[2]->z < llf.z)
-      llf.z = w->vert[2]->z;
-    else if (w->vert[2]->z > urb.z)
-      urb.z = w->vert[2]->z;
-
-    /* Reject those without overlapping bounding boxes */
-    b = R2 * (1.0 - mv->x * mv->x * m2_i);
-    a = llf.x - loc->x;
-    if (a > 0 && a * a >= b)
+    switch (exd_wall_edge(world, fr, moving, wl->this_wall, &pa, &pb)) {
+    case EXD_WALL_MISS:
       continue;
-    a = loc->x - urb.x;
-    if (a > 0 && a * a >= b)
-      continue;
-
-    b = R2 * (1.0 - mv->y * mv->y * m2_i);
-    a = llf.y - loc->y;
-    if (a > 0 && a * a >= b)
-      continue;
-    a = loc->y - urb.y;
-    if (a > 0 && a * a >= b)
-      continue;
-
-    b = R2 * (1.0 - mv->z * mv->z * m2_i);
-    a = llf.z - loc->z;
-    if (a > 0 && a * a >= b)
-      continue;
-    a = loc->z - urb.z;
-    if (a > 0 && a * a >= b)
-      continue;
-
-    /* Ignore this wall if moving molecule can travel through it */
-
-    /* Reject those that the moving particle can travel through */
-    if ((moving->properties->flags & CAN_VOLWALL) != 0) {
-      num_matching_rxns = trigger_intersect(
-          world->reaction_hash, world->rx_hashsize, world->all_mols,
-          world->all_volume_mols, world->all_surface_mols,
-          moving->properties->hashval, (struct abstract_molecule *)moving, 0, w,
-          matching_rxns, 1, 1, 0);
-      if (num_matching_rxns == 0)
-        continue;
-      int blocked = 0;
-      for (i = 0; i < num_matching_rxns; i++) {
-        if (matching_rxns[i]->n_pathways == RX_REFLEC) {
-          blocked = 1;
-        }
-      }
-      if (!blocked) {
-        continue;
-      }
-    }
-
-    /* Find line of intersection between wall and disk */
-
-#if 0
-    /* Set up coordinate system and convert vertices */
-    if (uncoordinated) {
-      exd_coordize(mv, &m, &u, &v);
-
-      Lmuv.m = loc->x * m.x + loc->y * m.y + loc->z * m.z;
-      Lmuv.u = loc->x * u.x + loc->y * u.y + loc->z * u.z;
-      Lmuv.v = loc->x * v.x + loc->y * v.y + loc->z * v.z;
-
-      if (!distinguishable_vec3(loc, &(target->pos),
-                                EPS_C)) /* Hit target exactly! */
-      {
-        sm.u = sm.v = sm.r2 = sm.zeta = 0.0;
-      } else /* Find location of target in moving-molecule-centric coords */
-      {
-        sm.u = (target->pos.x - loc->x) * u.x + (target->pos.y - loc->y) * u.y +
-               (target->pos.z - loc->z) * u.z;
-        sm.v = (target->pos.x - loc->x) * v.x + (target->pos.y - loc->y) * v.y +
-               (target->pos.z - loc->z) * v.z;
-        sm.r2 = sm.u * sm.u + sm.v * sm.v;
-        sm.zeta = exd_zetize(sm.v, sm.u);
-      }
-      uncoordinated = 0;
-    }
-#endif
-    v0muv.m = w->vert[0]->x * m.x + w->vert[0]->y * m.y + w->vert[0]->z * m.z -
-              Lmuv.m;
-    v0muv.u = w->vert[0]->x * u.x + w->vert[0]->y * u.y + w->vert[0]->z * u.z -
-              Lmuv.u;
-    v0muv.v = w->vert[0]->x * v.x + w->vert[0]->y * v.y + w->vert[0]->z * v.z -
-              Lmuv.v;
-
-    v1muv.m = w->vert[1]->x * m.x + w->vert[1]->y * m.y + w->vert[1]->z * m.z -
-              Lmuv.m;
-    v1muv.u = w->vert[1]->x * u.x + w->vert[1]->y * u.y + w->vert[1]->z * u.z -
-              Lmuv.u;
-    v1muv.v = w->vert[1]->x * v.x + w->vert[1]->y * v.y + w->vert[1]->z * v.z -
-              Lmuv.v;
-
-    v2muv.m = w->vert[2]->x * m.x + w->vert[2]->y * m.y + w->vert[2]->z * m.z -
-              Lmuv.m;
-    v2muv.u = w->vert[2]->x * u.x + w->vert[2]->y * u.y + w->vert[2]->z * u.z -
-              Lmuv.u;
-    v2muv.v = w->vert[2]->x * v.x + w->vert[2]->y * v.y + w->vert[2]->z * v.z -
-              Lmuv.v;
-
-    /* Draw lines between points and pick intersections with plane of m=0 */
-    if ((v0muv.m < 0) == (v1muv.m < 0)) /* v0,v1 on same side */
-    {
-      if ((v2muv.m < 0) == (v1muv.m < 0))
-        continue;
-      t = v0muv.m / (v0muv.m - v2muv.m);
-      pa.u = v0muv.u + (v2muv.u - v0muv.u) * t;
-      pa.v = v0muv.v + (v2muv.v - v0muv.v) * t;
-      t = v1muv.m / (v1muv.m - v2muv.m);
-      pb.u = v1muv.u + (v2muv.u - v1muv.u) * t;
-      pb.v = v1muv.v + (v2muv.v - v1muv.v) * t;
-    } else if ((v0muv.m < 0) == (v2muv.m < 0)) /* v0,v2 on same side */
-    {
-      t = v0muv.m / (v0muv.m - v1muv.m);
-      pa.u = v0muv.u + (v1muv.u - v0muv.u) * t;
-      pa.v = v0muv.v + (v1muv.v - v0muv.v) * t;
-      t = v2muv.m / (v2muv.m - v1muv.m);
-      pb.u = v2muv.u + (v1muv.u - v2muv.u) * t;
-      pb.v = v2muv.v + (v1muv.v - v2muv.v) * t;
-    } else /* v1, v2 on same side */
-    {
-      t = v1muv.m / (v1muv.m - v0muv.m);
-      pa.u = v1muv.u + (v0muv.u - v1muv.u) * t;
-      pa.v = v1muv.v + (v0muv.v - v1muv.v) * t;
-      t = v2muv.m / (v2muv.m - v0muv.m);
-      pb.u = v2muv.u + (v0muv.u - v2muv.u) * t;
-      pb.v = v2muv.v + (v0muv.v - v2muv.v) * t;
-    }
-
-    /* Check to make sure endpoints are sensible */
-    pa.r2 = pa.u * pa.u + pa.v * pa.v;
-    pb.r2 = pb.u * pb.u + pb.v * pb.v;
-    if (pa.r2 < EPS_C * R2 ||
-        pb.r2 < EPS_C * R2) /* Can't tell where origin is relative to wall
-                               endpoints */
-    {
+    case EXD_WALL_BLOCKS:
       if (vertex_head != NULL)
         mem_put_list(sv->local_storage->exdv, vertex_head);
       return TARGET_OCCLUDED;
+    default:
+      break;
     }
-    if (!distinguishable(pa.u * pb.v, pb.u * pa.v, EPS_C) &&
-        pa.u * pb.u + pa.v * pb.v <
-            0) /* Antiparallel, can't tell which side of wall origin is on */
-    {
-      if (vertex_head != NULL)
-        mem_put_list(sv->local_storage->exdv, vertex_head);
-      return TARGET_OCCLUDED;
-    }
-
-    /* Intersect line with circle; skip this wall if no intersection */
-    t = 0;
-    s = 1;
-    if (pa.r2 > R2 || pb.r2 > R2) {
-      pa_pb = pa.u * pb.u + pa.v * pb.v;
-      if (!distinguishable(pa.r2 + pb.r2, 2 * pa_pb,
-                           EPS_C)) /* Wall endpoints are basically on top of
-                                      each other */
-      {
-        /* Might this tiny bit of wall block the target?  If not, continue,
-         * otherwise return TARGET_OCCLUDED */
-        /* Safe if we're clearly closer; in danger if we're even remotely
-         * parallel, otherwise surely safe */
-        /* Note: use SQRT_EPS_C for cross products since previous test vs. EPS_C
-         * was on squared values (linear difference term cancels) */
-        if (sm.r2 < pa.r2 && sm.r2 < pb.r2 &&
-            distinguishable(sm.r2, pa.r2, EPS_C) &&
-            distinguishable(sm.r2, pa.r2, EPS_C))
-          continue;
-        if (!distinguishable(sm.u * pa.v, sm.v * pa.u, SQRT_EPS_C) ||
-            !distinguishable(sm.u * pb.v, sm.v * pb.u, SQRT_EPS_C)) {
-          if (vertex_head != NULL)
-            mem_put_list(sv->local_storage->exdv, vertex_head);
-          return TARGET_OCCLUDED;
-        }
-        continue;
-      }
-      a = 1.0 / (pa.r2 + pb.r2 - 2 * pa_pb);
-      b = (pa_pb - pa.r2) * a;
-      c = (R2 - pa.r2) * a;
-      d = b * b + c;
-      if (d <= 0)
-        continue;
-      d = sqrt(d);
-      t = -b - d;
-      if (t >= 1)
-        continue;
-      if (t < 0)
-        t = 0;
-      s = -b + d;
-      if (s <= 0)
-        continue;
-      if (s > 1)
-        s = 1;
-    }
+    (*n_cut_walls)++;
 
-    /* Add this edge to the growing list, or return -1 if edge blocks target */
-
-    /* Construct final endpoints and prepare to store them */
+    /* Add this edge to the growing list */
     ppa = (struct exd_vertex *)CHECKED_MEM_GET(sv->local_storage->exdv,
                                                "exact disk vertex");
     ppb = (struct exd_vertex *)CHECKED_MEM_GET(sv->local_storage->exdv,
                                                "exact disk vertex");
-    if (t > 0) {
-      ppa->u = pa.u + t * (pb.u - pa.u);
-      ppa->v = pa.v + t * (pb.v - pa.v);
-      ppa->r2 = ppa->u * ppa->u + ppa->v * ppa->v;
-      ppa->zeta = exd_zetize(ppa->v, ppa->u);
-    } else {
-      ppa->u = pa.u;
-      ppa->v = pa.v;
-      ppa->r2 = pa.r2;
-      ppa->zeta = exd_zetize(pa.v, pa.u);
-    }
-    if (s < 1) {
-      ppb->u = pa.u + s * (pb.u - pa.u);
-      ppb->v = pa.v + s * (pb.v - pa.v);
-      ppb->r2 = ppb->u * ppb->u + ppb->v * ppb->v;
-      ppb->zeta = exd_zetize(ppb->v, ppb->u);
-    } else {
-      ppb->u = pb.u;
-      ppb->v = pb.v;
-      ppb->r2 = pb.r2;
-      ppb->zeta = exd_zetize(pb.v, pb.u);
-    }
-
-    /* It's convenient if ppa is earlier, ccw, than ppb */
-    a = (ppb->zeta - ppa->zeta);
-    if (a < 0)
-      a += 4.0;
-    if (a >= 2.0) {
-      vp = ppb;
-      ppb = ppa;
-      ppa = vp;
-      a = 4.0 - a;
-    }
-
-    /* Detect a blocked reaction: line is between origin and target */
-    b = (sm.zeta - ppa->zeta);
-    if (b < 0)
-      b += 4.0;
-
-    if (b < a) {
-      c = (ppa->u - sm.u) * (ppb->v - sm.v) - (ppa->v - sm.v) * (ppb->u - sm.u);
-      if (c < 0 || !distinguishable((ppa->u - sm.u) * (ppb->v - sm.v),
-                                    (ppa->v - sm.v) * (ppb->u - sm.u),
-                                    EPS_C)) /* Blocked! */
-      {
-        ppa->next = ppb;
-        ppb->next = vertex_head;
-        mem_put_list(sv->local_storage->exdv, ppa);
-        return TARGET_OCCLUDED;
-      }
-    }
-
+    *ppa = pa;
+    *ppb = pb;
     ppa->role = EXD_HEAD;
     ppb->role = EXD_TAIL;
     ppa->e = ppb;
@@ -2215,6 +2475,24 @@ double exact_disk(struct volume *world, struct vector3 *loc, struct vector3 *mv,
 /** done with exact_disk **/
 /**************************/
 
+/*************************************************************************
+vol_partners_present:
+  In: spec: species of a volume molecule
+  Out: 1 if any volume species it reacts with bimolecularly currently
+       exists, 0 otherwise.  Molecules with no partner around cannot take
+       part in a mol-mol reaction, so they can skip the partner search
+       and move as freely as molecules without such reactions.
+*************************************************************************/
+static int vol_partners_present(struct species *spec) {
+  for (int i = 0; i < spec->n_vol_partners; i++) {
+    struct species *partner = spec->vol_partners[i];
+    /* For A + A the moving molecule itself does not count */
+    if (partner->population > (partner == spec ? 1u : 0u))
+      return 1;
+  }
+  return 0;
+}
+
 /****************************************************************************
 safe_diffusion_step:
   In: vm: molecule that is moving
@@ -2235,7 +2513,9 @@ safe_diffusion_step:
         reacting, although those 1% will probably not go in the right
         direction).  This doesn't take into account the diffusion of other
         target molecules, so it may introduce errors for clouds of molecules
-        diffusing into each other from a distance.
+        diffusing into each other from a distance.  Molecules without
+        volume-volume reactions are not held to the subvolume boundary;
+        they may go as far again as the subvolume's wall clearance.
         *FIXME*: Add a flag to make this be very conservative or to turn
         this off entirely, aside from the TIME_STEP_MAX= directive.
 ****************************************************************************/
@@ -2277,33 +2557,36 @@ double safe_diffusion_step(struct volume_molecule *vm, struct collision *shead,
       d2min = d2;
   }
 
-  d2 = (vm->pos.x - x_fineparts[sv->llf.x]);
-  d2 *= d2;
-  if (d2 < d2min)
-    d2min = d2;
+  double d_part = fabs(vm->pos.x - x_fineparts[sv->llf.x]);
+  double d = fabs(vm->pos.x - x_fineparts[sv->urb.x]);
+  if (d < d_part)
+    d_part = d;
 
-  d2 = (vm->pos.x - x_fineparts[sv->urb.x]);
-  d2 *= d2;
-  if (d2 < d2min)
-    d2min = d2;
+  d = fabs(vm->pos.y - y_fineparts[sv->llf.y]);
+  if (d < d_part)
+    d_part = d;
 
-  d2 = (vm->pos.y - y_fineparts[sv->llf.y]);
-  d2 *= d2;
-  if (d2 < d2min)
-    d2min = d2;
+  d = fabs(vm->pos.y - y_fineparts[sv->urb.y]);
+  if (d < d_part)
+    d_part = d;
 
-  d2 = (vm->pos.y - y_fineparts[sv->urb.y]);
-  d2 *= d2;
-  if (d2 < d2min)
-    d2min = d2;
+  d = fabs(vm->pos.z - z_fineparts[sv->llf.z]);
+  if (d < d_part)
+    d_part = d;
 
-  d2 = (vm->pos.z - z_fineparts[sv->llf.z]);
-  d2 *= d2;
-  if (d2 < d2min)
-    d2min = d2;
+  d = fabs(vm->pos.z - z_fineparts[sv->urb.z]);
+  if (d < d_part)
+    d_part = d;
+
+  /* Reaction partners in other subvolumes are not in shead, but molecules
+     without volume-volume reactions (or with none of their partners
+     around) only need to keep clear of walls.  Walls that do not
+     intersect this subvolume are wall_clearance beyond its boundary. */
+  if ((vm->properties->flags & (CAN_VOLVOLVOL | CAN_VOLVOLSURF)) == 0 &&
+      !vol_partners_present(vm->properties))
+    d_part += sv->wall_clearance;
 
-  d2 = (vm->pos.z - z_fineparts[sv->urb.z]);
-  d2 *= d2;
+  d2 = d_part * d_part;
   if (d2 < d2min)
     d2min = d2;
 
@@ -2362,6 +2645,11 @@ static struct collision *expand_collision_list_for_neighbor(
   int num_matching_rxns = 0;
   struct rxn *matching_rxns[MAX_MATCHING_RXNS];
 
+  /* Nothing to find in a subvolume without molecules (this includes the
+   * shared record of subvolumes that were never used) */
+  if (new_sv->n_species_lists == 0)
+    return shead1;
+
   /* Grab the subvolume boundaries */
   struct vector3 new_sv_llf, new_sv_urb;
   new_sv_llf.x = x_fineparts[new_sv->llf.x];
@@ -2411,27 +2699,19 @@ static struct collision *expand_collision_list_for_neighbor(
   }
 
   /* scan molecules from this SV */
-  struct per_species_list *psl_next, *psl, **psl_head = &new_sv->species_head;
-  for (psl = new_sv->species_head; psl != NULL; psl = psl_next) {
-    psl_next = psl->next;
-    if (psl->properties == NULL) {
-      psl_head = &psl->next;
-      continue;
-    }
+  int n_lists = 0;
+  for (int l = 0; l < new_sv->n_species_lists; l++) {
+    struct per_species_list *psl = new_sv->species_lists[l];
 
     /* Garbage collection of empty per-species lists */
     if (psl->head == NULL) {
-      *psl_head = psl->next;
-      ht_remove(&new_sv->mol_by_species, psl);
       mem_put(new_sv->local_storage->pslv, psl);
       continue;
-    } else
-      psl_head = &psl->next;
+    }
+    new_sv->species_lists[n_lists++] = psl;
 
     /* no possible reactions. skip it. */
-    if (!trigger_bimolecular_preliminary(
-             reaction_hash, rx_hashsize, vm->properties->hashval,
-             psl->properties->hashval, vm->properties, psl->properties))
+    if (!may_react_with(vm->properties, psl->properties))
       continue;
 
     for (struct volume_molecule *mp = psl->head; mp != NULL; mp = mp->next_v) {
@@ -2447,7 +2727,7 @@ static struct collision *expand_collision_list_for_neighbor(
       if (mp->pos.z < z_min || mp->pos.z > z_max)
         continue;
       // count only in the relevant periodic box
-      if (!periodic_boxes_are_identical(vm->periodic_box, mp->periodic_box)) {
+      if (!periodic_boxes_are_identical(&vm->periodic_box, &mp->periodic_box)) {
         continue;
       }
 
@@ -2472,6 +2752,7 @@ static struct collision *expand_collision_list_for_neighbor(
       }
     }
   }
+  new_sv->n_species_lists = n_lists;
 
   return shead1;
 }
@@ -2479,8 +2760,10 @@ static struct collision *expand_collision_list_for_neighbor(
 /****************************************************************************
 expand_collision_list:
   In: vm: molecule that is moving
-      mv: displacement to the new location
+      path_llf: lower left front corner of the box around the path
+      path_urb: upper right back corner of the box around the path
       sv: subvolume that we start in
+      subvol: the table of subvolumes
       rx_radius_3d:
       ny_parts:
       nz_parts:
@@ -2489,208 +2772,206 @@ expand_collision_list:
       z_fineparts:
   Out: Returns list of collisions with molecules from neighbor subvolumes
        that are located within "interaction_radius" from the the subvolume
-       border.  The molecules are added only when the molecule displacement
-       bounding box intersects with the subvolume bounding box.
+       border.  The molecules are added only when the path bounding box
+       (see path_bounding_box and reach_bounding_box) intersects with the
+       subvolume bounding box.
 ****************************************************************************/
 static struct collision *
-expand_collision_list(struct volume_molecule *vm, struct vector3 *mv,
-                      struct subvolume *sv, double rx_radius_3d,
-                      int ny_parts, int nz_parts, double *x_fineparts,
-                      double *y_fineparts, double *z_fineparts, int rx_hashsize,
+expand_collision_list(struct volume_molecule *vm, struct vector3 *path_llf,
+                      struct vector3 *path_urb, struct subvolume *sv,
+                      struct subvolume **subvol, double rx_radius_3d, int ny_parts, int nz_parts,
+                      double *x_fineparts, double *y_fineparts,
+                      double *z_fineparts, int rx_hashsize,
                       struct rxn **reaction_hash) {
   struct collision *shead1 = NULL;
-  /* neighbors of the current subvolume */
-  struct vector3 path_llf, path_urb;
   double R = (rx_radius_3d);
-
-  /* find the molecule path bounding box. */
-  path_bounding_box(&vm->pos, mv, &path_llf, &path_urb, rx_radius_3d);
+  struct subvolume **here = subvol + sv->index;
 
   /* Decide which directions we need to go */
   int x_neg = 0, x_pos = 0, y_neg = 0, y_pos = 0, z_neg = 0, z_pos = 0;
-  if (!(sv->world_edge & X_POS_BIT) && path_urb.x + R > x_fineparts[sv->urb.x])
+  if (!(sv->world_edge & X_POS_BIT) && path_urb->x + R > x_fineparts[sv->urb.x])
     x_pos = 1;
-  if (!(sv->world_edge & X_NEG_BIT) && path_llf.x - R < x_fineparts[sv->llf.x])
+  if (!(sv->world_edge & X_NEG_BIT) && path_llf->x - R < x_fineparts[sv->llf.x])
     x_neg = 1;
-  if (!(sv->world_edge & Y_POS_BIT) && path_urb.y + R > y_fineparts[sv->urb.y])
+  if (!(sv->world_edge & Y_POS_BIT) && path_urb->y + R > y_fineparts[sv->urb.y])
     y_pos = 1;
-  if (!(sv->world_edge & Y_NEG_BIT) && path_llf.y - R < y_fineparts[sv->llf.y])
+  if (!(sv->world_edge & Y_NEG_BIT) && path_llf->y - R < y_fineparts[sv->llf.y])
     y_neg = 1;
-  if (!(sv->world_edge & Z_POS_BIT) && path_urb.z + R > z_fineparts[sv->urb.z])
+  if (!(sv->world_edge & Z_POS_BIT) && path_urb->z + R > z_fineparts[sv->urb.z])
     z_pos = 1;
-  if (!(sv->world_edge & Z_NEG_BIT) && path_llf.z - R < z_fineparts[sv->llf.z])
+  if (!(sv->world_edge & Z_NEG_BIT) && path_llf->z - R < z_fineparts[sv->llf.z])
     z_neg = 1;
 
   /* go in the direction X_POS */
   if (x_pos) {
-    struct subvolume *new_sv = sv + (nz_parts - 1) * (ny_parts - 1);
+    struct subvolume **new_sv = here + (nz_parts - 1) * (ny_parts - 1);
     shead1 = expand_collision_list_for_neighbor(
-        sv, vm, new_sv, &path_llf, &path_urb, shead1, R, 0.0, 0.0, x_fineparts,
+        sv, vm, *new_sv, path_llf, path_urb, shead1, R, 0.0, 0.0, x_fineparts,
         y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +X, +Y) */
     if (y_pos) {
-      struct subvolume *new_sv_y = new_sv + (nz_parts - 1);
+      struct subvolume **new_sv_y = new_sv + (nz_parts - 1);
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv_y, &path_llf, &path_urb, shead1, R, R, 0.0, x_fineparts,
+          sv, vm, *new_sv_y, path_llf, path_urb, shead1, R, R, 0.0, x_fineparts,
           y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, +Y, +Z) */
       if (z_pos)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y + 1, &path_llf, &path_urb, shead1, R, R, R,
+            sv, vm, new_sv_y[1], path_llf, path_urb, shead1, R, R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, +Y, -Z */
       if (z_neg)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y - 1, &path_llf, &path_urb, shead1, R, R, -R,
+            sv, vm, new_sv_y[-1], path_llf, path_urb, shead1, R, R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go +X, -Y) */
     if (y_neg) {
-      struct subvolume *new_sv_y = new_sv - (nz_parts - 1);
+      struct subvolume **new_sv_y = new_sv - (nz_parts - 1);
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv_y, &path_llf, &path_urb, shead1, R, -R, 0.0,
+          sv, vm, *new_sv_y, path_llf, path_urb, shead1, R, -R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, -Y, +Z) */
       if (z_pos)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y + 1, &path_llf, &path_urb, shead1, R, -R, R,
+            sv, vm, new_sv_y[1], path_llf, path_urb, shead1, R, -R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, -Y, -Z */
       if (z_neg)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y - 1, &path_llf, &path_urb, shead1, R, -R, -R,
+            sv, vm, new_sv_y[-1], path_llf, path_urb, shead1, R, -R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go +X, +Z) */
     if (z_pos)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv + 1, &path_llf, &path_urb, shead1, R, 0.0, R,
+          sv, vm, new_sv[1], path_llf, path_urb, shead1, R, 0.0, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +X, -Z */
     if (z_neg)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv - 1, &path_llf, &path_urb, shead1, R, 0.0, -R,
+          sv, vm, new_sv[-1], path_llf, path_urb, shead1, R, 0.0, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go in the direction X_NEG */
   if (x_neg) {
-    struct subvolume *new_sv = sv - (nz_parts - 1) * (ny_parts - 1);
+    struct subvolume **new_sv = here - (nz_parts - 1) * (ny_parts - 1);
     shead1 = expand_collision_list_for_neighbor(
-        sv, vm, new_sv, &path_llf, &path_urb, shead1, -R, 0.0, 0.0, x_fineparts,
+        sv, vm, *new_sv, path_llf, path_urb, shead1, -R, 0.0, 0.0, x_fineparts,
         y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -X, +Y) */
     if (y_pos) {
-      struct subvolume *new_sv_y = new_sv + (nz_parts - 1);
+      struct subvolume **new_sv_y = new_sv + (nz_parts - 1);
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv_y, &path_llf, &path_urb, shead1, -R, R, 0.0,
+          sv, vm, *new_sv_y, path_llf, path_urb, shead1, -R, R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, +Y, +Z) */
       if (z_pos)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y + 1, &path_llf, &path_urb, shead1, -R, R, R,
+            sv, vm, new_sv_y[1], path_llf, path_urb, shead1, -R, R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, +Y, -Z */
       if (z_neg)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y - 1, &path_llf, &path_urb, shead1, -R, R, -R,
+            sv, vm, new_sv_y[-1], path_llf, path_urb, shead1, -R, R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go -X, -Y) */
     if (y_neg) {
-      struct subvolume *new_sv_y = new_sv - (nz_parts - 1);
+      struct subvolume **new_sv_y = new_sv - (nz_parts - 1);
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv_y, &path_llf, &path_urb, shead1, -R, -R, 0.0,
+          sv, vm, *new_sv_y, path_llf, path_urb, shead1, -R, -R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, -Y, +Z) */
       if (z_pos)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y + 1, &path_llf, &path_urb, shead1, -R, -R, R,
+            sv, vm, new_sv_y[1], path_llf, path_urb, shead1, -R, -R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, -Y, -Z */
       if (z_neg)
         shead1 = expand_collision_list_for_neighbor(
-            sv, vm, new_sv_y - 1, &path_llf, &path_urb, shead1, -R, -R, -R,
+            sv, vm, new_sv_y[-1], path_llf, path_urb, shead1, -R, -R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go -X, +Z) */
     if (z_pos)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv + 1, &path_llf, &path_urb, shead1, -R, 0.0, R,
+          sv, vm, new_sv[1], path_llf, path_urb, shead1, -R, 0.0, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -X, -Z */
     if (z_neg)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv - 1, &path_llf, &path_urb, shead1, -R, 0.0, -R,
+          sv, vm, new_sv[-1], path_llf, path_urb, shead1, -R, 0.0, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go in the direction Y_POS */
   if (y_pos) {
-    struct subvolume *new_sv = sv + (nz_parts - 1);
+    struct subvolume **new_sv = here + (nz_parts - 1);
     shead1 = expand_collision_list_for_neighbor(
-        sv, vm, new_sv, &path_llf, &path_urb, shead1, 0.0, R, 0.0, x_fineparts,
+        sv, vm, *new_sv, path_llf, path_urb, shead1, 0.0, R, 0.0, x_fineparts,
         y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +Y, +Z) */
     if (z_pos)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv + 1, &path_llf, &path_urb, shead1, 0.0, R, R,
+          sv, vm, new_sv[1], path_llf, path_urb, shead1, 0.0, R, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +Y, -Z */
     if (z_neg)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv - 1, &path_llf, &path_urb, shead1, 0.0, R, -R,
+          sv, vm, new_sv[-1], path_llf, path_urb, shead1, 0.0, R, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go in the direction Y_NEG */
   if (y_neg) {
-    struct subvolume *new_sv = sv - (nz_parts - 1);
+    struct subvolume **new_sv = here - (nz_parts - 1);
     shead1 = expand_collision_list_for_neighbor(
-        sv, vm, new_sv, &path_llf, &path_urb, shead1, 0.0, -R, 0.0, x_fineparts,
+        sv, vm, *new_sv, path_llf, path_urb, shead1, 0.0, -R, 0.0, x_fineparts,
         y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -Y, +Z) */
     if (z_pos)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv + 1, &path_llf, &path_urb, shead1, 0.0, -R, R,
+          sv, vm, new_sv[1], path_llf, path_urb, shead1, 0.0, -R, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -Y, -Z */
     if (z_neg)
       shead1 = expand_collision_list_for_neighbor(
-          sv, vm, new_sv - 1, &path_llf, &path_urb, shead1, 0.0, -R, -R,
+          sv, vm, new_sv[-1], path_llf, path_urb, shead1, 0.0, -R, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go in the direction Z_POS */
   if (z_pos)
     shead1 = expand_collision_list_for_neighbor(
-        sv, vm, sv + 1, &path_llf, &path_urb, shead1, 0.0, 0.0, R, x_fineparts,
+        sv, vm, here[1], path_llf, path_urb, shead1, 0.0, 0.0, R, x_fineparts,
         y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
   /* go in the direction Z_NEG */
   if (z_neg)
     shead1 = expand_collision_list_for_neighbor(
-        sv, vm, sv - 1, &path_llf, &path_urb, shead1, 0.0, 0.0, -R, x_fineparts,
+        sv, vm, here[-1], path_llf, path_urb, shead1, 0.0, 0.0, -R, x_fineparts,
         y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
   return shead1;
@@ -2735,6 +3016,11 @@ struct sp_collision *expand_collision_partner_list_for_neighbor(
   struct species *spec = vm->properties;
   struct sp_collision *smash;
 
+  /* Nothing to find in a subvolume without molecules (this includes the
+   * shared record of subvolumes that were never used) */
+  if (new_sv->n_species_lists == 0)
+    return shead1;
+
   /* Grab the subvolume boundaries */
   struct vector3 new_sv_llf, new_sv_urb;
   new_sv_llf.x = x_fineparts[new_sv->llf.x];
@@ -2797,22 +3083,16 @@ struct sp_collision *expand_collision_partner_list_for_neighbor(
   }
 
   /* scan molecules from this SV */
-  struct per_species_list *psl_next, *psl, **psl_head = &new_sv->species_head;
-  for (psl = new_sv->species_head; psl != NULL; psl = psl_next) {
-    psl_next = psl->next;
-    if (psl->properties == NULL) {
-      psl_head = &psl->next;
-      continue;
-    }
+  int n_lists = 0;
+  for (int l = 0; l < new_sv->n_species_lists; l++) {
+    struct per_species_list *psl = new_sv->species_lists[l];
 
     /* Garbage collection of empty per-species lists */
     if (psl->head == NULL) {
-      *psl_head = psl->next;
-      ht_remove(&new_sv->mol_by_species, psl);
       mem_put(new_sv->local_storage->pslv, psl);
       continue;
-    } else
-      psl_head = &psl->next;
+    }
+    new_sv->species_lists[n_lists++] = psl;
 
     col_tri_molecular_flag =
         moving_tri_molecular_flag &&
@@ -2820,9 +3100,7 @@ struct sp_collision *expand_collision_partner_list_for_neighbor(
     col_bi_molecular_flag =
         moving_bi_molecular_flag &&
         ((psl->properties->flags & CAN_VOLVOL) == CAN_VOLVOL) &&
-        trigger_bimolecular_preliminary(reaction_hash, rx_hashsize,
-                                        spec->hashval, psl->properties->hashval,
-                                        spec, psl->properties);
+        may_react_with(spec, psl->properties);
     col_mol_mol_grid_flag =
         moving_mol_mol_grid_flag &&
         ((psl->properties->flags & CAN_VOLVOLSURF) == CAN_VOLVOLSURF);
@@ -2873,6 +3151,7 @@ struct sp_collision *expand_collision_partner_list_for_neighbor(
       }
     }
   }
+  new_sv->n_species_lists = n_lists;
   return shead1;
 }
 
@@ -2902,6 +3181,10 @@ struct volume_molecule *diffuse_3D(
      and one or two surface molecules */
   int mol_grid_flag = ((spec->flags & CAN_VOLSURF) == CAN_VOLSURF);
   int mol_grid_grid_flag = ((spec->flags & CAN_VOLSURFSURF) == CAN_VOLSURFSURF);
+  /* mol-mol reactions are only looked for while some partner exists */
+  int mol_mol_flag =
+      ((spec->flags & (CAN_VOLVOL | CANT_INITIATE)) == CAN_VOLVOL) &&
+      vol_partners_present(spec);
 
   if (spec->space_step <= 0.0) {
     vm->t += max_time;
@@ -2934,9 +3217,11 @@ pretend_to_call_diffuse_3D: ; /* Label to allow fake recursion */
                                      tail of the collision linked list) */
   struct collision *shead_exp = NULL; /* Things we might hit (can interact with)
                                          from neighbor subvolumes */
+  /* Box around every path shead_exp was collected for (empty until then) */
+  struct vector3 exp_llf = { GIGANTIC, GIGANTIC, GIGANTIC };
+  struct vector3 exp_urb = { -GIGANTIC, -GIGANTIC, -GIGANTIC };
   /* scan subvolume for possible mol-mol reactions with vm */
-  if ((spec->flags & (CAN_VOLVOL | CANT_INITIATE)) == CAN_VOLVOL &&
-      inertness < inert_to_all) {
+  if (mol_mol_flag && inertness < inert_to_all) {
     determine_mol_mol_reactions(world, vm, &shead, &stail, inertness);
   }
 
@@ -2945,11 +3230,12 @@ pretend_to_call_diffuse_3D: ; /* Label to allow fake recursion */
       &rate_factor, &r_rate_factor, &steps, &t_steps, max_time);
   }
 
-  if (world->use_expanded_list &&
-      ((vm->properties->flags & (CAN_VOLVOL | CANT_INITIATE)) == CAN_VOLVOL) &&
-      !inertness) {
+  if (world->use_expanded_list && mol_mol_flag && !inertness) {
+    path_bounding_box(&vm->pos, &displacement, &exp_llf, &exp_urb,
+                      world->rx_radius_3d);
     shead_exp = expand_collision_list(
-      vm, &displacement, sv, world->rx_radius_3d, world->ny_parts,
+      vm, &exp_llf, &exp_urb, sv, world->subvol, world->rx_radius_3d,
+      world->ny_parts,
       world->nz_parts, world->x_fineparts, world->y_fineparts,
       world->z_fineparts, world->rx_hashsize, world->reaction_hash);
     if (stail != NULL)
@@ -2965,21 +3251,17 @@ pretend_to_call_diffuse_3D: ; /* Label to allow fake recursion */
 
   struct wall* reflectee = NULL;
   struct collision *smash;      /* Thing we've hit that's under consideration */
+  struct collision_buffer hits; /* What the current ray hit, in time order */
   do {
     /* due to redo_expand_collision_list_flag this only happens after reflection */
-    if (world->use_expanded_list && redo_expand_collision_list_flag) {
-      redo_collision_list(world, &shead, &stail, &shead_exp, vm, &displacement, sv);
+    if (world->use_expanded_list && mol_mol_flag &&
+        redo_expand_collision_list_flag) {
+      redo_collision_list(world, &shead, &stail, &shead_exp, &exp_llf,
+        &exp_urb, vm, &displacement, sv);
     }
 
-    struct collision* shead2 = ray_trace(world, &(vm->pos), shead, sv, &displacement, reflectee);
-    if (shead2 == NULL) {
-      mcell_internal_error("ray_trace returned NULL.");
-    }
-
-    if (shead2->next != NULL) {
-      shead2 =
-          (struct collision *)ae_list_sort((struct abstract_element *)shead2);
-    }
+    struct collision *shead2 = ray_trace(world, &(vm->pos), shead, sv,
+                                         &displacement, reflectee, &hits);
 
     struct vector3* loc_certain = NULL;
     struct collision *tentative = shead2;
@@ -3076,9 +3358,7 @@ pretend_to_call_diffuse_3D: ; /* Label to allow fake recursion */
       }
     }
 
-    if (shead2 != NULL) {
-      mem_put_list(sv->local_storage->coll, shead2);
-    }
+    collision_buffer_clear(&hits);
   } while (smash != NULL);
 
   vm->pos.x += displacement.x;
@@ -3136,7 +3416,7 @@ int move_sm_on_same_triangle(
   // We're on a new part of the grid
   struct surface_molecule_list *sm_list = sm->grid->sm_list[new_idx];
   if (new_idx != sm->grid_index) {
-    if ((state->periodic_box_obj && periodicbox_in_surfmol_list(sm->periodic_box, sm_list)) ||
+    if ((state->periodic_box_obj && periodicbox_in_surfmol_list(&sm->periodic_box, sm_list)) ||
         (!state->periodic_box_obj && sm_list && sm_list->sm)) {
       if (hd_info != NULL) {
         delete_void_list((struct void_list *)hd_info);
@@ -3146,10 +3426,12 @@ int move_sm_on_same_triangle(
     }
 
     remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+    update_tile_occupancy(sm->grid, sm->grid_index);
     sm->grid_index = new_idx;
     sm->grid->sm_list[new_idx] = add_surfmol_with_unique_pb_to_list(
       sm->grid->sm_list[new_idx], sm);
     assert(sm->grid->sm_list[new_idx] != NULL);
+    update_tile_occupancy(sm->grid, new_idx);
     count_moved_surface_mol(
       state, sm, sm->grid, new_loc, state->count_hashmask,
       state->count_hash, &state->ray_polygon_colls, previous_box);
@@ -3203,7 +3485,7 @@ int move_sm_to_new_triangle(
   }
 
   struct surface_molecule_list *sm_list = new_wall->grid->sm_list[new_idx];
-  if ((state->periodic_box_obj && periodicbox_in_surfmol_list(sm->periodic_box, sm_list)) ||
+  if ((state->periodic_box_obj && periodicbox_in_surfmol_list(&sm->periodic_box, sm_list)) ||
       (!state->periodic_box_obj && sm_list && sm_list->sm)) {
     if (hd_info != NULL) {
       delete_void_list((struct void_list *)hd_info);
@@ -3217,12 +3499,14 @@ int move_sm_to_new_triangle(
     state->count_hash, &state->ray_polygon_colls, previous_box);
 
   remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+  update_tile_occupancy(sm->grid, sm->grid_index);
   sm->grid->n_occupied--;
   sm->grid = new_wall->grid;
   sm->grid_index = new_idx;
   sm_list = add_surfmol_with_unique_pb_to_list(sm->grid->sm_list[new_idx], sm);
   assert(sm_list != NULL);
   sm->grid->sm_list[sm->grid_index] = sm_list;
+  update_tile_occupancy(sm->grid, sm->grid_index);
   sm->grid->n_occupied++;
 
   sm->s_pos.u = new_loc->u;
@@ -3302,10 +3586,11 @@ struct surface_molecule *diffuse_2D(
 
   world->diffusion_number++;
   world->diffusion_cumtime += steps;
+  COUNT_SUBVOL_LOAD(world, sm->grid->subvol, diffusion_steps, 1);
 
-  struct periodic_image previous_box = { .x = sm->periodic_box->x,
-                                         .y = sm->periodic_box->y,
-                                         .z = sm->periodic_box->z
+  struct periodic_image previous_box = { .x = sm->periodic_box.x,
+                                         .y = sm->periodic_box.y,
+                                         .z = sm->periodic_box.z
                                        };
   struct hit_data *hd_info = NULL;
   for (int find_new_position = (SURFACE_DIFFUSION_RETRIES + 1);
@@ -3417,22 +3702,21 @@ react_2D_all_neighbors(struct volume *world, struct surface_molecule *sm,
   int num_matching_rxns = 0;
   struct rxn *matching_rxns[MAX_MATCHING_RXNS];
 
-  /* linked list of the tile neighbors */
-  struct tile_neighbor *tile_nbr_head = NULL, *curr;
-  int list_length = 0; /* length of the linked lists above */
+  /* the tile neighbors */
+  struct tile_nbr_buf nbrs;
 
   if ((u_int)sm->grid_index >= sm->grid->n_tiles) {
     mcell_internal_error("tile index %u is greater or equal number_of_tiles %u",
                          (u_int)sm->grid_index, sm->grid->n_tiles);
   }
 
-  find_neighbor_tiles(world, sm, sm->grid, sm->grid_index, 0, 1, &tile_nbr_head,
-                      &list_length);
+  init_tile_nbr_buf(&nbrs);
+  get_neighbor_tiles(world, sm, sm->grid, sm->grid_index, 0, 1, &nbrs);
 
-  if (tile_nbr_head == NULL)
+  if (nbrs.n_tiles == 0)
     return sm; /* no reaction may happen */
 
-  const int num_nbrs = list_length;
+  const int num_nbrs = nbrs.n_tiles;
   int max_size = num_nbrs * MAX_MATCHING_RXNS;
   struct rxn *rxn_array[max_size]; /* array of reaction objects with neighbor
                                      molecules */
@@ -3455,10 +3739,10 @@ react_2D_all_neighbors(struct volume *world, struct surface_molecule *sm,
   }
 
   /* step through the neighbors */
-  for (curr = tile_nbr_head; curr != NULL; curr = curr->next) {
+  for (int nn = 0; nn < nbrs.n_tiles; nn++) {
+    struct tile_ref *curr = &nbrs.tiles[nn];
     /* Neighboring molecule */
-    struct surface_molecule_list *sm_list = curr->grid->sm_list[curr->idx]; 
-    if (sm_list == NULL || sm_list->sm == NULL)
+    if (!get_bit(curr->grid->occupancy, curr->idx))
       continue;
     struct surface_molecule *smp = curr->grid->sm_list[curr->idx]->sm;
 
@@ -3493,8 +3777,6 @@ react_2D_all_neighbors(struct volume *world, struct surface_molecule *sm,
 
       for (int jj = 0; jj < num_matching_rxns; jj++) {
         if (matching_rxns[jj] != NULL) {
-          if (matching_rxns[jj]->prob_t != NULL)
-            update_probs(world, matching_rxns[jj], sm->t);
           rxn_array[l] = matching_rxns[jj];
           cf[l] = t / (curr->grid->binding_factor);
           smol[l] = smp;
@@ -3506,7 +3788,7 @@ react_2D_all_neighbors(struct volume *world, struct surface_molecule *sm,
     }
   }
 
-  delete_tile_neighbor_list(tile_nbr_head);
+  free_tile_nbr_buf(&nbrs);
 
   if (n == 0) {
     return sm; /* Nobody to react with */
@@ -3555,7 +3837,7 @@ void clean_up_old_molecules(struct storage *local) {
       am = am->next;
       if ((temp->flags & IN_MASK) == IN_SCHEDULE) {
         temp->next = NULL;
-        mem_put(temp->birthplace, temp);
+        mem_put(molecule_storage(temp), temp);
       } else {
         temp->flags &= ~IN_SCHEDULE;
       }
@@ -3627,12 +3909,15 @@ void run_timestep(struct volume *state, struct storage *local,
   /* Do not trigger the scheduler to advance!  This will be done
    * by the main loop. */
   while (local->timer->current != NULL) {
+    /* temporary lists of the previous molecule are all dead by now */
+    scratch_reset(local->scratch);
+
     am = (struct abstract_molecule *)schedule_next(local->timer);
     if (am->properties == NULL) /* Defunct!  Remove molecule. */
     {
       if ((am->flags & IN_MASK) == IN_SCHEDULE) {
         am->next = NULL;
-        mem_put(am->birthplace, am);
+        mem_put(molecule_storage(am), am);
       } else
         am->flags &= ~IN_SCHEDULE;
       if (local->timer->defunct_count > 0)
@@ -3646,11 +3931,19 @@ void run_timestep(struct volume *state, struct storage *local,
     // Check for unimolecular reactions
     // If molec is new or need rescheduled, this just computes a new lifetime
     if (am->t2 < EPS_C || am->t2 < EPS_C * am->t) {
-      if (!check_for_unimolecular_reaction(state, am)) {
+      uint64_t t0 = phase_begin(state);
+      int alive = check_for_unimolecular_reaction(state, am);
+      phase_end(state, PHASE_UNIMOLECULAR, t0);
+      if (!alive) {
         continue;
       }
     }
 
+    // Well-mixed molecules away from walls are only counted
+    if ((am->properties->flags & WELL_MIXED) != 0 &&
+        well_mixed_absorb(state, (struct volume_molecule *)am))
+      continue;
+
     // How to advance surface molecule scheduling time
     double surface_mol_advance_time = 0;
 
@@ -3669,12 +3962,14 @@ void run_timestep(struct volume *state, struct storage *local,
         double save_sched_time = am->t;
         if (max_time > release_time - am->t)
           max_time = release_time - am->t;
+        uint64_t t0 = phase_begin(state);
         if (am->properties->flags & (CAN_VOLVOLVOL | CAN_VOLVOLSURF))
           am = (struct abstract_molecule *)diffuse_3D_big_list(
               state, (struct volume_molecule *)am, max_time);
         else
           am = (struct abstract_molecule *)diffuse_3D(
               state, (struct volume_molecule *)am, max_time);
+        phase_end(state, PHASE_DIFFUSE_3D, t0);
         if (am != NULL) /* We still exist */
         {
           // Perform only for unimolecular reactions
@@ -3693,9 +3988,11 @@ void run_timestep(struct volume *state, struct storage *local,
         // Remember current wall
         current_wall = ((struct surface_molecule *)am)->grid->surface;
 
+        uint64_t t0 = phase_begin(state);
         am = (struct abstract_molecule *)diffuse_2D(
             state, (struct surface_molecule *)am, max_time,
             &surface_mol_advance_time);
+        phase_end(state, PHASE_DIFFUSE_2D, t0);
         if (am == NULL) {
           continue;
         }
@@ -3720,6 +4017,7 @@ void run_timestep(struct volume *state, struct storage *local,
         max_time = surface_mol_advance_time;
 
       if (can_surface_mol_react) {
+        uint64_t t0 = phase_begin(state);
         if ((am->properties->flags & (CANT_INITIATE | CAN_SURFSURF)) ==
             CAN_SURFSURF) {
           am = (struct abstract_molecule *)react_2D_all_neighbors(
@@ -3727,10 +4025,9 @@ void run_timestep(struct volume *state, struct storage *local,
               state->notify->molecule_collision_report,
               state->rxn_flags.surf_surf_reaction_flag,
               &(state->surf_surf_colls));
-          if (am == NULL)
-            continue;
         }
-        if ((am->properties->flags & (CANT_INITIATE | CAN_SURFSURFSURF)) ==
+        if (am != NULL &&
+            (am->properties->flags & (CANT_INITIATE | CAN_SURFSURFSURF)) ==
             CAN_SURFSURFSURF) {
           am = (struct abstract_molecule *)react_2D_trimol_all_neighbors(
               state, (struct surface_molecule *)am, max_time,
@@ -3738,9 +4035,10 @@ void run_timestep(struct volume *state, struct storage *local,
               state->notify->final_summary,
               state->rxn_flags.surf_surf_surf_reaction_flag,
               &(state->surf_surf_surf_colls));
-          if (am == NULL)
-            continue;
         }
+        phase_end(state, PHASE_REACT_2D, t0);
+        if (am == NULL)
+          continue;
       }
     }
 
@@ -3819,8 +4117,6 @@ run_concentration_clamp:
        surfaces to maintain the desired concentation.
 *************************************************************************/
 void run_concentration_clamp(struct volume *world, double t_now) {
-  int this_count = 0;
-  static int total_count = 0;
   for (struct ccn_clamp_data *ccd = world->clamp_list; ccd != NULL; ccd = ccd->next) {
     if (ccd->objp == NULL) {
       continue;
@@ -3843,8 +4139,6 @@ void run_concentration_clamp(struct volume *world, double t_now) {
         vm.flags = IN_SCHEDULE | ACT_NEWBIE | TYPE_VOL | IN_VOLUME |
                   ACT_CLAMPED | ACT_DIFFUSE;
         vm.properties = ccdm->mol;
-        vm.mesh_name = NULL;
-        vm.birthplace = NULL;
         vm.birthday = convert_iterations_to_seconds(
             world->start_iterations, world->time_unit,
             world->simulation_start_seconds, t_now);
@@ -3853,7 +4147,6 @@ void run_concentration_clamp(struct volume *world, double t_now) {
         vm.index = 0;
         struct volume_molecule *vmp = NULL;
 
-        this_count += n_emitted;
         while (n_emitted > 0) {
           int idx = bisect_high(ccdo->cum_area, ccdo->n_sides,
                             rng_dbl(world->rng) *
@@ -3907,7 +4200,7 @@ void run_concentration_clamp(struct volume *world, double t_now) {
                                                 .z = 0
                                                };
           
-          vm.periodic_box = &periodic_box;
+          vm.periodic_box = periodic_box;
 
           if (vmp == NULL) {
             vmp = insert_volume_molecule(world, &vm, vmp);
@@ -3934,8 +4227,6 @@ void run_concentration_clamp(struct volume *world, double t_now) {
       }
     }
   }
-
-  total_count += this_count;
 }
 
 
@@ -3944,11 +4235,24 @@ void run_concentration_clamp(struct volume *world, double t_now) {
  * redo_collision list is a helper function used in diffuse_3D to compute the
  * list of possible collisions in neighboring subvolumes.
  *
+ * exp_llf and exp_urb bound every path the current list was collected for.
+ * If the new path stays inside them the list is kept as it is.  Otherwise
+ * the list is rebuilt for every path the rest of the step could take, so
+ * that further reflections in this subvolume can reuse it.
+ *
  ******************************************************************************/
 void redo_collision_list(struct volume* world, struct collision** shead,
-  struct collision** stail, struct collision** shead_exp, struct volume_molecule* m,
+  struct collision** stail, struct collision** shead_exp,
+  struct vector3* exp_llf, struct vector3* exp_urb, struct volume_molecule* m,
   struct vector3* displacement, struct subvolume* sv) {
 
+  struct vector3 path_llf, path_urb;
+  path_bounding_box(&m->pos, displacement, &path_llf, &path_urb,
+                    world->rx_radius_3d);
+  if (box_contains_box(exp_llf, exp_urb, &path_llf, &path_urb)) {
+    return;
+  }
+
   struct collision* st = *stail;
   struct collision* sh = *shead_exp;
   if (st != NULL) {
@@ -3963,7 +4267,10 @@ void redo_collision_list(struct volume* world, struct collision** shead,
     *shead = NULL;
   }
   if ((m->properties->flags & (CAN_VOLVOL | CANT_INITIATE)) == CAN_VOLVOL) {
-    sh = expand_collision_list(m, displacement, sv, world->rx_radius_3d,
+    reach_bounding_box(&m->pos, displacement, exp_llf, exp_urb,
+                       world->rx_radius_3d);
+    sh = expand_collision_list(m, exp_llf, exp_urb, sv, world->subvol,
+      world->rx_radius_3d,
       world->ny_parts, world->nz_parts, world->x_fineparts,
       world->y_fineparts, world->z_fineparts, world->rx_hashsize,
       world->reaction_hash);
@@ -4006,12 +4313,9 @@ static int collide_and_react_with_vol_mol(struct volume* world,
 
   double scaling = factor * r_rate_factor;
   struct rxn* rx = smash->intermediate;
-  if ((rx != NULL) && (rx->prob_t != NULL)) {
-    update_probs(world, rx, m->t);
-  }
 
   struct species *spec = m->properties;
-  struct periodic_image *periodic_box = m->periodic_box;
+  struct periodic_image *periodic_box = &m->periodic_box;
   int i = test_bimolecular(
     rx, scaling, 0, am, (struct abstract_molecule *)m, world->rng);
 
@@ -4101,7 +4405,7 @@ int collide_and_react_with_surf_mol(struct volume* world, struct collision* smas
   struct rxn *matching_rxns[MAX_MATCHING_RXNS];
   double scaling_coef[MAX_MATCHING_RXNS];
   struct species* spec = m->properties;
-  struct periodic_image *periodic_box = m->periodic_box;
+  struct periodic_image *periodic_box = &m->periodic_box;
   int ii = 0, jj = 0;
   if (mol_grid_flag) {
     num_matching_rxns = trigger_bimolecular(
@@ -4115,8 +4419,6 @@ int collide_and_react_with_surf_mol(struct volume* world, struct collision* smas
       }
 
       for (int l = 0; l < num_matching_rxns; l++) {
-        if (matching_rxns[l]->prob_t != NULL)
-          update_probs(world, matching_rxns[l], m->t);
         scaling_coef[l] = r_rate_factor / w->grid->binding_factor;
       }
 
@@ -4165,16 +4467,15 @@ int collide_and_react_with_surf_mol(struct volume* world, struct collision* smas
   /* test for the trimolecular reactions of the type MOL_GRID_GRID */
   if (mol_grid_grid_flag) {
     struct surface_molecule *smp; /* Neighboring molecules */
-    struct tile_neighbor *tile_nbr_head = NULL, *curr;
-    int list_length = 0;
+    struct tile_nbr_buf nbrs;
     int n = 0; /* total number of possible reactions for a given
                    molecule with all its neighbors */
 
     /* find neighbor molecules to react with */
-    find_neighbor_tiles(world, sm, sm->grid, sm->grid_index, 0, 1,
-      &tile_nbr_head, &list_length);
-    if (tile_nbr_head != NULL) {
-      const int num_nbrs = (const int)list_length;
+    init_tile_nbr_buf(&nbrs);
+    get_neighbor_tiles(world, sm, sm->grid, sm->grid_index, 0, 1, &nbrs);
+    if (nbrs.n_tiles > 0) {
+      const int num_nbrs = nbrs.n_tiles;
       double local_prob_factor; /*local probability factor for the
                                    reaction */
       int max_size = num_nbrs * MAX_MATCHING_RXNS;
@@ -4195,9 +4496,9 @@ int collide_and_react_with_surf_mol(struct volume* world, struct collision* smas
 
       /* step through the neighbors */
       int ll = 0;
-      for (curr = tile_nbr_head; curr != NULL; curr = curr->next) {
-        sm_list = curr->grid->sm_list[curr->idx];
-        if (sm_list == NULL || sm_list->sm == NULL)
+      for (int nn = 0; nn < nbrs.n_tiles; nn++) {
+        struct tile_ref *curr = &nbrs.tiles[nn];
+        if (!get_bit(curr->grid->occupancy, curr->idx))
           continue;
         smp = curr->grid->sm_list[curr->idx]->sm;
 
@@ -4232,9 +4533,6 @@ int collide_and_react_with_surf_mol(struct volume* world, struct collision* smas
               world->vol_surf_surf_colls++;
           }
           for (j = 0; j < num_matching_rxns; j++) {
-            if (matching_rxns[j]->prob_t != NULL) {
-              update_probs(world, matching_rxns[j], m->t);
-            }
             rxn_array[ll] = matching_rxns[j];
             cf[ll] = r_rate_factor / (w->grid->binding_factor *
                                       curr->grid->binding_factor);
@@ -4244,7 +4542,7 @@ int collide_and_react_with_surf_mol(struct volume* world, struct collision* smas
           n += num_matching_rxns;
         }
       }
-      delete_tile_neighbor_list(tile_nbr_head);
+      free_tile_nbr_buf(&nbrs);
 
       if (n == 1) {
         ii = test_bimolecular(rxn_array[0], cf[0], local_prob_factor,
@@ -4364,7 +4662,7 @@ int collide_and_react_with_walls(struct volume* world, struct collision* smash,
     world->vol_wall_colls++;
   }
 
-  struct periodic_image *periodic_box = m->periodic_box;
+  struct periodic_image *periodic_box = &m->periodic_box;
   if (is_transp_flag) {
     transp_rx->n_occurred++;
     if ((m->flags & COUNT_ME) != 0 && (spec->flags & COUNT_SOME_MASK) != 0) {
@@ -4382,11 +4680,6 @@ int collide_and_react_with_walls(struct volume* world, struct collision* smash,
   } else if (inertness < inert_to_all) {
     /* Collisions with the surfaces declared REFLECTIVE are treated similar to
      * the default surfaces after this loop. */
-    for (int l = 0; l < num_matching_rxns; l++) {
-      if (matching_rxns[l]->prob_t != NULL) {
-        update_probs(world, matching_rxns[l], m->t);
-      }
-    }
     int jj = 0;
     int i = 0;
     if (num_matching_rxns == 1) {
@@ -4501,7 +4794,7 @@ int reflect_or_periodic_bc(
 
   // X direction: reflect or periodic BC
   if (periodic_x) {
-    int x_inc = (vm->periodic_box->x % 2 == 0) ? 1 : -1;
+    int x_inc = (vm->periodic_box.x % 2 == 0) ? 1 : -1;
     if (!distinguishable(vm->pos.x, llx, EPS_C)) {
       x_pos = urx - EPS_C;
       box_inc_x = -x_inc;
@@ -4528,7 +4821,7 @@ int reflect_or_periodic_bc(
 
   // Y direction: reflect or periodic BC
   if (periodic_y) {
-    int y_inc = (vm->periodic_box->y % 2 == 0) ? 1 : -1;
+    int y_inc = (vm->periodic_box.y % 2 == 0) ? 1 : -1;
     if (!distinguishable(vm->pos.y, lly, EPS_C)) {
       y_pos = ury - EPS_C;
       box_inc_y = -y_inc;
@@ -4556,7 +4849,7 @@ int reflect_or_periodic_bc(
 
   // Z direction: reflect or periodic BC
   if (periodic_z) {
-    int z_inc = (vm->periodic_box->z % 2 == 0) ? 1 : -1;
+    int z_inc = (vm->periodic_box.z % 2 == 0) ? 1 : -1;
     if (!distinguishable(vm->pos.z, llz, EPS_C)) {
       z_pos = urz - EPS_C;
       box_inc_z = -z_inc;
@@ -4624,17 +4917,17 @@ int reflect_or_periodic_bc(
       if (vm->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) {
         count_region_from_scratch(world, (struct abstract_molecule *)vm, NULL,
                                   -1, &(orig_pos), NULL, reflect_t,
-                                  vm->periodic_box);
+                                  &vm->periodic_box);
       }
       struct volume_molecule *new_m = migrate_volume_molecule(vm, nsv);
-      vm->periodic_box->x += box_inc_x;
-      vm->periodic_box->y += box_inc_y;
-      vm->periodic_box->z += box_inc_z;
+      vm->periodic_box.x += box_inc_x;
+      vm->periodic_box.y += box_inc_y;
+      vm->periodic_box.z += box_inc_z;
       // increment counts of regions we are entering
       if (new_m->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) {
         count_region_from_scratch(world, (struct abstract_molecule *)new_m,
                                   NULL, 1, &(new_m->pos), NULL, reflect_t,
-                                  new_m->periodic_box);
+                                  &new_m->periodic_box);
       }
       *mol = new_m;
     }
@@ -4697,7 +4990,7 @@ int reflect_or_periodic_bc(
             COUNT_SOME_MASK)) {
         continue;
       }
-      count_region_update(world, m->properties, m->id, m->periodic_box,
+      count_region_update(world, m->properties, m->id, &m->periodic_box,
         ((struct wall *)ttv->target)->counting_regions,
         ((ttv->what & COLLIDE_MASK) == COLLIDE_FRONT) ? 1 : -1, 0, &(ttv->loc), ttv->t);
       if (ttv == smash)
@@ -4743,7 +5036,7 @@ void collide_and_react_with_subvol(struct volume* world, struct collision *smash
       if (!(spec->flags & ((struct wall *)ttv->target)->flags & COUNT_SOME_MASK)) {
         continue;
       }
-      count_region_update(world, spec, m->id, m->periodic_box,
+      count_region_update(world, spec, m->id, &m->periodic_box,
           ((struct wall *)ttv->target)->counting_regions,
           ((ttv->what & COLLIDE_MASK) == COLLIDE_FRONT) ? 1 : -1, 1, &(ttv->loc), ttv->t);
     }
@@ -4764,8 +5057,7 @@ void collide_and_react_with_subvol(struct volume* world, struct collision *smash
   }
 
   struct subvolume *nsv = traverse_subvol(
-    m->subvol, smash->what - COLLIDE_SV_NX - COLLIDE_SUBVOL, world->ny_parts,
-    world->nz_parts);
+    world, m->subvol, smash->what - COLLIDE_SV_NX - COLLIDE_SUBVOL);
   if (nsv == NULL) {
     mcell_internal_error(
         "A %s molecule escaped the world at [%.2f, %.2f, %.2f]",
@@ -4815,7 +5107,9 @@ void compute_displacement(struct volume* world, struct collision* shead,
     *r_rate_factor = *rate_factor = 1.0;
     *steps = 1.0;
   } else {
-    if (max_time > MULTISTEP_WORTHWHILE) {
+    /* Well-mixed species take single steps, since the hop rates out of the
+     * compartments match the flux of molecules taking single steps in */
+    if (max_time > MULTISTEP_WORTHWHILE && (spec->flags & WELL_MIXED) == 0) {
       *steps = safe_diffusion_step(m, shead, world->radial_subdivisions,
         world->r_step, world->x_fineparts, world->y_fineparts, world->z_fineparts);
     } else {
@@ -4853,6 +5147,7 @@ void compute_displacement(struct volume* world, struct collision* shead,
   }
   world->diffusion_number++;
   world->diffusion_cumtime += *steps;
+  COUNT_SUBVOL_LOAD(world, m->subvol, diffusion_steps, 1);
 }
 
 
@@ -4874,30 +5169,24 @@ void determine_mol_mol_reactions(struct volume* world, struct volume_molecule* m
   struct rxn *matching_rxns[MAX_MATCHING_RXNS];
   int num_matching_rxns = 0;
   struct species* spec = m->properties;
-  struct per_species_list *psl_next, *psl, **psl_head = &sv->species_head;
-  for (psl = sv->species_head; psl != NULL; psl = psl_next) {
-    psl_next = psl->next;
-    if (psl->properties == NULL) {
-      psl_head = &psl->next;
-      continue;
-    }
+  long long n_candidates = 0;
+  int n_lists = 0;
+  for (int l = 0; l < sv->n_species_lists; l++) {
+    struct per_species_list *psl = sv->species_lists[l];
 
     /* Garbage collection of empty per-species lists */
     if (psl->head == NULL) {
-      *psl_head = psl->next;
-      ht_remove(&sv->mol_by_species, psl);
       mem_put(sv->local_storage->pslv, psl);
       continue;
-    } else
-      psl_head = &psl->next;
+    }
+    sv->species_lists[n_lists++] = psl;
 
     /* no possible reactions. skip it. */
-    if (!trigger_bimolecular_preliminary(world->reaction_hash, world->rx_hashsize,
-      m->properties->hashval, psl->properties->hashval, m->properties, psl->properties)) {
+    if (!may_react_with(m->properties, psl->properties))
       continue;
-    }
 
     for (struct volume_molecule* mp = psl->head; mp != NULL; mp = mp->next_v) {
+      n_candidates++;
       if (mp == m) {
         continue;
       }
@@ -4907,7 +5196,7 @@ void determine_mol_mol_reactions(struct volume* world, struct volume_molecule* m
       }
 
       // count only in the relevant periodic box
-      if (!periodic_boxes_are_identical(m->periodic_box, mp->periodic_box)) {
+      if (!periodic_boxes_are_identical(&m->periodic_box, &mp->periodic_box)) {
         continue;
       }
 
@@ -4932,6 +5221,8 @@ void determine_mol_mol_reactions(struct volume* world, struct volume_molecule* m
       }
     }
   }
+  sv->n_species_lists = n_lists;
+  COUNT_SUBVOL_LOAD(world, sv, mol_candidates, n_candidates);
 }
 
 
@@ -5039,7 +5330,7 @@ bool periodicbox_in_surfmol_list(
        sml_curr != NULL;
        sml_curr = sml_curr->next) {
     struct surface_molecule *sm = sml_curr->sm;
-    if (sm && periodic_boxes_are_identical(periodic_box, sm->periodic_box)) {
+    if (sm && periodic_boxes_are_identical(periodic_box, &sm->periodic_box)) {
       return true;
     }
   }
@@ -61,14 +61,18 @@ struct wall *ray_trace_2D(struct volume *world, struct surface_molecule *sm,
 
 struct collision *ray_trace(struct volume *world, struct vector3 *init_pos,
                             struct collision *c, struct subvolume *sv,
-                            struct vector3 *v, struct wall *reflectee);
+                            struct vector3 *v, struct wall *reflectee,
+                            struct collision_buffer *hits);
+
+void collision_buffer_clear(struct collision_buffer *cb);
 
 struct sp_collision *ray_trace_trimol(struct volume *world,
                                       struct volume_molecule *m,
                                       struct sp_collision *c,
                                       struct subvolume *sv, struct vector3 *v,
                                       struct wall *reflectee,
-                                      double walk_start_time);
+                                      double walk_start_time,
+                                      struct sp_collision_buffer *hits);
 
 struct volume_molecule *diffuse_3D(struct volume *world,
                                    struct volume_molecule *m, double max_time);
@@ -127,6 +131,8 @@ double exact_disk(struct volume *world, struct vector3 *loc, struct vector3 *mv,
                   double *x_fineparts, double *y_fineparts,
                   double *z_fineparts);
 
+void delete_exd_cache(struct exd_cache *cache);
+
 bool periodicbox_in_surfmol_list(
     struct periodic_image *periodic_box,
     struct surface_molecule_list *sml);
@@ -41,6 +41,47 @@
 #include "wall_util.h"
 #include "react.h"
 #include "react_output.h"
+#include "volume_output.h"
+
+/**********************************************************************
+sp_collision_buffer_get, sp_collision_buffer_insert,
+sp_collision_buffer_clear:
+  The sp_collision counterparts of collision_buffer_get,
+  collision_buffer_insert and collision_buffer_clear in diffuse.c.
+**********************************************************************/
+static struct sp_collision *
+sp_collision_buffer_get(struct sp_collision_buffer *cb) {
+  if (cb->n_coll++ < COLLISION_BUFFER_INLINE)
+    return &cb->inline_coll[cb->n_coll - 1];
+  return (struct sp_collision *)CHECKED_MEM_GET(cb->spill,
+                                                "collision structure");
+}
+
+static void sp_collision_buffer_insert(struct sp_collision_buffer *cb,
+                                       struct sp_collision *c) {
+  if (cb->n_coll <= COLLISION_BUFFER_INLINE) {
+    ae_list_insert_sorted((struct abstract_element **)&cb->head,
+                          (struct abstract_element *)c);
+  } else {
+    c->next = cb->head;
+    cb->head = c;
+  }
+}
+
+static void sp_collision_buffer_clear(struct sp_collision_buffer *cb) {
+  if (cb->n_coll > COLLISION_BUFFER_INLINE) {
+    struct sp_collision *first = &cb->inline_coll[0];
+    struct sp_collision *last = &cb->inline_coll[COLLISION_BUFFER_INLINE];
+    struct sp_collision *next;
+    for (struct sp_collision *c = cb->head; c != NULL; c = next) {
+      next = c->next;
+      if (c < first || c >= last)
+        mem_put(cb->spill, c);
+    }
+  }
+  cb->head = NULL;
+  cb->n_coll = 0;
+}
 
 /**********************************************************************
 ray_trace_trimol:
@@ -51,10 +92,11 @@ ray_trace_trimol:
       wall we have reflected off of and should not hit again
       start time of the  molecule random walk (local
          to the molecule timestep)
+      buffer to store the collisions in
   Out: collision list of walls and molecules we intersected along our ray
-       (current subvolume only), plus the subvolume wall.  Will always
-       return at least the subvolume wall--NULL indicates an out of
-       memory eriror.
+       (current subvolume only), plus the subvolume wall, sorted by time.
+       Will always return at least the subvolume wall.  The list belongs
+       to the buffer; release it with sp_collision_buffer_clear.
   Note: This is a version of the "ray_trace()" function adapted for
         the case when moving molecule can engage in trimolecular collisions
 
@@ -64,8 +106,9 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
                                       struct sp_collision *c,
                                       struct subvolume *sv, struct vector3 *v,
                                       struct wall *reflectee,
-                                      double walk_start_time) {
-  struct sp_collision *smash, *shead;
+                                      double walk_start_time,
+                                      struct sp_collision_buffer *hits) {
+  struct sp_collision *smash;
   struct abstract_molecule *a;
   struct wall_list *wlp;
   struct wall_list fake_wlp;
@@ -73,13 +116,15 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
   /* time, in units of of the molecule's time step, at which molecule
      will cross the x,y,z partitions, respectively. */
   double tx, ty, tz;
+  double t_hit;
+  struct vector3 loc_hit;
   int i, j, k;
 
   world->ray_voxel_tests++;
 
-  shead = NULL;
-  smash = (struct sp_collision *)CHECKED_MEM_GET(sv->local_storage->sp_coll,
-                                                 "collision structure");
+  hits->head = NULL;
+  hits->spill = sv->local_storage->sp_coll;
+  hits->n_coll = 0;
 
   fake_wlp.next = sv->wall_head;
 
@@ -87,17 +132,19 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
     if (wlp->this_wall == reflectee)
       continue;
 
-    i = collide_wall(&(m->pos), v, wlp->this_wall, &(smash->t), &(smash->loc),
+    i = collide_wall(&(m->pos), v, wlp->this_wall, &t_hit, &loc_hit,
                      1, world->rng, world->notify, &(world->ray_polygon_tests));
+    COUNT_SUBVOL_LOAD(world, sv, wall_collisions, 1);
     if (i == COLLIDE_REDO) {
-      if (shead != NULL)
-        mem_put_list(sv->local_storage->sp_coll, shead);
-      shead = NULL;
+      sp_collision_buffer_clear(hits);
       wlp = &fake_wlp;
       continue;
     } else if (i != COLLIDE_MISS) {
       world->ray_polygon_colls++;
 
+      smash = sp_collision_buffer_get(hits);
+      smash->t = t_hit;
+      smash->loc = loc_hit;
       smash->what = COLLIDE_WALL + i;
       smash->moving = m->properties;
       smash->target = (void *)wlp->this_wall;
@@ -110,14 +157,12 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
       smash->disp.x = v->x;
       smash->disp.y = v->y;
       smash->disp.z = v->z;
-
-      smash->next = shead;
-      shead = smash;
-      smash = (struct sp_collision *)CHECKED_MEM_GET(sv->local_storage->sp_coll,
-                                                     "collision structure");
+      sp_collision_buffer_insert(hits, smash);
     }
   }
 
+  smash = sp_collision_buffer_get(hits);
+
   dx = dy = dz = 0.0;
   i = -10;
   if (v->x < 0.0) {
@@ -242,9 +287,7 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
   smash->disp.x = v->x;
   smash->disp.y = v->y;
   smash->disp.z = v->z;
-
-  smash->next = shead;
-  shead = smash;
+  sp_collision_buffer_insert(hits, smash);
 
   for (; c != NULL; c = c->next) {
     a = (struct abstract_molecule *)c->target;
@@ -253,8 +296,7 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
 
     i = collide_mol(&(m->pos), v, a, &(c->t), &(c->loc), world->rx_radius_3d);
     if (i != COLLIDE_MISS) {
-      smash = (struct sp_collision *)CHECKED_MEM_GET(sv->local_storage->sp_coll,
-                                                     "collision structure");
+      smash = sp_collision_buffer_get(hits);
       memcpy(smash, c, sizeof(struct sp_collision));
 
       smash->t_start = walk_start_time;
@@ -265,229 +307,232 @@ struct sp_collision *ray_trace_trimol(struct volume *world,
       smash->disp.x = v->x;
       smash->disp.y = v->y;
       smash->disp.z = v->z;
-
-      smash->next = shead;
-      shead = smash;
+      sp_collision_buffer_insert(hits, smash);
     }
   }
 
-  return shead;
+  if (hits->n_coll > COLLISION_BUFFER_INLINE) {
+    hits->head = (struct sp_collision *)ae_list_sort(
+        (struct abstract_element *)hits->head);
+  }
+  return hits->head;
 }
 
 /****************************************************************************
 expand_collision_partner_list:
   In: molecule that is moving
       displacement to the new location
+      lower left front corner of the box around the path
+      upper right back corner of the box around the path
       subvolume that we start in
+      the table of subvolumes
   Out: Returns linked list of molecules from neighbor subvolumes
        that are located within "interaction_radius" from the the subvolume
        border.
-       The molecules are added only when the molecule displacement
-       bounding box intersects with the subvolume bounding box.
+       The molecules are added only when the path bounding box (see
+       path_bounding_box and reach_bounding_box) intersects with the
+       subvolume bounding box.
   Note:  This is a version of the function "expand_collision_list()"
         adapted for the case when molecule can engage in trimolecular
         collisions.
 ****************************************************************************/
 static struct sp_collision *expand_collision_partner_list(
-    struct volume_molecule *m, struct vector3 *mv, struct subvolume *sv,
-    double rx_radius_3d, double *x_fineparts, double *y_fineparts,
-    double *z_fineparts, int nx_parts, int ny_parts, int nz_parts,
-    int rx_hashsize, struct rxn **reaction_hash) {
+    struct volume_molecule *m, struct vector3 *mv, struct vector3 *path_llf,
+    struct vector3 *path_urb, struct subvolume *sv, struct subvolume **subvol,
+    double rx_radius_3d,
+    double *x_fineparts, double *y_fineparts, double *z_fineparts,
+    int nx_parts, int ny_parts, int nz_parts, int rx_hashsize,
+    struct rxn **reaction_hash) {
   struct sp_collision *shead1 = NULL;
-  /* lower left and upper_right corners of the molecule path
-     bounding box expanded by R. */
-  struct vector3 path_llf, path_urb;
   double R; /* molecule interaction radius */
   R = (rx_radius_3d);
-
-  /* find the molecule path bounding box. */
-  path_bounding_box(&m->pos, mv, &path_llf, &path_urb, rx_radius_3d);
+  struct subvolume **here = subvol + sv->index;
 
   /* Decide which directions we need to go */
   int x_neg = 0, x_pos = 0, y_neg = 0, y_pos = 0, z_neg = 0, z_pos = 0;
-  if (!(sv->world_edge & X_POS_BIT) && path_urb.x + R > x_fineparts[sv->urb.x])
+  if (!(sv->world_edge & X_POS_BIT) && path_urb->x + R > x_fineparts[sv->urb.x])
     x_pos = 1;
-  if (!(sv->world_edge & X_NEG_BIT) && path_llf.x - R < x_fineparts[sv->llf.x])
+  if (!(sv->world_edge & X_NEG_BIT) && path_llf->x - R < x_fineparts[sv->llf.x])
     x_neg = 1;
-  if (!(sv->world_edge & Y_POS_BIT) && path_urb.y + R > y_fineparts[sv->urb.y])
+  if (!(sv->world_edge & Y_POS_BIT) && path_urb->y + R > y_fineparts[sv->urb.y])
     y_pos = 1;
-  if (!(sv->world_edge & Y_NEG_BIT) && path_llf.y - R < y_fineparts[sv->llf.y])
+  if (!(sv->world_edge & Y_NEG_BIT) && path_llf->y - R < y_fineparts[sv->llf.y])
     y_neg = 1;
-  if (!(sv->world_edge & Z_POS_BIT) && path_urb.z + R > z_fineparts[sv->urb.z])
+  if (!(sv->world_edge & Z_POS_BIT) && path_urb->z + R > z_fineparts[sv->urb.z])
     z_pos = 1;
-  if (!(sv->world_edge & Z_NEG_BIT) && path_llf.z - R < z_fineparts[sv->llf.z])
+  if (!(sv->world_edge & Z_NEG_BIT) && path_llf->z - R < z_fineparts[sv->llf.z])
     z_neg = 1;
 
   /* go +X */
   if (x_pos) {
-    struct subvolume *newsv_x = sv + (nz_parts - 1) * (ny_parts - 1);
+    struct subvolume **newsv_x = here + (nz_parts - 1) * (ny_parts - 1);
     shead1 = expand_collision_partner_list_for_neighbor(
-        sv, m, mv, newsv_x, &path_llf, &path_urb, shead1, R, 0.0, 0.0,
+        sv, m, mv, *newsv_x, path_llf, path_urb, shead1, R, 0.0, 0.0,
         x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +X, +Y */
     if (y_pos) {
-      struct subvolume *newsv_y = newsv_x + (nz_parts - 1);
+      struct subvolume **newsv_y = newsv_x + (nz_parts - 1);
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y, &path_llf, &path_urb, shead1, R, R, 0.0,
+          sv, m, mv, *newsv_y, path_llf, path_urb, shead1, R, R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, +Y, +Z */
       if (z_pos)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y + 1, &path_llf, &path_urb, shead1, R, R, R,
+            sv, m, mv, newsv_y[1], path_llf, path_urb, shead1, R, R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, +Y, -Z */
       if (z_neg)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y - 1, &path_llf, &path_urb, shead1, R, R, -R,
+            sv, m, mv, newsv_y[-1], path_llf, path_urb, shead1, R, R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go +X, -Y */
     if (y_neg) {
-      struct subvolume *newsv_y = newsv_x - (nz_parts - 1);
+      struct subvolume **newsv_y = newsv_x - (nz_parts - 1);
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y, &path_llf, &path_urb, shead1, R, -R, 0.0,
+          sv, m, mv, *newsv_y, path_llf, path_urb, shead1, R, -R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, -Y, +Z */
       if (z_pos)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y + 1, &path_llf, &path_urb, shead1, R, -R, R,
+            sv, m, mv, newsv_y[1], path_llf, path_urb, shead1, R, -R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go +X, -Y, -Z */
       if (z_neg)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y - 1, &path_llf, &path_urb, shead1, R, -R, -R,
+            sv, m, mv, newsv_y[-1], path_llf, path_urb, shead1, R, -R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go +X, +Z */
     if (z_pos)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_x + 1, &path_llf, &path_urb, shead1, R, 0.0, R,
+          sv, m, mv, newsv_x[1], path_llf, path_urb, shead1, R, 0.0, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +X, -Z */
     if (z_neg)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_x - 1, &path_llf, &path_urb, shead1, R, 0.0, -R,
+          sv, m, mv, newsv_x[-1], path_llf, path_urb, shead1, R, 0.0, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go -X */
   if (x_neg) {
-    struct subvolume *newsv_x = sv - (nz_parts - 1) * (ny_parts - 1);
+    struct subvolume **newsv_x = here - (nz_parts - 1) * (ny_parts - 1);
     shead1 = expand_collision_partner_list_for_neighbor(
-        sv, m, mv, newsv_x, &path_llf, &path_urb, shead1, -R, 0.0, 0.0,
+        sv, m, mv, *newsv_x, path_llf, path_urb, shead1, -R, 0.0, 0.0,
         x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -X, +Y */
     if (y_pos) {
-      struct subvolume *newsv_y = newsv_x + (nz_parts - 1);
+      struct subvolume **newsv_y = newsv_x + (nz_parts - 1);
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y, &path_llf, &path_urb, shead1, -R, R, 0.0,
+          sv, m, mv, *newsv_y, path_llf, path_urb, shead1, -R, R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, +Y, +Z */
       if (z_pos)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y + 1, &path_llf, &path_urb, shead1, -R, R, R,
+            sv, m, mv, newsv_y[1], path_llf, path_urb, shead1, -R, R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, +Y, -Z */
       if (z_neg)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y - 1, &path_llf, &path_urb, shead1, -R, R, -R,
+            sv, m, mv, newsv_y[-1], path_llf, path_urb, shead1, -R, R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go -X, -Y */
     if (y_neg) {
-      struct subvolume *newsv_y = newsv_x - (nz_parts - 1);
+      struct subvolume **newsv_y = newsv_x - (nz_parts - 1);
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y, &path_llf, &path_urb, shead1, -R, -R, 0.0,
+          sv, m, mv, *newsv_y, path_llf, path_urb, shead1, -R, -R, 0.0,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, -Y, +Z */
       if (z_pos)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y + 1, &path_llf, &path_urb, shead1, -R, -R, R,
+            sv, m, mv, newsv_y[1], path_llf, path_urb, shead1, -R, -R, R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
       /* go -X, -Y, -Z */
       if (z_neg)
         shead1 = expand_collision_partner_list_for_neighbor(
-            sv, m, mv, newsv_y - 1, &path_llf, &path_urb, shead1, -R, -R, -R,
+            sv, m, mv, newsv_y[-1], path_llf, path_urb, shead1, -R, -R, -R,
             x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
     }
 
     /* go -X, +Z */
     if (z_pos)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_x + 1, &path_llf, &path_urb, shead1, -R, 0.0, R,
+          sv, m, mv, newsv_x[1], path_llf, path_urb, shead1, -R, 0.0, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -X, -Z */
     if (z_neg)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_x - 1, &path_llf, &path_urb, shead1, -R, 0.0, -R,
+          sv, m, mv, newsv_x[-1], path_llf, path_urb, shead1, -R, 0.0, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go +Y */
   if (y_pos) {
-    struct subvolume *newsv_y = sv + (nz_parts - 1);
+    struct subvolume **newsv_y = here + (nz_parts - 1);
     shead1 = expand_collision_partner_list_for_neighbor(
-        sv, m, mv, newsv_y, &path_llf, &path_urb, shead1, 0.0, R, 0.0,
+        sv, m, mv, *newsv_y, path_llf, path_urb, shead1, 0.0, R, 0.0,
         x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +Y, +Z */
     if (z_pos)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y + 1, &path_llf, &path_urb, shead1, 0.0, R, R,
+          sv, m, mv, newsv_y[1], path_llf, path_urb, shead1, 0.0, R, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go +Y, -Z */
     if (z_neg)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y - 1, &path_llf, &path_urb, shead1, 0.0, R, -R,
+          sv, m, mv, newsv_y[-1], path_llf, path_urb, shead1, 0.0, R, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go -Y */
-  if (y_pos) {
-    struct subvolume *newsv_y = sv - (nz_parts - 1);
+  if (y_neg) {
+    struct subvolume **newsv_y = here - (nz_parts - 1);
     shead1 = expand_collision_partner_list_for_neighbor(
-        sv, m, mv, newsv_y, &path_llf, &path_urb, shead1, 0.0, -R, 0.0,
+        sv, m, mv, *newsv_y, path_llf, path_urb, shead1, 0.0, -R, 0.0,
         x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -Y, +Z */
     if (z_pos)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y + 1, &path_llf, &path_urb, shead1, 0.0, -R, R,
+          sv, m, mv, newsv_y[1], path_llf, path_urb, shead1, 0.0, -R, R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
     /* go -Y, -Z */
     if (z_neg)
       shead1 = expand_collision_partner_list_for_neighbor(
-          sv, m, mv, newsv_y - 1, &path_llf, &path_urb, shead1, 0.0, -R, -R,
+          sv, m, mv, newsv_y[-1], path_llf, path_urb, shead1, 0.0, -R, -R,
           x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
   }
 
   /* go +Z */
   if (z_pos)
     shead1 = expand_collision_partner_list_for_neighbor(
-        sv, m, mv, sv + 1, &path_llf, &path_urb, shead1, 0.0, 0.0, R,
+        sv, m, mv, here[1], path_llf, path_urb, shead1, 0.0, 0.0, R,
         x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
   /* go -Z */
   if (z_neg)
     shead1 = expand_collision_partner_list_for_neighbor(
-        sv, m, mv, sv - 1, &path_llf, &path_urb, shead1, 0.0, 0.0, -R,
+        sv, m, mv, here[-1], path_llf, path_urb, shead1, 0.0, 0.0, -R,
         x_fineparts, y_fineparts, z_fineparts, rx_hashsize, reaction_hash);
 
   return shead1;
@@ -514,7 +559,11 @@ struct volume_molecule *diffuse_3D_big_list(struct volume *world,
   struct sp_collision *stail; /* tail of the collision list shead */
   struct sp_collision *shead_exp; /* Things we might hit (can interact with)
                                      from neighbor subvolumes */
+  struct vector3 exp_llf, exp_urb; /* Box around every path shead_exp was
+                                      collected for */
+  struct vector3 path_llf, path_urb; /* Box around the current path */
   struct sp_collision *shead2; /* Things that we will hit, given our motion */
+  struct sp_collision_buffer hits; /* Storage for shead2 */
 
   struct sp_collision *main_shead2 =
       NULL; /* Things that we will hit, given our motion */
@@ -564,7 +613,7 @@ struct volume_molecule *diffuse_3D_big_list(struct volume *world,
       col_mol_mol_grid_flag;
 
   struct species *spec = m->properties;
-  struct periodic_image *periodic_box = m->periodic_box;
+  struct periodic_image *periodic_box = &m->periodic_box;
   if (spec == NULL)
     mcell_internal_error(
         "Attempted to take a diffusion step for a defunct molecule.");
@@ -621,6 +670,8 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
   stail = NULL;
   shead_exp = NULL;
   shead2 = NULL;
+  exp_llf.x = exp_llf.y = exp_llf.z = GIGANTIC;
+  exp_urb.x = exp_urb.y = exp_urb.z = -GIGANTIC;
 
   if (calculate_displacement) {
     if (m->flags &
@@ -689,6 +740,7 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
 
     world->diffusion_number++;
     world->diffusion_cumtime += steps;
+    COUNT_SUBVOL_LOAD(world, m->subvol, diffusion_steps, 1);
   }
 
   moving_bi_molecular_flag =
@@ -703,23 +755,16 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
   if (moving_tri_molecular_flag || moving_bi_molecular_flag ||
       moving_mol_mol_grid_flag) {
     /* scan molecules from this SV */
-    struct per_species_list *psl_next, *psl,
-        **psl_head = &m->subvol->species_head;
-    for (psl = m->subvol->species_head; psl != NULL; psl = psl_next) {
-      psl_next = psl->next;
-      if (psl->properties == NULL) {
-        psl_head = &psl->next;
-        continue;
-      }
+    int n_lists = 0;
+    for (int l = 0; l < sv->n_species_lists; l++) {
+      struct per_species_list *psl = sv->species_lists[l];
 
       /* Garbage collection of empty per-species lists */
       if (psl->head == NULL) {
-        *psl_head = psl->next;
-        ht_remove(&sv->mol_by_species, psl);
         mem_put(sv->local_storage->pslv, psl);
         continue;
-      } else
-        psl_head = &psl->next;
+      }
+      sv->species_lists[n_lists++] = psl;
 
       col_bi_molecular_flag =
           moving_bi_molecular_flag &&
@@ -731,10 +776,7 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
           moving_mol_mol_grid_flag &&
           ((psl->properties->flags & CAN_VOLVOLSURF) == CAN_VOLVOLSURF);
 
-      if (col_bi_molecular_flag &&
-          !trigger_bimolecular_preliminary(
-               world->reaction_hash, world->rx_hashsize, spec->hashval,
-               psl->properties->hashval, spec, psl->properties))
+      if (col_bi_molecular_flag && !may_react_with(spec, psl->properties))
         col_bi_molecular_flag = 0;
 
       /* What types of collisions are we concerned with for this molecule type?
@@ -751,6 +793,7 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
        * local molecules to our collision list */
       if (what != 0) {
         for (mp = psl->head; mp != NULL; mp = mp->next_v) {
+          COUNT_SUBVOL_LOAD(world, m->subvol, mol_candidates, 1);
           if (mp == m)
             continue;
 
@@ -777,6 +820,7 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
         }
       }
     }
+    sv->n_species_lists = n_lists;
 
     if (world->use_expanded_list && shead != NULL) {
       for (stail = shead; stail->next != NULL; stail = stail->next) {
@@ -786,11 +830,14 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
     if (world->use_expanded_list &&
         (moving_tri_molecular_flag || moving_bi_molecular_flag ||
          moving_mol_mol_grid_flag)) {
+      path_bounding_box(&m->pos, &displacement, &exp_llf, &exp_urb,
+                        world->rx_radius_3d);
       shead_exp = expand_collision_partner_list(
-          m, &displacement, sv, world->rx_radius_3d, world->x_fineparts,
-          world->y_fineparts, world->z_fineparts, world->nx_parts,
-          world->ny_parts, world->nz_parts, world->rx_hashsize,
-          world->reaction_hash);
+          m, &displacement, &exp_llf, &exp_urb, sv, world->subvol,
+          world->rx_radius_3d,
+          world->x_fineparts, world->y_fineparts, world->z_fineparts,
+          world->nx_parts, world->ny_parts, world->nz_parts,
+          world->rx_hashsize, world->reaction_hash);
 
       if (stail != NULL)
         stail->next = shead_exp;
@@ -817,6 +864,15 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
   } while (0)
 
   do {
+    /* After a reflection the old list is still good if the new path stays
+       inside the box it was collected for */
+    if (world->use_expanded_list && redo_expand_collision_list_flag) {
+      path_bounding_box(&m->pos, &displacement, &path_llf, &path_urb,
+                        world->rx_radius_3d);
+      if (box_contains_box(&exp_llf, &exp_urb, &path_llf, &path_urb))
+        redo_expand_collision_list_flag = 0;
+    }
+
     if (world->use_expanded_list && redo_expand_collision_list_flag) {
       /* split the combined collision list into two original lists
          and remove old "shead_exp" */
@@ -833,11 +889,16 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
 
       if (moving_tri_molecular_flag || moving_bi_molecular_flag ||
           moving_mol_mol_grid_flag) {
+        /* Cover the rest of the step so that further reflections in this
+           subvolume can keep the list */
+        reach_bounding_box(&m->pos, &displacement, &exp_llf, &exp_urb,
+                           world->rx_radius_3d);
         shead_exp = expand_collision_partner_list(
-            m, &displacement, sv, world->rx_radius_3d, world->x_fineparts,
-            world->y_fineparts, world->z_fineparts, world->nx_parts,
-            world->ny_parts, world->nz_parts, world->rx_hashsize,
-            world->reaction_hash);
+            m, &displacement, &exp_llf, &exp_urb, sv, world->subvol,
+            world->rx_radius_3d,
+            world->x_fineparts, world->y_fineparts, world->z_fineparts,
+            world->nx_parts, world->ny_parts, world->nz_parts,
+            world->rx_hashsize, world->reaction_hash);
 
         /* combine two collision lists */
         if (shead_exp != NULL) {
@@ -853,15 +914,7 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
     }
 
     shead2 = ray_trace_trimol(world, m, shead, sv, &displacement, reflectee,
-                              t_start);
-
-    if (shead2 == NULL)
-      mcell_internal_error("ray_trace_trimol returned NULL.");
-
-    if (shead2->next != NULL) {
-      shead2 = (struct sp_collision *)ae_list_sort(
-          (struct abstract_element *)shead2);
-    }
+                              t_start, &hits);
 
     for (smash = shead2; smash != NULL; smash = smash->next) {
       if (smash->t >= 1.0 || smash->t < 0.0) {
@@ -1008,8 +1061,8 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
         if (t_steps < EPS_C)
           t_steps = EPS_C;
 
-        nsv = traverse_subvol(sv, smash->what - COLLIDE_SV_NX - COLLIDE_SUBVOL,
-                              world->ny_parts, world->nz_parts);
+        nsv = traverse_subvol(world, sv,
+                              smash->what - COLLIDE_SV_NX - COLLIDE_SUBVOL);
         if (nsv == NULL) {
           mcell_internal_error(
               "A %s molecule escaped the world at [%.2f, %.2f, %.2f]",
@@ -1027,7 +1080,7 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
         }
 
         if (shead2 != NULL) {
-          mem_put_list(sv->local_storage->sp_coll, shead2);
+          sp_collision_buffer_clear(&hits);
           shead2 = NULL;
         }
         if (shead != NULL) {
@@ -1045,13 +1098,13 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
     } /* end for (smash ...) */
 
     if (shead2 != NULL) {
-      mem_put_list(sv->local_storage->sp_coll, shead2);
+      sp_collision_buffer_clear(&hits);
       shead2 = NULL;
     }
   } while (smash != NULL);
 
   if (shead2 != NULL) {
-    mem_put_list(sv->local_storage->sp_coll, shead2);
+    sp_collision_buffer_clear(&hits);
     shead2 = NULL;
   }
   if (shead != NULL) {
@@ -1501,9 +1554,6 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
 
       k = tri_smash->orient;
 
-      if ((rx != NULL) && (rx->prob_t != NULL))
-        update_probs(world, rx, m->t);
-
       /* XXX: Change required here to support macromol+trimol */
       i = test_bimolecular(rx, tri_smash->factor, tri_smash->local_prob_factor,
                            NULL, NULL,
@@ -1617,8 +1667,6 @@ pretend_to_call_diffuse_3D_big_list: /* Label to allow fake recursion */
 
             continue; /* Ignore this wall and keep going */
           } else if (rx->n_pathways != RX_REFLEC) {
-            if (rx->prob_t != NULL)
-              update_probs(world, rx, m->t);
             i = test_intersect(rx, r_rate_factor, world->rng);
             if (i > RX_NO_RX) {
               /* Save m flags in case it gets collected in outcome_intersect */
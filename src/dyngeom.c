@@ -40,8 +40,185 @@
 #include "dyngeom_parse_extras.h"
 #include "mdlparse_aux.h"
 #include "react.h"
+#include "sym_table.h"
+#include "region_query.h"
 
-#define NO_MESH "\0"
+/***************************************************************************
+ intern_mesh_name: Look up the interned copy of a mesh name.
+
+ Mesh names are mapped to small integer ids which stay valid across dynamic
+ geometry changes (the objects themselves are thrown away and recreated). Id
+ 0 is reserved for "no mesh".
+
+ In:  state: MCell state
+      name: fully qualified mesh name
+ Out: The symbol for this mesh name. Its value is the mesh id and its name
+      lives as long as the simulation does.
+***************************************************************************/
+struct sym_entry *intern_mesh_name(struct volume *state, char const *name) {
+  if (state->mesh_id_table == NULL) {
+    state->mesh_id_table = init_symtab(1024);
+    if (state->mesh_id_table == NULL)
+      mcell_allocfailed("Failed to initialize mesh id table.");
+  }
+
+  struct sym_entry *sym = retrieve_sym(name, state->mesh_id_table);
+  if (sym == NULL) {
+    sym = store_sym(name, STR, state->mesh_id_table,
+                    (void *)(intptr_t)(++state->n_mesh_ids));
+    if (sym == NULL)
+      mcell_allocfailed("Failed to store mesh name in mesh id table.");
+  }
+  return sym;
+}
+
+/***************************************************************************
+ get_mesh_id:
+
+ In:  state: MCell state
+      obj_ptr: a polygon object
+ Out: The interned id of the object's name. The id is cached on the object, so
+      only the first lookup per object does any string work.
+***************************************************************************/
+int get_mesh_id(struct volume *state, struct object *obj_ptr) {
+  if (obj_ptr->mesh_id == 0) {
+    obj_ptr->mesh_id =
+        (int)(intptr_t)intern_mesh_name(state, obj_ptr->sym->name)->value;
+  }
+  return obj_ptr->mesh_id;
+}
+
+/***************************************************************************
+ mesh_id_pool_append:
+
+ In:  pool: growable array of mesh ids
+      mesh_id: id to append
+ Out: Nothing. mesh_id is added at the end of the pool.
+***************************************************************************/
+static void mesh_id_pool_append(struct mesh_id_pool *pool, int mesh_id) {
+  if (pool->n_ids == pool->max_ids) {
+    int new_max = (pool->max_ids == 0) ? 1024 : 2 * pool->max_ids;
+    int *new_ids = realloc(pool->ids, new_max * sizeof(int));
+    if (new_ids == NULL)
+      mcell_allocfailed("Failed to grow mesh nesting array.");
+    pool->ids = new_ids;
+    pool->max_ids = new_max;
+  }
+  pool->ids[pool->n_ids++] = mesh_id;
+}
+
+/***************************************************************************
+ make_ignored_mesh_ids:
+
+ In:  state: MCell state
+      meshes_to_ignore: names of meshes to ignore (or NULL)
+      n_flags: the size of the returned array is stored here
+ Out: Array indexed by mesh id that is nonzero for meshes we should ignore,
+      or NULL if there is nothing to ignore.
+***************************************************************************/
+static char *make_ignored_mesh_ids(struct volume *state,
+                                   struct string_buffer *meshes_to_ignore,
+                                   int *n_flags) {
+  *n_flags = 0;
+  if (meshes_to_ignore == NULL || meshes_to_ignore->n_strings == 0)
+    return NULL;
+
+  int ids[meshes_to_ignore->n_strings];
+  for (int i = 0; i < meshes_to_ignore->n_strings; i++)
+    ids[i] = (int)(intptr_t)intern_mesh_name(
+        state, meshes_to_ignore->strings[i])->value;
+
+  *n_flags = state->n_mesh_ids + 1;
+  char *ignore = CHECKED_MALLOC_ARRAY(char, *n_flags, "ignored mesh ids");
+  memset(ignore, 0, *n_flags);
+  for (int i = 0; i < meshes_to_ignore->n_strings; i++)
+    ignore[ids[i]] = 1;
+  return ignore;
+}
+
+/***************************************************************************
+ init_mesh_nesting_cache:
+
+ In:  state: MCell state
+      cache: per-subvolume cache to initialize
+      ignore: mesh ids to ignore while computing nesting (or NULL)
+      n_ignore: number of entries in ignore
+ Out: Nothing. Every subvolume starts out without a cached nesting.
+***************************************************************************/
+static void init_mesh_nesting_cache(struct volume *state,
+                                    struct mesh_nesting_cache *cache,
+                                    char const *ignore, int n_ignore) {
+  cache->sv_start = CHECKED_MALLOC_ARRAY(int, state->n_subvols,
+                                         "per-subvolume mesh nesting");
+  cache->sv_count = CHECKED_MALLOC_ARRAY(int, state->n_subvols,
+                                         "per-subvolume mesh nesting");
+  for (int i = 0; i < state->n_subvols; i++)
+    cache->sv_start[i] = -1;
+  cache->ignore = ignore;
+  cache->n_ignore = n_ignore;
+}
+
+/***************************************************************************
+ destroy_mesh_nesting_cache:
+
+ In:  cache: per-subvolume cache
+ Out: Nothing. The cache is freed (the ignore flags are owned by the caller).
+***************************************************************************/
+static void destroy_mesh_nesting_cache(struct mesh_nesting_cache *cache) {
+  free(cache->sv_start);
+  free(cache->sv_count);
+}
+
+/***************************************************************************
+ subvol_has_closed_mesh_walls:
+
+ In:  sv: subvolume
+ Out: 1 if any wall of a closed mesh passes through the subvolume, 0 if not.
+      Without such walls, every point in the subvolume is enclosed by the same
+      meshes, so the nesting only has to be computed once per subvolume.
+***************************************************************************/
+static int subvol_has_closed_mesh_walls(struct subvolume *sv) {
+  for (struct wall_list *wl = sv->wall_head; wl != NULL; wl = wl->next) {
+    if (wl->this_wall->parent_object->is_closed > 0)
+      return 1;
+  }
+  return 0;
+}
+
+/***************************************************************************
+ find_enclosing_meshes_cached:
+
+ In:  state: MCell state
+      vm: volume molecule
+      cache: per-subvolume nesting cache
+      nesting: the ids of the enclosing meshes are stored here
+      n_meshes: the number of enclosing meshes is stored here
+      is_cached: set if the result is shared with other molecules in the same
+                 subvolume (and so must stay in nesting)
+ Out: Offset of the enclosing mesh ids in nesting (innermost mesh first).
+***************************************************************************/
+static int find_enclosing_meshes_cached(struct volume *state,
+                                        struct volume_molecule *vm,
+                                        struct mesh_nesting_cache *cache,
+                                        struct mesh_id_pool *nesting,
+                                        int *n_meshes, int *is_cached) {
+  const int sv_index = vm->subvol->index;
+  if (cache->sv_start[sv_index] >= 0) {
+    *n_meshes = cache->sv_count[sv_index];
+    *is_cached = 1;
+    return cache->sv_start[sv_index];
+  }
+
+  int start = find_enclosing_meshes(state, vm, cache->ignore, cache->n_ignore,
+                                    nesting, n_meshes);
+  *is_cached = 0;
+  if (!subvol_has_closed_mesh_walls(vm->subvol)) {
+    cache->sv_start[sv_index] = start;
+    cache->sv_count[sv_index] = *n_meshes;
+    *is_cached = 1;
+  }
+  return start;
+}
 
 /***************************************************************************
  save_all_molecules: Save all the molecules currently in the scheduler.
@@ -49,16 +226,27 @@
  In:  state: MCell state
       storage_head: we will pull all the molecules out of the scheduler from
         this
- Out: An array of all the molecules to be saved
+ Out: An array of all the molecules to be saved. The nesting of volume
+      molecules is stored in state->all_mesh_ids, the regions of surface
+      molecules in state->all_reg_names (one entry per wall).
 ***************************************************************************/
-struct molecule_info **save_all_molecules(struct volume *state,
-                                          struct storage_list *storage_head) {
+struct molecule_info *save_all_molecules(struct volume *state,
+                                         struct storage_list *storage_head) {
 
   // Find total number of molecules in the scheduler.
   unsigned long long num_all_molecules = count_items_in_scheduler(storage_head);
   int ctr = 0;
-  struct molecule_info **all_molecules = CHECKED_MALLOC_ARRAY(
-      struct molecule_info *, num_all_molecules, "all molecules");
+  struct molecule_info *all_molecules = CHECKED_MALLOC_ARRAY(
+      struct molecule_info, num_all_molecules, "all molecules");
+
+  state->all_mesh_ids.n_ids = 0;
+  state->all_reg_names =
+      CHECKED_MALLOC_STRUCT(struct pointer_hash, "region names by wall");
+  if (pointer_hash_init(state->all_reg_names, 64))
+    mcell_allocfailed("Failed to initialize region names by wall.");
+
+  struct mesh_nesting_cache cache;
+  init_mesh_nesting_cache(state, &cache, NULL, 0);
 
   // Iterate over all the molecules in every scheduler of every storage.
   for (struct storage_list *sl_ptr = storage_head; sl_ptr != NULL;
@@ -73,41 +261,29 @@ struct molecule_info **save_all_molecules(struct volume *state,
           if (am_ptr->properties == NULL)
             continue;
 
-          struct molecule_info *mol_info =
-              CHECKED_MALLOC_STRUCT(struct molecule_info, "molecule info");
-          all_molecules[ctr] = mol_info;
-          mol_info->molecule = CHECKED_MALLOC_STRUCT(struct abstract_molecule,
-                                                     "abstract molecule");
-
-          // Mesh names needed for VOLUME molecules
-          struct string_buffer *nested_mesh_names = NULL;
-
-          // Region names and mesh name needed for SURFACE molecules
-          struct string_buffer *reg_names =
-              CHECKED_MALLOC_STRUCT(struct string_buffer, "string buffer");
-          if (initialize_string_buffer(reg_names, MAX_NUM_REGIONS)) {
-            return NULL;
-          }
-          char *mesh_name = NULL;
+          struct molecule_info *mol_info = &all_molecules[ctr];
+          mol_info->reg_names = NULL;
+          mol_info->mesh_ids_start = 0;
+          mol_info->n_mesh_ids = 0;
+          mol_info->mesh_id = 0;
 
           if ((am_ptr->properties->flags & NOT_FREE) == 0) {
-            save_volume_molecule(state, mol_info, am_ptr, &nested_mesh_names);
+            save_volume_molecule(state, mol_info, am_ptr, &cache);
           } else if ((am_ptr->properties->flags & ON_GRID) != 0) {
-            if (save_surface_molecule(mol_info, am_ptr, &reg_names, &mesh_name))
+            if (save_surface_molecule(state, mol_info, am_ptr))
               return NULL;
           } else {
-            destroy_string_buffer(reg_names);
             continue;
           }
 
-          save_common_molecule_properties(
-              mol_info, am_ptr, reg_names, nested_mesh_names, mesh_name);
+          save_common_molecule_properties(mol_info, am_ptr);
           ctr += 1;
         }
       }
     }
   }
 
+  destroy_mesh_nesting_cache(&cache);
   state->num_all_molecules = ctr;
 
   return all_molecules;
@@ -118,33 +294,18 @@ struct molecule_info **save_all_molecules(struct volume *state,
 
  In:  mol_info: holds all the information for recreating and placing a molecule
       am_ptr: abstract molecule pointer
-      reg_names: the region names the molecule is on (surface molecules)
-      nested_mesh_names: the meshes the molecule is nested inside of (volume molecs)
-      mesh_name: mesh name that molecule is in (surface molecs)
  Out: Nothing. The common properties of surface and volume molecules are saved
       in mol_info.
 ***************************************************************************/
 void save_common_molecule_properties(struct molecule_info *mol_info,
-                                     struct abstract_molecule *am_ptr,
-                                     struct string_buffer *reg_names,
-                                     struct string_buffer *nested_mesh_names,
-                                     char *mesh_name) {
-  mol_info->molecule->t = am_ptr->t;
-  mol_info->molecule->t2 = am_ptr->t2;
-  mol_info->molecule->flags = am_ptr->flags;
-  mol_info->molecule->properties = am_ptr->properties;
-  mol_info->molecule->birthday = am_ptr->birthday;
-  mol_info->molecule->id = am_ptr->id;
-  mol_info->molecule->periodic_box = am_ptr->periodic_box;
-  mol_info->molecule->mesh_name = CHECKED_STRDUP(mesh_name, "mesh name");
-  // Only free temporary object names we just allocated above.
-  // Don't want to accidentally free symbol names of objects.
-  if (mesh_name && (strcmp(mesh_name, NO_MESH) != 0) &&
-      ((am_ptr->properties->flags & NOT_FREE) == 0)) {
-    free(mesh_name);
-  }
-  mol_info->reg_names = reg_names;
-  mol_info->mesh_names = nested_mesh_names;
+                                     struct abstract_molecule *am_ptr) {
+  mol_info->molecule.t = am_ptr->t;
+  mol_info->molecule.t2 = am_ptr->t2;
+  mol_info->molecule.flags = am_ptr->flags;
+  mol_info->molecule.properties = am_ptr->properties;
+  mol_info->molecule.birthday = am_ptr->birthday;
+  mol_info->molecule.id = am_ptr->id;
+  mol_info->molecule.periodic_box = am_ptr->periodic_box;
 }
 
 /***************************************************************************
@@ -153,16 +314,19 @@ void save_common_molecule_properties(struct molecule_info *mol_info,
  In:  state: MCell state
       mol_info: holds all the information for recreating and placing a molecule
       am_ptr: abstract molecule pointer
-      nested_mesh_names: mesh names that molecule is inside of
- Out: Nothing. Molecule info and mesh name are updated
+      cache: per-subvolume cache of the enclosing meshes
+ Out: Nothing. Molecule info and the meshes it is nested in are updated
 ***************************************************************************/
 void save_volume_molecule(struct volume *state,
                           struct molecule_info *mol_info,
                           struct abstract_molecule *am_ptr,
-                          struct string_buffer **nested_mesh_names) {
+                          struct mesh_nesting_cache *cache) {
   struct volume_molecule *vm_ptr = (struct volume_molecule *)am_ptr;
 
-  *nested_mesh_names = find_enclosing_meshes(state, vm_ptr, NULL);
+  int is_cached;
+  mol_info->mesh_ids_start = find_enclosing_meshes_cached(
+      state, vm_ptr, cache, &state->all_mesh_ids, &mol_info->n_mesh_ids,
+      &is_cached);
   mol_info->pos.x = vm_ptr->pos.x;
   mol_info->pos.y = vm_ptr->pos.y;
   mol_info->pos.z = vm_ptr->pos.z;
@@ -172,74 +336,86 @@ void save_volume_molecule(struct volume *state,
 /***************************************************************************
  save_surface_molecule:
 
- In:  mol_info: holds all the information for recreating and placing a molecule
+ In:  state: MCell state
+      mol_info: holds all the information for recreating and placing a molecule
       am_ptr: abstract molecule pointer
-      reg_names: surface region names that the molecule is on get stored here
-      mesh_name: mesh name that molecule is on gets stored here
  Out: Zero on success. One otherwise. Save relevant surface molecule data in
-      mol_info. Set the mesh_name. Populate reg_names with the region names the
-      sm is on.
+      mol_info, including the id of the mesh it is on. The region names the
+      sm is on are shared by all molecules on the same wall and are only
+      looked up once per wall.
 ***************************************************************************/
-int save_surface_molecule(struct molecule_info *mol_info,
-                          struct abstract_molecule *am_ptr,
-                          struct string_buffer **reg_names,
-                          char **mesh_name) {
+int save_surface_molecule(struct volume *state,
+                          struct molecule_info *mol_info,
+                          struct abstract_molecule *am_ptr) {
   struct vector3 where;
   struct surface_molecule *sm_ptr = (struct surface_molecule *)am_ptr;
-  uv2xyz(&sm_ptr->s_pos, sm_ptr->grid->surface, &where);
+  struct wall *w = sm_ptr->grid->surface;
+  uv2xyz(&sm_ptr->s_pos, w, &where);
   mol_info->pos.x = where.x;
   mol_info->pos.y = where.y;
   mol_info->pos.z = where.z;
   mol_info->orient = sm_ptr->orient;
-  *mesh_name = sm_ptr->grid->surface->parent_object->sym->name;
-  struct name_list *reg_name_list_head, *reg_name_list;
-  reg_name_list_head = find_regions_names_by_wall(sm_ptr->grid->surface, NULL);
-  // Add the names from reg_name_list_head to reg_names
-  for (reg_name_list = reg_name_list_head; reg_name_list != NULL;
-       reg_name_list = reg_name_list->next) {
-    char *str = CHECKED_STRDUP(reg_name_list->name, "region name");
-    if (add_string_to_buffer(*reg_names, str)) {
-      free(str);
-      destroy_string_buffer(*reg_names);
+  mol_info->mesh_id = get_mesh_id(state, w->parent_object);
+
+  unsigned int keyhash = (unsigned int)(intptr_t)w;
+  struct string_buffer *reg_names = (struct string_buffer *)
+      pointer_hash_lookup(state->all_reg_names, w, keyhash);
+  if (reg_names == NULL) {
+    reg_names = CHECKED_MALLOC_STRUCT(struct string_buffer, "string buffer");
+    if (initialize_string_buffer(reg_names, MAX_NUM_REGIONS)) {
+      free(reg_names);
       return 1;
     }
+    struct name_list *reg_name_list_head, *reg_name_list;
+    reg_name_list_head = find_regions_names_by_wall(w, NULL);
+    // Add the names from reg_name_list_head to reg_names
+    for (reg_name_list = reg_name_list_head; reg_name_list != NULL;
+         reg_name_list = reg_name_list->next) {
+      char *str = CHECKED_STRDUP(reg_name_list->name, "region name");
+      if (add_string_to_buffer(reg_names, str)) {
+        free(str);
+        destroy_string_buffer(reg_names);
+        free(reg_names);
+        return 1;
+      }
+    }
+    if (reg_name_list_head != NULL) {
+      remove_molecules_name_list(&reg_name_list_head);
+    }
+    if (pointer_hash_add(state->all_reg_names, w, keyhash, reg_names))
+      mcell_allocfailed("Failed to store region names of wall.");
   }
-  if (reg_name_list_head != NULL) {
-    remove_molecules_name_list(&reg_name_list_head);
-  }
+  mol_info->reg_names = reg_names;
+
   remove_surfmol_from_list(&sm_ptr->grid->sm_list[sm_ptr->grid_index], sm_ptr);
+  update_tile_occupancy(sm_ptr->grid, sm_ptr->grid_index);
   return 0;
 }
 
 /***************************************************************************
- cleanup_names_molecs: Cleanup molecule data and string buffers for mesh and
-                       region names
+ cleanup_names_molecs: Cleanup molecule data and string buffers for region
+                       names
 
- In:  num_all_molecules: the number of all the molecules we just placed
-      all_molecules: array of info about all the molecules we just placed
+ In:  state: MCell state
  Out: Nothing
 ***************************************************************************/
-void cleanup_names_molecs(
-    int num_all_molecules,
-    struct molecule_info **all_molecules) {
-  for (int i = 0; i < num_all_molecules; i++) {
-    char *mesh_name = all_molecules[i]->molecule->mesh_name;
-    if (mesh_name && (strcmp(mesh_name, NO_MESH) != 0)) {
-      free(mesh_name);
+void cleanup_names_molecs(struct volume *state) {
+  free(state->all_molecules);
+  state->all_molecules = NULL;
+  state->num_all_molecules = 0;
+  state->all_mesh_ids.n_ids = 0;
+
+  struct pointer_hash *all_reg_names = state->all_reg_names;
+  for (int i = 0; i < all_reg_names->table_size; i++) {
+    struct string_buffer *reg_names = all_reg_names->values[i];
+    if (all_reg_names->keys[i] != NULL && reg_names != NULL) {
+      destroy_string_buffer(reg_names);
+      free(reg_names);
     }
-    free(all_molecules[i]->molecule);
-    // XXX: Could consolidate "reg_names" and "mesh_names", but we might want
-    // both for surface molecules eventually.
-    destroy_string_buffer(all_molecules[i]->reg_names);
-    free(all_molecules[i]->reg_names);
-    // This is currently unused for surface molecules.
-    if (all_molecules[i]->mesh_names != NULL) {
-      destroy_string_buffer(all_molecules[i]->mesh_names);
-      free(all_molecules[i]->mesh_names);
-    }
-    free(all_molecules[i]);
   }
-  free(all_molecules);
+  pointer_hash_destroy(all_reg_names);
+  free(all_reg_names);
+  state->all_reg_names = NULL;
 }
 
 /***************************************************************************
@@ -261,12 +437,18 @@ int place_all_molecules(
   struct volume_molecule *vm_ptr = &vm;
   struct volume_molecule *vm_guess = NULL;
 
+  int n_ignore;
+  char *ignore = make_ignored_mesh_ids(state, meshes_to_ignore, &n_ignore);
+  struct mesh_nesting_cache cache;
+  init_mesh_nesting_cache(state, &cache, ignore, n_ignore);
+  struct mesh_id_pool nesting_new = { NULL, 0, 0 };
+
   int num_all_molecules = state->num_all_molecules;
 
   for (int n_mol = 0; n_mol < num_all_molecules; n_mol++) {
 
-    struct molecule_info *mol_info = state->all_molecules[n_mol];
-    struct abstract_molecule *am_ptr = mol_info->molecule;
+    struct molecule_info *mol_info = &state->all_molecules[n_mol];
+    struct abstract_molecule *am_ptr = &mol_info->molecule;
     // Insert volume molecule into world.
     if ((am_ptr->properties->flags & NOT_FREE) == 0) {
       vm_ptr->t = am_ptr->t;
@@ -281,7 +463,7 @@ int place_all_molecules(
       vm_ptr->periodic_box = am_ptr->periodic_box;
 
       vm_guess = insert_volume_molecule_encl_mesh(
-          state, vm_ptr, vm_guess, mol_info->mesh_names, meshes_to_ignore);
+          state, vm_ptr, vm_guess, mol_info, &cache, &nesting_new);
 
       if (vm_guess == NULL) {
         mcell_error("Cannot insert copy of molecule of species '%s' into "
@@ -291,12 +473,10 @@ int place_all_molecules(
     }
     // Insert surface molecule into world.
     else if ((am_ptr->properties->flags & ON_GRID) != 0) {
-      char *mesh_name = am_ptr->mesh_name;
       struct surface_molecule *sm = insert_surface_molecule(
           state, am_ptr->properties, &mol_info->pos, mol_info->orient,
-          state->vacancy_search_dist2, am_ptr->t, mesh_name,
-          mol_info->reg_names, regions_to_ignore, am_ptr->periodic_box);
-      free(am_ptr->periodic_box);
+          state->vacancy_search_dist2, am_ptr->t, mol_info->mesh_id,
+          mol_info->reg_names, regions_to_ignore, &am_ptr->periodic_box);
       if (sm == NULL) {
         mcell_warn("Unable to find surface upon which to place molecule %s.",
                    am_ptr->properties->sym->name);
@@ -304,11 +484,26 @@ int place_all_molecules(
     }
   }
 
-  cleanup_names_molecs(state->num_all_molecules, state->all_molecules);
+  free(nesting_new.ids);
+  destroy_mesh_nesting_cache(&cache);
+  free(ignore);
+  cleanup_names_molecs(state);
 
   return 0;
 }
 
+/***************************************************************************
+ mesh_id_at:
+
+ In:  mesh_ids: nested mesh ids, innermost first
+      n_mesh_ids: number of entries in mesh_ids
+      idx: index to look up
+ Out: The mesh id at idx, or 0 (no mesh) past the end of the nesting.
+***************************************************************************/
+static int mesh_id_at(int const *mesh_ids, int n_mesh_ids, int idx) {
+  return (idx >= 0 && idx < n_mesh_ids) ? mesh_ids[idx] : 0;
+}
+
 /***************************************************************************
  compare_molecule_nesting:
 
@@ -320,24 +515,24 @@ int place_all_molecules(
   concise. When we say something like A->B->C->null, this means that mesh A is
   inside mesh B which is inside mesh C. Lastly, C is an outermost mesh. Now,
   onto the algorithm itself...
-  
+
   First, assume there is overlap, which we will check later.
   For example:
-    mesh_names_old: A->B->C->D->null
-    mesh_names_new:       C->D->null
+    mesh_ids_old: A->B->C->D->null
+    mesh_ids_new:       C->D->null
   A was the closest enclosing mesh and then C became the closest enclosing
   mesh. That means the molecule moved from A to C.
-  
+
   The order could be reversed like this:
-    mesh_names_old:       C->D->null
-    mesh_names_new: A->B->C->D->null
+    mesh_ids_old:       C->D->null
+    mesh_ids_new: A->B->C->D->null
   This means the molecule moved from C to A.
-  
+
   Check the last overlapping entry for both. If they actually overlap, these
-  strings will be the same. Otherwise, this is nonoverlapping (aside for null)
+  ids will be the same. Otherwise, this is nonoverlapping (aside for null)
   like this:
-    mesh_names_old: C->D->null
-    mesh_names_new: E->F->null
+    mesh_ids_old: C->D->null
+    mesh_ids_new: E->F->null
   This means the molecule moved from C to E.
 
   Next, we see if movement is possible from the starting position to ending
@@ -345,72 +540,69 @@ int place_all_molecules(
 
  In: move_molecule: if set, we need to move the molecule
      out_to_in: if set, the molecule moved from outside to inside
-     mesh_names_old: a list of names that the molecule was nested in
-     mesh_names_new: a list of names that the molecule is nested in
+     mesh_ids_old: the meshes that the molecule was nested in
+     n_old: number of entries in mesh_ids_old
+     mesh_ids_new: the meshes that the molecule is nested in
+     n_new: number of entries in mesh_ids_new
      mesh_transp: the object transparency rules for this species
- Out: The name of the mesh that we are either immediately inside or outside of.
-      Also move_molecule and out_to_in are set.
+ Out: The id of the mesh that we are either immediately inside or outside of
+      (0 for none). Also move_molecule and out_to_in are set.
 ***************************************************************************/
-char *compare_molecule_nesting(int *move_molecule,
-                               int *out_to_in, 
-                               struct string_buffer *mesh_names_old,
-                               struct string_buffer *mesh_names_new,
-                               struct mesh_transparency *mesh_transp) {
-
-  int old_n_strings = mesh_names_old->n_strings;
-  int new_n_strings = mesh_names_new->n_strings;
+int compare_molecule_nesting(int *move_molecule,
+                             int *out_to_in,
+                             int const *mesh_ids_old,
+                             int n_old,
+                             int const *mesh_ids_new,
+                             int n_new,
+                             struct mesh_transparency *mesh_transp) {
+
   int difference;
-  char *old_mesh_name;
-  char *new_mesh_name;
-  char *best_mesh = mesh_names_old->strings[0];
-  struct string_buffer *compare_this;
-
-  // mesh_names_old example:       C->D->null
-  // mesh_names_new example: A->B->C->D->null
-  if (old_n_strings < new_n_strings) {
-    difference = new_n_strings - old_n_strings;
-    old_mesh_name = mesh_names_old->strings[0];
-    new_mesh_name = mesh_names_new->strings[difference];
-    compare_this = mesh_names_new;
+  int old_mesh_id;
+  int new_mesh_id;
+  int best_mesh = mesh_id_at(mesh_ids_old, n_old, 0);
+  int const *compare_this;
+  int n_compare;
+
+  // mesh_ids_old example:       C->D->null
+  // mesh_ids_new example: A->B->C->D->null
+  if (n_old < n_new) {
+    difference = n_new - n_old;
+    old_mesh_id = mesh_id_at(mesh_ids_old, n_old, 0);
+    new_mesh_id = mesh_id_at(mesh_ids_new, n_new, difference);
+    compare_this = mesh_ids_new;
+    n_compare = n_new;
     *out_to_in = 1;
   }
-  // mesh_names_old example: A->B->C->D->null
-  // mesh_names_new example:       C->D->null
-  else if (new_n_strings < old_n_strings) {
-    difference = old_n_strings - new_n_strings;
-    old_mesh_name = mesh_names_old->strings[difference];
-    new_mesh_name = mesh_names_new->strings[0];
-    compare_this = mesh_names_old;
+  // mesh_ids_old example: A->B->C->D->null
+  // mesh_ids_new example:       C->D->null
+  else if (n_new < n_old) {
+    difference = n_old - n_new;
+    old_mesh_id = mesh_id_at(mesh_ids_old, n_old, difference);
+    new_mesh_id = mesh_id_at(mesh_ids_new, n_new, 0);
+    compare_this = mesh_ids_old;
+    n_compare = n_old;
     *out_to_in = 0;
   }
   // Same amount of nesting
   else {
     difference = 0;
-    old_mesh_name = mesh_names_old->strings[0];
-    new_mesh_name = mesh_names_new->strings[0];
+    old_mesh_id = mesh_id_at(mesh_ids_old, n_old, 0);
+    new_mesh_id = mesh_id_at(mesh_ids_new, n_new, 0);
     // Doesn't really matter if we use old or new one
-    compare_this = mesh_names_old; 
+    compare_this = mesh_ids_old;
+    n_compare = n_old;
   }
 
-  if (old_mesh_name == NULL) {
-    old_mesh_name = NO_MESH;
-  }
-  if (new_mesh_name == NULL) {
-    new_mesh_name = NO_MESH;
-  }
-  if (best_mesh == NULL) {
-    best_mesh = NO_MESH;
-  }
-  int names_match = (strcmp(old_mesh_name, new_mesh_name) == 0);
-  if (names_match && (difference != 0)) {
+  int ids_match = (old_mesh_id == new_mesh_id);
+  if (ids_match && (difference != 0)) {
     best_mesh = check_overlapping_meshes(
-        move_molecule, out_to_in, difference, compare_this, best_mesh,
-        mesh_transp);
+        move_molecule, out_to_in, difference, compare_this, n_compare,
+        best_mesh, mesh_transp);
   }
-  else if (!names_match) {
+  else if (!ids_match) {
     best_mesh = check_nonoverlapping_meshes(
-        move_molecule, out_to_in, mesh_names_old, mesh_names_new, best_mesh,
-        mesh_transp);
+        move_molecule, out_to_in, mesh_ids_old, n_old, mesh_ids_new, n_new,
+        best_mesh, mesh_transp);
   }
 
   return best_mesh;
@@ -422,18 +614,20 @@ char *compare_molecule_nesting(int *move_molecule,
  In: move_molecule: if set, we need to move the molecule
      out_to_in: if set, the molecule moved from outside to inside
      difference: number of different meshes between old and new
-     compare_this: the mesh names to check
-     best_mesh: the current best mesh name
+     compare_this: the mesh ids to check
+     n_compare: number of entries in compare_this
+     best_mesh: the current best mesh id
      mesh_transp: the object transparency rules for this species
- Out: The name of the mesh that we are either immediately inside or outside of.
+ Out: The id of the mesh that we are either immediately inside or outside of.
       Also move_molecule and out_to_in are set.
 ***************************************************************************/
-char *check_overlapping_meshes(
+int check_overlapping_meshes(
     int *move_molecule,
     int *out_to_in,
     int difference,
-    struct string_buffer *compare_this,
-    char *best_mesh,
+    int const *compare_this,
+    int n_compare,
+    int best_mesh,
     struct mesh_transparency *mesh_transp) {
   int start;
   int increment;
@@ -453,15 +647,9 @@ char *check_overlapping_meshes(
     increment = 1;
     end = difference;
   }
-  best_mesh = check_outin_or_inout(
+  return check_outin_or_inout(
       start, increment, end, move_molecule, out_to_in, best_mesh,
-      compare_this, mesh_transp);
-  if (strcmp(best_mesh, NO_MESH) == 0) {
-    return NULL;
-  }
-  else {
-    return best_mesh;
-  }
+      compare_this, n_compare, mesh_transp);
 }
 
 /***************************************************************************
@@ -474,39 +662,43 @@ char *check_overlapping_meshes(
 
  In: move_molecule: if set, we need to move the molecule
      out_to_in: if set, the molecule moved from outside to inside
-     mesh_names_old: the nested mesh names prior to this dyngeom event
-     mesh_names_new: the nested mesh names during to this dyngeom event
+     mesh_ids_old: the nested mesh ids prior to this dyngeom event
+     n_old: number of entries in mesh_ids_old
+     mesh_ids_new: the nested mesh ids during to this dyngeom event
+     n_new: number of entries in mesh_ids_new
      best_mesh: the mesh the molecule should actully be inside
      mesh_transp: the object transparency rules for this species
- Out: The name of the mesh that we are either immediately inside or outside of.
+ Out: The id of the mesh that we are either immediately inside or outside of.
       Also move_molecule and out_to_in are set.
 ***************************************************************************/
-char *check_nonoverlapping_meshes(int *move_molecule,
-                                  int *out_to_in,
-                                  struct string_buffer *mesh_names_old,
-                                  struct string_buffer *mesh_names_new,
-                                  char *best_mesh,
-                                  struct mesh_transparency *mesh_transp) {
+int check_nonoverlapping_meshes(int *move_molecule,
+                                int *out_to_in,
+                                int const *mesh_ids_old,
+                                int n_old,
+                                int const *mesh_ids_new,
+                                int n_new,
+                                int best_mesh,
+                                struct mesh_transparency *mesh_transp) {
 
   *out_to_in = 0;
   int start = 0;
   int increment = 1;
-  int end = mesh_names_old->n_strings;
+  int end = n_old;
 
   // Moving in to out
   best_mesh = check_outin_or_inout(
       start, increment, end, move_molecule, out_to_in, best_mesh,
-      mesh_names_old, mesh_transp); 
+      mesh_ids_old, n_old, mesh_transp);
 
   // Moving out to in
   if (!(*move_molecule)) {
     *out_to_in = 1;
-    start = mesh_names_new->n_strings;
+    start = n_new;
     end = 0;
     increment = -1;
     best_mesh = check_outin_or_inout(
         start, increment, end, move_molecule, out_to_in, best_mesh,
-        mesh_names_new, mesh_transp); 
+        mesh_ids_new, n_new, mesh_transp);
   }
 
   return best_mesh;
@@ -514,44 +706,43 @@ char *check_nonoverlapping_meshes(int *move_molecule,
 
 /***************************************************************************
  check_outin_or_inout:
- 
- See if a molecule can move from through the meshes (mesh_names) in the
- direction specified (out_to_in). If it has to stop, return the name of the
+
+ See if a molecule can move from through the meshes (mesh_ids) in the
+ direction specified (out_to_in). If it has to stop, return the id of the
  mesh that blocks it.
 
  In: start: start checking at this index
-     increment: move forward or backward through the string buffer
+     increment: move forward or backward through the mesh ids
      end: stop checking at this index
      move_molecule: if set, we need to move the molecule
      out_to_in: if set, the molecule moved from outside to inside
-     best_mesh: the current best mesh name
-     mesh_names: mesh names that molecule is inside of
+     best_mesh: the current best mesh id
+     mesh_ids: mesh ids that molecule is inside of
+     n_mesh_ids: number of entries in mesh_ids
      mesh_transp: the object transparency rules for this species
- Out: The name of the mesh that we are either immediately inside or outside of.
+ Out: The id of the mesh that we are either immediately inside or outside of.
       Also move_molecule and out_to_in are set.
 ***************************************************************************/
-char *check_outin_or_inout(
+int check_outin_or_inout(
     int start,
     int increment,
     int end,
     int *move_molecule,
     int *out_to_in,
-    char *best_mesh,
-    struct string_buffer *mesh_names,
+    int best_mesh,
+    int const *mesh_ids,
+    int n_mesh_ids,
     struct mesh_transparency *mesh_transp) {
   int done = 0;
   int mesh_idx = start;
   while (!done) {
-    char *mesh_name = mesh_names->strings[mesh_idx];
-    if (mesh_name == NULL) {
-      mesh_name = NO_MESH;
-    }
+    int mesh_id = mesh_id_at(mesh_ids, n_mesh_ids, mesh_idx);
     struct mesh_transparency *mt = mesh_transp;
     for (; mt != NULL; mt = mt->next) {
-      if (strcmp(mesh_name, mt->name) == 0) {
+      if (mesh_id == mt->mesh_id) {
         if (((*out_to_in) && !mt->out_to_in) ||
             (!(*out_to_in) && !mt->in_to_out)) {
-          best_mesh = mesh_name;
+          best_mesh = mesh_id;
           *move_molecule = 1;
           done = 1;
         }
@@ -559,7 +750,7 @@ char *check_outin_or_inout(
       }
     }
     if (mesh_idx == end) {
-      done = 1; 
+      done = 1;
     }
     mesh_idx = mesh_idx + increment;
   }
@@ -571,8 +762,11 @@ insert_volume_molecule_encl_mesh:
   In: state: MCell state
       vm: pointer to volume_molecule that we're going to place in local storage
       vm_guess: pointer to a volume_molecule that may be nearby
-      nested_mesh_names_old: the meshes this molecule was inside of previously
-      meshes_to_ignore: the meshes we should ignore when placing this molecule
+      mol_info: the saved molecule, including the meshes it was inside of
+                previously
+      cache: per-subvolume nesting cache for the new geometry (also knows
+             which meshes to ignore when placing this molecule)
+      nesting_new: scratch space for the meshes the molecule is inside of now
   Out: pointer to the new volume_molecule (copies data from volume molecule
        passed in), or NULL if out of memory.  Molecule is placed in scheduler
        also.
@@ -581,8 +775,9 @@ struct volume_molecule *insert_volume_molecule_encl_mesh(
     struct volume *state,
     struct volume_molecule *vm,
     struct volume_molecule *vm_guess,
-    struct string_buffer *nested_mesh_names_old,
-    struct string_buffer *meshes_to_ignore) {
+    struct molecule_info *mol_info,
+    struct mesh_nesting_cache *cache,
+    struct mesh_id_pool *nesting_new) {
   struct subvolume *sv;
 
   // We should only have to do this the first time this function gets called
@@ -598,25 +793,32 @@ struct volume_molecule *insert_volume_molecule_encl_mesh(
   struct volume_molecule *new_vm = CHECKED_MEM_GET(
     sv->local_storage->mol, "volume molecule");
   memcpy(new_vm, vm, sizeof(struct volume_molecule));
-  new_vm->mesh_name = NULL;
   new_vm->prev_v = NULL;
   new_vm->next_v = NULL;
   new_vm->next = NULL;
   new_vm->subvol = sv;
-  new_vm->periodic_box = vm->periodic_box;
 
-  struct string_buffer *nested_mesh_names_new = find_enclosing_meshes(
-      state, new_vm, meshes_to_ignore);
-
-  // Make a new string buffer without all the meshes we don't care about (i.e.
-  // the ones we *removed* in this dyn_geom_event). We are already ingoring the
-  // ones just *added* in this dyn_geom_event (in find_enclosing_meshes). Maybe
-  // we should do that here to be consistent and keep the logic decoupled.
-  struct string_buffer *nested_mesh_names_old_filtered =
-      CHECKED_MALLOC_STRUCT(struct string_buffer, "string buffer");
-  initialize_string_buffer(nested_mesh_names_old_filtered, MAX_NUM_OBJECTS);
-  diff_string_buffers(
-    nested_mesh_names_old_filtered, nested_mesh_names_old, meshes_to_ignore);
+  // Molecules in subvolumes without walls share their nesting, so only
+  // scratch results are dropped again below.
+  int n_new;
+  int is_cached;
+  int pool_top = nesting_new->n_ids;
+  int new_start = find_enclosing_meshes_cached(
+      state, new_vm, cache, nesting_new, &n_new, &is_cached);
+
+  // Drop the meshes we don't care about (i.e. the ones we *removed* in this
+  // dyn_geom_event) from the old nesting. We are already ignoring the ones
+  // just *added* in this dyn_geom_event (in find_enclosing_meshes). The old
+  // nesting may be shared with other molecules, so filter into a copy.
+  int *old_ids = state->all_mesh_ids.ids + mol_info->mesh_ids_start;
+  int n_old = 0;
+  int old_filtered[mol_info->n_mesh_ids + 1];
+  for (int i = 0; i < mol_info->n_mesh_ids; i++) {
+    int mesh_id = old_ids[i];
+    if (mesh_id < cache->n_ignore && cache->ignore[mesh_id])
+      continue;
+    old_filtered[n_old++] = mesh_id;
+  }
 
   char *species_name = new_vm->properties->sym->name;
   unsigned int keyhash = (unsigned int)(intptr_t)(species_name);
@@ -627,35 +829,42 @@ struct volume_molecule *insert_volume_molecule_encl_mesh(
 
   int move_molecule = 0;
   int out_to_in = 0;
-  char *mesh_name = compare_molecule_nesting(
+  int mesh_id = compare_molecule_nesting(
     &move_molecule,
     &out_to_in,
-    nested_mesh_names_old_filtered,
-    nested_mesh_names_new,
+    old_filtered,
+    n_old,
+    nesting_new->ids + new_start,
+    n_new,
     mesh_transp);
 
+  if (!is_cached)
+    nesting_new->n_ids = pool_top;
+
   struct vector3 new_pos;
   if (move_molecule) {
     /* move molecule to another location so that it is directly inside or
-     * outside of "mesh_name" */
+     * outside of mesh "mesh_id" */
     place_mol_relative_to_mesh(
-        state, &(vm->pos), sv, mesh_name, &new_pos, out_to_in);
+        state, &(vm->pos), sv, mesh_id, &new_pos, out_to_in);
     check_for_large_molecular_displacement(
         &(vm->pos), &new_pos, vm, &(state->time_unit),
         state->notify->large_molecular_displacement);
     new_vm->pos = new_pos;
     struct subvolume *new_sv = find_subvolume(state, &(new_vm->pos), NULL);
+    if (new_sv->local_storage != sv->local_storage) {
+      // The molecule has to live in the storage of its subvolume
+      struct volume_molecule *moved_vm = CHECKED_MEM_GET(
+        new_sv->local_storage->mol, "volume molecule");
+      memcpy(moved_vm, new_vm, sizeof(struct volume_molecule));
+      mem_put(sv->local_storage->mol, new_vm);
+      new_vm = moved_vm;
+    }
     new_vm->subvol = new_sv;
     state->dyngeom_molec_displacements++;
   }
 
-  destroy_string_buffer(nested_mesh_names_old_filtered);
-  free(nested_mesh_names_old_filtered);
-  destroy_string_buffer(nested_mesh_names_new);
-  free(nested_mesh_names_new);
-
-  new_vm->birthplace = new_vm->subvol->local_storage->mol;
-  ht_add_molecule_to_list(&(new_vm->subvol->mol_by_species), new_vm);
+  add_molecule_to_list(new_vm);
   new_vm->subvol->mol_count++;
   new_vm->properties->population++;
 
@@ -666,7 +875,7 @@ struct volume_molecule *insert_volume_molecule_encl_mesh(
   if (new_vm->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) {
     count_region_from_scratch(state, (struct abstract_molecule *)new_vm, NULL,
                               1, &(new_vm->pos), NULL, new_vm->t,
-                              new_vm->periodic_box);
+                              &new_vm->periodic_box);
   }
 
   if (schedule_add(new_vm->subvol->local_storage->timer, new_vm))
@@ -681,7 +890,7 @@ check_for_large_molecular_displacement:
        new_pos: The position we are trying to move the molecule to
        vm: volume molecule
        timestep: global timestep in seconds
-       large_molecular_displacement_warning: the warning value 
+       large_molecular_displacement_warning: the warning value
           (ignore, warn, error) set for molecular displacement
   Out: 0 on success, 1 otherwise.
 ************************************************************************/
@@ -718,226 +927,124 @@ void check_for_large_molecular_displacement(
 }
 
 /*************************************************************************
-hit_wall:
-  In:  w: wall
-       name_hits_head: the head of a list that tracks the meshes we've hit and
-         how many times they've been hit
-       name_tail_head: the tail of the same list
-       displace_vector: a large displacement vector that spans the whole
-         simulation space
-  Out: Head and tail are updated. In other words, we track meshes we've hit
+add_enclosing_mesh:
+  In:  hits: the enclosing meshes found so far, nearest first
+       mesh_id: id of a mesh the ray crossed an odd number of times
+       t: distance along the ray to the first crossing of the mesh
+  Out: None. The mesh is inserted in order of distance. Only spill to the
+       heap if the point is enclosed by an unusually large number of meshes.
 ************************************************************************/
-int hit_wall(
-    struct wall *w,
-    struct name_hits **name_hits_head,
-    struct name_hits **name_tail_head,
-    struct vector3 *displace_vector) {
-
-  // Discard open-type meshes, like planes, etc.
-  if (w->parent_object->is_closed <= 0)
-    return 1;
-
-  /* Discard the cases when the random vector just grazes the mesh at the
-   * encounter point */
-  double d_prod = dot_prod(displace_vector, &(w->normal));
-  if (!distinguishable(d_prod, 0, EPS_C))
-    return 1;
-
-  // First time hitting *any* object
-  if (*name_hits_head == NULL) {
-    // name and count of hits
-    struct name_hits *nh = CHECKED_MALLOC_STRUCT(
-        struct name_hits, "struct name_hits");
-    nh->name = CHECKED_STRDUP(w->parent_object->sym->name,
-                              "w->parent_object->sym->name");
-    nh->hits = 1;
-    nh->next = NULL;
-    *name_hits_head = nh;
-    *name_tail_head = *name_hits_head;
-  // We've hit at least one object already
-  } else {
-    int found = 0; // flag
-    for (struct name_hits *nhl = *name_hits_head; nhl != NULL; nhl = nhl->next) {
-      // Keep track of how many times we hit *this* object
-      if (strcmp(nhl->name, w->parent_object->sym->name) == 0) {
-        nhl->hits++;
-        found = 1;
-        break;
-      }
-    }
-    // First time hitting *this* object
-    if (!found) {
-      // Add to the end of list
-      struct name_hits *nh =
-          CHECKED_MALLOC_STRUCT(struct name_hits, "struct name_hits");
-      nh->name = CHECKED_STRDUP(w->parent_object->sym->name,
-                                "w->parent_object->sym->name");
-      nh->hits = 1;
-      nh->next = (*name_tail_head)->next;
-      (*name_tail_head)->next = nh;
-      *name_tail_head = (*name_tail_head)->next;
-    }
-  }
-  return 0;
-}
-
-/*************************************************************************
-hit_subvol:
-  In:  state: MCell state
-       mesh_names: meshes that the molecule is inside of
-       smash: the thing that the current molecule has collided with
-       shead: the head of a list of what the current molecule has collided with
-       name_hits_head: the head of a list that tracks the meshes we've hit and
-         how many times they've been hit
-       sv: subvolume
-       virt_mol:
-  Out: Compile list of meshes we are inside of (hit odd number of times) or
-       update next subvolume
-************************************************************************/
-void hit_subvol(
-    struct n_parts *np,
-    struct string_buffer *mesh_names,
-    struct collision *smash,
-    struct collision *shead,
-    struct name_hits *name_hits_head,
-    struct subvolume *sv,
-    struct volume_molecule *virt_mol) {
-
-  virt_mol->pos.x = smash->loc.x;
-  virt_mol->pos.y = smash->loc.y;
-  virt_mol->pos.z = smash->loc.z;
-  virt_mol->subvol = NULL;
-
-  struct subvolume *new_sv = traverse_subvol(
-      sv, smash->what - COLLIDE_SV_NX - COLLIDE_SUBVOL,
-      np->ny_parts, np->nz_parts);
-  // Hit the edge of the world
-  if (new_sv == NULL) {
-    if (shead != NULL)
-      mem_put_list(sv->local_storage->coll, shead);
-
-    // Compile the final list of meshes (names and counts) that we are inside
-    for (struct name_hits *nhl = name_hits_head; nhl != NULL; nhl = nhl->next) {
-      if (nhl->hits % 2 != 0) {
-        char *mesh_name = CHECKED_STRDUP(nhl->name, "mesh name");
-        if (add_string_to_buffer(mesh_names, mesh_name)) {
-          free(mesh_name);
-          destroy_string_buffer(mesh_names);
-        }
-      }
-    }
-    
-    // Clean up
-    while (name_hits_head != NULL) {
-      struct name_hits *nnext = name_hits_head->next;
-      free(name_hits_head->name);
-      free(name_hits_head);
-      name_hits_head = nnext;
-    }
-    return;
-  }
-
-  if (shead != NULL)
-    mem_put_list(sv->local_storage->coll, shead);
-  virt_mol->subvol = new_sv;
+static void add_enclosing_mesh(struct mesh_hit_list *hits, int mesh_id,
+                               double t) {
+  if (hits->n_hits == hits->max_hits) {
+    int new_max = 2 * hits->max_hits;
+    struct mesh_hits *new_hits = CHECKED_MALLOC_ARRAY(
+        struct mesh_hits, new_max, "mesh hits");
+    memcpy(new_hits, hits->hits, hits->n_hits * sizeof(struct mesh_hits));
+    if (hits->hits != hits->local)
+      free(hits->hits);
+    hits->hits = new_hits;
+    hits->max_hits = new_max;
+  }
+
+  int i = hits->n_hits++;
+  while (i > 0 && hits->hits[i - 1].t > t) {
+    hits->hits[i] = hits->hits[i - 1];
+    i--;
+  }
+  hits->hits[i].mesh_id = mesh_id;
+  hits->hits[i].t = t;
 }
 
 /*************************************************************************
 find_enclosing_meshes:
   In:  state: MCell state
        vm: volume molecule
-       meshes_to_ignore: ignore these meshes when checking what this molecule
-         is inside of
-  Out: String buffer of enclosing meshes if they exist. NULL otherwise.
+       meshes_to_ignore: nonzero entries (indexed by mesh id) are ignored when
+         checking what this molecule is inside of. May be NULL.
+       n_ignore: number of entries in meshes_to_ignore
+       nesting: the ids of the enclosing meshes are appended here
+       n_meshes: the number of enclosing meshes is stored here
+  Out: Offset of the enclosing mesh ids in nesting, innermost mesh first.
+       A ray is cast from the molecule out of the world (see
+       region_query.c). We are inside every closed mesh it crosses an odd
+       number of times, and the meshes are nested in the order the ray first
+       crosses them. The same direction has to be used for all the meshes to
+       get that order right, so the whole ray is cast again if it grazes any
+       of them.
 ************************************************************************/
-struct string_buffer *find_enclosing_meshes(
+int find_enclosing_meshes(
     struct volume *state,
     struct volume_molecule *vm,
-    struct string_buffer *meshes_to_ignore) {
-
-  // We create a virtual molecule, so that we don't displace the real one (vm).
-  struct volume_molecule virt_mol;
-  memcpy(&virt_mol, vm, sizeof(struct volume_molecule));
-  virt_mol.prev_v = NULL;
-  virt_mol.next_v = NULL;
-  virt_mol.next = NULL;
-
-  // This is where we will store the names of the meshes we are nested in.
-  struct string_buffer *mesh_names =
-      CHECKED_MALLOC_STRUCT(struct string_buffer, "string buffer");
-  if (initialize_string_buffer(mesh_names, MAX_NUM_OBJECTS)) {
-    return NULL;
-  }
+    char const *meshes_to_ignore,
+    int n_ignore,
+    struct mesh_id_pool *nesting,
+    int *n_meshes) {
+
+  // This is where we will store the ids of the meshes we are nested in.
+  int start = nesting->n_ids;
+
+  int n_objects;
+  struct object **objects = get_wall_objects(state, &n_objects);
+  struct wall_crossing_list wcl;
+  init_wall_crossing_list(&wcl);
+  struct mesh_hit_list hits;
+  hits.hits = hits.local;
+  hits.max_hits = MAX_NUM_OBJECTS;
+
+  for (int attempt = 0; attempt < N_CONTAINMENT_DIRECTIONS; attempt++) {
+    // On the last attempt, take what we get and skip the grazing crossings.
+    int last_attempt = (attempt == N_CONTAINMENT_DIRECTIONS - 1);
+    struct vector3 dir;
+    containment_direction(attempt, &dir);
+    hits.n_hits = 0;
+
+    int grazed = 0;
+    for (int i = 0; i < n_objects && !grazed; i++) {
+      struct object *obj = objects[i];
+      // Discard open-type meshes, like planes, etc.
+      if (obj->is_closed <= 0)
+        continue;
+      int mesh_id = get_mesh_id(state, obj);
+      // Only check this when we are placing molecules, not when we are
+      // saving them.
+      if (meshes_to_ignore != NULL && mesh_id < n_ignore &&
+          meshes_to_ignore[mesh_id])
+        continue;
 
-  // Displacement vector along arbitray cardinal axis.
-  struct vector3 displace_vector = {0.0, 0.0, 1.0};
-  // Find the diagonal of the world's bounding box
-  struct vector3 world_diag;
-  vectorize(&state->bb_urb, &state->bb_llf, &world_diag);
-  // Length of the world's bounding box diagonal
-  double world_diag_length = vect_length(&world_diag);
-  // Set world diagonal to nonzero value so we don't fail in traverse_subvol
-  if (!distinguishable(world_diag_length, 0, EPS_C)) {
-    world_diag_length = 1.0;
-  }
-
-  // Scale displacement vector by the length of the world
-  displace_vector.x *= world_diag_length;
-  displace_vector.y *= world_diag_length;
-  displace_vector.z *= world_diag_length;
-
-  struct collision *smash; /* Thing we've hit that's under consideration */
-  struct collision *shead = NULL; // Head of the linked list of collisions
-  struct subvolume *sv = virt_mol.subvol;
-  struct name_hits *nh_head = NULL, *nh_tail = NULL;
-  do {
-    // Get collision list for walls and a subvolume. We don't care about
-    // colliding with other molecules like we do with reactions
-    shead = ray_trace(state, &(virt_mol.pos), NULL, sv, &displace_vector, NULL);
-    if (shead == NULL)
-      mcell_internal_error("ray_trace() returned NULL.");
-
-    if (shead->next != NULL) {
-      shead =
-          (struct collision *)ae_list_sort((struct abstract_element *)shead);
-    }
+      wcl.n_crossings = 0;
+      object_ray_crossings(get_object_bvh(state, obj), &vm->pos, &dir, &wcl);
 
-    for (smash = shead; smash != NULL; smash = smash->next) {
-      // We hit a wall
-      if ((smash->what & COLLIDE_WALL) != 0) {
-        // Only check this when we are placing molecules, not when we are
-        // saving them.
-        struct wall *w = (struct wall *)smash->target;
-        if ((meshes_to_ignore) && (is_string_present_in_string_array(
-              w->parent_object->sym->name,
-              meshes_to_ignore->strings,
-              meshes_to_ignore->n_strings))) {
-          continue; 
-        }
-        if (hit_wall(w, &nh_head, &nh_tail, &displace_vector)) {
+      int n_crossed = 0;
+      double t_first = GIGANTIC;
+      for (int k = 0; k < wcl.n_crossings; k++) {
+        if (wcl.crossings[k].sign == 0) {
+          if (!last_attempt) {
+            grazed = 1;
+            break;
+          }
           continue;
         }
-
-      // We hit a subvolume
-      } else if ((smash->what & COLLIDE_SUBVOL) != 0) {
-
-        // Numbers of coarse partitions
-        struct n_parts np = {
-          state->nx_parts, state->ny_parts, state->nz_parts};
-        hit_subvol(&np, mesh_names, smash, shead, nh_head, sv, &virt_mol);
-        // We hit the edge of the world
-        if (virt_mol.subvol == NULL) {
-          return mesh_names; 
-        }
-        sv = virt_mol.subvol;
-        break;
+        n_crossed++;
+        t_first = min2d(t_first, wcl.crossings[k].t);
       }
+      if (!grazed && n_crossed % 2 != 0)
+        add_enclosing_mesh(&hits, mesh_id, t_first);
     }
 
-  } while (smash != NULL);
+    if (!grazed)
+      break;
+  }
 
-  free(mesh_names);
-  return NULL;
+  // Compile the final list of meshes that we are inside
+  for (int i = 0; i < hits.n_hits; i++)
+    mesh_id_pool_append(nesting, hits.hits[i].mesh_id);
+
+  if (hits.hits != hits.local)
+    free(hits.hits);
+  free_wall_crossing_list(&wcl);
+  *n_meshes = nesting->n_ids - start;
+  return start;
 }
 
 /**********************************************************************
@@ -945,14 +1052,14 @@ place_mol_relative_to_mesh:
   In: state: MCell state
       loc: 3D location of molecule
       sv: start subvolume
-      mesh_name: name of closest enclosing mesh (NULL means that molecule
-        is outside of all meshes)
+      mesh_id: id of closest enclosing mesh (0 means that molecule is outside
+        of all meshes)
       new_pos: new position of molecule (return value)
       out_to_in: if set, the molecule moved from outside to inside
   Note: new position of molecule that is just behind the closest
-       wall that belongs to object called "mesh_name" (if "mesh_name != NULL")
+       wall that belongs to object with id "mesh_id" (if "mesh_id != 0")
        or just outside the closest wall that belongs to the farthest
-       enclosing mesh object (if "mesh_name == NULL").
+       enclosing mesh object (if "mesh_id == 0").
   Note: we call this function when geometry changes after checkpoint so that:
         1) before checkpoint molecule was inside the mesh, and after
            checkpoint it is outside the mesh,
@@ -965,7 +1072,7 @@ place_mol_relative_to_mesh:
 void place_mol_relative_to_mesh(struct volume *state,
                                 struct vector3 *loc,
                                 struct subvolume *sv,
-                                char *mesh_name,
+                                int mesh_id,
                                 struct vector3 *new_pos,
                                 int out_to_in) {
   struct vector2 s_loc;
@@ -975,7 +1082,7 @@ void place_mol_relative_to_mesh(struct volume *state,
   double best_d2 = GIGANTIC + 1;
 
   for (struct wall_list *wl = sv->wall_head; wl != NULL; wl = wl->next) {
-    if (strcmp(wl->this_wall->parent_object->sym->name, mesh_name) != 0) {
+    if (get_mesh_id(state, wl->this_wall->parent_object) != mesh_id) {
       continue;
     }
 
@@ -988,7 +1095,7 @@ void place_mol_relative_to_mesh(struct volume *state,
   }
 
   // Look into neighbor subvolumes
-  const int sv_index = sv - state->subvol;
+  const int sv_index = sv->index;
   int sv_remain = sv_index;
 
   // Turn linear sv_index into part_x, part_y, part_z triple.
@@ -1063,9 +1170,9 @@ void place_mol_relative_to_mesh(struct volume *state,
           if (this_sv == sv_index)
             continue;
 
-          for (struct wall_list *wl = state->subvol[this_sv].wall_head;
+          for (struct wall_list *wl = state->subvol[this_sv]->wall_head;
                wl != NULL; wl = wl->next) {
-            if (strcmp(wl->this_wall->parent_object->sym->name, mesh_name) != 0) {
+            if (get_mesh_id(state, wl->this_wall->parent_object) != mesh_id) {
               continue;
             }
 
@@ -1186,6 +1293,9 @@ destroy_everything:
        this time.
 ***************************************************************************/
 int destroy_everything(struct volume *state) {
+  destroy_wall_bvhs(state);
+  delete_exd_cache(state->exd_cache);
+  state->exd_cache = NULL;
   destroy_objects(state->root_instance, 1);
   destroy_objects(state->root_object, 0);
   state->root_instance->first_child = NULL; 
@@ -1209,6 +1319,8 @@ int destroy_everything(struct volume *state) {
   // Destroy memory helpers
   delete_mem(state->coll_mem);
   delete_mem(state->exdv_mem);
+  delete_scratch_arena(state->scratch_mem);
+  state->scratch_mem = NULL;
 
   struct storage_list *mem;
   for (mem = state->storage_head; mem != NULL; mem = mem->next) {
@@ -1224,8 +1336,10 @@ int destroy_everything(struct volume *state) {
 
   // Destroy subvolumes
   for (int i = 0; i < state->n_subvols; i++) {
-    struct subvolume *sv = &state->subvol[i];
-    pointer_hash_destroy(&sv->mol_by_species);
+    struct subvolume *sv = state->subvol[i];
+    if (sv == &state->empty_subvol)
+      continue;
+    free(sv->species_lists);
     sv->local_storage->wall_head = NULL;
     sv->local_storage->wall_count = 0;
     sv->local_storage->vert_count = 0;
@@ -1239,6 +1353,11 @@ int destroy_everything(struct volume *state) {
   state->storage_head->store = NULL;
   state->storage_head = NULL;
 
+  delete_mem(state->subvol_mem);
+  free(state->storage_grid);
+  free(state->subvol_clearance);
+  state->subvol_clearance = NULL;
+
   delete_mem(state->storage_allocator);
   delete_mem(state->sp_coll_mem);
   delete_mem(state->tri_coll_mem);
@@ -1306,6 +1425,8 @@ destroy_objects:
   Out: Zero on success. One otherwise. Recursively destroys objects.
   Note: Currently, this ultimately only destroys polygon objects. I don't know
         if there's a need to trash release objects that use release patterns.
+        Region release sites only lose their voxel maps, which were built
+        for the old walls.
 ***************************************************************************/
 int destroy_objects(struct object *obj_ptr, int free_poly_flag) {
   obj_ptr->sym->count = 0;
@@ -1326,8 +1447,12 @@ int destroy_objects(struct object *obj_ptr, int free_poly_flag) {
     destroy_poly_object(obj_ptr, free_poly_flag);
     break;
 
-  // do nothing
   case REL_SITE_OBJ:
+    delete_release_voxel_map(
+        ((struct release_site_obj *)obj_ptr->contents)->region_data);
+    break;
+
+  // do nothing
   case VOXEL_OBJ:
     break;
   }
@@ -1350,6 +1475,8 @@ int destroy_poly_object(struct object *obj_ptr, int free_poly_flag) {
       if (w->grid) {
         /*free(w->grid->mol);*/
         delete_void_list((struct void_list *)w->grid->sm_list);
+        free_bit_array(w->grid->occupancy);
+        destroy_tile_adjacency(w->grid);
       } 
       delete_void_list((struct void_list *)w->surf_class_head);
     }
@@ -1605,7 +1732,7 @@ int init_species_mesh_transp(struct volume *state) {
     if (spec->flags & ON_GRID) {
       sm_flag = 1;
     }
-    find_all_obj_region_transp(state->root_instance, &mesh_transp_head,
+    find_all_obj_region_transp(state, state->root_instance, &mesh_transp_head,
                                &mesh_transp_tail, species_name, sm_flag);
     if (pointer_hash_add(
         state->species_mesh_transp, key, keyhash, (void *)mesh_transp_head)) {
@@ -1643,6 +1770,7 @@ int find_sm_region_transp(struct object *obj_ptr,
           struct mesh_transparency, "object transparency");
       mesh_transp->next = NULL;
       mesh_transp->name = reg_ptr->sym->name;
+      mesh_transp->mesh_id = 0;
       // Ignore this until I merge in Markus' experimental changes
       mesh_transp->in_to_out = 0;
       mesh_transp->out_to_in = 0;
@@ -1710,14 +1838,16 @@ void check_surf_class_properties(
 
 /***************************************************************************
 find_vm_obj_region_transp:
-  In:  obj_ptr: The object we are currently checking for transparency
+  In:  state: MCell state
+       obj_ptr: The object we are currently checking for transparency
        mesh_transp_head: Head of the mesh transparency list
        mesh_transp_tail: Tail of the mesh transparency list
        species_name: The name of the molecule/species we are checking
   Out: Zero on success. Check every region on obj_ptr to see if any of them are
        transparent to the volume molecules with species_name.
 ***************************************************************************/
-int find_vm_obj_region_transp(struct object *obj_ptr,
+int find_vm_obj_region_transp(struct volume *state,
+                              struct object *obj_ptr,
                               struct mesh_transparency **mesh_transp_head,
                               struct mesh_transparency **mesh_transp_tail,
                               char *species_name) {
@@ -1727,6 +1857,7 @@ int find_vm_obj_region_transp(struct object *obj_ptr,
       CHECKED_MALLOC_STRUCT(struct mesh_transparency, "object transparency");
   mesh_transp->next = NULL;
   mesh_transp->name = obj_ptr->sym->name;
+  mesh_transp->mesh_id = get_mesh_id(state, obj_ptr);
   mesh_transp->in_to_out = 0;
   mesh_transp->out_to_in = 0;
   if (*mesh_transp_tail == NULL) {
@@ -1789,7 +1920,8 @@ int find_vm_obj_region_transp(struct object *obj_ptr,
 
 /***************************************************************************
 find_all_obj_region_transp:
-  In: obj_ptr: The mesh object
+  In: state: MCell state
+      obj_ptr: The mesh object
       mesh_transp_head: Head of the object transparency list
       mesh_transp_tail: Tail of the object transparency list
       species_name: The name of the molecule/species we are checking
@@ -1797,7 +1929,8 @@ find_all_obj_region_transp:
   Out: Zero on success. Check every polygon object to see if it is transparent
        to species_name.
 ***************************************************************************/
-int find_all_obj_region_transp(struct object *obj_ptr,
+int find_all_obj_region_transp(struct volume *state,
+                               struct object *obj_ptr,
                                struct mesh_transparency **mesh_transp_head,
                                struct mesh_transparency **mesh_transp_tail,
                                char *species_name,
@@ -1808,7 +1941,7 @@ int find_all_obj_region_transp(struct object *obj_ptr,
     for (struct object *child_obj_ptr = obj_ptr->first_child;
          child_obj_ptr != NULL; child_obj_ptr = child_obj_ptr->next) {
       if (find_all_obj_region_transp(
-          child_obj_ptr, mesh_transp_head, mesh_transp_tail, species_name,
+          state, child_obj_ptr, mesh_transp_head, mesh_transp_tail, species_name,
           sm_flag))
         return 1;
     }
@@ -1824,7 +1957,7 @@ int find_all_obj_region_transp(struct object *obj_ptr,
     }
     else {
       if (find_vm_obj_region_transp(
-          obj_ptr, mesh_transp_head, mesh_transp_tail, species_name)) {
+          state, obj_ptr, mesh_transp_head, mesh_transp_tail, species_name)) {
         return 1;
       }
     }
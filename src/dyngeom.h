@@ -32,44 +32,54 @@
 struct mesh_transparency {
   struct mesh_transparency *next;
   char *name;
+  int mesh_id; /* interned id of name (volume molecules only) */
   int in_to_out;
   int out_to_in;
   int transp_top_front;
   int transp_top_back;
 };
 
-struct name_hits {
-  struct name_hits *next;
-  char *name; /* molecule name */
-  int hits; /* molecule orientation */
+struct mesh_hits {
+  int mesh_id; /* interned mesh name */
+  double t; /* distance along the ray to the first crossing of this mesh */
 };
 
-struct n_parts {
-  int nx_parts;
-  int ny_parts;
-  int nz_parts;
+/* Meshes enclosing a point, in the order a ray from the point first crosses
+ * them. Kept on the stack unless there are more than MAX_NUM_OBJECTS. */
+struct mesh_hit_list {
+  struct mesh_hits *hits;
+  int n_hits;
+  int max_hits;
+  struct mesh_hits local[MAX_NUM_OBJECTS];
 };
 
-struct molecule_info ** save_all_molecules(
+/* Enclosing meshes of each subvolume that has no closed mesh walls in it. */
+struct mesh_nesting_cache {
+  int *sv_start; /* offset into the nesting pool, or -1 if not computed */
+  int *sv_count; /* number of enclosing meshes */
+  char const *ignore; /* meshes to ignore, indexed by mesh id (or NULL) */
+  int n_ignore;
+};
+
+struct sym_entry *intern_mesh_name(struct volume *state, char const *name);
+
+int get_mesh_id(struct volume *state, struct object *obj_ptr);
+
+struct molecule_info *save_all_molecules(
     struct volume *state, struct storage_list *storage_head);
 
 void save_common_molecule_properties(struct molecule_info *mol_info,
-                                     struct abstract_molecule *am_ptr,
-                                     struct string_buffer *reg_names,
-                                     struct string_buffer *mesh_names,
-                                     char *mesh_name);
+                                     struct abstract_molecule *am_ptr);
 
 void save_volume_molecule(struct volume *state, struct molecule_info *mol_info,
                           struct abstract_molecule *am_ptr,
-                          struct string_buffer **mesh_names);
+                          struct mesh_nesting_cache *cache);
 
-int save_surface_molecule(struct molecule_info *mol_info,
-                          struct abstract_molecule *am_ptr,
-                          struct string_buffer **reg_names,
-                          char **mesh_name);
+int save_surface_molecule(struct volume *state,
+                          struct molecule_info *mol_info,
+                          struct abstract_molecule *am_ptr);
 
-void cleanup_names_molecs(
-    int num_all_molecules, struct molecule_info **all_molecules);
+void cleanup_names_molecs(struct volume *state);
 
 int place_all_molecules(
     struct volume *state,
@@ -83,54 +93,48 @@ void check_for_large_molecular_displacement(
     double *time_unit,
     enum warn_level_t large_molecular_displacement_warning);
 
-char *compare_molecule_nesting(int *move_molecule,
-                               int *out_to_in, 
-                               struct string_buffer *mesh_names_old,
-                               struct string_buffer *mesh_names_new,
-                               struct mesh_transparency *mesh_transp);
+int compare_molecule_nesting(int *move_molecule,
+                             int *out_to_in,
+                             int const *mesh_ids_old, int n_old,
+                             int const *mesh_ids_new, int n_new,
+                             struct mesh_transparency *mesh_transp);
 
-char *check_overlapping_meshes(
+int check_overlapping_meshes(
     int *move_molecule, int *out_to_in, int difference,
-    struct string_buffer *compare_this, char *best_mesh,
+    int const *compare_this, int n_compare, int best_mesh,
     struct mesh_transparency *mesh_transp);
 
-char *check_nonoverlapping_meshes(int *move_molecule,
-                                  int *out_to_in,
-                                  struct string_buffer *mesh_names_old,
-                                  struct string_buffer *mesh_names_new,
-                                  char *best_mesh,
-                                  struct mesh_transparency *mesh_transp);
+int check_nonoverlapping_meshes(int *move_molecule,
+                                int *out_to_in,
+                                int const *mesh_ids_old, int n_old,
+                                int const *mesh_ids_new, int n_new,
+                                int best_mesh,
+                                struct mesh_transparency *mesh_transp);
 
-char *check_outin_or_inout(
+int check_outin_or_inout(
     int start, int increment, int end, int *move_molecule,
-    int *out_to_in, char *best_mesh, struct string_buffer *mesh_names,
+    int *out_to_in, int best_mesh, int const *mesh_ids, int n_mesh_ids,
     struct mesh_transparency *mesh_transp);
 
 struct volume_molecule *insert_volume_molecule_encl_mesh(
     struct volume *state,
     struct volume_molecule *vm,
     struct volume_molecule *vm_guess,
-    struct string_buffer *mesh_names_old,
-    struct string_buffer *names_to_ignore);
-
-int hit_wall(
-    struct wall *w, struct name_hits **name_head,
-    struct name_hits **name_tail, struct vector3 *rand_vector);
-
-void hit_subvol(
-    struct n_parts *np, struct string_buffer *mesh_names,
-    struct collision *smash, struct collision *shead,
-    struct name_hits *name_head, struct subvolume *sv,
-    struct volume_molecule *virt_mol);
+    struct molecule_info *mol_info,
+    struct mesh_nesting_cache *cache,
+    struct mesh_id_pool *nesting_new);
 
-struct string_buffer *find_enclosing_meshes(
+int find_enclosing_meshes(
     struct volume *state,
     struct volume_molecule *vm,
-    struct string_buffer *names_to_ignore);
+    char const *meshes_to_ignore,
+    int n_ignore,
+    struct mesh_id_pool *nesting,
+    int *n_meshes);
 
 void place_mol_relative_to_mesh(
     struct volume *state, struct vector3 *loc, struct subvolume *sv,
-    char *mesh_name, struct vector3 *new_pos, int out_to_in);
+    int mesh_id, struct vector3 *new_pos, int out_to_in);
 
 void destroy_mesh_transp_data(
     struct sym_table_head *mol_sym_table,
@@ -167,12 +171,14 @@ void check_surf_class_properties(
   char *species_name, struct mesh_transparency *mesh_transp,
   struct name_orient *surf_class_props);
 
-int find_vm_obj_region_transp(struct object *obj_ptr,
+int find_vm_obj_region_transp(struct volume *state,
+                              struct object *obj_ptr,
                               struct mesh_transparency **mesh_transp_head,
                               struct mesh_transparency **mesh_transp_tail,
                               char *species_name);
 
-int find_all_obj_region_transp(struct object *obj_ptr,
+int find_all_obj_region_transp(struct volume *state,
+                               struct object *obj_ptr,
                                struct mesh_transparency **mesh_transp_head,
                                struct mesh_transparency **mesh_transp_tail,
                                char *species_name, int sm_flag);
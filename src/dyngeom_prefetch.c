@@ -0,0 +1,290 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "logging.h"
+#include "mem_util.h"
+#include "dyngeom_prefetch.h"
+
+/* The MDL parser writes straight into the world (symbol tables, object tree,
+ * memory pools), so it cannot run concurrently with the simulation. What can
+ * be overlapped is everything up to the parser: the helper thread stays one
+ * snapshot ahead of the geometry scheduler and keeps the raw contents of the
+ * next MDL file in memory. */
+struct dg_prefetch {
+  int n_files;     /* Number of scheduled geometry files */
+  char **paths;    /* Geometry file names, in order of event time */
+  int next_take;   /* Index of the next file the simulation will ask for */
+  int next_load;   /* Index of the next file the helper thread will read */
+
+  char *buffer;    /* Contents of file 'loaded_idx', or NULL */
+  size_t size;     /* Number of bytes in buffer */
+  int loaded_idx;  /* Which file is in buffer (-1 if none) */
+
+  int loading_idx; /* Which file the helper thread is reading (-1 if none) */
+  int quit;        /* Set to ask the helper thread to exit */
+
+#ifndef _WIN32
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+};
+
+#ifndef _WIN32
+
+/***************************************************************************
+ read_whole_file:
+  In:  path: name of the file to read
+       size: number of bytes read is stored here
+  Out: Newly allocated buffer with the contents of the file, or NULL if the
+       file could not be read. Uses plain malloc rather than the checked
+       allocators, since failure here only means we fall back to reading the
+       file at the time of the geometry change.
+***************************************************************************/
+static char *read_whole_file(char const *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return NULL;
+
+  size_t capacity = 1 << 16;
+  size_t used = 0;
+  char *buf = malloc(capacity);
+  while (buf != NULL) {
+    used += fread(buf + used, 1, capacity - used, f);
+    if (used < capacity)
+      break;
+    capacity *= 2;
+    char *bigger = realloc(buf, capacity);
+    if (bigger == NULL)
+      free(buf);
+    buf = bigger;
+  }
+
+  if (buf != NULL && ferror(f)) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+
+  *size = used;
+  return buf;
+}
+
+/***************************************************************************
+ dg_prefetch_main:
+  In:  data: the prefetch state
+  Out: NULL. Reads geometry files one at a time, waiting for the simulation to
+       consume each one before reading the next.
+***************************************************************************/
+static void *dg_prefetch_main(void *data) {
+  struct dg_prefetch *pf = (struct dg_prefetch *)data;
+
+  pthread_mutex_lock(&pf->lock);
+  while (!pf->quit) {
+    if (pf->loaded_idx >= 0 || pf->next_load >= pf->n_files) {
+      pthread_cond_wait(&pf->cond, &pf->lock);
+      continue;
+    }
+
+    int idx = pf->next_load++;
+    pf->loading_idx = idx;
+    pthread_mutex_unlock(&pf->lock);
+
+    size_t size = 0;
+    char *buf = read_whole_file(pf->paths[idx], &size);
+
+    pthread_mutex_lock(&pf->lock);
+    pf->loading_idx = -1;
+    if (buf != NULL && idx >= pf->next_take) {
+      pf->buffer = buf;
+      pf->size = size;
+      pf->loaded_idx = idx;
+    } else {
+      free(buf);
+    }
+    pthread_cond_broadcast(&pf->cond);
+  }
+  pthread_mutex_unlock(&pf->lock);
+  return NULL;
+}
+
+#endif
+
+/***************************************************************************
+ dg_prefetch_create:
+  In:  dg_head: list of dynamic geometry events (before they are handed to the
+                scheduler, which reuses the 'next' pointers)
+  Out: The prefetch state with its helper thread running, or NULL if there is
+       nothing to prefetch or threads are not available.
+***************************************************************************/
+struct dg_prefetch *dg_prefetch_create(struct dg_time_filename *dg_head) {
+#ifdef _WIN32
+  UNUSED(dg_head);
+  mcell_warn("Prefetching of dynamic geometry files is not supported on this "
+             "platform.");
+  return NULL;
+#else
+  int n_files = 0;
+  for (struct dg_time_filename *dg = dg_head; dg != NULL; dg = dg->next)
+    n_files++;
+  if (n_files == 0)
+    return NULL;
+
+  struct dg_prefetch *pf =
+      CHECKED_MALLOC_STRUCT(struct dg_prefetch, "dynamic geometry prefetch");
+  memset(pf, 0, sizeof(struct dg_prefetch));
+  pf->n_files = n_files;
+  pf->loaded_idx = -1;
+  pf->loading_idx = -1;
+
+  // Keep the file names sorted by event time, which is the order in which
+  // the geometry scheduler will hand them out.
+  struct dg_time_filename **events = CHECKED_MALLOC_ARRAY(
+      struct dg_time_filename *, n_files, "dynamic geometry events");
+  int n = 0;
+  for (struct dg_time_filename *dg = dg_head; dg != NULL; dg = dg->next) {
+    int i = n++;
+    while (i > 0 && events[i - 1]->event_time > dg->event_time) {
+      events[i] = events[i - 1];
+      i--;
+    }
+    events[i] = dg;
+  }
+
+  pf->paths = CHECKED_MALLOC_ARRAY(char *, n_files, "dynamic geometry files");
+  for (int i = 0; i < n_files; i++)
+    pf->paths[i] = CHECKED_STRDUP(events[i]->mdl_file_path,
+                                  "dynamic geometry file name");
+  free(events);
+
+  pthread_mutex_init(&pf->lock, NULL);
+  pthread_cond_init(&pf->cond, NULL);
+  if (pthread_create(&pf->thread, NULL, dg_prefetch_main, pf) != 0) {
+    mcell_warn("Failed to start dynamic geometry prefetch thread; geometry "
+               "files will be read when they are needed.");
+    pthread_cond_destroy(&pf->cond);
+    pthread_mutex_destroy(&pf->lock);
+    for (int i = 0; i < n_files; i++)
+      free(pf->paths[i]);
+    free(pf->paths);
+    free(pf);
+    return NULL;
+  }
+
+  return pf;
+#endif
+}
+
+/***************************************************************************
+ dg_prefetch_take:
+  In:  pf: the prefetch state
+       path: the geometry file the parser is about to open
+       buffer: contents of the file are stored here (caller frees)
+       size: number of bytes in buffer
+  Out: 0 if the file was prefetched, 1 otherwise (the caller should read the
+       file itself). If the request does not match the next expected file
+       (e.g. the scheduler skipped a snapshot), the following files are
+       searched for it, any skipped snapshots are dropped and the helper
+       thread resumes after the requested one. A file that is not in the
+       list at all leaves the prefetch state untouched.
+***************************************************************************/
+int dg_prefetch_take(struct dg_prefetch *pf, char const *path, char **buffer,
+                     size_t *size) {
+#ifdef _WIN32
+  UNUSED(pf);
+  UNUSED(path);
+  UNUSED(buffer);
+  UNUSED(size);
+  return 1;
+#else
+  int found = 1;
+
+  pthread_mutex_lock(&pf->lock);
+  int idx = pf->next_take;
+  while (idx < pf->n_files && strcmp(pf->paths[idx], path) != 0)
+    idx++;
+  if (idx >= pf->n_files) {
+    pthread_mutex_unlock(&pf->lock);
+    return 1;
+  }
+
+  // If the helper thread is reading this very file, it is cheaper to wait
+  // for it than to start reading it a second time. A skipped file that is
+  // still being read is discarded by the helper once it sees next_take.
+  while (pf->loading_idx == idx)
+    pthread_cond_wait(&pf->cond, &pf->lock);
+
+  if (pf->loaded_idx == idx) {
+    *buffer = pf->buffer;
+    *size = pf->size;
+    found = 0;
+  } else {
+    free(pf->buffer);
+  }
+  pf->buffer = NULL;
+  pf->size = 0;
+  pf->loaded_idx = -1;
+  pf->next_take = idx + 1;
+  if (pf->next_load < pf->next_take)
+    pf->next_load = pf->next_take;
+  pthread_cond_broadcast(&pf->cond);
+  pthread_mutex_unlock(&pf->lock);
+
+  return found;
+#endif
+}
+
+/***************************************************************************
+ dg_prefetch_destroy:
+  In:  pf: the prefetch state
+  Out: None. The helper thread is stopped and all memory is released.
+***************************************************************************/
+void dg_prefetch_destroy(struct dg_prefetch *pf) {
+  if (pf == NULL)
+    return;
+#ifndef _WIN32
+  pthread_mutex_lock(&pf->lock);
+  pf->quit = 1;
+  pthread_cond_broadcast(&pf->cond);
+  pthread_mutex_unlock(&pf->lock);
+  pthread_join(pf->thread, NULL);
+  pthread_cond_destroy(&pf->cond);
+  pthread_mutex_destroy(&pf->lock);
+
+  free(pf->buffer);
+  for (int i = 0; i < pf->n_files; i++)
+    free(pf->paths[i]);
+  free(pf->paths);
+  free(pf);
+#endif
+}
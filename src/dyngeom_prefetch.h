@@ -0,0 +1,44 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+ *****************************************************************************/
+
+#ifndef DYNGEOM_PREFETCH_H
+#define DYNGEOM_PREFETCH_H
+
+#include <stddef.h>
+
+#include "mcell_structs.h"
+
+/* Background loader for dynamic geometry snapshots. A helper thread reads the
+ * MDL file of the next scheduled geometry change into memory while the
+ * current interval is being simulated, so that the geometry change itself
+ * only has to parse from memory. */
+struct dg_prefetch;
+
+struct dg_prefetch *dg_prefetch_create(struct dg_time_filename *dg_head);
+
+int dg_prefetch_take(struct dg_prefetch *pf, char const *path, char **buffer,
+                     size_t *size);
+
+void dg_prefetch_destroy(struct dg_prefetch *pf);
+
+#endif
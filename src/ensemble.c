@@ -0,0 +1,233 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "logging.h"
+#include "util.h"
+#include "dyngeom_prefetch.h"
+#include "ensemble.h"
+
+/*************************************************************************
+replicate_file_name:
+  In: name: output file name or prefix from the model
+      seed: random sequence of this replicate
+  Out: The name with a "seed_NNNNN" directory inserted before its last path
+       element.  The old name is freed.
+*************************************************************************/
+static char *replicate_file_name(char *name, u_int seed) {
+  char *base = strrchr(name, '/');
+  base = (base == NULL) ? name : base + 1;
+
+  char *new_name = CHECKED_SPRINTF("%.*sseed_%05u/%s", (int)(base - name),
+                                   name, seed, base);
+  free(name);
+  return new_name;
+}
+
+/*************************************************************************
+set_replicate_chkpt_init:
+  In: world: simulation state, set up for the checkpoint file name given
+             in the model
+      chkpt_init: 1 if this replicate starts afresh, 0 if it reads its own
+                  checkpoint file
+  Out: No return value.  The molecule schedulers, which init_partitions only
+       creates for a fresh start, match the new state.
+*************************************************************************/
+static void set_replicate_chkpt_init(struct volume *world, u_int chkpt_init) {
+  for (struct storage_list *stg = world->storage_head; stg != NULL;
+       stg = stg->next) {
+    if (chkpt_init) {
+      if ((stg->store->timer = create_scheduler(1.0, 100.0, 100, 0.0)) == NULL)
+        mcell_allocfailed("Failed to create molecule scheduler.");
+      stg->store->current_time = 0.0;
+    } else {
+      /* The checkpoint reader creates its own */
+      delete_scheduler(stg->store->timer);
+      stg->store->timer = NULL;
+    }
+  }
+  world->chkpt_init = chkpt_init;
+}
+
+/*************************************************************************
+become_replicate:
+  In: world: simulation state, copied from the first replicate by fork
+      idx: index of this replicate
+  Out: No return value.  The random sequence, output file names and
+       checkpoint file names are those of replicate idx.
+*************************************************************************/
+static void become_replicate(struct volume *world, int idx) {
+  world->seed_seq += idx;
+  rng_init(world->rng, world->seed_seq);
+
+  for (struct output_block *obp = world->output_block_head; obp != NULL;
+       obp = obp->next) {
+    for (struct output_set *set = obp->data_set_head; set != NULL;
+         set = set->next) {
+      /* The parser created the directories for the original names */
+      set->outfile_name = replicate_file_name(set->outfile_name,
+                                              world->seed_seq);
+      if (make_parent_dir(set->outfile_name))
+        mcell_error("Cannot create directory for reaction output file '%s'.",
+                    set->outfile_name);
+    }
+  }
+
+  for (struct viz_output_block *vizblk = world->viz_blocks; vizblk != NULL;
+       vizblk = vizblk->next) {
+    if (vizblk->file_prefix_name != NULL)
+      vizblk->file_prefix_name =
+          replicate_file_name(vizblk->file_prefix_name, world->seed_seq);
+  }
+
+  for (struct volume_output_item *vo = world->volume_output_head; vo != NULL;
+       vo = vo->next)
+    vo->filename_prefix = replicate_file_name(vo->filename_prefix,
+                                              world->seed_seq);
+
+  /* Each replicate continues from the checkpoint it wrote itself, and starts
+   * afresh if there is none yet */
+  if (world->chkpt_infile != NULL) {
+    world->chkpt_infile = replicate_file_name(world->chkpt_infile,
+                                              world->seed_seq);
+    FILE *chkpt_infs = fopen(world->chkpt_infile, "rb");
+    u_int chkpt_init = (chkpt_infs == NULL);
+    if (chkpt_infs != NULL)
+      fclose(chkpt_infs);
+    if (chkpt_init != world->chkpt_init)
+      set_replicate_chkpt_init(world, chkpt_init);
+  }
+
+  if (world->chkpt_outfile != NULL) {
+    world->chkpt_outfile = replicate_file_name(world->chkpt_outfile,
+                                               world->seed_seq);
+    if (make_parent_dir(world->chkpt_outfile))
+      mcell_error("Cannot create directory for checkpoint file '%s'.",
+                  world->chkpt_outfile);
+  }
+
+  if (world->load_heatmap_prefix != NULL)
+    world->load_heatmap_prefix =
+        replicate_file_name(world->load_heatmap_prefix, world->seed_seq);
+
+  if (world->phase_timing_file != NULL)
+    world->phase_timing_file = replicate_file_name(world->phase_timing_file,
+                                                   world->seed_seq);
+}
+
+/*************************************************************************
+fork_replicates:
+  In: world: simulation state with the model set up except for molecules
+  Out: Returns 1 on error, 0 on success.  When world->n_replicates is more
+       than one, this returns once in each of n_replicates processes, each
+       running one replicate.  The first replicate keeps the pids of the
+       others in world->replicate_pids.
+*************************************************************************/
+int fork_replicates(struct volume *world) {
+  if (world->n_replicates <= 1)
+    return 0;
+
+#ifdef _WIN32
+  mcell_error_nodie("-replicates is not supported on this platform.");
+  return 1;
+#else
+  if ((u_int)world->n_replicates - 1 > INT_MAX - world->seed_seq) {
+    mcell_error_nodie("Random sequences %u to %u are out of range.",
+                      world->seed_seq,
+                      world->seed_seq + (u_int)world->n_replicates - 1);
+    return 1;
+  }
+
+  /* A helper thread does not survive fork */
+  if (world->dg_prefetch != NULL) {
+    mcell_warn("-dyngeom_prefetch is ignored with -replicates.");
+    dg_prefetch_destroy(world->dg_prefetch);
+    world->dg_prefetch = NULL;
+  }
+
+  if (world->notify->progress_report != NOTIFY_NONE)
+    mcell_log("Running %d replicates with random sequences %u to %u.",
+              world->n_replicates, world->seed_seq,
+              world->seed_seq + (u_int)world->n_replicates - 1);
+
+  world->replicate_pids = CHECKED_MALLOC_ARRAY(
+      pid_t, world->n_replicates - 1, "replicate process ids");
+  if (world->replicate_pids == NULL)
+    return 1;
+
+  /* Don't let every replicate write out what is buffered so far */
+  fflush(NULL);
+
+  for (int idx = 1; idx < world->n_replicates; idx++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      mcell_perror_nodie(errno, "Failed to start replicate %d", idx);
+      world->n_replicates = idx;
+      break;
+    }
+    if (pid == 0) {
+      free(world->replicate_pids);
+      world->replicate_pids = NULL;
+      become_replicate(world, idx);
+      return 0;
+    }
+    world->replicate_pids[idx - 1] = pid;
+  }
+
+  become_replicate(world, 0);
+  return 0;
+#endif
+}
+
+/*************************************************************************
+wait_for_replicates:
+  In: world: simulation state of the first replicate
+  Out: Returns the number of other replicates which failed.
+*************************************************************************/
+int wait_for_replicates(struct volume *world) {
+  int n_failed = 0;
+#ifndef _WIN32
+  for (int idx = 1; idx < world->n_replicates; idx++) {
+    int status = 0;
+    if (waitpid(world->replicate_pids[idx - 1], &status, 0) < 0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      mcell_warn("Replicate %d (random sequence %u) failed.", idx,
+                 world->seed_seq + (u_int)idx);
+      n_failed++;
+    }
+  }
+#endif
+  free(world->replicate_pids);
+  world->replicate_pids = NULL;
+  return n_failed;
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "mcell_structs.h"
+
+/* Ensemble runs (see -replicates).
+ *
+ * The model is parsed and its geometry, partitions, regions and reaction
+ * tables are built once.  The process then forks one copy per additional
+ * replicate before the first random number is drawn after parsing, so all
+ * replicates share these pages copy-on-write and only the pages they write
+ * (molecules, schedulers, counters, surface grids) are duplicated.  Replicate
+ * k uses the random sequence seed + k and writes its output files into a
+ * "seed_NNNNN" directory next to the file names given in the model.  Its
+ * checkpoint files go to such a directory as well, and a checkpoint given
+ * with -checkpoint_infile is read from there, so that each replicate resumes
+ * from its own state. */
+
+int fork_replicates(struct volume *world);
+
+int wait_for_replicates(struct volume *world);
+
+#endif
@@ -0,0 +1,140 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+/* exd_cache_check: regression check for the exact disk cache.
+ *
+ * Two collisions next to the +X face of a box fall into the same cache
+ * entry.  The disk of the first one ends just short of the face, so no wall
+ * cuts it and its area is cached.  The disk of the second one reaches
+ * through the face, and its target lies on the far side.  exact_disk must
+ * report that target as occluded even though the cached disk had no walls.
+ *
+ * Exits with 0 if all checks pass, 1 otherwise. */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "diffuse.h"
+#include "logging.h"
+#include "mcell_objects.h"
+#include "vol_util.h"
+
+/* Interaction radius and cache tolerance of the check.  The location
+ * quantum is 0.003 um, and the cell [0.489, 0.492) holds points both more
+ * and less than R away from the face at x = 0.5. */
+#define CHECK_R 0.01
+#define CHECK_TOLERANCE 0.3
+
+static int build_check_model(MCELL_STATE *state, mcell_symbol **a) {
+  /* No partition at x = 0.5, so the face only crosses one subvolume row */
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.2));
+  *a = bench_add_species(state, "A", 1e-6, 0);
+  if (*a == NULL)
+    return 1;
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  if (bench_add_box(state, world, "box", &llf, &urb, NULL) == NULL)
+    return 1;
+  return 0;
+}
+
+/*************************************************************************
+check_disk:
+  In: world: simulation state
+      what: description of the collision for the report
+      moving: the moving molecule
+      loc: location of the moving molecule at the collision, in microns
+      target: location of the target molecule, in microns
+      expect_occluded: whether the target should be occluded
+  Out: Returns 1 if the result is not as expected, 0 otherwise.
+*************************************************************************/
+static int check_disk(struct volume *world, char const *what,
+                      struct volume_molecule *moving, struct vector3 const *loc,
+                      struct vector3 const *target, int expect_occluded) {
+  /* Internal lengths are in units of world->length_unit */
+  double s = world->r_length_unit;
+  struct vector3 here = { loc->x * s, loc->y * s, loc->z * s };
+  struct vector3 mv = { 0.0, 1e-3 * s, 0.0 }; /* Parallel to the face */
+  struct volume_molecule there = *moving;
+  there.pos.x = target->x * s;
+  there.pos.y = target->y * s;
+  there.pos.z = target->z * s;
+
+  struct subvolume *sv = find_subvolume(world, &here, NULL);
+  double factor = exact_disk(world, &here, &mv, CHECK_R * s, sv, moving,
+                             &there, world->use_expanded_list,
+                             world->x_fineparts, world->y_fineparts,
+                             world->z_fineparts);
+  int occluded = (factor < 0);
+  fprintf(stdout, "%-45s %12.6g  %s\n", what, factor,
+          (occluded == expect_occluded) ? "ok" : "FAIL");
+  return (occluded == expect_occluded) ? 0 : 1;
+}
+
+int main(void) {
+  MCELL_STATE *state = mcell_create();
+  if (state == NULL)
+    return 1;
+  mcell_set_log_file(stderr);
+  state->quiet_flag = 1;
+  state->seed_seq = 1;
+  if (mcell_init_state(state) || mcell_set_time_step(state, 1e-6) ||
+      mcell_set_iterations(state, 1))
+    return 1;
+  mcell_symbol *a = NULL;
+  if (build_check_model(state, &a) || mcell_init_simulation(state)) {
+    fprintf(stderr, "Failed to set up the exact disk check model.\n");
+    return 1;
+  }
+  state->exd_cache_tolerance = CHECK_TOLERANCE;
+
+  struct volume_molecule moving;
+  memset(&moving, 0, sizeof(moving));
+  moving.properties = (struct species *)a->value;
+
+  int failures = 0;
+
+  /* 1.09 R from the face: the disk misses it, the target is inside */
+  struct vector3 near = { 0.4891, 0.1, 0.3 };
+  struct vector3 target = { 0.4841, 0.1, 0.3 };
+  failures += check_disk(state, "disk short of the face (fills the cache)",
+                         &moving, &near, &target, 0);
+
+  /* 0.81 R from the face, same cache entry: the target is behind it */
+  struct vector3 nearer = { 0.4919, 0.1, 0.3 };
+  target.x = 0.501;
+  failures += check_disk(state, "disk through the face, target behind it",
+                         &moving, &nearer, &target, 1);
+
+  /* Same disk, target on the near side */
+  target.x = 0.499;
+  failures += check_disk(state, "disk through the face, target in front",
+                         &moving, &nearer, &target, 0);
+
+  return (failures != 0) ? 1 : 0;
+}
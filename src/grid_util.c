@@ -42,6 +42,7 @@
 #include "wall_util.h"
 #include "react.h"
 #include "init.h"
+#include "dyngeom.h"
 
 /*************************************************************************
 xyz2uv and uv2xyz:
@@ -345,11 +346,44 @@ int create_grid(struct volume *world, struct wall *w, struct subvolume *guess) {
     sg->sm_list[i] = NULL;
   }
 
+  sg->occupancy = new_bit_array(sg->n_tiles);
+  if (sg->occupancy == NULL)
+    mcell_allocfailed("Failed to allocate surface grid occupancy.");
+  set_all_bits(sg->occupancy, 0);
+
+  sg->adjacency = NULL;
   w->grid = sg;
 
+  /* tiles on this wall may now be neighbors of tiles next to it */
+  for (int kk = 0; kk < 3; kk++) {
+    if (w->nb_walls[kk] != NULL && w->nb_walls[kk]->grid != NULL)
+      destroy_tile_adjacency(w->nb_walls[kk]->grid);
+  }
+  if (world->walls_using_vertex != NULL) {
+    for (int kk = 0; kk < 3; kk++) {
+      struct wall_list *wl =
+          world->walls_using_vertex[w->vert[kk] - world->all_vertices];
+      for (; wl != NULL; wl = wl->next) {
+        if (wl->this_wall->grid != NULL)
+          destroy_tile_adjacency(wl->this_wall->grid);
+      }
+    }
+  }
+
   return 0;
 }
 
+/*************************************************************************
+update_tile_occupancy:
+  In: a surface grid
+      index of a tile on it whose sm_list entry was just changed
+  Out: The occupancy bit of the tile matches sm_list again.
+*************************************************************************/
+void update_tile_occupancy(struct surface_grid *g, int idx) {
+  struct surface_molecule_list *sm_list = g->sm_list[idx];
+  set_bit(g->occupancy, idx, sm_list != NULL && sm_list->sm != NULL);
+}
+
 /*************************************************************************
 grid_neighbors:
   In: a surface grid
@@ -498,8 +532,9 @@ nearest_free:
        to the vector, or -1 if no unoccupied points are found in range
   Note: we assume you've already checked the grid element that contains
         the point, so we don't bother looking there first.
-  Note: if no unoccupied tile is found, found_dist2 contains distance to
-        closest occupied tile.
+  Note: strips whose tiles are all occupied are skipped using the grid's
+        occupancy bits, so if no unoccupied tile is found found_dist2 is
+        not meaningful.
 *************************************************************************/
 
 int nearest_free(struct surface_grid *g, struct vector2 *v, double max_d2,
@@ -530,6 +565,11 @@ int nearest_free(struct surface_grid *g, struct vector2 *v, double max_d2,
       continue; /* Entire strip is too far away */
 
     span = (g->n - k);
+    h = (g->n - k) - 1;
+    h = h * h;
+    if (test_bit_range(g->occupancy, h, h + 2 * span - 2, 1))
+      continue; /* Entire strip is occupied */
+
     for (j = 0; j < span; j++) {
       can_flip = (j != span - 1);
       for (i = 0; i <= can_flip; i++) {
@@ -546,7 +586,7 @@ int nearest_free(struct surface_grid *g, struct vector2 *v, double max_d2,
           h = (g->n - k) - 1;
           h = h * h + 2 * j + i;
 
-          if (!g->sm_list[h] || !g->sm_list[h]->sm) {
+          if (!get_bit(g->occupancy, h)) {
             idx = h;
             d2 = fff;
           } else if (idx == -1) {
@@ -566,20 +606,22 @@ int nearest_free(struct surface_grid *g, struct vector2 *v, double max_d2,
 
 /*************************************************************************
 verify_wall_regions_match:
-  In: char *mesh_name - the name of the polygon object to be checked
+  In: state - MCell state
+      int mesh_id - the interned id of the polygon object to be checked
       string_buffer *reg_names - contains the regions names to be checked
       wall *w - we will compare the regions on this wall to those in reg_names
   Out: 0 if region names in reg_names match those of the wall or if we aren't really
-       checking (mesh_name and/or reg_names are NULL), 1 otherwise.
+       checking (mesh_id is 0 and/or reg_names is NULL), 1 otherwise.
 *************************************************************************/
 int verify_wall_regions_match(
-    char *mesh_name, struct string_buffer *prev_reg_names, struct wall *w,
+    struct volume *state, int mesh_id, struct string_buffer *prev_reg_names,
+    struct wall *w,
     struct string_buffer *regions_to_ignore,
     struct mesh_transparency *mesh_transp, char *species_name) {
 
 
-  if ((mesh_name != NULL) && (prev_reg_names != NULL)) {
-    if (strcmp(w->parent_object->sym->name, mesh_name) != 0) {
+  if ((mesh_id != 0) && (prev_reg_names != NULL)) {
+    if (get_mesh_id(state, w->parent_object) != mesh_id) {
       return 1;
     }
     struct name_list *wall_reg_names = NULL;
@@ -672,7 +714,7 @@ struct wall *search_nbhd_for_free(struct volume *world, struct wall *origin,
                                   struct vector2 *point, double max_d2,
                                   int *found_idx,
                                   int (*ok)(void *, struct wall *),
-                                  void *context, char *mesh_name,
+                                  void *context, int mesh_id,
                                   struct string_buffer *reg_names) {
   struct wall *there = NULL;
   int i, j;
@@ -718,7 +760,8 @@ struct wall *search_nbhd_for_free(struct volume *world, struct wall *origin,
       if (ok != NULL && !(*ok)(context, there))
         continue; /* Calling function doesn't like this wall */
 
-      if (verify_wall_regions_match(mesh_name, reg_names, there, NULL, NULL, NULL)) {
+      if (verify_wall_regions_match(world, mesh_id, reg_names, there, NULL,
+                                    NULL, NULL)) {
         continue; 
       }
 
@@ -836,6 +879,25 @@ void push_tile_neighbor_to_list(struct tile_neighbor **head,
   *head = old_head;
 }
 
+/***************************************************************************
+push_tile_neighbor_to_scratch_list:
+   In: scratch arena to allocate the node from
+       head of the linked list
+       grid and tile index to add
+   Out: none. The tile is pushed onto the head of the list. The list must
+        not be passed to delete_tile_neighbor_list().
+****************************************************************************/
+void push_tile_neighbor_to_scratch_list(struct scratch_arena *sa,
+                                        struct tile_neighbor **head,
+                                        struct surface_grid *grid, int idx) {
+  struct tile_neighbor *tile_nbr = SCRATCH_GET_STRUCT(sa, struct tile_neighbor);
+  tile_nbr->grid = grid;
+  tile_nbr->flag = 0;
+  tile_nbr->idx = idx;
+  tile_nbr->next = *head;
+  *head = tile_nbr;
+}
+
 /***************************************************************************
 push_tile_neighbor_to_list_with_checking:
    In: head of the linked list
@@ -2978,7 +3040,7 @@ void find_shared_vertices_for_neighbor_walls(struct wall *orig_wall,
 }
 
 /**************************************************************************
-find_neighbor_tiles:
+derive_neighbor_tiles:
   In: a surface molecule
       surface grid of the wall where hit happens, or
           surface molecule is located
@@ -2992,12 +3054,16 @@ find_neighbor_tiles:
        Neighbors should share either common edge or common vertex.
   Note: This version allows looking for the neighbors at the neighbor walls
        that are connected to the start wall through vertices only.
+       The neighbors are worked out from the geometry on every call, use
+       find_neighbor_tiles() or get_neighbor_tiles() instead.
 ****************************************************************************/
-void find_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
-                         struct surface_grid *grid, int idx,
-                         int create_grid_flag, int search_for_reactant,
-                         struct tile_neighbor **tile_nbr_head,
-                         int *list_length) {
+static void derive_neighbor_tiles(struct volume *world,
+                                  struct surface_molecule *sm,
+                                  struct surface_grid *grid, int idx,
+                                  int create_grid_flag,
+                                  int search_for_reactant,
+                                  struct tile_neighbor **tile_nbr_head,
+                                  int *list_length) {
   int kk;
   struct tile_neighbor *tile_nbr_head_vert = NULL, *tmp_head = NULL;
   int list_length_vert = 0; /* length of the linked list */
@@ -3030,8 +3096,9 @@ void find_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
 
       /* create list of neighbor walls that share one vertex
          with the start tile  (not edge-to-edge neighbor walls) */
-      wall_nbr_head =
-          find_nbr_walls_shared_one_vertex(world, grid->surface, shared_vert);
+      struct scratch_mark mark = scratch_mark(world->scratch_mem);
+      wall_nbr_head = find_nbr_walls_shared_one_vertex(
+          world, grid->surface, shared_vert, world->scratch_mem);
 
       if (wall_nbr_head != NULL) {
         grid_all_neighbors_across_walls_through_vertices(
@@ -3039,10 +3106,8 @@ void find_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
             search_for_reactant, &tile_nbr_head_vert, &list_length_vert);
       }
 
-      if (wall_nbr_head != NULL) {
-        delete_wall_list(wall_nbr_head);
-        wall_nbr_head = NULL;
-      }
+      scratch_release(world->scratch_mem, mark);
+      wall_nbr_head = NULL;
 
       grid_all_neighbors_across_walls_through_edges(
           world, sm, grid, idx, create_grid_flag, search_for_reactant,
@@ -3064,4 +3129,326 @@ void find_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
   *list_length = tmp_list_length;
 }
 
+/**************************************************************************
+grid_touches_gridless_wall:
+  In: a surface grid
+  Out: 1 if an edge neighbor of the grid's wall, or a wall sharing one of
+       its vertices, has no grid yet; 0 otherwise.
+****************************************************************************/
+static int grid_touches_gridless_wall(struct volume *world,
+                                      struct surface_grid *grid) {
+  struct wall *w = grid->surface;
+
+  for (int kk = 0; kk < 3; kk++) {
+    if (w->nb_walls[kk] != NULL && w->nb_walls[kk]->grid == NULL)
+      return 1;
+  }
+  if (world->walls_using_vertex != NULL) {
+    for (int kk = 0; kk < 3; kk++) {
+      struct wall_list *wl =
+          world->walls_using_vertex[w->vert[kk] - world->all_vertices];
+      for (; wl != NULL; wl = wl->next) {
+        if (wl->this_wall->grid == NULL)
+          return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**************************************************************************
+build_tile_adjacency:
+  In: a surface grid
+  Out: The neighbor tiles of every border tile on the grid, without region
+       border checks and without creating grids on the neighbor walls.
+****************************************************************************/
+static struct tile_adjacency *build_tile_adjacency(struct volume *world,
+                                                   struct surface_grid *grid) {
+  struct tile_adjacency *adj =
+      CHECKED_MALLOC_STRUCT(struct tile_adjacency, "tile adjacency");
+  adj->offsets =
+      CHECKED_MALLOC_ARRAY(int, grid->n_tiles + 1, "tile adjacency");
+  adj->complete = !grid_touches_gridless_wall(world, grid);
+
+  int max_tiles = 24 * grid->n + 16;
+  adj->tiles =
+      CHECKED_MALLOC_ARRAY(struct tile_ref, max_tiles, "tile adjacency");
+
+  int n = 0;
+  for (unsigned int idx = 0; idx < grid->n_tiles; idx++) {
+    adj->offsets[idx] = n;
+    if (is_inner_tile(grid, idx))
+      continue;
+
+    struct tile_neighbor *head = NULL;
+    int list_length = 0;
+    derive_neighbor_tiles(world, NULL, grid, idx, 0, 0, &head, &list_length);
+
+    if (n + list_length > max_tiles) {
+      max_tiles = 2 * (n + list_length);
+      struct tile_ref *tiles = CHECKED_MALLOC_ARRAY(struct tile_ref, max_tiles,
+                                                    "tile adjacency");
+      memcpy(tiles, adj->tiles, n * sizeof(struct tile_ref));
+      free(adj->tiles);
+      adj->tiles = tiles;
+    }
+
+    for (struct tile_neighbor *tn = head; tn != NULL; tn = tn->next) {
+      adj->tiles[n].grid = tn->grid;
+      adj->tiles[n].idx = tn->idx;
+      n++;
+    }
+    if (head != NULL)
+      delete_tile_neighbor_list(head);
+  }
+  adj->offsets[grid->n_tiles] = n;
+
+  return adj;
+}
+
+/**************************************************************************
+destroy_tile_adjacency:
+  In: a surface grid
+  Out: The cached neighbor tiles of the grid are freed. They are built
+       again the next time they are needed.
+****************************************************************************/
+void destroy_tile_adjacency(struct surface_grid *grid) {
+  if (grid->adjacency == NULL)
+    return;
+
+  free(grid->adjacency->offsets);
+  free(grid->adjacency->tiles);
+  free(grid->adjacency);
+  grid->adjacency = NULL;
+}
+
+/**************************************************************************
+init_tile_nbr_buf, free_tile_nbr_buf:
+  In: a neighbor tile buffer
+  Out: The buffer is set up empty, or the memory it took is released.
+****************************************************************************/
+void init_tile_nbr_buf(struct tile_nbr_buf *buf) {
+  buf->tiles = buf->local;
+  buf->n_tiles = 0;
+  buf->max_tiles = TILE_NBR_LOCAL;
+}
+
+void free_tile_nbr_buf(struct tile_nbr_buf *buf) {
+  if (buf->tiles != buf->local)
+    free(buf->tiles);
+  init_tile_nbr_buf(buf);
+}
+
+static void add_tile_nbr(struct tile_nbr_buf *buf, struct tile_ref const *t) {
+  if (buf->n_tiles == buf->max_tiles) {
+    int new_max = 2 * buf->max_tiles;
+    struct tile_ref *new_tiles = CHECKED_MALLOC_ARRAY(
+        struct tile_ref, new_max, "neighbor tiles");
+    memcpy(new_tiles, buf->tiles, buf->n_tiles * sizeof(struct tile_ref));
+    if (buf->tiles != buf->local)
+      free(buf->tiles);
+    buf->tiles = new_tiles;
+    buf->max_tiles = new_max;
+  }
+  buf->tiles[buf->n_tiles++] = *t;
+}
+
+/**************************************************************************
+add_inner_tile_nbrs:
+  In: a surface grid
+      index of an inner tile on that grid
+      buffer to add the neighbor tiles to
+  Out: The 12 neighbors of the tile are added to the buffer in the order
+       grid_all_neighbors_for_inner_tile() returns them.
+****************************************************************************/
+static void add_inner_tile_nbrs(struct surface_grid *grid, int idx,
+                                struct tile_nbr_buf *buf) {
+  int root = (int)(sqrt((double)idx));
+  int rootrem = idx - root * root;
+  int stripe = rootrem / 2;
+  int flip = rootrem - 2 * stripe;
+
+  int row[8];
+  int n = 0;
+  if (flip == 0) {
+    /* 3 neighbors in the row below, 5 in the row above */
+    int down = idx - 2 * root;
+    int vert = 1 + 2 * stripe + (root + 1) * (root + 1);
+    row[n++] = down + 1;
+    row[n++] = down - 1;
+    row[n++] = down;
+    row[n++] = vert + 2;
+    row[n++] = vert + 1;
+    row[n++] = vert - 2;
+    row[n++] = vert - 1;
+    row[n++] = vert;
+  } else {
+    /* 5 neighbors in the row below, 3 in the row above */
+    int up = idx + 2 * (root + 1);
+    int vert = 2 * stripe + (root - 1) * (root - 1);
+    row[n++] = vert + 2;
+    row[n++] = vert + 1;
+    row[n++] = vert - 2;
+    row[n++] = vert - 1;
+    row[n++] = vert;
+    row[n++] = up + 1;
+    row[n++] = up - 1;
+    row[n++] = up;
+  }
+
+  struct tile_ref t;
+  t.grid = grid;
+  for (int i = 0; i < n; i++) {
+    t.idx = row[i];
+    add_tile_nbr(buf, &t);
+  }
+  /* 2 neighbors to the left and 2 to the right */
+  t.idx = idx + 2;
+  add_tile_nbr(buf, &t);
+  t.idx = idx + 1;
+  add_tile_nbr(buf, &t);
+  t.idx = idx - 2;
+  add_tile_nbr(buf, &t);
+  t.idx = idx - 1;
+  add_tile_nbr(buf, &t);
+}
+
+/**************************************************************************
+can_reach_nbr_wall:
+  In: a surface molecule that can interact with region borders
+      restricted regions of the molecule's own wall (may be NULL)
+      a neighbor wall
+  Out: 1 if the neighbor wall is on the same side of every restricted
+       region border as the molecule's wall, 0 otherwise.
+****************************************************************************/
+static int can_reach_nbr_wall(struct volume *world, struct surface_molecule *sm,
+                              struct region_list *rlp_head_own_wall,
+                              struct wall *nbr) {
+  /* INSIDE-OUT check against molecule's own wall */
+  if (rlp_head_own_wall != NULL &&
+      !wall_belongs_to_all_regions_in_region_list(nbr, rlp_head_own_wall))
+    return 0;
+
+  /* Similar test done OUTSIDE-IN */
+  int ok = 1;
+  struct scratch_mark mark = scratch_mark(world->scratch_mem);
+  struct region_list *rlp_head_nbr_wall =
+      find_restricted_regions_by_wall_scratch(world, world->scratch_mem, nbr,
+                                              sm);
+  if (rlp_head_nbr_wall != NULL)
+    ok = wall_belongs_to_all_regions_in_region_list(sm->grid->surface,
+                                                    rlp_head_nbr_wall);
+  scratch_release(world->scratch_mem, mark);
+  return ok;
+}
+
+/**************************************************************************
+get_neighbor_tiles:
+  In: a surface molecule
+      surface grid of the wall where hit happens, or
+          surface molecule is located
+      index of the tile where hit happens, or surface molecule is located
+      flag that tells whether we need to create a grid on a neighbor wall
+      flag that tells whether we are searching for reactant
+          (value = 1) or doing product placement (value = 0)
+      buffer to fill with the neighbor tiles (set up by init_tile_nbr_buf)
+  Out: Same neighbors as find_neighbor_tiles(), in the same order, but
+       copied out of the grid's cached adjacency table instead of a
+       freshly allocated linked list. Inner tiles only have neighbors on
+       their own grid and don't need the table.
+****************************************************************************/
+void get_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
+                        struct surface_grid *grid, int idx,
+                        int create_grid_flag, int search_for_reactant,
+                        struct tile_nbr_buf *buf) {
+  if ((u_int)idx >= grid->n_tiles) {
+    mcell_internal_error("Surface molecule tile index %u is greater than or "
+                         "equal of the number of tiles on the grid %u\n",
+                         (u_int)idx, grid->n_tiles);
+  }
+
+  buf->n_tiles = 0;
+  if (is_inner_tile(grid, idx)) {
+    add_inner_tile_nbrs(grid, idx, buf);
+    return;
+  }
+
+  /* creating the grids drops our table, it is rebuilt below */
+  if (create_grid_flag &&
+      (grid->adjacency == NULL || !grid->adjacency->complete)) {
+    struct tile_neighbor *head = NULL;
+    int list_length = 0;
+    derive_neighbor_tiles(world, NULL, grid, idx, 1, 0, &head, &list_length);
+    if (head != NULL)
+      delete_tile_neighbor_list(head);
+  }
+
+  if (grid->adjacency == NULL)
+    grid->adjacency = build_tile_adjacency(world, grid);
+  struct tile_adjacency *adj = grid->adjacency;
+
+  struct region_list *rlp_head_own_wall = NULL;
+  struct scratch_mark mark = scratch_mark(world->scratch_mem);
+  int check_borders = (sm != NULL) && search_for_reactant &&
+                      (sm->properties->flags & CAN_REGION_BORDER);
+  if (check_borders)
+    rlp_head_own_wall = find_restricted_regions_by_wall_scratch(
+        world, world->scratch_mem, sm->grid->surface, sm);
+
+  /* the tiles of one neighbor wall sit next to each other in the table,
+     so only check a wall again when it changes */
+  struct wall *last_wall = NULL;
+  int last_ok = 1;
+  for (int i = adj->offsets[idx]; i < adj->offsets[idx + 1]; i++) {
+    struct tile_ref *t = &adj->tiles[i];
+    if (check_borders && t->grid != grid) {
+      if (t->grid->surface != last_wall) {
+        last_wall = t->grid->surface;
+        last_ok = can_reach_nbr_wall(world, sm, rlp_head_own_wall, last_wall);
+      }
+      if (!last_ok)
+        continue;
+    }
+    add_tile_nbr(buf, t);
+  }
+
+  scratch_release(world->scratch_mem, mark);
+}
+
+/**************************************************************************
+find_neighbor_tiles:
+  In: a surface molecule
+      surface grid of the wall where hit happens, or
+          surface molecule is located
+      index of the tile where hit happens, or surface molecule is located
+      flag that tells whether we need to create a grid on a neighbor wall
+      flag that tells whether we are searching for reactant
+          (value = 1) or doing product placement (value = 0)
+      a linked list of  neighbor tiles (return value)
+      a length of the linked list above (return value)
+  Out: The list of nearest neighbors are returned,
+       Neighbors should share either common edge or common vertex.
+  Note: This version allows looking for the neighbors at the neighbor walls
+       that are connected to the start wall through vertices only.
+       Callers that only walk the list should use get_neighbor_tiles().
+****************************************************************************/
+void find_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
+                         struct surface_grid *grid, int idx,
+                         int create_grid_flag, int search_for_reactant,
+                         struct tile_neighbor **tile_nbr_head,
+                         int *list_length) {
+  struct tile_nbr_buf buf;
+  struct tile_neighbor *head = NULL;
 
+  init_tile_nbr_buf(&buf);
+  get_neighbor_tiles(world, sm, grid, idx, create_grid_flag,
+                     search_for_reactant, &buf);
+
+  /* pushing to the head of the list, so go backwards */
+  for (int i = buf.n_tiles - 1; i >= 0; i--)
+    push_tile_neighbor_to_list(&head, buf.tiles[i].grid, buf.tiles[i].idx);
+
+  *tile_nbr_head = head;
+  *list_length = buf.n_tiles;
+  free_tile_nbr_buf(&buf);
+}
@@ -36,6 +36,35 @@ struct tile_neighbor {
   struct tile_neighbor *next;
 };
 
+/* a tile on some surface grid */
+struct tile_ref {
+  struct surface_grid *grid;
+  int idx;
+};
+
+/* Neighbor tiles of the border tiles of a surface grid, stored in
+   compressed sparse row form: the neighbors of tile i are
+   tiles[offsets[i]] .. tiles[offsets[i+1] - 1], in the same order
+   find_neighbor_tiles() has always returned them. Inner tiles have no
+   entries, their neighbors are worked out from the index. Only the walls
+   that had a grid when the table was built are in it, so it is dropped
+   whenever a grid is created on a wall touching this one. */
+struct tile_adjacency {
+  int *offsets;
+  struct tile_ref *tiles;
+  int complete; /* every wall touching this one already had a grid */
+};
+
+#define TILE_NBR_LOCAL 16
+
+/* neighbor tiles returned by get_neighbor_tiles() */
+struct tile_nbr_buf {
+  struct tile_ref *tiles;
+  int n_tiles;
+  int max_tiles;
+  struct tile_ref local[TILE_NBR_LOCAL];
+};
+
 void xyz2uv(struct vector3 *a, struct wall *w, struct vector2 *b);
 
 void uv2xyz(struct vector2 *a, struct wall *w, struct vector3 *b);
@@ -55,6 +84,8 @@ void init_grid_geometry(struct surface_grid *sm);
 
 int create_grid(struct volume *world, struct wall *w, struct subvolume *guess);
 
+void update_tile_occupancy(struct surface_grid *g, int idx);
+
 void grid_neighbors(struct volume *world, struct surface_grid *grid, int idx,
                     int create_grid_flag, struct surface_grid **nb_grid,
                     int *nb_idx);
@@ -63,7 +94,8 @@ int nearest_free(struct surface_grid *sm, struct vector2 *v, double max_d2,
                  double *found_dist2);
 
 int verify_wall_regions_match(
-    char *mesh_name, struct string_buffer *reg_names, struct wall *w,
+    struct volume *state, int mesh_id, struct string_buffer *reg_names,
+    struct wall *w,
     struct string_buffer *regions_to_ignore,
     struct mesh_transparency *mesh_transp, char *species_name);
 
@@ -71,7 +103,7 @@ struct wall *search_nbhd_for_free(struct volume *world, struct wall *origin,
                                   struct vector2 *point, double max_d2,
                                   int *found_idx,
                                   int (*ok)(void *, struct wall *),
-                                  void *context, char *mesh_name,
+                                  void *context, int mesh_id,
                                   struct string_buffer *reg_names);
 
 void delete_tile_neighbor_list(struct tile_neighbor *head);
@@ -81,6 +113,10 @@ void delete_region_list(struct region_list *head);
 void push_tile_neighbor_to_list(struct tile_neighbor **head,
                                 struct surface_grid *grid, int idx);
 
+void push_tile_neighbor_to_scratch_list(struct scratch_arena *sa,
+                                        struct tile_neighbor **head,
+                                        struct surface_grid *grid, int idx);
+
 int push_tile_neighbor_to_list_with_checking(struct tile_neighbor **head,
                                              struct surface_grid *grid,
                                              int idx);
@@ -107,6 +143,17 @@ void find_closest_position(struct surface_grid *grid1, int idx1,
                            struct vector2 *p);
 int is_inner_tile(struct surface_grid *sm, int idx);
 
+void init_tile_nbr_buf(struct tile_nbr_buf *buf);
+
+void free_tile_nbr_buf(struct tile_nbr_buf *buf);
+
+void get_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
+                        struct surface_grid *grid, int idx,
+                        int create_grid_flag, int search_for_reactant,
+                        struct tile_nbr_buf *buf);
+
+void destroy_tile_adjacency(struct surface_grid *grid);
+
 void find_neighbor_tiles(struct volume *world, struct surface_molecule *sm,
                          struct surface_grid *grid, int tile_idx,
                          int create_grid_flag, int search_for_reactant,
@@ -55,6 +55,7 @@
 #include "mcell_objects.h"
 #include "dyngeom.h"
 #include "dyngeom_parse_extras.h"
+#include "dyngeom_prefetch.h"
 #include "triangle_overlap.h"
 
 #define MESH_DISTINCTIVE EPS_C
@@ -75,6 +76,8 @@ static int compute_bb_polygon_object(struct volume *world, struct object *objp,
                                      double (*im)[4]);
 
 static int init_species_defaults(struct volume *world);
+static void init_vol_partners(struct volume *world);
+static void init_partner_bits(struct volume *world);
 static int init_regions_helper(struct volume *world);
 
 static struct ccn_clamp_data* find_clamped_object_in_list(struct ccn_clamp_data *ccd,
@@ -230,7 +233,7 @@ int init_variables(struct volume *world) {
   // XXX: This is in the wrong place here and should be moved
   //      to a separate function perhaps
   install_emergency_output_hooks(world);
-  emergency_output_hook_enabled = 0;
+  world->emergency_output_hook_enabled = 0;
 
   world->curr_file = world->mdl_infile_name;
   world->chkpt_iterations = 0;
@@ -597,6 +600,9 @@ int init_species(struct volume *world) {
   if (surf_species_name_list != NULL)
     remove_molecules_name_list(&surf_species_name_list);
 
+  init_vol_partners(world);
+  init_partner_bits(world);
+
   /* If there are no 3D molecules-reactants in the simulation
      set up the "use_expanded_list" flag to zero. */
   for (int i = 0; i < world->n_species; i++) {
@@ -625,6 +631,84 @@ int init_species(struct volume *world) {
   return 0;
 }
 
+/***********************************************************************
+init_vol_partners:
+  In: simulation state with the reaction hash built
+  Out: No return value.  Every volume species gets the list of volume
+       species it reacts with in bimolecular reactions, so that diffusion
+       can tell whether any of them currently exist.
+***********************************************************************/
+static void init_vol_partners(struct volume *world) {
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < world->rx_hashsize; i++) {
+      for (struct rxn *rx = world->reaction_hash[i]; rx != NULL;
+           rx = rx->next) {
+        if (rx->n_reactants != 2 || (rx->players[0]->flags & NOT_FREE) ||
+            (rx->players[1]->flags & NOT_FREE))
+          continue;
+
+        for (int j = 0; j < 2; j++) {
+          struct species *sp = rx->players[j];
+          struct species *partner = rx->players[1 - j];
+          if (pass == 0) {
+            /* Upper bound; duplicates are dropped below */
+            sp->n_vol_partners++;
+            continue;
+          }
+
+          int k;
+          for (k = 0; k < sp->n_vol_partners; k++) {
+            if (sp->vol_partners[k] == partner)
+              break;
+          }
+          if (k == sp->n_vol_partners)
+            sp->vol_partners[sp->n_vol_partners++] = partner;
+        }
+      }
+    }
+
+    if (pass == 0) {
+      for (int i = 0; i < world->n_species; i++) {
+        struct species *sp = world->species_list[i];
+        if (sp->n_vol_partners > 0) {
+          sp->vol_partners = CHECKED_MALLOC_ARRAY(
+              struct species *, sp->n_vol_partners, "volume reaction partners");
+          sp->n_vol_partners = 0;
+        }
+      }
+    }
+  }
+}
+
+/***********************************************************************
+init_partner_bits:
+  In: simulation state with the reaction hash built
+  Out: No return value.  Every species gets the bit set of the species it
+       appears with as the first two reactants of a reaction, the same
+       test trigger_bimolecular_preliminary makes by walking the reaction
+       hash.  Scans of the molecules in a subvolume use it to skip the
+       lists of species that cannot react with the moving molecule.
+***********************************************************************/
+static void init_partner_bits(struct volume *world) {
+  int n_words = (world->n_species + 31) / 32;
+  u_int *bits = CHECKED_MALLOC_ARRAY(u_int, world->n_species * n_words,
+                                     "reaction partner bit sets");
+  memset(bits, 0, world->n_species * n_words * sizeof(u_int));
+  for (int i = 0; i < world->n_species; i++)
+    world->species_list[i]->partner_bits = bits + i * n_words;
+
+  for (int i = 0; i < world->rx_hashsize; i++) {
+    for (struct rxn *rx = world->reaction_hash[i]; rx != NULL; rx = rx->next) {
+      if (rx->n_reactants < 2)
+        continue;
+
+      u_int a = rx->players[0]->species_id, b = rx->players[1]->species_id;
+      rx->players[0]->partner_bits[b / 32] |= 1u << (b % 32);
+      rx->players[1]->partner_bits[a / 32] |= 1u << (a % 32);
+    }
+  }
+}
+
 /***********************************************************************
  *
  * initialize the models' vertices and walls
@@ -706,6 +790,7 @@ int init_vertices_walls(struct volume *world) {
                       "among partitions.");
     return 1;
   }
+  init_wall_clearance(world);
 
   if (world->notify->progress_report != NOTIFY_NONE)
     mcell_log("Creating edges...");
@@ -1314,6 +1399,7 @@ static struct storage *create_storage(struct volume *world, int nsubvols) {
   shared_mem->sp_coll = world->sp_coll_mem;
   shared_mem->tri_coll = world->tri_coll_mem;
   shared_mem->exdv = world->exdv_mem;
+  shared_mem->scratch = world->scratch_mem;
 
   if (world->chkpt_init) {
     if ((shared_mem->timer = create_scheduler(1.0, 100.0, 100, 0.0)) == NULL)
@@ -1416,13 +1502,27 @@ int init_partitions(struct volume *world) {
                                           "dummy waypoint");
 
   /* Allocate the subvolumes */
+  int n_old_subvols = world->n_subvols;
   world->n_subvols =
       (world->nz_parts - 1) * (world->ny_parts - 1) * (world->nx_parts - 1);
   if (world->notify->progress_report != NOTIFY_NONE)
     mcell_log("Creating %d subvolumes (%d,%d,%d per axis).", world->n_subvols,
               world->nx_parts - 1, world->ny_parts - 1, world->nz_parts - 1);
-  world->subvol = CHECKED_MALLOC_ARRAY(struct subvolume, world->n_subvols,
+  world->subvol = CHECKED_MALLOC_ARRAY(struct subvolume *, world->n_subvols,
                                        "spatial subvolumes");
+  if ((world->subvol_mem = create_mem_named(sizeof(struct subvolume), 1024,
+                                            "subvolume")) == NULL)
+    mcell_allocfailed("Failed to create memory pool for subvolumes.");
+
+  /* Keep the load counters across geometry changes that keep the grid */
+  if (world->load_heatmap_prefix != NULL &&
+      (world->subvol_load == NULL || world->n_subvols != n_old_subvols)) {
+    free(world->subvol_load);
+    world->subvol_load = CHECKED_MALLOC_ARRAY(
+        struct subvolume_load, world->n_subvols, "subvolume load counters");
+    memset(world->subvol_load, 0,
+           sizeof(struct subvolume_load) * world->n_subvols);
+  }
 
   /* Decide how fine-grained to make the memory subdivisions */
   sanity_check_memory_subdivision(world);
@@ -1443,6 +1543,8 @@ int init_partitions(struct volume *world) {
                                           "exact disk vertex")) == NULL)
     mcell_allocfailed(
         "Failed to create memory pool for exact disk calculation vertices.");
+  if ((world->scratch_mem = create_scratch_arena(16384)) == NULL)
+    mcell_allocfailed("Failed to create scratch memory for temporary lists.");
 
   /* How many storage subdivisions along each axis? */
   int nx = (world->nx_parts + (world->mem_part_x) - 2) / (world->mem_part_x);
@@ -1459,7 +1561,9 @@ int init_partitions(struct volume *world) {
     mcell_allocfailed("Failed to create memory pool for storage list.");
 
   /* Allocate the storages */
-  struct storage *shared_mem[nx * ny * nz];
+  struct storage **shared_mem = CHECKED_MALLOC_ARRAY(
+      struct storage *, nx * ny * nz, "storages by memory partition");
+  world->storage_grid = shared_mem;
   int cx = 0, cy = 0, cz = 0;
   for (int i = 0; i < nx * ny * nz; ++i) {
     /* Determine the number of subvolumes included in this subdivision */
@@ -1490,56 +1594,93 @@ int init_partitions(struct volume *world) {
     world->storage_head = l;
   }
 
-  /* Initialize each subvolume */
-  for (int i = 0; i < world->nx_parts - 1; i++)
-    for (int j = 0; j < world->ny_parts - 1; j++)
-      for (int k = 0; k < world->nz_parts - 1; k++) {
-        int h = k + (world->nz_parts - 1) * (j + (world->ny_parts - 1) * i);
-        struct subvolume *sv = &(world->subvol[h]);
-        sv->wall_head = NULL;
-        memset(&sv->mol_by_species, 0, sizeof(struct pointer_hash));
-        sv->species_head = NULL;
-        sv->mol_count = 0;
-
-        sv->llf.x = bisect_near(world->x_fineparts, world->n_fineparts,
-                                world->x_partitions[i]);
-        sv->llf.y = bisect_near(world->y_fineparts, world->n_fineparts,
-                                world->y_partitions[j]);
-        sv->llf.z = bisect_near(world->z_fineparts, world->n_fineparts,
-                                world->z_partitions[k]);
-        sv->urb.x = bisect_near(world->x_fineparts, world->n_fineparts,
-                                world->x_partitions[i + 1]);
-        sv->urb.y = bisect_near(world->y_fineparts, world->n_fineparts,
-                                world->y_partitions[j + 1]);
-        sv->urb.z = bisect_near(world->z_fineparts, world->n_fineparts,
-                                world->z_partitions[k + 1]);
-
-        /* Set flags so we know which directions to not go (we will fall off the
-         * world!) */
-        sv->world_edge =
-            0; /* Assume we're not at the edge of the world in any direction */
-        if (i == 0)
-          sv->world_edge |= X_NEG_BIT;
-        if (i == world->nx_parts - 2)
-          sv->world_edge |= X_POS_BIT;
-        if (j == 0)
-          sv->world_edge |= Y_NEG_BIT;
-        if (j == world->ny_parts - 2)
-          sv->world_edge |= Y_POS_BIT;
-        if (k == 0)
-          sv->world_edge |= Z_NEG_BIT;
-        if (k == world->nz_parts - 2)
-          sv->world_edge |= Z_POS_BIT;
-
-        /* Bind this subvolume to the appropriate storage */
-        int shidx =
-            (i / (world->mem_part_x)) +
-            nx * (j / (world->mem_part_y) + ny * (k / (world->mem_part_z)));
-        sv->local_storage = shared_mem[shidx];
-      }
+  /* Subvolumes get a record of their own on first use (see get_subvol) */
+  memset(&world->empty_subvol, 0, sizeof(struct subvolume));
+  world->empty_subvol.index = -1;
+  for (int h = 0; h < world->n_subvols; h++)
+    world->subvol[h] = &world->empty_subvol;
+  world->used_subvols = NULL;
   return 0;
 }
 
+/***************************************************************************
+init_subvolume:
+  In: world: simulation state with partitions and storages set up
+      sv: record to fill in
+      h: index of the subvolume
+  Out: No return value.  sv is set up as subvolume h holding nothing: its
+       corners, the edges of the world it touches and its storage.
+***************************************************************************/
+void init_subvolume(struct volume *world, struct subvolume *sv, int h) {
+  int k = h % (world->nz_parts - 1);
+  int j = (h / (world->nz_parts - 1)) % (world->ny_parts - 1);
+  int i = h / ((world->nz_parts - 1) * (world->ny_parts - 1));
+
+  sv->wall_head = NULL;
+  sv->species_lists = NULL;
+  sv->n_species_lists = 0;
+  sv->max_species_lists = 0;
+  sv->mol_count = 0;
+  sv->index = h;
+
+  sv->llf.x = bisect_near(world->x_fineparts, world->n_fineparts,
+                          world->x_partitions[i]);
+  sv->llf.y = bisect_near(world->y_fineparts, world->n_fineparts,
+                          world->y_partitions[j]);
+  sv->llf.z = bisect_near(world->z_fineparts, world->n_fineparts,
+                          world->z_partitions[k]);
+  sv->urb.x = bisect_near(world->x_fineparts, world->n_fineparts,
+                          world->x_partitions[i + 1]);
+  sv->urb.y = bisect_near(world->y_fineparts, world->n_fineparts,
+                          world->y_partitions[j + 1]);
+  sv->urb.z = bisect_near(world->z_fineparts, world->n_fineparts,
+                          world->z_partitions[k + 1]);
+
+  /* Set flags so we know which directions to not go (we will fall off the
+   * world!) */
+  sv->world_edge =
+      0; /* Assume we're not at the edge of the world in any direction */
+  if (i == 0)
+    sv->world_edge |= X_NEG_BIT;
+  if (i == world->nx_parts - 2)
+    sv->world_edge |= X_POS_BIT;
+  if (j == 0)
+    sv->world_edge |= Y_NEG_BIT;
+  if (j == world->ny_parts - 2)
+    sv->world_edge |= Y_POS_BIT;
+  if (k == 0)
+    sv->world_edge |= Z_NEG_BIT;
+  if (k == world->nz_parts - 2)
+    sv->world_edge |= Z_POS_BIT;
+
+  /* Set once the walls are distributed (see init_wall_clearance) */
+  sv->wall_clearance =
+      (world->subvol_clearance != NULL) ? world->subvol_clearance[h] : 0.0;
+
+  /* Bind this subvolume to the appropriate storage */
+  sv->local_storage = subvol_storage(world, h);
+  sv->next = NULL;
+}
+
+/***************************************************************************
+subvol_storage:
+  In: world: simulation state with partitions and storages set up
+      h: index of a subvolume
+  Out: The storage holding the molecules and walls of subvolume h.
+***************************************************************************/
+struct storage *subvol_storage(struct volume *world, int h) {
+  int k = h % (world->nz_parts - 1);
+  int j = (h / (world->nz_parts - 1)) % (world->ny_parts - 1);
+  int i = h / ((world->nz_parts - 1) * (world->ny_parts - 1));
+
+  int nx = (world->nx_parts + (world->mem_part_x) - 2) / (world->mem_part_x);
+  int ny = (world->ny_parts + (world->mem_part_y) - 2) / (world->mem_part_y);
+  int shidx =
+      (i / (world->mem_part_x)) +
+      nx * (j / (world->mem_part_y) + ny * (k / (world->mem_part_z)));
+  return world->storage_grid[shidx];
+}
+
 /**
  * Initializes the bounding boxes of the world.
  */
@@ -2811,6 +2952,61 @@ int init_surf_mols_by_density(struct volume *world, struct wall *w,
   return 0;
 }
 
+/********************************************************************
+ place_surf_mols_on_free_tiles:
+
+    Place surface molecules on tiles picked uniformly at random from a list
+    of free tiles. Tiles are drawn without replacement by a partial
+    Fisher-Yates shuffle, so every draw hits a free tile, however full the
+    region is. The chosen tiles are moved to the end of the list, so the
+    first n_free_sm - n_set entries are the tiles that are still free.
+
+    In:  tiles, idx, walls - free tiles (tile pointer, grid index and wall)
+         n_free_sm - number of free tiles
+         n_set - number of molecules to place (at most n_free_sm)
+         sm - species to place
+         orientation - orientation of the new molecules
+         flags - flags of the new molecules
+    Out: None
+ *******************************************************************/
+static void place_surf_mols_on_free_tiles(struct volume *world,
+                                          struct surface_molecule ***tiles,
+                                          unsigned int *idx,
+                                          struct wall **walls,
+                                          unsigned int n_free_sm,
+                                          unsigned int n_set,
+                                          struct species *sm,
+                                          short orientation, short flags) {
+  for (unsigned int j = 0; j < n_set; j++) {
+    unsigned int last = n_free_sm - 1 - j;
+    unsigned int slot_num = (unsigned int)(rng_dbl(world->rng) * (last + 1));
+    if (slot_num > last)
+      slot_num = last;
+
+    struct surface_molecule **tile = tiles[slot_num];
+    unsigned int tile_idx = idx[slot_num];
+    struct wall *w = walls[slot_num];
+    tiles[slot_num] = tiles[last];
+    idx[slot_num] = idx[last];
+    walls[slot_num] = walls[last];
+    tiles[last] = tile;
+    idx[last] = tile_idx;
+    walls[last] = w;
+
+    struct periodic_image periodic_box = {.x = 0, .y = 0, .z = 0};
+    struct vector3 pos3d = {.x = 0, .y = 0, .z = 0};
+    struct surface_molecule *new_sm = place_single_molecule(
+        world, w, tile_idx, sm, flags, orientation, 0, 0, 0, &periodic_box,
+        &pos3d);
+    if (trigger_unimolecular(world->reaction_hash, world->rx_hashsize,
+                             sm->hashval,
+                             (struct abstract_molecule *)new_sm) != NULL ||
+        (sm->flags & CAN_SURFWALL) != 0) {
+      new_sm->flags |= ACT_REACT;
+    }
+  }
+}
+
 /********************************************************************
  init_surf_mols_by_number:
 
@@ -2823,9 +3019,6 @@ int init_surf_mols_by_density(struct volume *world, struct wall *w,
  *******************************************************************/
 int init_surf_mols_by_number(struct volume *world, struct object *objp,
                              struct region_list *reg_sm_num_head) {
-  static struct surface_molecule DUMMY_MOLECULE;
-  static struct surface_molecule *bread_crumb = &DUMMY_MOLECULE;
-
   short flags = TYPE_SURF | ACT_NEWBIE | IN_SCHEDULE | IN_SURFACE;
   unsigned int n_free_sm;
   // struct subvolume *gsv = NULL;
@@ -2899,7 +3092,6 @@ int init_surf_mols_by_number(struct volume *world, struct object *objp,
           struct species *sm = smdp->sm;
           short orientation;
           unsigned int n_set = (unsigned int)smdp->quantity;
-          unsigned int n_clear = n_free_sm - n_set;
 
           /* Compute orientation */
           if (smdp->orientation > 0)
@@ -2919,113 +3111,15 @@ int init_surf_mols_by_number(struct volume *world, struct object *objp,
                 sm->sym->name, n_set, n_free_sm, rp->parent->sym->name,
                 rp->region_last_name, sm->sym->name);
             n_set = n_free_sm;
-            n_clear = 0;
           }
 
           no_printf("distribute %d of surface molecule %s\n", n_set,
                     sm->sym->name);
-          no_printf("n_set = %d  n_clear = %d  n_free_sm = %d\n", n_set,
-                    n_clear, n_free_sm);
-
-          /* if filling more than half the free tiles
-             init all with bread_crumbs
-             choose which tiles to free again
-             and then convert remaining bread_crumbs to actual molecules */
-          if (n_set > n_free_sm / 2) {
-            no_printf("filling more than half the free tiles: init all with "
-                      "bread_crumb\n");
-            for (unsigned int j = 0; j < n_free_sm; j++) {
-              *tiles[j] = bread_crumb;
-            }
-
-            no_printf("choose which tiles to free again\n");
-            for (unsigned int j = 0; j < n_clear; j++) {
-
-              /* Loop until we find a vacant tile. */
-              while (1) {
-                int slot_num = (int)(rng_dbl(world->rng) * n_free_sm);
-                if (*tiles[slot_num] == bread_crumb) {
-                  *tiles[slot_num] = NULL;
-                  break;
-                }
-              }
-            }
-
-            no_printf("convert remaining bread_crumbs to actual molecules\n");
-            for (unsigned int j = 0; j < n_free_sm; j++) {
-              if (*tiles[j] == bread_crumb) {
-                struct periodic_image periodic_box = {.x = 0, .y = 0, .z = 0};
-                struct vector3 pos3d = {.x = 0, .y = 0, .z = 0};
-                struct surface_molecule *new_sm = place_single_molecule(
-                    world, walls[j], idx[j], sm, flags, orientation, 0, 0, 0,
-                    &periodic_box, &pos3d);
-                if (trigger_unimolecular(
-                        world->reaction_hash, world->rx_hashsize, sm->hashval,
-                        (struct abstract_molecule *)new_sm) != NULL ||
-                    (sm->flags & CAN_SURFWALL) != 0) {
-                  new_sm->flags |= ACT_REACT;
-                }
-              }
-            }
-          } else { /* just fill only the tiles we need */
-            no_printf("fill only the tiles we need\n");
-            for (unsigned int j = 0; j < n_set; j++) {
-
-              /* Loop until we find a vacant tile. */
-              while (1) {
-                int slot_num = (int)(rng_dbl(world->rng) * n_free_sm);
-                if (*tiles[slot_num] == NULL) {
-                  struct periodic_image periodic_box = {.x = 0, .y = 0, .z = 0};
-                  struct vector3 pos3d = {.x = 0, .y = 0, .z = 0};
-                  struct surface_molecule *new_sm = place_single_molecule(
-                      world, walls[slot_num], idx[slot_num], sm, flags,
-                      orientation, 0, 0, 0, &periodic_box, &pos3d);
-                  if (trigger_unimolecular(
-                          world->reaction_hash, world->rx_hashsize, sm->hashval,
-                          (struct abstract_molecule *)new_sm) != NULL ||
-                      (sm->flags & CAN_SURFWALL) != 0) {
-                    new_sm->flags |= ACT_REACT;
-                  }
-                  break;
-                }
-              }
-            }
-          }
+          no_printf("n_set = %d  n_free_sm = %d\n", n_set, n_free_sm);
 
-          if (n_clear > 0) {
-            struct surface_molecule ***tiles_tmp;
-            unsigned int *idx_tmp;
-            struct wall **walls_tmp;
-
-            /* allocate memory to hold array of pointers to remaining free tiles
-             */
-            tiles_tmp =
-                CHECKED_MALLOC_ARRAY(struct surface_molecule **, n_clear,
-                                     "surface molecule placement tiles array");
-            idx_tmp = CHECKED_MALLOC_ARRAY(
-                unsigned int, n_clear,
-                "surface molecule placement indices array");
-            walls_tmp =
-                CHECKED_MALLOC_ARRAY(struct wall *, n_clear,
-                                     "surface molecule placement walls array");
-
-            n_slot = 0;
-            for (unsigned int n_sm = 0; n_sm < n_free_sm; n_sm++) {
-              if (*tiles[n_sm] == NULL) {
-                tiles_tmp[n_slot] = tiles[n_sm];
-                idx_tmp[n_slot] = idx[n_sm];
-                walls_tmp[n_slot++] = walls[n_sm];
-              }
-            }
-            /* free original array of pointers to all free tiles */
-            free(tiles);
-            free(idx);
-            free(walls);
-            tiles = tiles_tmp;
-            idx = idx_tmp;
-            walls = walls_tmp;
-            n_free_sm = n_free_sm - n_set;
-          }
+          place_surf_mols_on_free_tiles(world, tiles, idx, walls, n_free_sm,
+                                        n_set, sm, orientation, flags);
+          n_free_sm -= n_set;
 
           /* update n_occupied for each surface molecule grid */
           for (int n_wall = 0; n_wall < rp->membership->nbits; n_wall++) {
@@ -3052,7 +3146,6 @@ int init_surf_mols_by_number(struct volume *world, struct object *objp,
             struct species *sm = smdp->sm;
             short orientation;
             unsigned int n_set = (unsigned int)smdp->quantity;
-            unsigned int n_clear = n_free_sm - n_set;
 
             /* Compute orientation */
             if (smdp->orientation > 0)
@@ -3072,114 +3165,15 @@ int init_surf_mols_by_number(struct volume *world, struct object *objp,
                   sm->sym->name, n_set, n_free_sm, rp->parent->sym->name,
                   rp->region_last_name, sm->sym->name);
               n_set = n_free_sm;
-              n_clear = 0;
             }
 
             no_printf("distribute %d of surface molecule %s\n", n_set,
                       sm->sym->name);
-            no_printf("n_set = %d  n_clear = %d  n_free_sm = %d\n", n_set,
-                      n_clear, n_free_sm);
-
-            /* if filling more than half the free tiles
-               init all with bread_crumbs
-               choose which tiles to free again
-               and then convert remaining bread_crumbs to actual molecules */
-            if (n_set > n_free_sm / 2) {
-              no_printf("filling more than half the free tiles: init all with "
-                        "bread_crumb\n");
-              for (unsigned int j = 0; j < n_free_sm; j++) {
-                *tiles[j] = bread_crumb;
-              }
-
-              no_printf("choose which tiles to free again\n");
-              for (unsigned int j = 0; j < n_clear; j++) {
+            no_printf("n_set = %d  n_free_sm = %d\n", n_set, n_free_sm);
 
-                /* Loop until we find a vacant tile. */
-                while (1) {
-                  int slot_num = (int)(rng_dbl(world->rng) * n_free_sm);
-                  if (*tiles[slot_num] == bread_crumb) {
-                    *tiles[slot_num] = NULL;
-                    break;
-                  }
-                }
-              }
-
-              no_printf("convert remaining bread_crumbs to actual molecules\n");
-              for (unsigned int j = 0; j < n_free_sm; j++) {
-                if (*tiles[j] == bread_crumb) {
-                  struct periodic_image periodic_box = {.x = 0, .y = 0, .z = 0};
-                  struct vector3 pos3d = {.x = 0, .y = 0, .z = 0};
-                  struct surface_molecule *new_sm = place_single_molecule(
-                      world, walls[j], idx[j], sm, flags, orientation, 0, 0, 0,
-                      &periodic_box, &pos3d);
-                  if (trigger_unimolecular(
-                          world->reaction_hash, world->rx_hashsize, sm->hashval,
-                          (struct abstract_molecule *)new_sm) != NULL ||
-                      (sm->flags & CAN_SURFWALL) != 0) {
-                    new_sm->flags |= ACT_REACT;
-                  }
-                }
-              }
-            } else { /* just fill only the tiles we need */
-              no_printf("fill only the tiles we need\n");
-              for (unsigned int j = 0; j < n_set; j++) {
-
-                /* Loop until we find a vacant tile. */
-                while (1) {
-                  int slot_num = (int)(rng_dbl(world->rng) * n_free_sm);
-                  if (*tiles[slot_num] == NULL) {
-                    struct periodic_image periodic_box = {.x = 0, .y = 0, .z = 0};
-                    struct vector3 pos3d = {.x = 0, .y = 0, .z = 0};
-                    struct surface_molecule *new_sm = place_single_molecule(
-                        world, walls[slot_num], idx[slot_num], sm, flags,
-                        orientation, 0, 0, 0, &periodic_box, &pos3d);
-                    if (trigger_unimolecular(
-                            world->reaction_hash, world->rx_hashsize,
-                            sm->hashval,
-                            (struct abstract_molecule *)new_sm) != NULL ||
-                        (sm->flags & CAN_SURFWALL) != 0) {
-                      new_sm->flags |= ACT_REACT;
-                    }
-                    break;
-                  }
-                }
-              }
-            }
-
-            if (n_clear > 0) {
-              struct surface_molecule ***tiles_tmp;
-              unsigned int *idx_tmp;
-              struct wall **walls_tmp;
-
-              /* allocate memory to hold array of pointers to remaining free
-               * tiles */
-              tiles_tmp = CHECKED_MALLOC_ARRAY(
-                  struct surface_molecule **, n_clear,
-                  "surface molecule placement tiles array");
-              idx_tmp = CHECKED_MALLOC_ARRAY(
-                  unsigned int, n_clear,
-                  "surface molecule placement indices array");
-              walls_tmp = CHECKED_MALLOC_ARRAY(
-                  struct wall *, n_clear,
-                  "surface molecule placement walls array");
-
-              n_slot = 0;
-              for (unsigned int n_sm = 0; n_sm < n_free_sm; n_sm++) {
-                if (*tiles[n_sm] == NULL) {
-                  tiles_tmp[n_slot] = tiles[n_sm];
-                  idx_tmp[n_slot] = idx[n_sm];
-                  walls_tmp[n_slot++] = walls[n_sm];
-                }
-              }
-              /* free original array of pointers to all free tiles */
-              free(tiles);
-              free(idx);
-              free(walls);
-              tiles = tiles_tmp;
-              idx = idx_tmp;
-              walls = walls_tmp;
-              n_free_sm = n_free_sm - n_set;
-            }
+            place_surf_mols_on_free_tiles(world, tiles, idx, walls, n_free_sm,
+                                          n_set, sm, orientation, flags);
+            n_free_sm -= n_set;
 
             /* update n_occupied for each surface molecule grid */
             for (int n_wall = 0; n_wall < rp->membership->nbits; n_wall++) {
@@ -3488,6 +3482,18 @@ static int init_rel_region_data_2d(struct release_site_obj *rsop,
     }
   }
 
+  /* Walls are picked with an alias table, so that each pick is constant time
+   * no matter how many walls are in the release region. */
+  if (rrd->n_walls_included > 0) {
+    rrd->alias_prob = CHECKED_MALLOC_ARRAY(
+        double, rrd->n_walls_included, "alias table for 2D region release");
+    rrd->alias_index = CHECKED_MALLOC_ARRAY(
+        int, rrd->n_walls_included, "alias table for 2D region release");
+    if (build_alias_table(rrd->cum_area_list, rrd->n_walls_included,
+                          rrd->alias_prob, rrd->alias_index))
+      mcell_allocfailed("Failed to build alias table for 2D region release.");
+  }
+
   for (int n_wall = 1; n_wall < rrd->n_walls_included; n_wall++) {
     rrd->cum_area_list[n_wall] += rrd->cum_area_list[n_wall - 1];
   }
@@ -3769,6 +3775,12 @@ int schedule_dynamic_geometry(struct mdlparse_vars *parse_state) {
     return 1;     
   }
 
+  // The helper thread needs the events in order, so start it before the
+  // scheduler takes over the list.
+  if (state->dynamic_geometry_prefetch && state->dg_prefetch == NULL) {
+    state->dg_prefetch = dg_prefetch_create(state->dynamic_geometry_head);
+  }
+
   // This is the actual scheduling.
   struct dg_time_filename *dg_time_fname, *dg_time_fname_next;
   for (dg_time_fname = state->dynamic_geometry_head; dg_time_fname != NULL;
@@ -6687,7 +6699,7 @@ check_for_overlapped_walls:
        1 if there are any overlapped walls.
 ******************************************************************/
 int check_for_overlapped_walls(
-    struct rng_state *rng, int n_subvols, struct subvolume *subvol) {
+    struct rng_state *rng, int n_subvols, struct subvolume **subvol) {
 
   /* pick up a random vector */
   struct vector3 rand_vector;
@@ -6696,7 +6708,7 @@ int check_for_overlapped_walls(
   rand_vector.z = rng_dbl(rng);
 
   for (int i = 0; i < n_subvols; i++) {
-    struct subvolume *sv = &(subvol[i]);
+    struct subvolume *sv = subvol[i];
     struct wall_aux_list *head = NULL;
 
     for (struct wall_list *wlp = sv->wall_head; wlp != NULL; wlp = wlp->next) {
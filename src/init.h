@@ -32,6 +32,8 @@ int init_data_structures(struct volume *world);
 int init_species(struct volume *world);
 int init_bounding_box(struct volume *world);
 int init_partitions(struct volume *world);
+void init_subvolume(struct volume *world, struct subvolume *sv, int h);
+struct storage *subvol_storage(struct volume *world, int h);
 int init_vertices_walls(struct volume *world);
 int init_regions(struct volume *world);
 int init_checkpoint_state(struct volume *world, long long *exec_iterations);
@@ -121,5 +123,5 @@ void create_name_lists_of_volume_and_surface_mols(
     struct name_list **surf_species_name_list);
 void remove_molecules_name_list(struct name_list **nlist);
 int check_for_overlapped_walls(
-    struct rng_state *rng, int n_subvols, struct subvolume *subvol);
+    struct rng_state *rng, int n_subvols, struct subvolume **subvol);
 struct vector3 *create_region_bbox(struct region *r);
@@ -30,11 +30,11 @@
 #define _XOPEN_SOURCE 600
 #include <string.h>
 
-/* Our log file */
-static FILE *mcell_log_file = NULL;
+/* Our log file.  Each thread running a simulation has its own. */
+static _Thread_local FILE *mcell_log_file = NULL;
 
 /* Our warning/error file */
-static FILE *mcell_error_file = NULL;
+static _Thread_local FILE *mcell_error_file = NULL;
 
 /* Get the log file. */
 FILE *mcell_get_log_file(void) {
@@ -269,6 +269,7 @@ void mcell_allocfailedv_nodie(char const *fmt, va_list args) {
   mcell_errorv_raw(fmt, args);
   fprintf(mcell_get_error_file(), "\n");
   fprintf(mcell_get_error_file(), "Fatal error: Out of memory\n\n");
+  mem_report_pools(mcell_get_error_file());
   mem_dump_stats(mcell_get_error_file());
 }
 
@@ -0,0 +1,510 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+/* mcell_bench: run synthetic models built through the libmcell API and
+ * report how fast they run.
+ *
+ * Each scenario stresses one part of the simulator.  Scenarios run in
+ * separate processes so that the peak memory reported for one does not
+ * include the others.  Results are written to stdout as CSV, one row per
+ * scenario; everything MCell itself logs goes to stderr. */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "bench_util.h"
+#include "logging.h"
+#include "mcell_init.h"
+#include "mcell_misc.h"
+#include "mcell_objects.h"
+#include "mcell_react_out.h"
+#include "mcell_reactions.h"
+#include "mcell_release.h"
+#include "mcell_run.h"
+#include "mcell_species.h"
+#include "mcell_surfclass.h"
+#include "mcell_viz.h"
+#include "util.h"
+
+/* Parameters shared by all scenarios */
+struct bench_options {
+  double scale;         /* Multiplier for molecule numbers */
+  long long iterations; /* Iterations to run */
+  int seed;             /* Random sequence number */
+  int cubes;            /* Cubes per axis in the neuropil scenario */
+  char const *outdir;   /* Directory for reaction data and viz output */
+};
+
+struct bench_scenario {
+  char const *name;
+  char const *description;
+  int (*build)(MCELL_STATE *state, struct bench_options const *opts);
+};
+
+
+/* Count each species in the world every iteration, one file per species */
+static int count_every_step(MCELL_STATE *state, char const *dir,
+                            mcell_symbol **species, int n_species,
+                            int buffer_size) {
+  struct output_set_list sets = { NULL, NULL };
+  for (int i = 0; i < n_species; ++i) {
+    struct output_column_list count;
+    BUILD_CHECK(mcell_create_count(state, species[i], ORIENT_NOT_SET, NULL,
+                                   REPORT_WORLD | REPORT_CONTENTS, NULL,
+                                   &count));
+    char *file = CHECKED_SPRINTF("%s/counts/%s.dat", dir, species[i]->name);
+    BUILD_CHECK(make_parent_dir(file));
+    struct output_set *os = mcell_create_new_output_set(
+        NULL, 0, count.column_head, FILE_SUBSTITUTE, file);
+    if (os == NULL)
+      return 1;
+    os->next = sets.set_head;
+    sets.set_head = os;
+    if (sets.set_tail == NULL)
+      sets.set_tail = os;
+  }
+
+  struct output_times_inlist times;
+  memset(&times, 0, sizeof(times));
+  times.type = OUTPUT_BY_STEP;
+  times.step = state->time_unit;
+  return mcell_add_reaction_output_block(state, &sets, buffer_size, &times);
+}
+
+/*************************************************************************
+ Scenarios
+*************************************************************************/
+
+/* A + B <-> C in a 1 um box, dense enough that the partner search and the
+ * bimolecular collision tests dominate. */
+static int build_cytosol(MCELL_STATE *state, struct bench_options const *opts) {
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.05));
+  mcell_symbol *a = bench_add_species(state, "A", 1e-6, 0);
+  mcell_symbol *b = bench_add_species(state, "B", 1e-6, 0);
+  mcell_symbol *c = bench_add_species(state, "C", 5e-7, 0);
+  if (a == NULL || b == NULL || c == NULL)
+    return 1;
+  mcell_symbol *ab[] = { a, b };
+  BUILD_CHECK(bench_add_reaction(state, ab, 2, &c, 1, 0, 1e8));
+  BUILD_CHECK(bench_add_reaction(state, &c, 1, ab, 2, 0, 1e4));
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  if (bench_add_box(state, world, "cell", &llf, &urb, NULL) == NULL)
+    return 1;
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_A", a,
+                                    20000 * opts->scale, 0.99));
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_B", b,
+                                    20000 * opts->scale, 0.99));
+  return 0;
+}
+
+/* Two receptors that bind and unbind on the surface of a 1 um box. */
+static int build_membrane(MCELL_STATE *state,
+                          struct bench_options const *opts) {
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.1));
+  mcell_symbol *r = bench_add_species(state, "R", 1e-8, 1);
+  mcell_symbol *l = bench_add_species(state, "L", 1e-8, 1);
+  mcell_symbol *rl = bench_add_species(state, "RL", 5e-9, 1);
+  if (r == NULL || l == NULL || rl == NULL)
+    return 1;
+  mcell_symbol *pair[] = { r, l };
+  BUILD_CHECK(bench_add_reaction(state, pair, 2, &rl, 1, 1, 1.0));
+  BUILD_CHECK(bench_add_reaction(state, &rl, 1, pair, 2, 1, 1e3));
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  struct region *sides = NULL;
+  if (bench_add_box(state, world, "cell", &llf, &urb, &sides) == NULL)
+    return 1;
+  mcell_symbol *mols[] = { r, l };
+  double density[] = { 2000 * opts->scale, 2000 * opts->scale };
+  return bench_release_on_region(state, sides, "receptors", mols, density, 2);
+}
+
+/* Molecules diffusing through a lattice of small reflective boxes, so that
+ * most of the time goes into ray tracing against walls. */
+static int build_neuropil(MCELL_STATE *state,
+                          struct bench_options const *opts) {
+  int n = opts->cubes;
+  double pitch = 1.0 / n;
+  BUILD_CHECK(bench_set_partitions(state, 0.6, pitch / 2));
+  mcell_symbol *a = bench_add_species(state, "A", 1e-6, 0);
+  if (a == NULL)
+    return 1;
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  if (bench_add_box(state, world, "cell", &llf, &urb, NULL) == NULL)
+    return 1;
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      for (int k = 0; k < n; ++k) {
+        struct vector3 lo = { -0.5 + pitch * (i + 0.2),
+                              -0.5 + pitch * (j + 0.2),
+                              -0.5 + pitch * (k + 0.2) };
+        struct vector3 hi = { lo.x + 0.6 * pitch, lo.y + 0.6 * pitch,
+                              lo.z + 0.6 * pitch };
+        char name[64];
+        snprintf(name, sizeof(name), "process_%d_%d_%d", i, j, k);
+        if (bench_add_box(state, world, name, &lo, &hi, NULL) == NULL)
+          return 1;
+      }
+  return bench_release_in_cube(state, world, "rel_A", a, 10000 * opts->scale,
+                               0.99);
+}
+
+/* A + B + C <-> D, which scans pairs of partners for every moving
+ * molecule. */
+static int build_trimolecular(MCELL_STATE *state,
+                              struct bench_options const *opts) {
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.05));
+  mcell_symbol *a = bench_add_species(state, "A", 1e-6, 0);
+  mcell_symbol *b = bench_add_species(state, "B", 1e-6, 0);
+  mcell_symbol *c = bench_add_species(state, "C", 1e-6, 0);
+  mcell_symbol *d = bench_add_species(state, "D", 5e-7, 0);
+  if (a == NULL || b == NULL || c == NULL || d == NULL)
+    return 1;
+  mcell_symbol *abc[] = { a, b, c };
+  BUILD_CHECK(bench_add_reaction(state, abc, 3, &d, 1, 0, 1e12));
+  BUILD_CHECK(bench_add_reaction(state, &d, 1, abc, 3, 0, 1e4));
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  if (bench_add_box(state, world, "cell", &llf, &urb, NULL) == NULL)
+    return 1;
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_A", a,
+                                    5000 * opts->scale, 0.99));
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_B", b,
+                                    5000 * opts->scale, 0.99));
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_C", c,
+                                    5000 * opts->scale, 0.99));
+  return 0;
+}
+
+/* Many species counted in the world on every iteration, with a small
+ * output buffer so that the files are written often. */
+static int build_count_output(MCELL_STATE *state,
+                              struct bench_options const *opts) {
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.1));
+  enum { N_SPECIES = 32 };
+  mcell_symbol *species[N_SPECIES];
+  for (int i = 0; i < N_SPECIES; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "S%02d", i);
+    if ((species[i] = bench_add_species(state, name, 1e-6, 0)) == NULL)
+      return 1;
+  }
+  /* A chain of decays keeps the counts changing */
+  for (int i = 0; i + 1 < N_SPECIES; ++i)
+    BUILD_CHECK(bench_add_reaction(state, &species[i], 1, &species[i + 1], 1,
+                                   0, 1e3));
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  if (bench_add_box(state, world, "cell", &llf, &urb, NULL) == NULL)
+    return 1;
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_S00", species[0],
+                                    2000 * opts->scale, 0.99));
+  char *dir = CHECKED_SPRINTF("%s/count_output", opts->outdir);
+  int failure = count_every_step(state, dir, species, N_SPECIES, 16);
+  free(dir);
+  return failure;
+}
+
+/* Positions of every molecule written on every iteration. */
+static int build_viz_output(MCELL_STATE *state,
+                            struct bench_options const *opts) {
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.1));
+  mcell_symbol *a = bench_add_species(state, "A", 1e-6, 0);
+  mcell_symbol *b = bench_add_species(state, "B", 1e-6, 0);
+  if (a == NULL || b == NULL)
+    return 1;
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  if (bench_add_box(state, world, "cell", &llf, &urb, NULL) == NULL)
+    return 1;
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_A", a,
+                                    10000 * opts->scale, 0.99));
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_B", b,
+                                    10000 * opts->scale, 0.99));
+
+  char *prefix = CHECKED_SPRINTF("%s/viz_output/viz/bench", opts->outdir);
+  BUILD_CHECK(make_parent_dir(prefix));
+  struct mcell_species *mols = mcell_add_to_species_list(a, false, 0, NULL);
+  mols = mcell_add_to_species_list(b, false, 0, mols);
+  int failure = mcell_create_viz_output(state, prefix, mols, 0,
+                                        opts->iterations, 1);
+  mcell_delete_species_list(mols);
+  return failure;
+}
+
+static struct bench_scenario const SCENARIOS[] = {
+  { "cytosol", "dense volume-volume reactions", build_cytosol },
+  { "membrane", "surface-surface reactions", build_membrane },
+  { "neuropil", "diffusion among many reflective walls", build_neuropil },
+  { "trimolecular", "volume trimolecular reactions", build_trimolecular },
+  { "count_output", "COUNT of 32 species on every iteration",
+    build_count_output },
+  { "viz_output", "visualization output on every iteration",
+    build_viz_output },
+};
+
+#define N_SCENARIOS ((int)(sizeof(SCENARIOS) / sizeof(SCENARIOS[0])))
+
+/*************************************************************************
+ Running and reporting
+*************************************************************************/
+
+static double wall_seconds(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + 1e-6 * (double)tv.tv_usec;
+}
+
+/* Peak resident memory of this process in kilobytes, or -1 if unknown */
+static long peak_memory_kb(void) {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+/*************************************************************************
+run_scenario:
+  In: scenario: the model to build
+      opts: benchmark parameters
+  Out: Returns 1 on error, 0 on success.  One CSV row is written to stdout.
+*************************************************************************/
+static int run_scenario(struct bench_scenario const *scenario,
+                        struct bench_options const *opts) {
+  double t_start = wall_seconds();
+
+  MCELL_STATE *state = mcell_create();
+  if (state == NULL)
+    return 1;
+  mcell_set_log_file(stderr);
+  state->quiet_flag = 1;
+  state->seed_seq = opts->seed;
+  if (mcell_init_state(state) ||
+      mcell_set_time_step(state, 1e-6) ||
+      mcell_set_iterations(state, opts->iterations))
+    return 1;
+
+  if (scenario->build(state, opts)) {
+    mcell_error_nodie("Failed to build scenario '%s'.", scenario->name);
+    return 1;
+  }
+
+  if (mcell_init_simulation(state) || mcell_init_read_checkpoint(state) ||
+      mcell_init_output(state))
+    return 1;
+
+  double t_run = wall_seconds();
+  if (mcell_run_simulation(state))
+    return 1;
+  double t_end = wall_seconds();
+
+  double run_seconds = t_end - t_run;
+  long long steps = state->current_iterations - state->start_iterations;
+  long long mol_steps = state->diffusion_number;
+  fprintf(stdout, "%s,%lld,%.6f,%.6f,%.3f,%lld,%.3f,%ld\n", scenario->name,
+          steps, t_run - t_start, run_seconds,
+          (run_seconds > 0) ? (double)steps / run_seconds : 0.0, mol_steps,
+          (mol_steps > 0) ? 1e9 * run_seconds / (double)mol_steps : 0.0,
+          peak_memory_kb());
+  fflush(stdout);
+  return 0;
+}
+
+static void print_bench_usage(FILE *f, char const *argv0) {
+  fprintf(f, "Usage: %s [options] [scenario ...]\n\n", argv0);
+  fprintf(
+      f,
+      "  options:\n"
+      "     [-help]                  print this help message\n"
+      "     [-list]                  list the scenarios and exit\n"
+      "     [-scale f]               multiply molecule numbers by f "
+      "(default: 1)\n"
+      "     [-iterations n]          iterations per scenario (default: 1000)\n"
+      "     [-seed n]                random sequence number (default: 1)\n"
+      "     [-cubes n]               boxes per axis in neuropil "
+      "(default: 8)\n"
+      "     [-outdir dir]            directory for model output "
+      "(default: bench_output)\n"
+      "\n"
+      "  Runs all scenarios if none are named.  For each one, writes a CSV "
+      "row with\n"
+      "  the iterations run, setup and run time in seconds, iterations per "
+      "second,\n"
+      "  diffusion steps taken, run time per diffusion step in ns, and peak "
+      "memory\n"
+      "  in kB.\n\n");
+}
+
+static struct option const bench_options[] = {
+  { "help", 0, 0, 'h' },       { "list", 0, 0, 'l' },
+  { "scale", 1, 0, 's' },      { "iterations", 1, 0, 'i' },
+  { "seed", 1, 0, 'r' },       { "cubes", 1, 0, 'c' },
+  { "outdir", 1, 0, 'o' },     { NULL, 0, 0, 0 }
+};
+
+int main(int argc, char **argv) {
+  struct bench_options opts = { 1.0, 1000, 1, 8, "bench_output" };
+
+  int c;
+  while ((c = getopt_long_only(argc, argv, "?h", bench_options, NULL)) != -1) {
+    char *endptr = NULL;
+    switch (c) {
+    case 'l':
+      for (int i = 0; i < N_SCENARIOS; ++i)
+        fprintf(stdout, "%-14s %s\n", SCENARIOS[i].name,
+                SCENARIOS[i].description);
+      return 0;
+
+    case 's':
+      opts.scale = strtod(optarg, &endptr);
+      if (*endptr != '\0' || opts.scale <= 0) {
+        fprintf(stderr, "Scale must be a positive number: %s\n", optarg);
+        return 1;
+      }
+      break;
+
+    case 'i':
+      opts.iterations = strtoll(optarg, &endptr, 0);
+      if (*endptr != '\0' || opts.iterations < 1) {
+        fprintf(stderr, "Iteration count must be a positive integer: %s\n",
+                optarg);
+        return 1;
+      }
+      break;
+
+    case 'r':
+      opts.seed = (int)strtol(optarg, &endptr, 0);
+      if (*endptr != '\0') {
+        fprintf(stderr, "Random seed must be an integer: %s\n", optarg);
+        return 1;
+      }
+      break;
+
+    case 'c':
+      opts.cubes = (int)strtol(optarg, &endptr, 0);
+      if (*endptr != '\0' || opts.cubes < 1) {
+        fprintf(stderr, "Cube count must be a positive integer: %s\n", optarg);
+        return 1;
+      }
+      break;
+
+    case 'o':
+      opts.outdir = optarg;
+      break;
+
+    case 'h':
+      print_bench_usage(stdout, argv[0]);
+      return 0;
+
+    default:
+      print_bench_usage(stderr, argv[0]);
+      return 1;
+    }
+  }
+
+  /* Pick the scenarios to run */
+  struct bench_scenario const *selected[N_SCENARIOS];
+  int n_selected = 0;
+  if (optind == argc) {
+    for (int i = 0; i < N_SCENARIOS; ++i)
+      selected[n_selected++] = &SCENARIOS[i];
+  }
+  for (; optind < argc; ++optind) {
+    int i;
+    for (i = 0; i < N_SCENARIOS; ++i)
+      if (strcmp(argv[optind], SCENARIOS[i].name) == 0)
+        break;
+    if (i == N_SCENARIOS) {
+      fprintf(stderr, "Unknown scenario '%s' (see -list).\n", argv[optind]);
+      return 1;
+    }
+    if (n_selected == N_SCENARIOS) {
+      fprintf(stderr, "Too many scenarios given.\n");
+      return 1;
+    }
+    selected[n_selected++] = &SCENARIOS[i];
+  }
+
+  fprintf(stdout, "scenario,iterations,setup_s,run_s,iterations_per_s,"
+          "molecule_steps,ns_per_molecule_step,peak_memory_kb\n");
+  fflush(stdout);
+
+  int failures = 0;
+  for (int i = 0; i < n_selected; ++i) {
+#ifndef _WIN32
+    /* A fresh process per scenario keeps the peak memory separate */
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0)
+      exit(run_scenario(selected[i], &opts));
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "Scenario '%s' failed.\n", selected[i]->name);
+      ++failures;
+    }
+#else
+    if (run_scenario(selected[i], &opts)) {
+      fprintf(stderr, "Scenario '%s' failed.\n", selected[i]->name);
+      ++failures;
+    }
+#endif
+  }
+
+  return (failures != 0) ? 1 : 0;
+}
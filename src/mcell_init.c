@@ -49,6 +49,9 @@
 #include "mcell_reactions.h"
 #include "dyngeom.h"
 #include "chkpt.h"
+#include "well_mixed.h"
+#include "phase_timing.h"
+#include "ensemble.h"
 
 /* simple wrapper for executing the supplied function call. In case
  * of an error returns with MCELL_FAIL and prints out error_message */
@@ -192,6 +195,10 @@ mcell_init_simulation(MCELL_STATE *state) {
                "Error initializing vertices and walls.");
   CHECKED_CALL(init_regions(state), "Error initializing regions.");
 
+  // Everything up to here is shared by all replicates.  Nothing above draws
+  // from the random number generator, which each replicate reseeds.
+  CHECKED_CALL(fork_replicates(state), "Error while starting replicates.");
+
   if (state->place_waypoints_flag) {
     CHECKED_CALL(place_waypoints(state), "Error while placing waypoints.");
   }
@@ -210,6 +217,9 @@ mcell_init_simulation(MCELL_STATE *state) {
   CHECKED_CALL(init_species_mesh_transp(state),
                "Error while initializing species-mesh transparency list.");
 
+  CHECKED_CALL(init_well_mixed(state),
+               "Error while initializing well-mixed species.");
+
   CHECKED_CALL(init_counter_name_hash(
       &state->counter_by_name, state->output_block_head),
       "Error while initializing counter name hash.");
@@ -304,7 +314,7 @@ mcell_redo_geom(MCELL_STATE *state) {
 MCELL_STATUS
 mcell_init_read_checkpoint(MCELL_STATE *state) {
 
-  // set up global state in chkpt.c. This is needed to provided
+  // register the state with chkpt.c. This is needed to provide
   // the state for the signal triggered checkpointing
   CHECKED_CALL(set_checkpoint_state(state),
     "An error occured during setting the state of the checkpointing routine.");
@@ -358,6 +368,8 @@ mcell_init_output(MCELL_STATE *state) {
   CHECKED_CALL(init_reaction_data(state),
                "Error while initializing reaction data.");
   CHECKED_CALL(init_timers(state), "Error initializing the simulation timers.");
+  CHECKED_CALL(init_phase_timing(state),
+               "Error while initializing phase timing.");
 
   // signal successful end of simulation
   state->initialization_state = NULL;
@@ -0,0 +1,864 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+/* mcell_microbench: time the kernels the simulator is built on in isolation.
+ *
+ * A small model (a box lined with surface molecules around a lattice of
+ * smaller boxes, with three reacting volume species) is built through the
+ * API and run for two iterations.  The kernels are then called on inputs
+ * drawn from that model: rays from real subvolumes against the walls that
+ * cross them, real molecules as collision targets and reaction partners,
+ * points on real surface grids, and so on.  Inputs are generated before
+ * timing starts.
+ *
+ * Each kernel runs in batches; the time of every batch is divided by the
+ * batch size, and the percentiles are taken over those per-batch means.
+ * Results are written to stdout as CSV, one row per kernel. */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench_util.h"
+#include "diffuse.h"
+#include "grid_util.h"
+#include "logging.h"
+#include "mcell_objects.h"
+#include "mcell_run.h"
+#include "mem_util.h"
+#include "react.h"
+#include "rng.h"
+#include "sched_util.h"
+#include "vol_util.h"
+#include "wall_util.h"
+
+/* Number of precomputed inputs per kernel; calls cycle through them */
+#define MICRO_CASES 4096
+
+/* Results are folded in here so that the calls cannot be optimized away */
+static volatile double micro_sink;
+
+/* The model the kernels draw their inputs from */
+struct micro_fixture {
+  MCELL_STATE *state;
+
+  struct volume_molecule **mols; /* Diffusing volume molecules */
+  int n_mols;
+
+  struct wall **walls;        /* Walls crossing subvolumes ... */
+  struct subvolume **wall_sv; /* ... and the subvolume each one crosses */
+  int n_walls;
+
+  struct wall **grid_walls; /* Walls with a surface grid */
+  int n_grid_walls;
+};
+
+struct micro_kernel {
+  char const *name;
+  char const *description;
+  /* Allocate and fill the inputs, or return NULL on failure */
+  void *(*setup)(struct micro_fixture *fx);
+  /* Make n calls of the kernel.  Kernels that look up the model while
+   * running set run_model, the others set run. */
+  void (*run_model)(struct micro_fixture *fx, void *data, int n);
+  void (*run)(void *data, int n);
+  /* Free the inputs; NULL means free() */
+  void (*teardown)(void *data);
+};
+
+/*************************************************************************
+ Fixture
+*************************************************************************/
+
+static int build_fixture_model(MCELL_STATE *state) {
+  BUILD_CHECK(bench_set_partitions(state, 0.6, 0.05));
+  mcell_symbol *a = bench_add_species(state, "A", 1e-6, 0);
+  mcell_symbol *b = bench_add_species(state, "B", 1e-6, 0);
+  mcell_symbol *c = bench_add_species(state, "C", 5e-7, 0);
+  mcell_symbol *s = bench_add_species(state, "S", 1e-8, 1);
+  if (a == NULL || b == NULL || c == NULL || s == NULL)
+    return 1;
+  mcell_symbol *ab[] = { a, b }, *ac[] = { a, c }, *bc[] = { b, c };
+  BUILD_CHECK(bench_add_reaction(state, ab, 2, &c, 1, 0, 1e7));
+  BUILD_CHECK(bench_add_reaction(state, ac, 2, &b, 1, 0, 1e6));
+  BUILD_CHECK(bench_add_reaction(state, bc, 2, &a, 1, 0, 1e6));
+
+  struct object *world = NULL;
+  BUILD_CHECK(mcell_create_instance_object(state, "world", &world));
+  struct vector3 llf = { -0.5, -0.5, -0.5 }, urb = { 0.5, 0.5, 0.5 };
+  struct region *sides = NULL;
+  if (bench_add_box(state, world, "cell", &llf, &urb, &sides) == NULL)
+    return 1;
+  double density = 1000;
+  BUILD_CHECK(bench_release_on_region(state, sides, "lining", &s, &density,
+                                      1));
+
+  int const n = 4;
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      for (int k = 0; k < n; ++k) {
+        struct vector3 lo = { -0.5 + (i + 0.3) / n, -0.5 + (j + 0.3) / n,
+                              -0.5 + (k + 0.3) / n };
+        struct vector3 hi = { lo.x + 0.4 / n, lo.y + 0.4 / n,
+                              lo.z + 0.4 / n };
+        char name[64];
+        snprintf(name, sizeof(name), "process_%d_%d_%d", i, j, k);
+        if (bench_add_box(state, world, name, &lo, &hi, NULL) == NULL)
+          return 1;
+      }
+
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_A", a, 10000, 0.99));
+  BUILD_CHECK(bench_release_in_cube(state, world, "rel_B", b, 10000, 0.99));
+  return bench_release_in_cube(state, world, "rel_C", c, 10000, 0.99);
+}
+
+/*************************************************************************
+init_fixture:
+  In: fx: fixture to fill in
+      seed: random sequence number
+  Out: Returns 1 on error, 0 on success.  The model is built, run for two
+       iterations so that all molecules are released and placed, and its
+       molecules and walls are collected.
+*************************************************************************/
+static int init_fixture(struct micro_fixture *fx, int seed) {
+  memset(fx, 0, sizeof(*fx));
+  MCELL_STATE *state = fx->state = mcell_create();
+  if (state == NULL)
+    return 1;
+  mcell_set_log_file(stderr);
+  state->quiet_flag = 1;
+  state->seed_seq = seed;
+  if (mcell_init_state(state) || mcell_set_time_step(state, 1e-6) ||
+      mcell_set_iterations(state, 2))
+    return 1;
+  if (build_fixture_model(state)) {
+    mcell_error_nodie("Failed to build the microbenchmark model.");
+    return 1;
+  }
+  if (mcell_init_simulation(state) || mcell_init_read_checkpoint(state) ||
+      mcell_init_output(state))
+    return 1;
+  int restarted = 0;
+  for (int i = 0; i < 2; ++i)
+    if (mcell_run_iteration(state, 1000, &restarted))
+      return 1;
+  /* There is no reaction output to save if the process exits */
+  state->emergency_output_hook_enabled = 0;
+
+  int max_mols = 0, max_walls = 0;
+  for (int i = 0; i < state->n_subvols; ++i) {
+    max_mols += state->subvol[i]->mol_count;
+    for (struct wall_list *wl = state->subvol[i]->wall_head; wl != NULL;
+         wl = wl->next)
+      ++max_walls;
+  }
+  fx->mols = CHECKED_MALLOC_ARRAY(struct volume_molecule *, max_mols + 1,
+                                  "microbenchmark molecules");
+  fx->walls = CHECKED_MALLOC_ARRAY(struct wall *, max_walls + 1,
+                                   "microbenchmark walls");
+  fx->wall_sv = CHECKED_MALLOC_ARRAY(struct subvolume *, max_walls + 1,
+                                     "microbenchmark wall subvolumes");
+  fx->grid_walls = CHECKED_MALLOC_ARRAY(struct wall *, max_walls + 1,
+                                        "microbenchmark surface grids");
+  if (fx->mols == NULL || fx->walls == NULL || fx->wall_sv == NULL ||
+      fx->grid_walls == NULL)
+    return 1;
+
+  for (int i = 0; i < state->n_subvols; ++i) {
+    struct subvolume *sv = state->subvol[i];
+    for (int l = 0; l < sv->n_species_lists; l++) {
+      struct per_species_list *psl = sv->species_lists[l];
+      if (psl->properties->space_step <= 0)
+        continue;
+      for (struct volume_molecule *vm = psl->head; vm != NULL; vm = vm->next_v)
+        if (vm->properties != NULL && fx->n_mols < max_mols)
+          fx->mols[fx->n_mols++] = vm;
+    }
+    for (struct wall_list *wl = sv->wall_head; wl != NULL; wl = wl->next) {
+      fx->walls[fx->n_walls] = wl->this_wall;
+      fx->wall_sv[fx->n_walls++] = sv;
+      /* Each wall once, from the subvolume its grid points at */
+      if (wl->this_wall->grid != NULL && wl->this_wall->grid->subvol == sv)
+        fx->grid_walls[fx->n_grid_walls++] = wl->this_wall;
+    }
+  }
+  if (fx->n_mols == 0 || fx->n_walls == 0 || fx->n_grid_walls == 0) {
+    mcell_error_nodie("The microbenchmark model has no molecules, walls or "
+                      "surface grids.");
+    return 1;
+  }
+  return 0;
+}
+
+static struct volume_molecule *random_mol(struct micro_fixture *fx) {
+  return fx->mols[rng_uint(fx->state->rng) % (u_int)fx->n_mols];
+}
+
+/* A uniformly distributed point on a wall */
+static void random_point_on_wall(struct rng_state *rng, struct wall *w,
+                                 struct vector3 *p) {
+  double r1 = rng_dbl(rng), r2 = rng_dbl(rng);
+  if (r1 + r2 > 1.0) {
+    r1 = 1.0 - r1;
+    r2 = 1.0 - r2;
+  }
+  p->x = w->vert[0]->x + r1 * (w->vert[1]->x - w->vert[0]->x) +
+         r2 * (w->vert[2]->x - w->vert[0]->x);
+  p->y = w->vert[0]->y + r1 * (w->vert[1]->y - w->vert[0]->y) +
+         r2 * (w->vert[2]->y - w->vert[0]->y);
+  p->z = w->vert[0]->z + r1 * (w->vert[1]->z - w->vert[0]->z) +
+         r2 * (w->vert[2]->z - w->vert[0]->z);
+}
+
+/*************************************************************************
+ Kernels
+*************************************************************************/
+
+/* Inputs shared by the ray kernels: a start point, a diffusion step and the
+ * object hit test is done against */
+struct ray_cases {
+  int next;
+  struct vector3 point[MICRO_CASES];
+  struct vector3 move[MICRO_CASES];
+  void *target[MICRO_CASES];
+  struct subvolume *sv[MICRO_CASES];
+};
+
+/* A ray starting anywhere in a subvolume, against a wall crossing it */
+static void *setup_collide_wall(struct micro_fixture *fx) {
+  struct ray_cases *rc =
+      CHECKED_MALLOC_STRUCT(struct ray_cases, "collide_wall inputs");
+  if (rc == NULL)
+    return NULL;
+  struct volume *world = fx->state;
+  rc->next = 0;
+  for (int i = 0; i < MICRO_CASES; ++i) {
+    int k = rng_uint(world->rng) % (u_int)fx->n_walls;
+    struct subvolume *sv = fx->wall_sv[k];
+    struct vector3 lo = { world->x_fineparts[sv->llf.x],
+                          world->y_fineparts[sv->llf.y],
+                          world->z_fineparts[sv->llf.z] };
+    struct vector3 hi = { world->x_fineparts[sv->urb.x],
+                          world->y_fineparts[sv->urb.y],
+                          world->z_fineparts[sv->urb.z] };
+    rc->point[i].x = lo.x + rng_dbl(world->rng) * (hi.x - lo.x);
+    rc->point[i].y = lo.y + rng_dbl(world->rng) * (hi.y - lo.y);
+    rc->point[i].z = lo.z + rng_dbl(world->rng) * (hi.z - lo.z);
+    pick_displacement(&rc->move[i], random_mol(fx)->properties->space_step,
+                      world->rng);
+    rc->target[i] = fx->walls[k];
+    rc->sv[i] = sv;
+  }
+  return rc;
+}
+
+static void run_collide_wall(struct micro_fixture *fx, void *data, int n) {
+  struct ray_cases *rc = data;
+  struct volume *world = fx->state;
+  long long tests = 0;
+  double sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = rc->next;
+    rc->next = (k + 1) % MICRO_CASES;
+    double t;
+    struct vector3 hit;
+    if (collide_wall(&rc->point[k], &rc->move[k], rc->target[k], &t, &hit, 0,
+                     world->rng, world->notify, &tests) != COLLIDE_MISS)
+      sum += t;
+  }
+  micro_sink += sum;
+}
+
+/* A molecule's diffusion step against another molecule of its subvolume */
+static void *setup_collide_mol(struct micro_fixture *fx) {
+  struct ray_cases *rc =
+      CHECKED_MALLOC_STRUCT(struct ray_cases, "collide_mol inputs");
+  if (rc == NULL)
+    return NULL;
+  rc->next = 0;
+  for (int i = 0; i < MICRO_CASES; ++i) {
+    struct volume_molecule *m = random_mol(fx);
+    struct volume_molecule *target = NULL;
+    for (int tries = 0; tries < 100 && target == NULL; ++tries) {
+      struct volume_molecule *t = random_mol(fx);
+      if (t != m && t->subvol == m->subvol)
+        target = t;
+    }
+    if (target == NULL)
+      target = random_mol(fx);
+    rc->point[i] = m->pos;
+    pick_displacement(&rc->move[i], m->properties->space_step,
+                      fx->state->rng);
+    rc->target[i] = target;
+    rc->sv[i] = m->subvol;
+  }
+  return rc;
+}
+
+static void run_collide_mol(struct micro_fixture *fx, void *data, int n) {
+  struct ray_cases *rc = data;
+  double sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = rc->next;
+    rc->next = (k + 1) % MICRO_CASES;
+    double t;
+    struct vector3 hit;
+    if (collide_mol(&rc->point[k], &rc->move[k], rc->target[k], &t, &hit,
+                    fx->state->rx_radius_3d) != COLLIDE_MISS)
+      sum += t;
+  }
+  micro_sink += sum;
+}
+
+/* A diffusion step ending near another molecule in a subvolume with walls,
+ * as in a volume-volume collision */
+struct exact_disk_cases {
+  struct ray_cases rays; /* target is the moving molecule */
+  struct volume_molecule targets[MICRO_CASES];
+};
+
+static void *setup_exact_disk(struct micro_fixture *fx) {
+  struct exact_disk_cases *ec =
+      CHECKED_MALLOC_STRUCT(struct exact_disk_cases, "exact_disk inputs");
+  if (ec == NULL)
+    return NULL;
+  struct volume *world = fx->state;
+  struct ray_cases *rc = &ec->rays;
+  rc->next = 0;
+  for (int i = 0; i < MICRO_CASES; ++i) {
+    struct volume_molecule *m = NULL;
+    for (int tries = 0; tries < 1000; ++tries) {
+      m = random_mol(fx);
+      if (m->subvol->wall_head != NULL)
+        break;
+    }
+    pick_displacement(&rc->move[i], m->properties->space_step, world->rng);
+    rc->point[i].x = m->pos.x + rc->move[i].x;
+    rc->point[i].y = m->pos.y + rc->move[i].y;
+    rc->point[i].z = m->pos.z + rc->move[i].z;
+    rc->target[i] = m;
+    rc->sv[i] = m->subvol;
+
+    /* Somewhere on the interaction disk around the end of the step */
+    struct vector3 off;
+    pick_displacement(&off, 0.5 * world->rx_radius_3d, world->rng);
+    ec->targets[i] = *m;
+    ec->targets[i].pos.x = rc->point[i].x + off.x;
+    ec->targets[i].pos.y = rc->point[i].y + off.y;
+    ec->targets[i].pos.z = rc->point[i].z + off.z;
+  }
+  return ec;
+}
+
+static void run_exact_disk(struct micro_fixture *fx, void *data, int n) {
+  struct exact_disk_cases *ec = data;
+  struct ray_cases *rc = &ec->rays;
+  struct volume *world = fx->state;
+  double sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = rc->next;
+    rc->next = (k + 1) % MICRO_CASES;
+    sum += exact_disk(world, &rc->point[k], &rc->move[k], world->rx_radius_3d,
+                      rc->sv[k], rc->target[k], &ec->targets[k],
+                      world->use_expanded_list, world->x_fineparts,
+                      world->y_fineparts, world->z_fineparts);
+  }
+  micro_sink += sum;
+}
+
+/* Random pairs of molecules looked up in the reaction hash */
+struct pair_cases {
+  int next;
+  struct abstract_molecule *a[MICRO_CASES];
+  struct abstract_molecule *b[MICRO_CASES];
+};
+
+static void *setup_trigger_bimolecular(struct micro_fixture *fx) {
+  struct pair_cases *pc =
+      CHECKED_MALLOC_STRUCT(struct pair_cases, "trigger_bimolecular inputs");
+  if (pc == NULL)
+    return NULL;
+  pc->next = 0;
+  for (int i = 0; i < MICRO_CASES; ++i) {
+    pc->a[i] = (struct abstract_molecule *)random_mol(fx);
+    pc->b[i] = (struct abstract_molecule *)random_mol(fx);
+  }
+  return pc;
+}
+
+static void run_trigger_bimolecular(struct micro_fixture *fx, void *data,
+                                    int n) {
+  struct pair_cases *pc = data;
+  struct volume *world = fx->state;
+  struct rxn *matching[MAX_MATCHING_RXNS];
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = pc->next;
+    pc->next = (k + 1) % MICRO_CASES;
+    struct abstract_molecule *a = pc->a[k], *b = pc->b[k];
+    sum += trigger_bimolecular(world->reaction_hash, world->rx_hashsize,
+                               a->properties->hashval, b->properties->hashval,
+                               a, b, 0, 0, matching);
+  }
+  micro_sink += sum;
+}
+
+/* The end point of a diffusion step, starting from the old subvolume */
+struct point_cases {
+  int next;
+  struct vector3 point[MICRO_CASES];
+  struct subvolume *guess[MICRO_CASES];
+};
+
+static void *setup_find_subvolume(struct micro_fixture *fx) {
+  struct point_cases *pc =
+      CHECKED_MALLOC_STRUCT(struct point_cases, "find_subvolume inputs");
+  if (pc == NULL)
+    return NULL;
+  pc->next = 0;
+  for (int i = 0; i < MICRO_CASES; ++i) {
+    struct volume_molecule *m = random_mol(fx);
+    struct vector3 move;
+    pick_displacement(&move, m->properties->space_step, fx->state->rng);
+    pc->point[i].x = m->pos.x + move.x;
+    pc->point[i].y = m->pos.y + move.y;
+    pc->point[i].z = m->pos.z + move.z;
+    pc->guess[i] = m->subvol;
+  }
+  return pc;
+}
+
+static void run_find_subvolume(struct micro_fixture *fx, void *data, int n) {
+  struct point_cases *pc = data;
+  long sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = pc->next;
+    pc->next = (k + 1) % MICRO_CASES;
+    struct subvolume *sv =
+        find_subvolume(fx->state, &pc->point[k], pc->guess[k]);
+    sum += sv->index;
+  }
+  micro_sink += sum;
+}
+
+/* Points on surface grids, in world and in wall coordinates */
+struct grid_cases {
+  int next;
+  struct vector3 xyz[MICRO_CASES];
+  struct vector2 uv[MICRO_CASES];
+  struct surface_grid *grid[MICRO_CASES];
+};
+
+static void *setup_grid(struct micro_fixture *fx) {
+  struct grid_cases *gc =
+      CHECKED_MALLOC_STRUCT(struct grid_cases, "surface grid inputs");
+  if (gc == NULL)
+    return NULL;
+  gc->next = 0;
+  for (int i = 0; i < MICRO_CASES; ++i) {
+    struct wall *w = fx->grid_walls[rng_uint(fx->state->rng) %
+                                    (u_int)fx->n_grid_walls];
+    random_point_on_wall(fx->state->rng, w, &gc->xyz[i]);
+    xyz2uv(&gc->xyz[i], w, &gc->uv[i]);
+    gc->grid[i] = w->grid;
+  }
+  return gc;
+}
+
+static void run_xyz2grid(void *data, int n) {
+  struct grid_cases *gc = data;
+  long sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = gc->next;
+    gc->next = (k + 1) % MICRO_CASES;
+    sum += xyz2grid(&gc->xyz[k], gc->grid[k]);
+  }
+  micro_sink += sum;
+}
+
+static void run_uv2grid(void *data, int n) {
+  struct grid_cases *gc = data;
+  long sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int k = gc->next;
+    gc->next = (k + 1) % MICRO_CASES;
+    sum += uv2grid(&gc->uv[k], gc->grid[k]);
+  }
+  micro_sink += sum;
+}
+
+/* A generator of its own, so that the model's sequence is not disturbed */
+static void *setup_rng(struct micro_fixture *fx) {
+  struct rng_state *rng =
+      CHECKED_MALLOC_STRUCT(struct rng_state, "random number generator");
+  if (rng == NULL)
+    return NULL;
+  rng_init(rng, fx->state->seed_seq);
+  return rng;
+}
+
+static void run_rng_gauss(void *data, int n) {
+  struct rng_state *rng = data;
+  double sum = 0;
+  for (int i = 0; i < n; ++i)
+    sum += rng_gauss(rng);
+  micro_sink += sum;
+}
+
+static void run_isaac64_generate(void *data, int n) {
+#ifndef USE_MINIMAL_RNG
+  struct rng_state *rng = data;
+  for (int i = 0; i < n; ++i)
+    isaac64_generate(rng);
+  micro_sink += (double)rng->randrsl[0];
+#endif
+}
+
+/* A scheduler holding a population of molecules: each call takes the next
+ * item and schedules it again, one time step later for most items and up
+ * to fifty time steps later for the rest. */
+struct schedule_cases {
+  struct schedule_helper *sh;
+  struct abstract_element *items;
+  int next;
+  double delay[MICRO_CASES];
+};
+
+#define MICRO_SCHEDULED 20000
+
+static void *setup_schedule(struct micro_fixture *fx) {
+  struct schedule_cases *sc =
+      CHECKED_MALLOC_STRUCT(struct schedule_cases, "scheduler inputs");
+  if (sc == NULL)
+    return NULL;
+  sc->sh = create_scheduler(1.0, 100.0, 100, 0.0);
+  sc->items = CHECKED_MALLOC_ARRAY(struct abstract_element, MICRO_SCHEDULED,
+                                   "scheduled items");
+  if (sc->sh == NULL || sc->items == NULL)
+    return NULL;
+  struct rng_state *rng = fx->state->rng;
+  for (int i = 0; i < MICRO_CASES; ++i)
+    sc->delay[i] = (rng_dbl(rng) < 0.9) ? 1.0 : 1.0 + 50.0 * rng_dbl(rng);
+  for (int i = 0; i < MICRO_SCHEDULED; ++i) {
+    sc->items[i].next = NULL;
+    sc->items[i].t = sc->delay[i % MICRO_CASES] * rng_dbl(rng);
+    if (schedule_add(sc->sh, &sc->items[i]))
+      return NULL;
+  }
+  sc->next = 0;
+  return sc;
+}
+
+static void run_schedule(void *data, int n) {
+  struct schedule_cases *sc = data;
+  for (int i = 0; i < n;) {
+    struct abstract_element *ae = schedule_next(sc->sh);
+    if (ae == NULL)
+      continue; /* Advanced to the next time step */
+    int k = sc->next;
+    sc->next = (k + 1) % MICRO_CASES;
+    ae->t += sc->delay[k];
+    schedule_add(sc->sh, ae);
+    ++i;
+  }
+  micro_sink += sc->sh->now;
+}
+
+static void teardown_schedule(void *data) {
+  struct schedule_cases *sc = data;
+  delete_scheduler(sc->sh);
+  free(sc->items);
+  free(sc);
+}
+
+/* A pool of molecule-sized records with a churning population: each call
+ * frees a random live record or allocates into a random empty slot. */
+#define MICRO_MEM_SLOTS 16384
+
+struct mem_cases {
+  struct mem_helper *mh;
+  void *slot[MICRO_MEM_SLOTS];
+  int next;
+  int pick[MICRO_CASES];
+};
+
+static void *setup_mem(struct micro_fixture *fx) {
+  struct mem_cases *mc =
+      CHECKED_MALLOC_STRUCT(struct mem_cases, "memory pool inputs");
+  if (mc == NULL)
+    return NULL;
+  mc->mh = create_mem(sizeof(struct volume_molecule), 128);
+  if (mc->mh == NULL)
+    return NULL;
+  struct rng_state *rng = fx->state->rng;
+  for (int i = 0; i < MICRO_MEM_SLOTS; ++i)
+    mc->slot[i] = (rng_dbl(rng) < 0.5) ? mem_get(mc->mh) : NULL;
+  for (int i = 0; i < MICRO_CASES; ++i)
+    mc->pick[i] = rng_uint(rng) % MICRO_MEM_SLOTS;
+  mc->next = 0;
+  return mc;
+}
+
+static void run_mem(void *data, int n) {
+  struct mem_cases *mc = data;
+  for (int i = 0; i < n; ++i) {
+    int k = mc->next;
+    mc->next = (k + 1) % MICRO_CASES;
+    void **slot = &mc->slot[mc->pick[k]];
+    if (*slot != NULL) {
+      mem_put(mc->mh, *slot);
+      *slot = NULL;
+    } else {
+      *slot = mem_get(mc->mh);
+    }
+  }
+}
+
+static void teardown_mem(void *data) {
+  struct mem_cases *mc = data;
+  delete_mem(mc->mh);
+  free(mc);
+}
+
+static struct micro_kernel const KERNELS[] = {
+  { "collide_wall", "ray against a wall crossing its subvolume",
+    setup_collide_wall, run_collide_wall, NULL, NULL },
+  { "collide_mol", "ray against a molecule in its subvolume",
+    setup_collide_mol, run_collide_mol, NULL, NULL },
+  { "exact_disk", "interaction disk area next to walls", setup_exact_disk,
+    run_exact_disk, NULL, NULL },
+  { "trigger_bimolecular", "reaction lookup for a pair of molecules",
+    setup_trigger_bimolecular, run_trigger_bimolecular, NULL, NULL },
+  { "find_subvolume", "subvolume at the end of a diffusion step",
+    setup_find_subvolume, run_find_subvolume, NULL, NULL },
+  { "xyz2grid", "surface grid tile of a point in space", setup_grid, NULL,
+    run_xyz2grid, NULL },
+  { "uv2grid", "surface grid tile of a point on a wall", setup_grid, NULL,
+    run_uv2grid, NULL },
+  { "rng_gauss", "one normally distributed random number", setup_rng, NULL,
+    run_rng_gauss, NULL },
+  { "isaac64_generate", "one block of 256 random words", setup_rng, NULL,
+    run_isaac64_generate, NULL },
+  { "schedule", "schedule_next and schedule_insert of one item",
+    setup_schedule, NULL, run_schedule, teardown_schedule },
+  { "mem_pool", "one mem_get or mem_put", setup_mem, NULL, run_mem,
+    teardown_mem },
+};
+
+#define N_KERNELS ((int)(sizeof(KERNELS) / sizeof(KERNELS[0])))
+
+/*************************************************************************
+ Timing and reporting
+*************************************************************************/
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1e9 * (double)ts.tv_sec + (double)ts.tv_nsec;
+}
+
+static int cmp_double(void const *a, void const *b) {
+  double x = *(double const *)a, y = *(double const *)b;
+  return (x < y) ? -1 : (x > y);
+}
+
+/* Value below which the fraction q of the sorted samples lie */
+static double percentile(double const *sorted, int n, double q) {
+  int i = (int)(q * (n - 1) + 0.5);
+  return sorted[i];
+}
+
+/* Make n calls of the kernel */
+static void run_calls(struct micro_fixture *fx,
+                      struct micro_kernel const *kernel, void *data, int n) {
+  if (kernel->run_model != NULL)
+    kernel->run_model(fx, data, n);
+  else
+    kernel->run(data, n);
+}
+
+/*************************************************************************
+run_kernel:
+  In: fx: the model to draw inputs from
+      kernel: the kernel to time
+      batches: number of timed batches
+      batch_size: calls per batch
+  Out: Returns 1 on error, 0 on success.  One CSV row is written to stdout.
+*************************************************************************/
+static int run_kernel(struct micro_fixture *fx,
+                      struct micro_kernel const *kernel, int batches,
+                      int batch_size) {
+  void *data = kernel->setup(fx);
+  double *ns_per_call =
+      CHECKED_MALLOC_ARRAY(double, batches, "microbenchmark timings");
+  if (data == NULL || ns_per_call == NULL) {
+    mcell_error_nodie("Failed to set up kernel '%s'.", kernel->name);
+    return 1;
+  }
+
+  /* Warm up the caches and the branch predictors */
+  run_calls(fx, kernel, data, MICRO_CASES);
+
+  double total = 0;
+  for (int b = 0; b < batches; ++b) {
+    double t0 = now_ns();
+    run_calls(fx, kernel, data, batch_size);
+    double t = now_ns() - t0;
+    total += t;
+    ns_per_call[b] = t / batch_size;
+  }
+  qsort(ns_per_call, batches, sizeof(double), &cmp_double);
+
+  long long calls = (long long)batches * batch_size;
+  fprintf(stdout, "%s,%lld,%.6f,%.1f,%.2f,%.2f,%.2f,%.2f\n", kernel->name,
+          calls, 1e-9 * total, (total > 0) ? 1e9 * calls / total : 0.0,
+          total / calls, percentile(ns_per_call, batches, 0.5),
+          percentile(ns_per_call, batches, 0.9),
+          percentile(ns_per_call, batches, 0.99));
+  fflush(stdout);
+
+  free(ns_per_call);
+  if (kernel->teardown != NULL)
+    kernel->teardown(data);
+  else
+    free(data);
+  return 0;
+}
+
+static void print_microbench_usage(FILE *f, char const *argv0) {
+  fprintf(f, "Usage: %s [options] [kernel ...]\n\n", argv0);
+  fprintf(
+      f,
+      "  options:\n"
+      "     [-help]                  print this help message\n"
+      "     [-list]                  list the kernels and exit\n"
+      "     [-batches n]             timed batches per kernel "
+      "(default: 2000)\n"
+      "     [-batch_size n]          calls per batch (default: 100)\n"
+      "     [-seed n]                random sequence number (default: 1)\n"
+      "\n"
+      "  Times all kernels if none are named.  For each one, writes a CSV "
+      "row with\n"
+      "  the number of calls, the total time in seconds, calls per second, "
+      "the mean\n"
+      "  time per call in ns and the 50th, 90th and 99th percentiles of the "
+      "time per\n"
+      "  call over the batches.\n\n");
+}
+
+static struct option const microbench_options[] = {
+  { "help", 0, 0, 'h' },       { "list", 0, 0, 'l' },
+  { "batches", 1, 0, 'b' },    { "batch_size", 1, 0, 'n' },
+  { "seed", 1, 0, 'r' },       { NULL, 0, 0, 0 }
+};
+
+int main(int argc, char **argv) {
+  int batches = 2000, batch_size = 100, seed = 1;
+
+  int c;
+  while ((c = getopt_long_only(argc, argv, "?h", microbench_options, NULL)) !=
+         -1) {
+    char *endptr = NULL;
+    switch (c) {
+    case 'l':
+      for (int i = 0; i < N_KERNELS; ++i)
+        fprintf(stdout, "%-20s %s\n", KERNELS[i].name, KERNELS[i].description);
+      return 0;
+
+    case 'b':
+      batches = (int)strtol(optarg, &endptr, 0);
+      if (*endptr != '\0' || batches < 1) {
+        fprintf(stderr, "Batch count must be a positive integer: %s\n",
+                optarg);
+        return 1;
+      }
+      break;
+
+    case 'n':
+      batch_size = (int)strtol(optarg, &endptr, 0);
+      if (*endptr != '\0' || batch_size < 1) {
+        fprintf(stderr, "Batch size must be a positive integer: %s\n", optarg);
+        return 1;
+      }
+      break;
+
+    case 'r':
+      seed = (int)strtol(optarg, &endptr, 0);
+      if (*endptr != '\0') {
+        fprintf(stderr, "Random seed must be an integer: %s\n", optarg);
+        return 1;
+      }
+      break;
+
+    case 'h':
+      print_microbench_usage(stdout, argv[0]);
+      return 0;
+
+    default:
+      print_microbench_usage(stderr, argv[0]);
+      return 1;
+    }
+  }
+
+  /* Pick the kernels to time */
+  struct micro_kernel const *selected[N_KERNELS];
+  int n_selected = 0;
+  if (optind == argc) {
+    for (int i = 0; i < N_KERNELS; ++i)
+      selected[n_selected++] = &KERNELS[i];
+  }
+  for (; optind < argc; ++optind) {
+    int i;
+    for (i = 0; i < N_KERNELS; ++i)
+      if (strcmp(argv[optind], KERNELS[i].name) == 0)
+        break;
+    if (i == N_KERNELS) {
+      fprintf(stderr, "Unknown kernel '%s' (see -list).\n", argv[optind]);
+      return 1;
+    }
+    if (n_selected == N_KERNELS) {
+      fprintf(stderr, "Too many kernels given.\n");
+      return 1;
+    }
+    selected[n_selected++] = &KERNELS[i];
+  }
+
+  struct micro_fixture fx;
+  if (init_fixture(&fx, seed)) {
+    fprintf(stderr, "Failed to set up the microbenchmark model.\n");
+    return 1;
+  }
+
+  fprintf(stdout, "kernel,calls,total_s,calls_per_s,mean_ns,p50_ns,p90_ns,"
+                  "p99_ns\n");
+  fflush(stdout);
+
+  int failures = 0;
+  for (int i = 0; i < n_selected; ++i)
+    failures += run_kernel(&fx, selected[i], batches, batch_size);
+  return (failures != 0) ? 1 : 0;
+}
@@ -97,6 +97,9 @@ static void check_reaction_for_duplicate_pathways(struct pathway **head);
 static int load_rate_file(double time_unit, struct mem_helper *tv_rxn_mem,
                           struct rxn *rx, char *fname, int path, enum warn_level_t neg_reaction);
 
+static int schedule_rate_changes(struct schedule_helper *rate_scheduler,
+                                 struct rxn *rx);
+
 static void add_surface_reaction_flags(struct sym_table_head *mol_sym_table,
                                        struct species *all_mols,
                                        struct species *all_surface_mols,
@@ -791,6 +794,9 @@ int init_reactions(MCELL_STATE *state) {
   state->tv_rxn_mem = create_mem(sizeof(struct t_func), 100);
   if (state->tv_rxn_mem == NULL)
     return 1;
+  state->rate_scheduler = create_scheduler(1.0, 100.0, 100, 0.0);
+  if (state->rate_scheduler == NULL)
+    return 1;
 
   for (int n_rxn_bin = 0; n_rxn_bin < state->rxn_sym_table->n_bins;
        n_rxn_bin++) {
@@ -1045,6 +1051,8 @@ int init_reactions(MCELL_STATE *state) {
         if (n_prob_t_rxns > 0) {
           for (struct t_func *tp = rx->prob_t; tp != NULL; tp = tp->next)
             tp->value *= pb_factor;
+          if (schedule_rate_changes(state->rate_scheduler, rx))
+            return 1;
         }
 
         /* Move counts from list into array */
@@ -1141,6 +1149,10 @@ int init_reactions(MCELL_STATE *state) {
   add_surface_reaction_flags(state->mol_sym_table, state->all_mols, state->all_surface_mols,
                              state->all_volume_mols);
 
+  /* All time-varying rates have been copied into per-reaction arrays */
+  delete_mem(state->tv_rxn_mem);
+  state->tv_rxn_mem = NULL;
+
   if (state->notify->reaction_probabilities == NOTIFY_FULL)
     mcell_log_raw("\n");
 
@@ -3305,7 +3317,9 @@ struct reaction_rates mcell_create_reaction_rates(int forwardRateType,
  Note: The file format is assumed to be two columns of numbers; the first
        column is time (in seconds) and the other is rate constant (in
        appropriate units) that starts at that time.  Lines that are not numbers
-       are ignored.
+       are ignored.  Rates only change at the start of an iteration (see
+       process_rate_changes), so times that are not multiples of the time
+       step are moved to the next iteration with a warning.
 *************************************************************************/
 int load_rate_file(double time_unit, struct mem_helper *tv_rxn_mem,
                    struct rxn *rx, char *fname, int path,
@@ -3378,9 +3392,22 @@ int load_rate_file(double time_unit, struct mem_helper *tv_rxn_mem,
           fclose(f);
           return 1;
         }
+        /* Rates only change at the start of an iteration, so a time that
+         * falls between two iterations takes effect at the later one */
+        double it = t / time_unit;
+        if (t > 0.0) {
+          double snapped = ceil(it - EPS_C * it);
+          if (fabs(it - snapped) > EPS_C * it)
+            mcell_warn("In rate constants file '%s', line %d: time %.15g s is "
+                       "not a multiple of the time step; the rate constant "
+                       "will change at iteration %.15g.",
+                       fname, linecount, t, snapped);
+          it = snapped;
+        }
+
         tp->next = NULL;
         tp->path = path;
-        tp->time = t / time_unit;
+        tp->time = it;
         tp->value = rate_constant;
 #ifdef DEBUG
         valid_linecount++;
@@ -3415,3 +3442,51 @@ int load_rate_file(double time_unit, struct mem_helper *tv_rxn_mem,
   }
   return 0;
 }
+
+/*************************************************************************
+ schedule_rate_changes:
+  In: rate_scheduler: scheduler for the rate changes of all reactions
+      rx: reaction with a sorted list of time-varying rates in rx->prob_t
+  Out: Returns 1 on error, 0 on success.
+       The list is copied into an array and the first pending change is
+       scheduled.  The list itself is freed with tv_rxn_mem; the array and
+       the event are freed by process_rate_changes after the last change.
+  Note: load_rate_file only accepts times at the start of an iteration.
+*************************************************************************/
+static int schedule_rate_changes(struct schedule_helper *rate_scheduler,
+                                 struct rxn *rx) {
+  int n_changes = 0;
+  for (struct t_func *tp = rx->prob_t; tp != NULL; tp = tp->next)
+    n_changes++;
+  if (n_changes == 0)
+    return 0;
+
+  struct t_func *table = CHECKED_MALLOC_ARRAY(struct t_func, n_changes,
+                                              "time-varying reaction rates");
+  struct rate_change_event *rce = CHECKED_MALLOC_STRUCT(
+      struct rate_change_event, "time-varying reaction rate event");
+  if (table == NULL || rce == NULL)
+    return 1;
+  rce->new_probs = CHECKED_MALLOC_ARRAY(double, rx->n_pathways,
+                                        "time-varying reaction rates");
+  rce->changed = CHECKED_MALLOC_ARRAY(byte, rx->n_pathways,
+                                      "time-varying reaction rates");
+  if (rce->new_probs == NULL || rce->changed == NULL)
+    return 1;
+  memset(rce->changed, 0, rx->n_pathways * sizeof(byte));
+
+  struct t_func *tp = rx->prob_t;
+  for (int i = 0; i < n_changes; i++, tp = tp->next) {
+    table[i] = *tp;
+    table[i].next = (i + 1 < n_changes) ? &table[i + 1] : NULL;
+  }
+  rx->prob_t = table;
+
+  rce->t = table[0].time;
+  rce->rx = rx;
+  rce->table = table;
+  if (schedule_add(rate_scheduler, rce))
+    return 1;
+
+  return 0;
+}
@@ -267,6 +267,9 @@ int mcell_set_release_site_geometry_region(
 
   rel_reg_data->n_walls_included = -1; /* Indicates uninitialized state */
   rel_reg_data->cum_area_list = NULL;
+  rel_reg_data->alias_prob = NULL;
+  rel_reg_data->alias_index = NULL;
+  rel_reg_data->voxel_map = NULL;
   rel_reg_data->wall_index = NULL;
   rel_reg_data->obj_index = NULL;
   rel_reg_data->n_objects = -1;
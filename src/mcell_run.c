@@ -40,12 +40,17 @@
 #include "viz_output.h"
 #include "volume_output.h"
 #include "diffuse.h"
+#include "react.h"
 #include "init.h"
 #include "chkpt.h"
 #include "argparse.h"
 #include "dyngeom.h"
+#include "dyngeom_prefetch.h"
 
 #include "mcell_run.h"
+#include "well_mixed.h"
+#include "phase_timing.h"
+#include "ensemble.h"
 
 // static helper functions
 static long long mcell_determine_output_frequency(MCELL_STATE *state);
@@ -124,6 +129,42 @@ void process_molecule_releases(struct volume *wrld, double not_yet) {
                          "should never happen.");
 }
 
+/***********************************************************************
+ process_rate_changes:
+
+    Apply this round's changes of time-varying reaction rates, if any.
+    Reactions are never checked for pending rate changes while the
+    iteration runs.  A reaction's event and rate table are freed after its
+    last change.
+
+ In: wrld: the world
+     not_yet: earliest time which should not yet be processed
+ Out: none.  reaction probabilities are updated.
+ ***********************************************************************/
+void process_rate_changes(struct volume *wrld, double not_yet) {
+  for (struct rate_change_event *rce = schedule_next(wrld->rate_scheduler);
+       rce != NULL || not_yet >= wrld->rate_scheduler->now;
+       rce = schedule_next(wrld->rate_scheduler)) {
+    if (rce == NULL)
+      continue;
+    update_probs(wrld, rce, not_yet);
+    if (rce->rx->prob_t != NULL) {
+      rce->t = rce->rx->prob_t->time;
+      if (schedule_add(wrld->rate_scheduler, rce))
+        mcell_allocfailed("Failed to schedule a reaction rate change.");
+    } else {
+      free(rce->table);
+      free(rce->new_probs);
+      free(rce->changed);
+      free(rce);
+    }
+  }
+  if (wrld->rate_scheduler->error)
+    mcell_internal_error("Scheduler reported an out-of-memory error while "
+                         "retrieving next scheduled rate change, but this "
+                         "should never happen.");
+}
+
 /***********************************************************************
  process_geometry_changes:
 
@@ -143,7 +184,9 @@ void process_geometry_changes(struct volume *state, double not_yet) {
 
     if (dg_time_fname == NULL)
       continue;
+    well_mixed_materialize_all(state, state->current_iterations);
     update_geometry(state, dg_time_fname);
+    reset_well_mixed_compartments(state);
   }
   if (state->dynamic_geometry_scheduler->error)
     mcell_internal_error("Scheduler reported an out-of-memory error while "
@@ -331,6 +374,9 @@ mcell_run_simulation(MCELL_STATE *world) {
     }
   }
 
+  dg_prefetch_destroy(world->dg_prefetch);
+  world->dg_prefetch = NULL;
+
   if (mcell_flush_data(world)) {
     mcell_error_nodie("Failed to flush reaction and visualization data.");
     status = 1;
@@ -346,6 +392,12 @@ mcell_run_simulation(MCELL_STATE *world) {
     status = 1;
   }
 
+  if (world->replicate_pids != NULL && wait_for_replicates(world) != 0)
+    status = 1;
+
+  /* There is nothing left to checkpoint */
+  clear_checkpoint_state(world);
+
   return status;
 }
 
@@ -361,7 +413,8 @@ mcell_run_simulation(MCELL_STATE *world) {
 MCELL_STATUS
 mcell_run_iteration(MCELL_STATE *world, long long frequency,
                     int *restarted_from_checkpoint) {
-  emergency_output_hook_enabled = 1;
+  world->emergency_output_hook_enabled = 1;
+  phase_timing_iteration(world);
 
   long long iter_report_phase = world->current_iterations % frequency;
   double not_yet = world->current_iterations + 1.0;
@@ -374,19 +427,31 @@ mcell_run_iteration(MCELL_STATE *world, long long frequency,
   if (!*restarted_from_checkpoint) {
 
     /* Change geometry if needed */
+    uint64_t t0 = phase_begin(world);
     process_geometry_changes(world, not_yet);
+    phase_end(world, PHASE_GEOMETRY, t0);
 
     /* Release molecules */
+    t0 = phase_begin(world);
     process_molecule_releases(world, not_yet);
+    phase_end(world, PHASE_RELEASES, t0);
 
     /* Produce output */
+    t0 = phase_begin(world);
     process_reaction_output(world, not_yet);
+    phase_end(world, PHASE_REACTION_OUTPUT, t0);
+    t0 = phase_begin(world);
     process_volume_output(world, not_yet);
+    if (update_load_heatmap(world))
+      mcell_error("Failed to write subvolume load output.");
+    phase_end(world, PHASE_VOLUME_OUTPUT, t0);
+    t0 = phase_begin(world);
     for (struct viz_output_block *vizblk = world->viz_blocks; vizblk != NULL;
          vizblk = vizblk->next) {
       if (vizblk->frame_data_head && update_frame_data_list(world, vizblk))
         mcell_error("Unknown error while updating frame data list.");
     }
+    phase_end(world, PHASE_VIZ_OUTPUT, t0);
 
     /* Produce iteration report */
     if (iter_report_phase == 0 &&
@@ -413,6 +478,8 @@ mcell_run_iteration(MCELL_STATE *world, long long frequency,
       }
 
       mcell_log_raw("\n");
+      if (world->mem_report)
+        mem_report_pools(mcell_get_log_file());
     }
 
     /* Check for a checkpoint on this iteration */
@@ -449,7 +516,11 @@ mcell_run_iteration(MCELL_STATE *world, long long frequency,
   // reset this flag to zero
   *restarted_from_checkpoint = 0;
 
+  process_rate_changes(world, not_yet);
+  uint64_t t_clamp = phase_begin(world);
   run_concentration_clamp(world, world->current_iterations);
+  run_well_mixed(world, world->current_iterations);
+  phase_end(world, PHASE_CLAMP, t_clamp);
 
   double next_release_time;
   if (!schedule_anticipate(world->releaser, &next_release_time))
@@ -490,6 +561,7 @@ mcell_run_iteration(MCELL_STATE *world, long long frequency,
     }
   }
 
+  release_empty_subvols(world);
   world->current_iterations++;
 
   return 0;
@@ -540,7 +612,7 @@ mcell_flush_data(MCELL_STATE *world) {
     status = make_checkpoint(world);
   }
 
-  emergency_output_hook_enabled = 0;
+  world->emergency_output_hook_enabled = 0;
   int num_errors = flush_reaction_output(world);
   if (num_errors != 0) {
     mcell_warn("%d errors occurred while flushing buffered reaction output.\n"
@@ -563,6 +635,8 @@ mcell_flush_data(MCELL_STATE *world) {
     }
   }
 
+  finish_phase_timing(world);
+
   return status;
 }
 
@@ -716,5 +790,8 @@ mcell_print_final_statistics(MCELL_STATE *world) {
               (long)difftime(t_end, world->t_start));
   }
 
+  if (world->mem_report)
+    mem_report_pools(mcell_get_log_file());
+
   return 0;
 }
@@ -65,6 +65,8 @@
 /* REGION_PRESENT set for the surface molecule when it is part of the
    SURFACE_CLASS definition and there are regions defined with this
    SURFACE_CLASS assigned */
+/* WELL_MIXED is set for volume molecules that are counted per subvolume
+   instead of being tracked individually away from walls (see -well_mixed) */
 #define ON_GRID 0x01
 #define IS_SURFACE 0x02
 #define NOT_FREE 0x03
@@ -88,6 +90,7 @@
 #define SET_MAX_STEP_LENGTH 0x80000
 #define CAN_REGION_BORDER 0x100000
 #define REGION_PRESENT 0x200000
+#define WELL_MIXED 0x400000
 
 /* Abstract Molecule Flags */
 
@@ -546,11 +549,10 @@ typedef unsigned int u_int;
 typedef unsigned long u_long;
 #endif
 
-/* Linked list used to separate molecules by species */
+/* Molecules of one species in a subvolume */
 struct per_species_list {
-  struct per_species_list *next; /* pointer to next p-s-l */
-  struct species *properties;    /* species for items in this bin */
-  struct volume_molecule *head;  /* linked list of mols */
+  struct species *properties;   /* species for items in this bin */
+  struct volume_molecule *head; /* linked list of mols */
 };
 
 /* Properties of one type of molecule or surface */
@@ -564,6 +566,12 @@ struct species {
                                  data list associated with surface class */
 
   u_int population; /* How many of this species exist? */
+  struct species **vol_partners; /* Volume species this one reacts with in
+                                    bimolecular reactions */
+  int n_vol_partners;
+  u_int *partner_bits; /* Bit set over species_id of the species that are
+                          the other one of the first two reactants of some
+                          reaction with this one (see may_react_with) */
 
   double D;               /* Diffusion constant */
   double space_step;      /* Characteristic step length */
@@ -614,7 +622,8 @@ struct rxn {
                            overflow? */
 
   struct t_func *
-  prob_t; /* List of probabilities changing over time, by pathway */
+  prob_t; /* Pending probabilities changing over time, by pathway.  Applied
+             by process_rate_changes, never in the middle of an iteration */
 
   struct pathway *pathway_head; /* List of pathways built at parse-time */
   struct pathway_info *info;    /* Counts and names for each pathway */
@@ -672,13 +681,14 @@ struct t_func {
   int path;     /* Which rxn pathway is this for? */
 };
 
-// Used for dynamic geometry.
-struct molecule_info {
-  struct abstract_molecule *molecule;
-  struct string_buffer *reg_names;   /* Region names */
-  struct string_buffer *mesh_names;  /* Mesh names that molec is nested in */
-  struct vector3 pos;                /* Position in space */
-  short orient;                      /* Which way do we point? */
+/* Next rate change of a reaction with time-varying rates */
+struct rate_change_event {
+  struct rate_change_event *next;
+  double t;       /* Iteration in which rx->prob_t takes effect */
+  struct rxn *rx; /* Reaction whose rates change */
+  struct t_func *table; /* All rate changes of rx (rx->prob_t points into it) */
+  double *new_probs;    /* Scratch: probability set for each pathway */
+  byte *changed;        /* Scratch: which pathways new_probs holds */
 };
 
 /* periodic_image tracks the periodic box a molecule is in in the presence
@@ -693,40 +703,59 @@ struct periodic_image {
 
 /* Abstract structure that starts all molecule structures */
 /* Used to make C structs act like C++ objects */
+/* The layout is kept compact since the largest runs hold hundreds of millions
+ * of molecules: the periodic image is stored inline next to the flags, and
+ * volume molecules do not store their allocator (see molecule_storage). */
 struct abstract_molecule {
   struct abstract_molecule *next; /* Next molecule in scheduling queue */
   double t;                      /* Scheduling time. */
   double t2;                     /* Time of next unimolecular reaction */
   short flags; /* Abstract Molecule Flags: Who am I, what am I doing, etc. */
+  struct periodic_image periodic_box; /* Periodic box the molecule is in */
   struct species *properties;       /* What type of molecule are we? */
-  struct mem_helper *birthplace;    /* What was I allocated from? */
   double birthday;                  /* Time at which this particle was born */
   u_long id;                        /* unique identifier of this molecule */
-  struct periodic_image* periodic_box;  /* track the periodic box a molecule is in */
-  char *mesh_name;                // Name of mesh that molecule is either in
-                                  // (volume molecule) or on (surface molecule)
+};
+
+// Used for dynamic geometry.
+struct molecule_info {
+  struct abstract_molecule molecule;
+  struct string_buffer *reg_names;   /* Region names (shared per wall) */
+  int mesh_ids_start;  /* Offset of the ids of the meshes molec is nested in */
+  int n_mesh_ids;      /* Number of meshes molec is nested in */
+  int mesh_id;         /* Interned id of the mesh a surface molec is on */
+  struct vector3 pos;                /* Position in space */
+  short orient;                      /* Which way do we point? */
+};
+
+/* Growable array of interned mesh ids (see intern_mesh_name) */
+struct mesh_id_pool {
+  int *ids;
+  int n_ids;
+  int max_ids;
 };
 
 /* Volume molecules: freely diffusing or fixed in solution */
+/* Fields used on every diffusion step come first; previous_wall and index
+ * are only read right after a release. The molecule always lives in the
+ * volume molecule pool of its subvolume's storage. */
 struct volume_molecule {
   struct abstract_molecule *next;
   double t;
   double t2;
   short flags;
+  struct periodic_image periodic_box;
   struct species *properties;
-  struct mem_helper *birthplace;
   double birthday;
   u_long id;
-  struct periodic_image* periodic_box;
-  char *mesh_name;                // Name of mesh that the molecule is in
   struct vector3 pos;       /* Position in space */
   struct subvolume *subvol; /* Partition we are in */
 
-  struct wall *previous_wall; /* Wall we were released from */
-  int index;                  /* Index on that wall (don't rebind) */
-
   struct volume_molecule **prev_v; /* Previous molecule in this subvolume */
   struct volume_molecule *next_v;  /* Next molecule in this subvolume */
+
+  struct wall *previous_wall; /* Wall we were released from */
+  int index;                  /* Index on that wall (don't rebind) */
 };
 
 /* Fixed molecule on a grid on a surface */
@@ -735,12 +764,11 @@ struct surface_molecule {
   double t;
   double t2;
   short flags;
+  struct periodic_image periodic_box;
   struct species *properties;
-  struct mem_helper *birthplace;
   double birthday;
   u_long id;
-  struct periodic_image* periodic_box;
-  char *mesh_name;                // Name of mesh that the molecule is on 
+  struct mem_helper *birthplace; /* What was I allocated from? */
   unsigned int grid_index;   /* Which gridpoint do we occupy? */
   short orient;              /* Which way do we point? */
   struct surface_grid *grid; /* Our grid (which tells us our surface) */
@@ -836,9 +864,15 @@ struct surface_grid {
   u_int n_occupied; /* Number of tiles occupied by surface_molecules */
   /* Array of pointers to surface_molecule_list for each tile */
   struct surface_molecule_list **sm_list; 
+  /* One bit per tile, set if sm_list holds a molecule there. Keep it in
+     sync with update_tile_occupancy() whenever sm_list changes. */
+  struct bit_array *occupancy;
 
   struct subvolume *subvol; /* Best match for which subvolume we're in */
   struct wall *surface;     /* The wall that we are in */
+
+  /* Cached neighbor tiles of each tile (see grid_util.h), or NULL */
+  struct tile_adjacency *adjacency;
 };
 
 /* 3D vector of integers */
@@ -872,6 +906,7 @@ struct storage {
   struct mem_helper *regl;     /* Region lists */
   struct mem_helper *exdv; /* Vertex lists for exact interaction disk area */
   struct mem_helper *pslv; /* Per-species-lists for vol mols */
+  struct scratch_arena *scratch; /* Temporary lists, emptied per molecule */
 
   struct wall *wall_head; /* Locally stored walls */
   int wall_count;         /* How many local walls? */
@@ -880,6 +915,9 @@ struct storage {
   struct schedule_helper *timer; /* Local scheduler */
   double current_time;           /* Local time */
   double max_timestep;           /* Local maximum timestep */
+
+  struct subvolume *free_subvols; /* Released records of subvolumes in this
+                                     storage (see release_empty_subvols) */
 };
 
 /* Linked list of storage areas. */
@@ -892,17 +930,33 @@ struct storage_list {
 struct subvolume {
   struct wall_list *wall_head; /* Head of linked list of intersecting walls */
 
-  struct pointer_hash mol_by_species; /* table of species->molecule list */
-  struct per_species_list *species_head;
+  struct per_species_list **species_lists; /* Molecules by species, sorted
+                                              by species_id */
+  int n_species_lists;   /* Lists in species_lists; empty lists are
+                            dropped when a scan comes across them */
+  int max_species_lists; /* Allocated length of species_lists */
   int mol_count; /* How many molecules are here? */
+  int index;     /* Position in world->subvol (-1 for the empty sentinel) */
 
   struct int3D llf; /* Indices of left lower front corner */
   struct int3D urb; /* Indices of upper right back corner */
 
   short world_edge; /* Direction Bit Flags that are set for SSVs at edge of
                        world */
+  double wall_clearance; /* Lower bound on the distance from this subvolume
+                            to walls that do not intersect it */
 
   struct storage *local_storage; /* Local memory and scheduler */
+  struct subvolume *next; /* Next record in world->used_subvols, or in the
+                             free_subvols of its storage once released */
+};
+
+/* Work done in a spatial subvolume, indexed like world->subvol */
+struct subvolume_load {
+  long long diffusion_steps; /* Molecules that started a step here */
+  long long wall_collisions; /* collide_wall calls while ray tracing */
+  long long mol_candidates;  /* Molecules scanned for reaction partners */
+  long long reactions;       /* Reactions of molecules here */
 };
 
 /* Count data specific to named reaction pathways */
@@ -991,8 +1045,13 @@ struct volume {
   // These are only used with dynamic geometry
   struct dyngeom_parse_vars *dg_parse;
   char *dynamic_geometry_filename;
-  struct molecule_info **all_molecules;
+  struct molecule_info *all_molecules;
   int num_all_molecules;
+  struct mesh_id_pool all_mesh_ids; /* Nesting of all saved volume molecs */
+  struct pointer_hash *all_reg_names; /* Region names of saved surface
+                                         molecules, keyed by wall */
+  struct sym_table_head *mesh_id_table; /* Mesh names -> small integer ids */
+  int n_mesh_ids;
   struct string_buffer *names_to_ignore;
 
   /* Coarse partitions are input by the user */
@@ -1024,8 +1083,20 @@ struct volume {
                                  information */
   byte place_waypoints_flag; /* Used to save memory if waypoints not needed */
 
-  int n_subvols;            /* How many coarse subvolumes? */
-  struct subvolume *subvol; /* Array containing all subvolumes */
+  struct wall_bvh_index *wall_bvhs; /* Per-object wall hierarchies for
+                                       point-in-region queries (built on
+                                       first use, see region_query.c) */
+
+  int n_subvols;             /* How many coarse subvolumes? */
+  struct subvolume **subvol; /* All subvolumes, indexed by position.  Ones
+                                that never held a wall or a molecule point
+                                at empty_subvol (see get_subvol) */
+  struct subvolume empty_subvol; /* Shared by all unused subvolumes */
+  struct mem_helper *subvol_mem; /* Records of the subvolumes in use */
+  struct subvolume *used_subvols; /* Records without walls, checked by
+                                     release_empty_subvols */
+  struct storage **storage_grid; /* Storages by memory partition */
+  double *subvol_clearance;      /* wall_clearance of every subvolume */
 
   int n_walls;                  /* Total number of walls */
   int n_verts;                  /* Total number of vertices */
@@ -1064,7 +1135,12 @@ struct volume {
 
   // Scheduler for dynamic geometry
   struct schedule_helper *dynamic_geometry_scheduler;
+
+  // If set, geometry files are read ahead of time by a helper thread
+  byte dynamic_geometry_prefetch;
+  struct dg_prefetch *dg_prefetch;
   struct schedule_helper *releaser; /* Scheduler for release events */
+  struct schedule_helper *rate_scheduler; /* Scheduler for rate changes */
 
   struct mem_helper *storage_allocator; /* Memory for storage list */
   struct storage_list *storage_head;    /* Linked list of all local
@@ -1212,6 +1288,7 @@ struct volume {
   struct mem_helper *sp_coll_mem;  /* Collision list (trimol) */
   struct mem_helper *tri_coll_mem; /* Collision list (trimol) */
   struct mem_helper *exdv_mem; // Vertex lists for exact interaction disk area
+  struct scratch_arena *scratch_mem; // Temporary lists (see mem_util.h)
 
   /* Current version number. Format is "3.XX.YY" where XX is major release
    * number (for new features) and YY is minor release number (for patches) */
@@ -1219,6 +1296,20 @@ struct volume {
 
   int use_expanded_list; /* If set, check neighboring subvolumes for mol-mol
                             interactions */
+  double exd_cache_tolerance; /* If nonzero, reuse exact disk areas within
+                                 this fraction of the interaction radius */
+  struct exd_cache *exd_cache; /* Cached exact disk areas (see diffuse.c) */
+  struct name_list *well_mixed_names; /* Species given with -well_mixed */
+  struct well_mixed_data *well_mixed; /* Per-subvolume counts of well-mixed
+                                         species (see well_mixed.c) */
+  char *phase_timing_file;      /* Per-phase timing output (-phase_timing) */
+  long long phase_timing_window; /* Iterations per row of phase timing */
+  struct phase_timing *phase_timing; /* Phase timers, or NULL if disabled */
+  char *load_heatmap_prefix;    /* Subvolume load output (-load_heatmap) */
+  long long load_heatmap_step;  /* Iterations between load outputs */
+  struct subvolume_load *subvol_load; /* Work done in each subvolume since
+                                         the last load output, or NULL */
+  byte mem_report; /* Report memory pools with the iteration report */
   int randomize_smol_pos; /* If set, always place surface molecule at random
                              location instead of center of grid */
   double vacancy_search_dist2; /* Square of distance to search for free grid
@@ -1236,6 +1327,8 @@ struct volume {
 
   /* MCell startup command line arguments */
   u_int seed_seq;         /* Seed for random number generator */
+  int n_replicates;       /* Copies run with consecutive seeds (-replicates) */
+  pid_t *replicate_pids;  /* Processes running the other replicates, or NULL */
   long long iterations;   /* How many iterations to run */
   unsigned long log_freq; /* Interval between simulation progress reports,
                              default scales as sqrt(iterations) */
@@ -1249,6 +1342,9 @@ struct volume {
                                         molecule concentrations should be
                                         clamped */
 
+  /* Flush reaction output from the emergency hooks if we die now */
+  byte emergency_output_hook_enabled;
+
   /* Flags for asynchronously-triggered checkpoints */
 
   /* Flag indicating whether a checkpoint has been requested. */
@@ -1260,6 +1356,8 @@ struct volume {
   last_checkpoint_iteration;  /* Last iteration when chkpt was created */
   time_t begin_timestamp;     /* Time since epoch at beginning of 'main' */
   char *initialization_state; /* NULL after initialization completes */
+  struct volume *next_chkpt_world; /* Next simulation reached by checkpoint
+                                      signals (see set_checkpoint_state) */
   struct reaction_flags rxn_flags;
   /* shared walls information per mesh vertex is created when there are
      reactions present with more than one surface reactant or more than one
@@ -1303,6 +1401,26 @@ struct sp_collision {
   struct vector3 loc;  /* Location of impact */
 };
 
+/* Collisions found along one ray, sorted by time.  The first
+   COLLISION_BUFFER_INLINE of them live in the buffer itself, which normally
+   sits on the stack of the diffusing routine; any further ones come from
+   the spill pool. */
+#define COLLISION_BUFFER_INLINE 8
+
+struct collision_buffer {
+  struct collision *head;   /* Collisions, earliest first */
+  struct mem_helper *spill; /* Pool for collisions past the inline ones */
+  int n_coll;               /* Number of collisions handed out */
+  struct collision inline_coll[COLLISION_BUFFER_INLINE];
+};
+
+struct sp_collision_buffer {
+  struct sp_collision *head; /* Collisions, earliest first */
+  struct mem_helper *spill;  /* Pool for collisions past the inline ones */
+  int n_coll;                /* Number of collisions handed out */
+  struct sp_collision inline_coll[COLLISION_BUFFER_INLINE];
+};
+
 /* Data structure to store information about trimolecular and bimolecular
    collisions. */
 struct tri_collision {
@@ -1405,6 +1523,11 @@ struct release_region_data {
 
   int n_walls_included;  /* How many walls total */
   double *cum_area_list; /* Cumulative area of all walls */
+  double *alias_prob;    /* Alias table over the walls, weighted by area */
+  int *alias_index;      /* (see build_alias_table) */
+
+  struct release_voxel_map *voxel_map; /* Voxelized 3D release region (built
+                                          on first release) */
   int *wall_index;       /* Indices of each wall (by object) */
   int *obj_index;        /* Indices for objects (in owners array) */
 
@@ -1420,6 +1543,18 @@ struct release_region_data {
                                            release site */
 };
 
+/* Voxelization of the bounding box of a 3D release region. Voxels which lie
+ * entirely inside the region can take a release without any further test,
+ * voxels which lie entirely outside it are never sampled. */
+struct release_voxel_map {
+  struct vector3 llf;        /* Corner of the first voxel */
+  struct vector3 voxel_size; /* Edge lengths of a voxel */
+  int nx, ny, nz;            /* Number of voxels along each axis */
+  int n_inside;     /* Number of voxels entirely inside the region */
+  int n_candidates; /* Number of voxels inside or on the region boundary */
+  int *candidates;  /* Voxel indices, the n_inside interior ones first */
+};
+
 /* Data structure used to build boolean combinations of regions */
 struct release_evaluator {
   byte op;    /* Region Expression Flags: the operation used */
@@ -1780,6 +1915,10 @@ struct object {
   short is_closed;              /* Flag that describes the geometry
                                    of the polygon object (e.g. for sphere
                                    is_closed = 1 and for plane is 0) */
+  int mesh_id; /* Interned id of the object name used by dynamic geometry
+                  (0 until first looked up) */
+  struct wall_bvh *wall_bvh; /* Bounding volume hierarchy over the walls
+                                (built on first use, owned by wall_bvhs) */
 
   bool periodic_x; // This flag only applies to box objects BOX_OBJ. If set
   bool periodic_y; // any volume molecules encountering the box surface in the x,
@@ -28,14 +28,16 @@
   #include "mcell_release.h"
   #include "mcell_objects.h"
   #include "mcell_dyngeom.h"
+  #include "dyngeom_prefetch.h"
 
   /* make sure to declare yyscan_t before including mdlparse.h */
+  #define YY_TYPEDEF_YY_SCANNER_T
   typedef void *yyscan_t;
   #include "mdlparse.h"
 
-  int mdllex_init(yyscan_t *ptr_yy_globals) ;
-  int mdllex_destroy(yyscan_t yyscanner);
-  void mdlrestart(FILE *infile, yyscan_t scanner);
+  /* mdllex.h only declares the default mdllex() unless YY_DECL is set */
+  #define YY_DECL int mdllex(YYSTYPE *yylval, struct mdlparse_vars *parse_state, yyscan_t yyscanner)
+  #include "mdllex.h"
   int mdllex(YYSTYPE *yylval, struct mdlparse_vars *parse_state, yyscan_t scanner);
 
 
@@ -2514,9 +2516,11 @@ int mdlparse_file(struct mdlparse_vars *parse_state, char const *name)
 {
   int failure;
   int cur_stack = parse_state->include_stack_ptr ++;
-  FILE *infile;
+  FILE *infile = NULL;
   yyscan_t scanner;
   char const *prev_file;
+  char *prefetched = NULL;
+  size_t prefetched_size = 0;
 
   /* Put filename and line number on stack */
   if (cur_stack >= MAX_INCLUDE_DEPTH)
@@ -2533,7 +2537,16 @@ int mdlparse_file(struct mdlparse_vars *parse_state, char const *name)
 
   /* Open file, or know the reason why */
   no_printf("Opening file %s\n", name);
-  if ((infile = fopen(name,"r")) == NULL)
+  /* Geometry files for dynamic geometry may already have been read */
+  if (parse_state->vol->dg_prefetch != NULL &&
+      dg_prefetch_take(parse_state->vol->dg_prefetch, name, &prefetched,
+                       &prefetched_size) == 0 &&
+      prefetched_size >= INT_MAX)
+  {
+    free(prefetched);
+    prefetched = NULL;
+  }
+  if (prefetched == NULL && (infile = fopen(name,"r")) == NULL)
   {
     char *err = mcell_strerror(errno);
     -- parse_state->include_stack_ptr;
@@ -2566,11 +2579,20 @@ int mdlparse_file(struct mdlparse_vars *parse_state, char const *name)
                    name,
                    parse_state->include_filename[cur_stack-1],
                    parse_state->line_num[cur_stack-1]);
-    fclose(infile);
+    if (infile != NULL)
+      fclose(infile);
+    free(prefetched);
     -- parse_state->include_stack_ptr;
     return 1;
   }
-  mdlrestart(infile, scanner);
+  if (prefetched != NULL)
+  {
+    /* The lexer keeps its own copy of the bytes */
+    mdl_scan_bytes(prefetched, prefetched_size, scanner);
+    free(prefetched);
+  }
+  else
+    mdlrestart(infile, scanner);
 
   /* Parse this file */
   prev_file = parse_state->vol->curr_file;
@@ -2580,7 +2602,8 @@ int mdlparse_file(struct mdlparse_vars *parse_state, char const *name)
   -- parse_state->include_stack_ptr;
 
   /* Clean up! */
-  fclose(infile);
+  if (infile != NULL)
+    fclose(infile);
   mdllex_destroy(scanner);
 
   return failure;
@@ -1425,7 +1425,13 @@ int mdl_fprint_time(struct mdlparse_vars *parse_state,
   struct file_stream *filep = (struct file_stream *)filep_sym->value;
 
   the_time = time(NULL);
-  strftime(time_str, 128, fmt, localtime(&the_time));
+  struct tm the_tm;
+#ifdef _WIN32
+  localtime_s(&the_tm, &the_time);
+#else
+  localtime_r(&the_time, &the_tm);
+#endif
+  strftime(time_str, 128, fmt, &the_tm);
   free(fmt);
   if (fprintf(filep->stream, "%s", time_str) == EOF) {
     mdlerror_fmt(parse_state, "Could not print to file: %s", filep_sym->name);
@@ -1447,7 +1453,13 @@ int mdl_fprint_time(struct mdlparse_vars *parse_state,
 void mdl_print_time(struct mdlparse_vars *parse_state, char *fmt) {
   char time_str[128];
   time_t the_time = time(NULL);
-  strftime(time_str, 128, fmt, localtime(&the_time));
+  struct tm the_tm;
+#ifdef _WIN32
+  localtime_s(&the_tm, &the_time);
+#else
+  localtime_r(&the_time, &the_tm);
+#endif
+  strftime(time_str, 128, fmt, &the_tm);
   free(fmt);
   if (parse_state->vol->procnum == 0)
     fprintf(mcell_get_log_file(), "%s", time_str);
@@ -3392,6 +3404,9 @@ duplicate_release_site(struct mdlparse_vars *parse_state,
            sizeof(struct vector3));
     rel_reg_data->n_walls_included = -1;
     rel_reg_data->cum_area_list = NULL;
+    rel_reg_data->alias_prob = NULL;
+    rel_reg_data->alias_index = NULL;
+    rel_reg_data->voxel_map = NULL;
     rel_reg_data->wall_index = NULL;
     rel_reg_data->obj_index = NULL;
     rel_reg_data->n_objects = -1;
@@ -4852,6 +4867,9 @@ mdl_set_release_site_geometry_object(struct mdlparse_vars *parse_state,
 
   rel_reg_data->n_walls_included = -1; /* Indicates uninitialized state */
   rel_reg_data->cum_area_list = NULL;
+  rel_reg_data->alias_prob = NULL;
+  rel_reg_data->alias_index = NULL;
+  rel_reg_data->voxel_map = NULL;
   rel_reg_data->wall_index = NULL;
   rel_reg_data->obj_index = NULL;
   rel_reg_data->n_objects = -1;
@@ -57,7 +57,7 @@
 #endif
 
 #ifdef DEBUG
-int howmany_count_malloc = 0;
+static _Thread_local int howmany_count_malloc = 0;
 
 void catch_me() {
   printf("Allocating unreasonably many memory blocks--what are you doing?!\n");
@@ -77,6 +77,96 @@ void *count_malloc(size_t n) {
 }
 #endif
 
+/*************************************************************************
+ * Pool accounting
+ *
+ * Always kept, unlike the detailed MEM_UTIL_KEEP_STATS statistics: one
+ * record per pool name and record size, updated with a few integer
+ * operations in mem_get and mem_put.  Like those statistics, the records
+ * are kept per thread, so simulations running side by side report
+ * separately.
+ *************************************************************************/
+
+struct mem_pool_stats {
+  struct mem_pool_stats *next;
+  char const *name;   /* Pool name, or NULL for unnamed pools */
+  size_t record_size; /* Size of one record */
+  long long live;     /* Records handed out and not returned */
+  long long peak_live;
+  long long arenas;   /* Arenas currently allocated */
+  long long bytes;    /* Bytes held by those arenas */
+  long long peak_bytes;
+};
+
+static _Thread_local struct mem_pool_stats *mem_pool_root = NULL;
+static _Thread_local long long mem_pool_bytes = 0; /* Sum over all pools */
+static _Thread_local long long mem_pool_peak_bytes = 0;
+
+/* Allocations through the checked malloc helpers.  Their memory is released
+   with plain free(), so only the totals requested are known. */
+static _Thread_local long long mem_heap_calls = 0;
+static _Thread_local long long mem_heap_bytes = 0;
+
+static struct mem_pool_stats *get_pool_stats(char const *name,
+                                             size_t record_size) {
+  struct mem_pool_stats *ps;
+  for (ps = mem_pool_root; ps != NULL; ps = ps->next) {
+    if (ps->record_size != record_size)
+      continue;
+    if (name == NULL ? ps->name == NULL
+                     : (ps->name != NULL && strcmp(name, ps->name) == 0))
+      return ps;
+  }
+
+  ps = (struct mem_pool_stats *)malloc(sizeof(struct mem_pool_stats));
+  if (ps == NULL)
+    return NULL;
+  memset(ps, 0, sizeof(struct mem_pool_stats));
+  ps->name = name;
+  ps->record_size = record_size;
+  ps->next = mem_pool_root;
+  mem_pool_root = ps;
+  return ps;
+}
+
+static void pool_arena_added(struct mem_pool_stats *ps, long long bytes) {
+  ++ps->arenas;
+  if ((ps->bytes += bytes) > ps->peak_bytes)
+    ps->peak_bytes = ps->bytes;
+  if ((mem_pool_bytes += bytes) > mem_pool_peak_bytes)
+    mem_pool_peak_bytes = mem_pool_bytes;
+}
+
+static inline void pool_record_taken(struct mem_pool_stats *ps) {
+  if (++ps->live > ps->peak_live)
+    ps->peak_live = ps->live;
+}
+
+/*************************************************************************
+mem_report_pools:
+   In: file to write to
+   Out: No return value.  Writes the live and peak records and bytes of
+        every pool that has been used by this thread, and the total of the
+        checked heap allocations.
+*************************************************************************/
+void mem_report_pools(FILE *out) {
+  fprintf(out, "Memory pools:\n");
+  fprintf(out, "  %-32s %6s %12s %12s %8s %14s %14s\n", "pool", "size",
+          "live", "peak live", "arenas", "bytes", "peak bytes");
+  for (struct mem_pool_stats *ps = mem_pool_root; ps != NULL; ps = ps->next) {
+    if (ps->arenas == 0 && ps->peak_live == 0)
+      continue;
+    fprintf(out, "  %-32s %6zu %12lld %12lld %8lld %14lld %14lld\n",
+            (ps->name != NULL) ? ps->name : "(unnamed)", ps->record_size,
+            ps->live, ps->peak_live, ps->arenas, ps->bytes, ps->peak_bytes);
+  }
+  fprintf(out, "  %-32s %6s %12s %12s %8s %14lld %14lld\n", "total", "", "",
+          "", "", mem_pool_bytes, mem_pool_peak_bytes);
+  fprintf(out, "  checked heap allocations: %lld calls, %lld bytes requested\n",
+          mem_heap_calls, mem_heap_bytes);
+  fflush(out);
+}
+
 /*************************************************************************
  * Checked malloc helpers
  *************************************************************************/
@@ -100,6 +190,7 @@ static void memalloc_failure(char const *file, unsigned int line,
     mcell_error_nodie("Failed to allocate %u bytes.", size);
 #endif
 
+  mem_report_pools(mcell_get_error_file());
   if (onfailure & CM_EXIT)
     mcell_error("Out of memory.\n"); /* extra newline */
   else
@@ -112,6 +203,8 @@ char *checked_strdup(char const *s, char const *file, unsigned int line,
     return NULL;
 
   char *data = strdup(s);
+  ++mem_heap_calls;
+  mem_heap_bytes += 1 + strlen(s);
   if (data == NULL)
     memalloc_failure(file, line, 1 + strlen(s), desc, onfailure);
   return data;
@@ -120,6 +213,8 @@ char *checked_strdup(char const *s, char const *file, unsigned int line,
 void *checked_malloc(size_t size, char const *file, unsigned int line,
                      char const *desc, int onfailure) {
   void *data = malloc(size);
+  ++mem_heap_calls;
+  mem_heap_bytes += size;
   if (data == NULL)
     memalloc_failure(file, line, size, desc, onfailure);
   return data;
@@ -132,6 +227,9 @@ char *checked_alloc_sprintf(char const *file, unsigned int line, int onfailure,
   va_copy(saved_args, args);
 
   char *data = alloc_vsprintf(fmt, args);
+  ++mem_heap_calls;
+  if (data != NULL)
+    mem_heap_bytes += 1 + strlen(data);
   if (data == NULL) {
     int needlen = vsnprintf(NULL, 0, fmt, saved_args);
     memalloc_failure(file, line, needlen + 1, "formatted string", onfailure);
@@ -174,17 +272,18 @@ struct mem_stats {
   long long int max_alloc;
 };
 
-static struct mem_stats *mem_stats_root = NULL;
-static long long int mem_stats_cur_mallocs = 0;
-static long long int mem_stats_cur_malloc_space = 0;
-static long long int mem_stats_max_mallocs = 0;
-static long long int mem_stats_max_malloc_space = 0;
-static long long mem_stats_total_mallocs = 0;
+/* Kept per thread, so simulations running side by side report separately */
+static _Thread_local struct mem_stats *mem_stats_root = NULL;
+static _Thread_local long long int mem_stats_cur_mallocs = 0;
+static _Thread_local long long int mem_stats_cur_malloc_space = 0;
+static _Thread_local long long int mem_stats_max_mallocs = 0;
+static _Thread_local long long int mem_stats_max_malloc_space = 0;
+static _Thread_local long long mem_stats_total_mallocs = 0;
 
-static long long int mem_cur_overall_allocation = 0;
-static long long int mem_max_overall_allocation = 0;
-static long long int mem_cur_overall_wastage = 0;
-static long long int mem_max_overall_wastage = 0;
+static _Thread_local long long int mem_cur_overall_allocation = 0;
+static _Thread_local long long int mem_max_overall_allocation = 0;
+static _Thread_local long long int mem_cur_overall_wastage = 0;
+static _Thread_local long long int mem_max_overall_wastage = 0;
 
 void *mem_util_tracking_malloc(size_t size) {
   unsigned char *bl = (unsigned char *)malloc(size + 16);
@@ -335,6 +434,11 @@ struct mem_helper *create_mem_named(size_t size, int length, char const *name) {
   mh->buf_index = 0;
   mh->defunct = NULL;
   mh->next_helper = NULL;
+  mh->pool = get_pool_stats(name, mh->record_size);
+  if (mh->pool == NULL) {
+    free(mh);
+    return NULL;
+  }
 
 #ifndef MEM_UTIL_NO_POOLING
 #ifdef MEM_UTIL_TRACK_FREED
@@ -349,6 +453,7 @@ struct mem_helper *create_mem_named(size_t size, int length, char const *name) {
     free(mh);
     return NULL;
   }
+  pool_arena_added(mh->pool, (long long)(mh->buf_len * mh->record_size));
 #else
   mh->heap_array = NULL;
 #endif
@@ -393,12 +498,14 @@ mem_get:
 
 void *mem_get(struct mem_helper *mh) {
 #ifdef MEM_UTIL_NO_POOLING
+  pool_record_taken(mh->pool);
   return malloc(mh->record_size);
 #else
   if (mh->defunct != NULL) {
     struct abstract_list *retval;
     retval = mh->defunct;
     mh->defunct = retval->next;
+    pool_record_taken(mh->pool);
 #ifdef MEM_UTIL_KEEP_STATS
     struct mem_stats *s = mh->stats;
     --s->cur_free;
@@ -443,6 +550,7 @@ void *mem_get(struct mem_helper *mh) {
     size_t offset = mh->buf_index * mh->record_size;
 #endif
     mh->buf_index++;
+    pool_record_taken(mh->pool);
 #ifdef MEM_UTIL_KEEP_STATS
     struct mem_stats *s = mh->stats;
     --s->cur_free;
@@ -476,7 +584,7 @@ void *mem_get(struct mem_helper *mh) {
       s->max_non_head_arenas = s->non_head_arenas;
     ++s->total_non_head_arenas;
 #else
-    mhnext = create_mem(mh->record_size, mh->buf_len);
+    mhnext = create_mem_named(mh->record_size, mh->buf_len, mh->pool->name);
 #endif
     if (mhnext == NULL)
       return NULL;
@@ -506,6 +614,7 @@ mem_put:
 *************************************************************************/
 
 void mem_put(struct mem_helper *mh, void *defunct) {
+  --mh->pool->live;
 #ifdef MEM_UTIL_NO_POOLING
   free(defunct);
   return;
@@ -554,6 +663,7 @@ void mem_put_list(struct mem_helper *mh, void *defunct) {
   struct abstract_list *alpNext;
   for (alp = data; alp != NULL; alp = alpNext) {
     alpNext = alp->next;
+    --mh->pool->live;
     free(alp);
   }
 #else
@@ -574,10 +684,11 @@ void mem_put_list(struct mem_helper *mh, void *defunct) {
     ptr[-1] = 0;
   }
 #endif
-#ifdef MEM_UTIL_KEEP_STATS
   int count = 1;
   for (alp = data; alp->next != NULL; alp = alp->next)
     ++count;
+  mh->pool->live -= count;
+#ifdef MEM_UTIL_KEEP_STATS
   struct mem_stats *s = mh->stats;
   s->cur_free += count;
   s->cur_alloc -= count;
@@ -587,9 +698,6 @@ void mem_put_list(struct mem_helper *mh, void *defunct) {
   if ((mem_cur_overall_wastage += mh->record_size * count) >
       mem_max_overall_wastage)
     mem_max_overall_wastage = mem_cur_overall_wastage;
-#else
-  for (alp = data; alp->next != NULL; alp = alp->next) {
-  }
 #endif
 
   alp->next = mh->defunct;
@@ -609,6 +717,15 @@ void delete_mem(struct mem_helper *mh) {
   if (mh == NULL)
     return;
 #ifndef MEM_UTIL_NO_POOLING
+  /* Records handed out from this arena and not returned die with it */
+  long long n_free = 0;
+  for (struct abstract_list *alp = mh->defunct; alp != NULL; alp = alp->next)
+    ++n_free;
+  struct mem_pool_stats *ps = mh->pool;
+  ps->live -= mh->buf_index - n_free;
+  --ps->arenas;
+  ps->bytes -= (long long)(mh->buf_len * mh->record_size);
+  mem_pool_bytes -= (long long)(mh->buf_len * mh->record_size);
 #ifdef MEM_UTIL_KEEP_STATS
   struct mem_stats *s = mh->stats;
   --s->num_arenas_unfreed;
@@ -629,3 +746,123 @@ void delete_mem(struct mem_helper *mh) {
 #endif
   free(mh);
 }
+
+/**************************************************************************\
+ ** scratch section: bump allocation of temporary lists that all die at   **
+ **   the same time. Chunks are never returned to the heap until the      **
+ **   arena is deleted, so after warm-up no allocator calls are made.     **
+\**************************************************************************/
+
+struct scratch_chunk {
+  struct scratch_chunk *next;
+  size_t size;
+  /* Chunk data runs off the end of this struct */
+};
+
+/* Round everything up so any struct can be placed in the arena */
+#define SCRATCH_ALIGN (2 * sizeof(void *))
+#define SCRATCH_ROUND(n) (((n) + SCRATCH_ALIGN - 1) & ~(SCRATCH_ALIGN - 1))
+
+static unsigned char *scratch_data(struct scratch_chunk *c) {
+  return (unsigned char *)c + SCRATCH_ROUND(sizeof(struct scratch_chunk));
+}
+
+static struct scratch_chunk *new_scratch_chunk(size_t size) {
+  struct scratch_chunk *c = (struct scratch_chunk *)Malloc(
+      SCRATCH_ROUND(sizeof(struct scratch_chunk)) + size);
+  if (c == NULL)
+    mcell_allocfailed("Failed to allocate scratch memory.");
+  c->next = NULL;
+  c->size = size;
+  return c;
+}
+
+/*************************************************************************
+create_scratch_arena:
+   In: Number of bytes to grab from the heap at a time
+   Out: Pointer to a new, empty scratch arena.
+*************************************************************************/
+struct scratch_arena *create_scratch_arena(size_t chunk_size) {
+  struct scratch_arena *sa =
+      (struct scratch_arena *)Malloc(sizeof(struct scratch_arena));
+  if (sa == NULL)
+    return NULL;
+
+  sa->chunk_size = SCRATCH_ROUND(chunk_size);
+  sa->first = sa->cur = new_scratch_chunk(sa->chunk_size);
+  sa->used = 0;
+  return sa;
+}
+
+/*************************************************************************
+scratch_get:
+   In: A scratch arena
+       Number of bytes wanted
+   Out: Pointer to the storage. It stays valid until the arena is reset or
+        released to a mark taken before this call.
+*************************************************************************/
+void *scratch_get(struct scratch_arena *sa, size_t size) {
+  size = SCRATCH_ROUND(size);
+
+  while (sa->used + size > sa->cur->size) {
+    struct scratch_chunk *next = sa->cur->next;
+    if (next == NULL || next->size < size) {
+      /* Splice a new chunk in after the current one */
+      struct scratch_chunk *c =
+          new_scratch_chunk(size > sa->chunk_size ? size : sa->chunk_size);
+      c->next = next;
+      sa->cur->next = c;
+      next = c;
+    }
+    sa->cur = next;
+    sa->used = 0;
+  }
+
+  void *data = scratch_data(sa->cur) + sa->used;
+  sa->used += size;
+  return data;
+}
+
+/*************************************************************************
+scratch_mark, scratch_release:
+   In: A scratch arena (and a mark taken earlier from the same arena)
+   Out: The current fill level of the arena, or everything allocated since
+        the mark is handed back.
+*************************************************************************/
+struct scratch_mark scratch_mark(struct scratch_arena *sa) {
+  struct scratch_mark mark = { sa->cur, sa->used };
+  return mark;
+}
+
+void scratch_release(struct scratch_arena *sa, struct scratch_mark mark) {
+  sa->cur = mark.chunk;
+  sa->used = mark.used;
+}
+
+/*************************************************************************
+scratch_reset:
+   In: A scratch arena
+   Out: Everything allocated from the arena is handed back.
+*************************************************************************/
+void scratch_reset(struct scratch_arena *sa) {
+  sa->cur = sa->first;
+  sa->used = 0;
+}
+
+/*************************************************************************
+delete_scratch_arena:
+   In: A scratch arena
+   Out: The arena and all of its chunks are freed.
+*************************************************************************/
+void delete_scratch_arena(struct scratch_arena *sa) {
+  if (sa == NULL)
+    return;
+
+  struct scratch_chunk *c = sa->first;
+  while (c != NULL) {
+    struct scratch_chunk *next = c->next;
+    free(c);
+    c = next;
+  }
+  free(sa);
+}
@@ -23,9 +23,10 @@
 
 #pragma once
 
-#ifdef MEM_UTIL_KEEP_STATS
 #include <stdio.h>
 #include <stdlib.h>
+
+#ifdef MEM_UTIL_KEEP_STATS
 char *mem_util_tracking_strdup(char const *in);
 void *mem_util_tracking_malloc(unsigned int size);
 void *mem_util_tracking_realloc(void *data, unsigned int size);
@@ -82,6 +83,10 @@ struct abstract_list {
   struct abstract_list *next;
 };
 
+/* Accounting shared by all mem_helpers with the same name and record size
+   (see mem_report_pools) */
+struct mem_pool_stats;
+
 /* Data structure to allocate blocks of memory for a specific size of struct */
 struct mem_helper {
   int buf_len;               /* Number of elements to allocate at once  */
@@ -91,6 +96,7 @@ struct mem_helper {
   struct abstract_list *defunct; /* Linked list of elements that may be reused
                                     for next memory request */
   struct mem_helper *next_helper; /* Next (fully-used) mem_helper */
+  struct mem_pool_stats *pool;    /* Live records, arenas and bytes */
 #ifdef MEM_UTIL_KEEP_STATS
   struct mem_stats *stats;
 #endif
@@ -104,6 +110,8 @@ void mem_dump_stats(FILE *out);
   } while (0)
 #endif
 
+void mem_report_pools(FILE *out);
+
 struct mem_helper *create_mem_named(size_t size, int length, char const *name);
 struct mem_helper *create_mem(size_t size, int length);
 void *mem_get(struct mem_helper *mh);
@@ -111,4 +119,33 @@ void mem_put(struct mem_helper *mh, void *defunct);
 void mem_put_list(struct mem_helper *mh, void *defunct);
 void delete_mem(struct mem_helper *mh);
 
+/* Bump allocator for short-lived lists built while a molecule is being
+   processed.  Nothing is freed individually: the whole arena is emptied by
+   scratch_reset() after every molecule, or back to a scratch_mark() by
+   scratch_release() in helpers that are done with their lists. */
+struct scratch_chunk;
+
+struct scratch_arena {
+  size_t chunk_size;            /* Minimum size of each chunk */
+  struct scratch_chunk *first;  /* First chunk (chunks are kept for reuse) */
+  struct scratch_chunk *cur;    /* Chunk being allocated from */
+  size_t used;                  /* Bytes used in the current chunk */
+};
+
+struct scratch_mark {
+  struct scratch_chunk *chunk;
+  size_t used;
+};
+
+struct scratch_arena *create_scratch_arena(size_t chunk_size);
+void *scratch_get(struct scratch_arena *sa, size_t size);
+struct scratch_mark scratch_mark(struct scratch_arena *sa);
+void scratch_release(struct scratch_arena *sa, struct scratch_mark mark);
+void scratch_reset(struct scratch_arena *sa);
+void delete_scratch_arena(struct scratch_arena *sa);
+
+#define SCRATCH_GET_STRUCT(sa, tp) (tp *) scratch_get((sa), sizeof(tp))
+#define SCRATCH_GET_ARRAY(sa, tp, num)                                         \
+  (tp *) scratch_get((sa), (num) * sizeof(tp))
+
 #define stack_nonempty(sh) ((sh)->index > 0 || (sh)->next != NULL)
@@ -0,0 +1,144 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logging.h"
+#include "util.h"
+#include "phase_timing.h"
+
+static char const *PHASE_NAMES[N_TIMING_PHASES] = {
+  "geometry",  "releases",    "reaction_output", "viz_output",
+  "volume_output", "clamp",   "unimolecular",    "diffuse_3D",
+  "diffuse_2D", "react_2D"
+};
+
+/*************************************************************************
+write_phase_row:
+  In: pt: phase timers
+      n_iterations: number of iterations in this row
+      now: current clock
+  Out: No return value.  One CSV row is written and the timers are reset.
+*************************************************************************/
+static void write_phase_row(struct phase_timing *pt, long long n_iterations,
+                            uint64_t now) {
+  uint64_t total = now - pt->window_clock;
+  uint64_t attributed = 0;
+
+  fprintf(pt->out, "%lld,%lld,%" PRIu64, pt->window_start, n_iterations,
+          total);
+  for (int i = 0; i < N_TIMING_PHASES; i++) {
+    fprintf(pt->out, ",%" PRIu64, pt->ticks[i]);
+    attributed += pt->ticks[i];
+  }
+  fprintf(pt->out, ",%" PRIu64 "\n", (total > attributed) ? total - attributed : 0);
+
+  memset(pt->ticks, 0, sizeof(pt->ticks));
+  pt->window_start += n_iterations;
+  pt->window_clock = now;
+}
+
+/*************************************************************************
+init_phase_timing:
+  In: world: simulation state
+  Out: Returns 1 on error, 0 on success.  If -phase_timing was given, the
+       output file is opened and the timers are started.
+*************************************************************************/
+int init_phase_timing(struct volume *world) {
+  if (world->phase_timing_file == NULL)
+    return 0;
+
+  struct phase_timing *pt = CHECKED_MALLOC_STRUCT(struct phase_timing,
+                                                  "phase timers");
+  if (pt == NULL)
+    return 1;
+  memset(pt, 0, sizeof(struct phase_timing));
+
+  if (make_parent_dir(world->phase_timing_file) ||
+      (pt->out = fopen(world->phase_timing_file, "w")) == NULL) {
+    mcell_perror_nodie(errno, "Failed to open phase timing file '%s'",
+                       world->phase_timing_file);
+    free(pt);
+    return 1;
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  fprintf(pt->out, "# clock: cycle counter ticks\n");
+#else
+  fprintf(pt->out, "# clock: nanoseconds\n");
+#endif
+  fprintf(pt->out, "iteration,iterations,total");
+  for (int i = 0; i < N_TIMING_PHASES; i++)
+    fprintf(pt->out, ",%s", PHASE_NAMES[i]);
+  fprintf(pt->out, ",other\n");
+
+  pt->window = (world->phase_timing_window > 0) ? world->phase_timing_window
+                                                : 100;
+  pt->window_start = world->start_iterations;
+  pt->window_clock = phase_clock();
+  world->phase_timing = pt;
+  return 0;
+}
+
+/*************************************************************************
+phase_timing_iteration:
+  In: world: simulation state, at the start of an iteration
+  Out: No return value.  A row is written once a window of iterations has
+       completed.
+*************************************************************************/
+void phase_timing_iteration(struct volume *world) {
+  struct phase_timing *pt = world->phase_timing;
+  if (pt == NULL)
+    return;
+
+  long long n_iterations = world->current_iterations - pt->window_start;
+  if (n_iterations >= pt->window)
+    write_phase_row(pt, n_iterations, phase_clock());
+}
+
+/*************************************************************************
+finish_phase_timing:
+  In: world: simulation state
+  Out: No return value.  The last, possibly partial, window is written and
+       the output file is closed.
+*************************************************************************/
+void finish_phase_timing(struct volume *world) {
+  struct phase_timing *pt = world->phase_timing;
+  if (pt == NULL)
+    return;
+
+  long long n_iterations = world->current_iterations - pt->window_start;
+  if (n_iterations > 0)
+    write_phase_row(pt, n_iterations, phase_clock());
+  if (fclose(pt->out) != 0)
+    mcell_warn("Failed to close phase timing file '%s'.",
+               world->phase_timing_file);
+  free(pt);
+  world->phase_timing = NULL;
+}
@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#ifndef PHASE_TIMING_H
+#define PHASE_TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "mcell_structs.h"
+
+/* Opt-in timing of the phases of the main loop (see -phase_timing).
+ *
+ * The time spent in each phase is accumulated in cycle counter ticks (or
+ * nanoseconds where no cycle counter is available) and written as one CSV
+ * row per window of iterations.  Time not attributed to any phase, such as
+ * scheduling, shows up in the "other" column.  When timing is disabled each
+ * phase costs one predictable branch. */
+
+enum timing_phase {
+  PHASE_GEOMETRY,        /* process_geometry_changes */
+  PHASE_RELEASES,        /* process_molecule_releases */
+  PHASE_REACTION_OUTPUT, /* counting and writing of reaction data */
+  PHASE_VIZ_OUTPUT,      /* update_frame_data_list */
+  PHASE_VOLUME_OUTPUT,   /* process_volume_output */
+  PHASE_CLAMP,           /* concentration clamps and well-mixed counts */
+  PHASE_UNIMOLECULAR,    /* check_for_unimolecular_reaction */
+  PHASE_DIFFUSE_3D,      /* diffuse_3D and diffuse_3D_big_list */
+  PHASE_DIFFUSE_2D,      /* diffuse_2D */
+  PHASE_REACT_2D,        /* react_2D_all_neighbors and its trimolecular twin */
+  N_TIMING_PHASES
+};
+
+struct phase_timing {
+  FILE *out;                        /* CSV output */
+  long long window;                 /* Iterations per row */
+  long long window_start;           /* First iteration of this row */
+  uint64_t window_clock;            /* Clock at the start of this row */
+  uint64_t ticks[N_TIMING_PHASES];  /* Time spent in each phase so far */
+};
+
+static inline uint64_t phase_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* Start timing a phase; pass the result to phase_end */
+static inline uint64_t phase_begin(struct volume *world) {
+  return (world->phase_timing != NULL) ? phase_clock() : 0;
+}
+
+static inline void phase_end(struct volume *world, enum timing_phase phase,
+                             uint64_t start) {
+  if (world->phase_timing != NULL)
+    world->phase_timing->ticks[phase] += phase_clock() - start;
+}
+
+int init_phase_timing(struct volume *world);
+
+void phase_timing_iteration(struct volume *world);
+
+void finish_phase_timing(struct volume *world);
+
+#endif
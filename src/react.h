@@ -61,6 +61,13 @@ int trigger_bimolecular_preliminary(struct rxn **reaction_hash, int hashsize,
                                     struct species *reacA,
                                     struct species *reacB);
 
+/* The test of trigger_bimolecular_preliminary, precomputed at startup */
+static inline int may_react_with(struct species const *reacA,
+                                 struct species const *reacB) {
+  return (reacA->partner_bits[reacB->species_id / 32] >>
+          (reacB->species_id % 32)) & 1;
+}
+
 int trigger_bimolecular(struct rxn **reaction_hash, int rx_hashsize,
                         u_int hashA, u_int hashB,
                         struct abstract_molecule *reacA,
@@ -141,7 +148,8 @@ struct rxn *test_many_unimol(struct rxn **rx, int n,
                              struct abstract_molecule *a,
                              struct rng_state *rng);
 
-void update_probs(struct volume *world, struct rxn *rx, double t);
+void update_probs(struct volume *world, struct rate_change_event *rce,
+                  double t);
 
 /* In react_outc.c */
 int outcome_unimolecular(struct volume *world, struct rxn *rx, int path,
@@ -110,7 +110,7 @@ int test_bimolecular(struct rxn *rx, double scaling, double local_prob_factor,
                      struct abstract_molecule *a1, struct abstract_molecule *a2,
                      struct rng_state *rng) {
   if (a1 != NULL && a2 != NULL) {
-    assert(periodic_boxes_are_identical(a1->periodic_box, a2->periodic_box));
+    assert(periodic_boxes_are_identical(&a1->periodic_box, &a2->periodic_box));
   }
 
   /* rescale probabilities for the case of the reaction
@@ -402,47 +402,41 @@ struct rxn *test_many_unimol(struct rxn **rx, int n,
 }
 
 /*************************************************************************
-check_probs:
-  In: A reaction struct
-      The current time
+update_probs:
+  In: world: simulation state
+      rce: the rate change event of a reaction
+      t: the time before which pending changes are applied
   Out: No return value.  Probabilities are updated if necessary.
-       Memory isn't reclaimed.
-  Note: This isn't meant for really heavy-duty use (multiple pathways
-        with rapidly changing rates)--if you want that, the code should
-        probably be rewritten to accumulate probability changes from the
-        list as it goes (and the list should be sorted by pathway, too).
+  Note: Only called from process_rate_changes at the start of an iteration,
+        so the reaction tests themselves never look at rx->prob_t.
+  Note: Each change only records the new probability of its pathway.  The
+        cumulative probabilities, which the reaction tests read, are rebuilt
+        once afterwards, from the first pathway that changed on.
   Note: We're still displaying geometries here, rather than orientations.
         Perhaps that should be fixed.
 *************************************************************************/
-void update_probs(struct volume *world, struct rxn *rx, double t) {
+void update_probs(struct volume *world, struct rate_change_event *rce,
+                  double t) {
+  struct rxn *rx = rce->rx;
   int j, k;
-  double dprob;
   struct t_func *tv;
   int did_something = 0;
+  int first = rx->n_pathways;
   double new_prob = 0;
 
   for (tv = rx->prob_t; tv != NULL && tv->time < t; tv = tv->next) {
     j = tv->path;
-    if (j == 0)
-      dprob = tv->value - rx->cum_probs[0];
-    else
-      dprob = tv->value - (rx->cum_probs[j] - rx->cum_probs[j - 1]);
-
-    for (k = tv->path; k < rx->n_pathways; k++)
-      rx->cum_probs[k] += dprob;
-    rx->max_fixed_p += dprob;
-    rx->min_noreaction_p += dprob;
+    rce->new_probs[j] = tv->value;
+    rce->changed[j] = 1;
+    if (j < first)
+      first = j;
     did_something++;
 
     /* Changing probabilities is easy.  Now lots of logic to notify user, or
      * not. */
+    new_prob = tv->value;
     if (world->notify->time_varying_reactions == NOTIFY_FULL &&
-        rx->cum_probs[j] >= world->notify->reaction_prob_notify) {
-      if (j == 0)
-        new_prob = rx->cum_probs[0];
-      else
-        new_prob = rx->cum_probs[j] - rx->cum_probs[j - 1];
-
+        new_prob >= world->notify->reaction_prob_notify) {
       if (world->chkpt_seq_num > 1) {
         if (tv->next != NULL) {
           if (tv->next->time < t)
@@ -483,6 +477,23 @@ void update_probs(struct volume *world, struct rxn *rx, double t) {
   if (!did_something)
     return;
 
+  double old_total = rx->cum_probs[rx->n_pathways - 1];
+  double old_cum = (first > 0) ? rx->cum_probs[first - 1] : 0.0;
+  double new_cum = old_cum;
+  for (k = first; k < rx->n_pathways; k++) {
+    double prob = rx->cum_probs[k] - old_cum;
+    old_cum = rx->cum_probs[k];
+    if (rce->changed[k]) {
+      prob = rce->new_probs[k];
+      rce->changed[k] = 0;
+    }
+    new_cum += prob;
+    rx->cum_probs[k] = new_cum;
+  }
+  double dprob = rx->cum_probs[rx->n_pathways - 1] - old_total;
+  rx->max_fixed_p += dprob;
+  rx->min_noreaction_p += dprob;
+
   /* Now we have to see if we need to warn the user. */
   if (rx->cum_probs[rx->n_pathways - 1] > world->notify->reaction_prob_warn) {
     FILE *warn_file = mcell_get_log_file();
@@ -37,6 +37,7 @@
 #include "vol_util.h"
 #include "wall_util.h"
 #include "diffuse.h"
+#include "volume_output.h"
 
 static int outcome_products_random(struct volume *world, struct wall *w,
                                    struct vector3 *hitpt, double t,
@@ -46,7 +47,6 @@ static int outcome_products_random(struct volume *world, struct wall *w,
                                    short orientA, short orientB);
 
 
-static int cleanup_and_block_rx(struct tile_neighbor *tn1, struct tile_neighbor *tn2);
 
 int is_compatible_surface(void *req_species, struct wall *w) {
   struct surf_class_list *scl, *scl2;
@@ -125,11 +125,9 @@ void tiny_diffuse_3D(
     .y = displacement->y,
     .z = displacement->z
   };
+  struct collision_buffer hits;
   struct collision *shead = ray_trace(
-      world, pos, NULL, subvol, &temp_displacement, w);
-  if (shead->next != NULL) {
-    shead = (struct collision *)ae_list_sort((struct abstract_element *)shead);
-  }
+      world, pos, NULL, subvol, &temp_displacement, w, &hits);
 
   struct collision *smash = NULL;
   for (smash = shead; smash != NULL; smash = smash->next) {
@@ -139,6 +137,7 @@ void tiny_diffuse_3D(
       break;
     }
   }
+  collision_buffer_clear(&hits);
   pos->x += displacement->x;
   pos->y += displacement->y;
   pos->z += displacement->z;
@@ -167,7 +166,6 @@ place_volume_product(struct volume *world, struct species *product_species,
   struct volume_molecule *new_volume_mol;
   new_volume_mol =
       CHECKED_MEM_GET(subvol->local_storage->mol, "volume molecule");
-  new_volume_mol->birthplace = subvol->local_storage->mol;
   new_volume_mol->birthday = convert_iterations_to_seconds(
       world->start_iterations, world->time_unit,
       world->simulation_start_seconds, t);
@@ -175,11 +173,9 @@ place_volume_product(struct volume *world, struct species *product_species,
   new_volume_mol->t = t;
   new_volume_mol->t2 = 0.0;
 
-  new_volume_mol->periodic_box = CHECKED_MALLOC_STRUCT(struct periodic_image,
-    "periodic image descriptor");
-  new_volume_mol->periodic_box->x = periodic_box->x;
-  new_volume_mol->periodic_box->y = periodic_box->y;
-  new_volume_mol->periodic_box->z = periodic_box->z;
+  new_volume_mol->periodic_box.x = periodic_box->x;
+  new_volume_mol->periodic_box.y = periodic_box->y;
+  new_volume_mol->periodic_box.z = periodic_box->z;
 
   new_volume_mol->properties = product_species;
   new_volume_mol->prev_v = NULL;
@@ -230,8 +226,7 @@ place_volume_product(struct volume *world, struct species *product_species,
   }
 
   /* Add the molecule to the subvolume */
-  ht_add_molecule_to_list(&new_volume_mol->subvol->mol_by_species,
-                          new_volume_mol);
+  add_molecule_to_list(new_volume_mol);
   ++new_volume_mol->subvol->mol_count;
 
   /* Add to the schedule. */
@@ -261,11 +256,9 @@ place_sm_product(struct volume *world, struct species *product_species,
   new_surf_mol->t = t;
   new_surf_mol->t2 = 0.0;
   new_surf_mol->properties = product_species;
-  new_surf_mol->periodic_box = CHECKED_MALLOC_STRUCT(struct periodic_image,
-    "periodic image descriptor");
-  new_surf_mol->periodic_box->x = periodic_box->x;
-  new_surf_mol->periodic_box->y = periodic_box->y;
-  new_surf_mol->periodic_box->z = periodic_box->z;
+  new_surf_mol->periodic_box.x = periodic_box->x;
+  new_surf_mol->periodic_box.y = periodic_box->y;
+  new_surf_mol->periodic_box.z = periodic_box->z;
 
   new_surf_mol->flags = TYPE_SURF | ACT_NEWBIE | IN_SCHEDULE;
   if (product_species->space_step > 0)
@@ -292,6 +285,7 @@ place_sm_product(struct volume *world, struct species *product_species,
   }
   grid->sm_list[grid_index] = add_surfmol_with_unique_pb_to_list(
     grid->sm_list[grid_index], new_surf_mol);
+  update_tile_occupancy(grid, grid_index);
 
   /* Add to the schedule. */
   if (schedule_add(sv->local_storage->timer, new_surf_mol))
@@ -341,6 +335,9 @@ static int outcome_products_random(struct volume *world, struct wall *w,
   /* Did the moving molecule cross the plane? */
   bool cross_wall = false; 
 
+  /* temporary lists below are dropped on every way out */
+  struct scratch_mark mark = scratch_mark(world->scratch_mem);
+
   /* index of the first player for the pathway */
   int const i0 = rx->product_idx[path]; 
   /* index of the first player for the next pathway */
@@ -469,29 +466,32 @@ static int outcome_products_random(struct volume *world, struct wall *w,
   int mol_idx = INT_MAX;
   /* If the reaction involves a surface, make sure there is room for each
    * product. */
-  struct tile_neighbor *tile_nbr_head = NULL; // list of neighbor tiles
-  int tile_nbr_list_length = 0;
-  struct tile_neighbor *tile_vacant_nbr_head = NULL; // list of vacant neighbor tiles
+  /* list of vacant neighbor tiles, it lives in the scratch arena until
+     this molecule is done */
+  struct tile_neighbor *tile_vacant_nbr_head = NULL;
   if (is_orientable) {
     if (num_surface_products > 0) {
+      struct tile_nbr_buf nbrs; // neighbor tiles
+      init_tile_nbr_buf(&nbrs);
       if (sm_reactant != NULL) {
-        find_neighbor_tiles(world, sm_reactant, sm_reactant->grid,
-                            sm_reactant->grid_index, 1, 0, &tile_nbr_head,
-                            &tile_nbr_list_length);
+        get_neighbor_tiles(world, sm_reactant, sm_reactant->grid,
+                           sm_reactant->grid_index, 1, 0, &nbrs);
       } else {
-        find_neighbor_tiles(world, sm_reactant, w->grid, rxn_uv_idx, 1, 0,
-                            &tile_nbr_head, &tile_nbr_list_length);
+        get_neighbor_tiles(world, sm_reactant, w->grid, rxn_uv_idx, 1, 0,
+                           &nbrs);
       }
 
       /* Create list of vacant tiles */
-      for (struct tile_neighbor *tile_nbr = tile_nbr_head; tile_nbr != NULL;
-           tile_nbr = tile_nbr->next) {
-        struct surface_molecule_list *sm_list = tile_nbr->grid->sm_list[tile_nbr->idx]; 
-        if (sm_list == NULL || sm_list->sm == NULL) {
+      for (int nn = 0; nn < nbrs.n_tiles; nn++) {
+        struct tile_ref *tile_nbr = &nbrs.tiles[nn];
+        if (!get_bit(tile_nbr->grid->occupancy, tile_nbr->idx)) {
           num_vacant_tiles++;
-          push_tile_neighbor_to_list(&tile_vacant_nbr_head, tile_nbr->grid, tile_nbr->idx);
+          push_tile_neighbor_to_scratch_list(world->scratch_mem,
+                                             &tile_vacant_nbr_head,
+                                             tile_nbr->grid, tile_nbr->idx);
         }
       }
+      free_tile_nbr_buf(&nbrs);
     }
 
     /* Can this reaction happen at all? */
@@ -502,7 +502,8 @@ static int outcome_products_random(struct volume *world, struct wall *w,
       num_recycled_tiles = 1;
     }
     if (num_surface_products > num_vacant_tiles + num_recycled_tiles) {
-      return cleanup_and_block_rx(tile_nbr_head, tile_vacant_nbr_head);
+      scratch_release(world->scratch_mem, mark);
+      return RX_BLOCKED;
     }
 
     /* set the orientations of the products. */
@@ -830,13 +831,15 @@ static int outcome_products_random(struct volume *world, struct wall *w,
 
         /* can't place products - reaction blocked */
         if (num_vacant_tiles == 0) {
-          return cleanup_and_block_rx(tile_nbr_head, tile_vacant_nbr_head);
+          scratch_release(world->scratch_mem, mark);
+          return RX_BLOCKED;
         }
 
         num_attempts = 0;
         while (true) {
           if (num_attempts > SURFACE_DIFFUSION_RETRIES) {
-            return cleanup_and_block_rx(tile_nbr_head, tile_vacant_nbr_head);
+            scratch_release(world->scratch_mem, mark);
+            return RX_BLOCKED;
           }
 
           /* randomly pick a tile from the list */
@@ -845,7 +848,8 @@ static int outcome_products_random(struct volume *world, struct wall *w,
           tile_grid = NULL;
           if (get_tile_neighbor_from_list_of_vacant_neighbors(
                   tile_vacant_nbr_head, rnd_num, &tile_grid, &tile_idx) == 0) {
-            return cleanup_and_block_rx(tile_nbr_head, tile_vacant_nbr_head);
+            scratch_release(world->scratch_mem, mark);
+            return RX_BLOCKED;
           }
           if (tile_idx < 0) {
             continue; /* this tile was probed already */
@@ -878,7 +882,7 @@ static int outcome_products_random(struct volume *world, struct wall *w,
 
   /* Determine the location of the reaction for count purposes. */
   struct vector3 count_pos_xyz;
-  struct periodic_image *periodic_box = ((struct volume_molecule *)reacA)->periodic_box;
+  struct periodic_image *periodic_box = &reacA->periodic_box;
   if (hitpt != NULL) {
     count_pos_xyz = *hitpt;
   } else if (sm_reactant) {
@@ -947,7 +951,7 @@ static int outcome_products_random(struct volume *world, struct wall *w,
       this_product = (struct abstract_molecule *)place_sm_product(
           world, product_species, product_grid[n_product],
           product_grid_idx[n_product], &prod_uv_pos, product_orient[n_product],
-          t, reacA->periodic_box);
+          t, &reacA->periodic_box);
     } else { /* else place the molecule in space. */
       /* For either a unimolecular reaction, or a reaction between two surface
          molecules we don't have a hitpoint. */
@@ -971,7 +975,7 @@ static int outcome_products_random(struct volume *world, struct wall *w,
 
       this_product = (struct abstract_molecule *)place_volume_product(
           world, product_species, sm_reactant, w, product_subvol, hitpt,
-          product_orient[n_product], t, reacA->periodic_box);
+          product_orient[n_product], t, &reacA->periodic_box);
 
       if (((struct volume_molecule *)this_product)->index < DISSOCIATION_MAX)
         update_dissociation_index = true;
@@ -980,7 +984,7 @@ static int outcome_products_random(struct volume *world, struct wall *w,
     /* Update molecule counts */
     ++product_species->population;
     if (product_species->flags & (COUNT_CONTENTS | COUNT_ENCLOSED))
-      count_region_from_scratch(world, this_product, NULL, 1, NULL, NULL, t, this_product->periodic_box);
+      count_region_from_scratch(world, this_product, NULL, 1, NULL, NULL, t, &this_product->periodic_box);
 
     /* preserve molecule id if rxn is unimolecular with one product */
     if (is_unimol && (n_players == 1)) {
@@ -1020,14 +1024,7 @@ static int outcome_products_random(struct volume *world, struct wall *w,
     }
   }
 
-  /* recover memory */
-  delete_tile_neighbor_list(tile_nbr_head);
-  delete_tile_neighbor_list(tile_vacant_nbr_head);
-  delete_region_list(rlp_head_wall_1);
-  delete_region_list(rlp_head_wall_2);
-  delete_region_list(rlp_head_obj_1);
-  delete_region_list(rlp_head_obj_2);
-
+  scratch_release(world->scratch_mem, mark);
   return cross_wall ? RX_FLIP : RX_A_OK;
 }
 
@@ -1075,6 +1072,7 @@ int outcome_unimolecular(struct volume *world, struct rxn *rx, int path,
   if (result != RX_BLOCKED) {
     rx->info[path].count++;
     rx->n_occurred++;
+    count_reaction_load(world, reac);
   }
 
   struct species *who_am_i = rx->players[rx->product_idx[path]];
@@ -1086,21 +1084,21 @@ int outcome_unimolecular(struct volume *world, struct rxn *rx, int path,
         vm->subvol->local_storage->timer->defunct_count++;
       if (vm->properties->flags & COUNT_SOME_MASK) {
         count_region_from_scratch(world, (struct abstract_molecule *)vm, NULL,
-                                  -1, &(vm->pos), NULL, vm->t, vm->periodic_box);
+                                  -1, &(vm->pos), NULL, vm->t, &vm->periodic_box);
       }
     } else {
       remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+      update_tile_occupancy(sm->grid, sm->grid_index);
       sm->grid->n_occupied--;
       if (sm->flags & IN_SCHEDULE) {
         sm->grid->subvol->local_storage->timer->defunct_count++;
       }
       if (sm->properties->flags & COUNT_SOME_MASK) {
         count_region_from_scratch(world, (struct abstract_molecule *)sm, NULL,
-                                  -1, NULL, NULL, sm->t, sm->periodic_box);
+                                  -1, NULL, NULL, sm->t, &sm->periodic_box);
       }
     }
 
-    free(reac->periodic_box);
     who_was_i->n_deceased++;
     double t_time = convert_iterations_to_seconds(
         world->start_iterations, world->time_unit,
@@ -1112,7 +1110,7 @@ int outcome_unimolecular(struct volume *world, struct rxn *rx, int path,
       collect_molecule(vm);
     else {
       reac->properties = NULL;
-      mem_put(reac->birthplace, reac);
+      mem_put(molecule_storage(reac), reac);
     }
     return RX_DESTROY;
   } else if (who_am_i != who_was_i) {
@@ -1147,7 +1145,7 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
                         short orientB, double t, struct vector3 *hitpt,
                         struct vector3 *loc_okay) {
 
-  assert(periodic_boxes_are_identical(reacA->periodic_box, reacB->periodic_box));
+  assert(periodic_boxes_are_identical(&reacA->periodic_box, &reacB->periodic_box));
 
   struct surface_molecule *sm = NULL;
   struct volume_molecule *vm = NULL;
@@ -1175,6 +1173,7 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
 
   rx->n_occurred++;
   rx->info[path].count++;
+  count_reaction_load(world, reacA);
 
   /* Figure out if either of the reactants was destroyed */
   if (rx->players[0] == reacA->properties) {
@@ -1191,6 +1190,7 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
       sm = (struct surface_molecule *)reacB;
 
       remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+      update_tile_occupancy(sm->grid, sm->grid_index);
       sm->grid->n_occupied--;
       if (sm->flags & IN_SURFACE)
         sm->flags -= IN_SURFACE;
@@ -1207,10 +1207,9 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
     }
 
     if ((reacB->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) != 0) {
-      count_region_from_scratch(world, reacB, NULL, -1, NULL, NULL, t, reacB->periodic_box);
+      count_region_from_scratch(world, reacB, NULL, -1, NULL, NULL, t, &reacB->periodic_box);
     }
 
-    free(reacB->periodic_box);
     reacB->properties->n_deceased++;
     double t_time = convert_iterations_to_seconds(
         world->start_iterations, world->time_unit,
@@ -1230,6 +1229,7 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
       sm = (struct surface_molecule *)reacA;
 
       remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+      update_tile_occupancy(sm->grid, sm->grid_index);
       sm->grid->n_occupied--;
       if (sm->flags & IN_SCHEDULE) {
         sm->grid->subvol->local_storage->timer->defunct_count++;
@@ -1248,7 +1248,7 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
       if (reacA->properties->flags &
           COUNT_SOME_MASK) /* If we're ever counted, try to count us now */
       {
-        count_region_from_scratch(world, reacA, NULL, -1, NULL, NULL, t, reacA->periodic_box);
+        count_region_from_scratch(world, reacA, NULL, -1, NULL, NULL, t, &reacA->periodic_box);
       }
     } else if (reacA->flags & COUNT_ME) {
       /* Subtlety: we made it up to hitpt, but our position is wherever we were
@@ -1257,7 +1257,7 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
           (reacB->properties != NULL &&
            (reacB->properties->flags & NOT_FREE) == 0)) {
         /* Vol-vol rx should be counted at hitpt */
-        count_region_from_scratch(world, reacA, NULL, -1, hitpt, NULL, t, reacA->periodic_box);
+        count_region_from_scratch(world, reacA, NULL, -1, hitpt, NULL, t, &reacA->periodic_box);
       } else /* Vol-surf but don't want to count exactly on a wall or we might
                 count on the wrong side */
       {
@@ -1273,11 +1273,10 @@ int outcome_bimolecular(struct volume *world, struct rxn *rx, int path,
         fake_hitpt.y = 0.5 * hitpt->y + 0.5 * loc_okay->y;
         fake_hitpt.z = 0.5 * hitpt->z + 0.5 * loc_okay->z;
 
-        count_region_from_scratch(world, reacA, NULL, -1, &fake_hitpt, NULL, t, reacA->periodic_box);
+        count_region_from_scratch(world, reacA, NULL, -1, &fake_hitpt, NULL, t, &reacA->periodic_box);
       }
     }
 
-    free(reacA->periodic_box);
     reacA->properties->n_deceased++;
     double t_time = convert_iterations_to_seconds(
         world->start_iterations, world->time_unit,
@@ -1351,6 +1350,7 @@ int outcome_intersect(struct volume *world, struct rxn *rx, int path,
 
     rx->info[path].count++;
     rx->n_occurred++;
+    count_reaction_load(world, reac);
 
     if (rx->players[idx] == NULL) {
       /* The code below is also valid for the special reaction of the type
@@ -1359,7 +1359,7 @@ int outcome_intersect(struct volume *world, struct rxn *rx, int path,
       if (world->place_waypoints_flag && (reac->flags & COUNT_ME)) {
         if (hitpt == NULL) {
           count_region_from_scratch(
-            world, reac, NULL, -1, NULL, NULL, t, reac->periodic_box);
+            world, reac, NULL, -1, NULL, NULL, t, &reac->periodic_box);
         } else {
           struct vector3 fake_hitpt;
 
@@ -1372,10 +1372,9 @@ int outcome_intersect(struct volume *world, struct rxn *rx, int path,
           fake_hitpt.z = 0.5 * hitpt->z + 0.5 * loc_okay->z;
 
           count_region_from_scratch(world, reac, NULL, -1, &fake_hitpt, NULL,
-                                    t, reac->periodic_box);
+                                    t, &reac->periodic_box);
         }
       }
-      free(reac->periodic_box);
       reac->properties->n_deceased++;
       double t_time = convert_iterations_to_seconds(
           world->start_iterations, world->time_unit,
@@ -1492,7 +1491,8 @@ int reaction_wizardry(struct volume *world, struct magic_list *incantation,
  *     pointer to array with restrictive regions which don't contain wall 2
  *
  * out: the 4 arrays with pointers to restrictive regions will be filled
- *      and returned
+ *      and returned. They are allocated from world->scratch_mem and go
+ *      away when the current molecule is done.
  *
  ***********************************************************************/
 int determine_molecule_region_topology(
@@ -1518,8 +1518,10 @@ int determine_molecule_region_topology(
             world, sm_2->grid->surface->parent_object, sm_2)) {
       w_1 = sm_1->grid->surface;
       w_2 = sm_2->grid->surface;
-      rlp_head_wall_1 = find_restricted_regions_by_wall(world, w_1, sm_1);
-      rlp_head_wall_2 = find_restricted_regions_by_wall(world, w_2, sm_2);
+      rlp_head_wall_1 = find_restricted_regions_by_wall_scratch(
+          world, world->scratch_mem, w_1, sm_1);
+      rlp_head_wall_2 = find_restricted_regions_by_wall_scratch(
+          world, world->scratch_mem, w_2, sm_2);
 
       /* both reactants are inside their respective restricted regions */
       if ((rlp_head_wall_1 != NULL) && (rlp_head_wall_2 != NULL)) {
@@ -1527,24 +1529,24 @@ int determine_molecule_region_topology(
       }
       /* both reactants are outside their respective restricted regions */
       else if ((rlp_head_wall_1 == NULL) && (rlp_head_wall_2 == NULL)) {
-        rlp_head_obj_1 =
-            find_restricted_regions_by_object(world, w_1->parent_object, sm_1);
-        rlp_head_obj_2 =
-            find_restricted_regions_by_object(world, w_2->parent_object, sm_2);
+        rlp_head_obj_1 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_1->parent_object, sm_1);
+        rlp_head_obj_2 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_2->parent_object, sm_2);
         sm_bitmask |= ALL_OUTSIDE;
       }
       /* grid1 is inside and grid2 is outside of its respective
        * restrictive region */
       else if ((rlp_head_wall_1 != NULL) && (rlp_head_wall_2 == NULL)) {
-        rlp_head_obj_2 =
-            find_restricted_regions_by_object(world, w_2->parent_object, sm_2);
+        rlp_head_obj_2 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_2->parent_object, sm_2);
         sm_bitmask |= SURF1_IN_SURF2_OUT;
       }
       /* grid2 is inside and grid1 is outside of its respective
        * restrictive region */
       else if ((rlp_head_wall_1 == NULL) && (rlp_head_wall_2 != NULL)) {
-        rlp_head_obj_1 =
-            find_restricted_regions_by_object(world, w_1->parent_object, sm_1);
+        rlp_head_obj_1 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_1->parent_object, sm_1);
         sm_bitmask |= SURF1_OUT_SURF2_IN;
       }
     }
@@ -1557,12 +1559,13 @@ int determine_molecule_region_topology(
               !are_restricted_regions_for_species_on_object(
                    world, sm_2->grid->surface->parent_object, sm_2))) {
       w_1 = sm_1->grid->surface;
-      rlp_head_wall_1 = find_restricted_regions_by_wall(world, w_1, sm_1);
+      rlp_head_wall_1 = find_restricted_regions_by_wall_scratch(
+          world, world->scratch_mem, w_1, sm_1);
       if (rlp_head_wall_1 != NULL) {
         sm_bitmask |= SURF1_IN;
       } else {
-        rlp_head_obj_1 =
-            find_restricted_regions_by_object(world, w_1->parent_object, sm_1);
+        rlp_head_obj_1 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_1->parent_object, sm_1);
         sm_bitmask |= SURF1_OUT;
       }
     }
@@ -1575,12 +1578,13 @@ int determine_molecule_region_topology(
               !are_restricted_regions_for_species_on_object(
                    world, sm_1->grid->surface->parent_object, sm_1))) {
       w_2 = sm_2->grid->surface;
-      rlp_head_wall_2 = find_restricted_regions_by_wall(world, w_2, sm_2);
+      rlp_head_wall_2 = find_restricted_regions_by_wall_scratch(
+          world, world->scratch_mem, w_2, sm_2);
       if (rlp_head_wall_2 != NULL) {
         sm_bitmask |= SURF2_IN;
       } else {
-        rlp_head_obj_2 =
-            find_restricted_regions_by_object(world, w_2->parent_object, sm_2);
+        rlp_head_obj_2 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_2->parent_object, sm_2);
         sm_bitmask |= SURF2_OUT;
       }
     }
@@ -1592,12 +1596,13 @@ int determine_molecule_region_topology(
         are_restricted_regions_for_species_on_object(
             world, sm_1->grid->surface->parent_object, sm_1)) {
       w_1 = sm_1->grid->surface;
-      rlp_head_wall_1 = find_restricted_regions_by_wall(world, w_1, sm_1);
+      rlp_head_wall_1 = find_restricted_regions_by_wall_scratch(
+          world, world->scratch_mem, w_1, sm_1);
       if (rlp_head_wall_1 != NULL) {
         sm_bitmask |= ALL_INSIDE;
       } else {
-        rlp_head_obj_1 =
-            find_restricted_regions_by_object(world, w_1->parent_object, sm_1);
+        rlp_head_obj_1 = find_restricted_regions_by_object_scratch(
+            world, world->scratch_mem, w_1->parent_object, sm_1);
         sm_bitmask |= ALL_OUTSIDE;
       }
     }
@@ -1693,16 +1698,3 @@ bool product_tile_can_be_reached(struct wall *target,
   return status;
 }
 
-/*
- * cleanup_and_block_rx is a simple helper function which deletes the provided
- * linked lists of tile_neighbors and the return RX_BLOCKED
- */
-int cleanup_and_block_rx(struct tile_neighbor *tn1, struct tile_neighbor *tn2) {
-  if (tn1 != NULL) {
-    delete_tile_neighbor_list(tn1);
-  }
-  if (tn2 != NULL) {
-    delete_tile_neighbor_list(tn2);
-  }
-  return RX_BLOCKED;
-}
@@ -37,6 +37,7 @@
 #include "react.h"
 #include "vol_util.h"
 #include "wall_util.h"
+#include "volume_output.h"
 
 static int outcome_products_trimol_reaction_random(
     struct volume *world, struct wall *w, struct vector3 *hitpt, double t,
@@ -72,11 +73,11 @@ static int outcome_products_trimol_reaction_random(
     short orientA, short orientB, short orientC) {
 
   if (reacA != NULL && reacB != NULL) {
-    assert(periodic_boxes_are_identical(reacA->periodic_box, reacB->periodic_box));
+    assert(periodic_boxes_are_identical(&reacA->periodic_box, &reacB->periodic_box));
   } else if (reacA != NULL && reacC != NULL) {
-    assert(periodic_boxes_are_identical(reacA->periodic_box, reacC->periodic_box));
+    assert(periodic_boxes_are_identical(&reacA->periodic_box, &reacC->periodic_box));
   } else if (reacB != NULL && reacC != NULL) {
-    assert(periodic_boxes_are_identical(reacB->periodic_box, reacC->periodic_box));
+    assert(periodic_boxes_are_identical(&reacB->periodic_box, &reacC->periodic_box));
   }
 
   bool update_dissociation_index =
@@ -687,8 +688,7 @@ static int outcome_products_trimol_reaction_random(
       /* Create list of vacant tiles */
       for (tile_nbr = tile_nbr_head; tile_nbr != NULL;
            tile_nbr = tile_nbr->next) {
-        struct surface_molecule_list *sm_list = tile_nbr->grid->sm_list[tile_nbr->idx];
-        if (sm_list == NULL || sm_list->sm == NULL) {
+        if (!get_bit(tile_nbr->grid->occupancy, tile_nbr->idx)) {
           num_vacant_tiles++;
           push_tile_neighbor_to_list(&tile_vacant_nbr_head, tile_nbr->grid,
                                      tile_nbr->idx);
@@ -1672,7 +1672,7 @@ static int outcome_products_trimol_reaction_random(
       this_product = (struct abstract_molecule *)place_sm_product(
           world, product_species, product_grid[n_product],
           product_grid_idx[n_product], &prod_uv_pos, product_orient[n_product],
-          t, reacA->periodic_box);
+          t, &reacA->periodic_box);
     }
 
     /* else place the molecule in space. */
@@ -1698,7 +1698,7 @@ static int outcome_products_trimol_reaction_random(
 
       this_product = (struct abstract_molecule *)place_volume_product(
           world, product_species, sm_reactant, w, product_subvol, hitpt,
-          product_orient[n_product], t, reacA->periodic_box);
+          product_orient[n_product], t, &reacA->periodic_box);
 
       if (((struct volume_molecule *)this_product)->index < DISSOCIATION_MAX)
         update_dissociation_index = true;
@@ -1810,6 +1810,7 @@ int outcome_trimolecular(struct volume *world, struct rxn *rx, int path,
 
   rx->n_occurred++;
   rx->info[path].count++;
+  count_reaction_load(world, reacA);
 
   /* Figure out if either of the reactants was destroyed */
 
@@ -1850,6 +1851,7 @@ int outcome_trimolecular(struct volume *world, struct rxn *rx, int path,
     if ((reacC->properties->flags & ON_GRID) != 0) {
       sm = (struct surface_molecule *)reacC;
       remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+      update_tile_occupancy(sm->grid, sm->grid_index);
       sm->grid->n_occupied--;
       if (sm->flags & IN_SURFACE)
         sm->flags -= IN_SURFACE;
@@ -1880,7 +1882,7 @@ int outcome_trimolecular(struct volume *world, struct rxn *rx, int path,
     else {
       reacC->properties = NULL;
       if ((reacC->flags & IN_MASK) == 0)
-        mem_put(reacC->birthplace, reacC);
+        mem_put(molecule_storage(reacC), reacC);
     }
   }
 
@@ -1889,6 +1891,7 @@ int outcome_trimolecular(struct volume *world, struct rxn *rx, int path,
     if ((reacB->properties->flags & ON_GRID) != 0) {
       sm = (struct surface_molecule *)reacB;
       remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+      update_tile_occupancy(sm->grid, sm->grid_index);
       sm->grid->n_occupied--;
       if (sm->flags & IN_SURFACE)
         sm->flags -= IN_SURFACE;
@@ -1919,7 +1922,7 @@ int outcome_trimolecular(struct volume *world, struct rxn *rx, int path,
     else {
       reacB->properties = NULL;
       if ((reacB->flags & IN_MASK) == 0)
-        mem_put(reacB->birthplace, reacB);
+        mem_put(molecule_storage(reacB), reacB);
     }
   }
 
@@ -1928,6 +1931,7 @@ int outcome_trimolecular(struct volume *world, struct rxn *rx, int path,
     if ((reacA->properties->flags & ON_GRID) != 0) {
       sm = (struct surface_molecule *)reacA;
       remove_surfmol_from_list(&sm->grid->sm_list[sm->grid_index], sm);
+      update_tile_occupancy(sm->grid, sm->grid_index);
       sm->grid->n_occupied--;
       if (sm->flags & IN_SURFACE)
         sm->flags -= IN_SURFACE;
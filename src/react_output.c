@@ -32,6 +32,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
+#include <stdatomic.h>
 
 #include "logging.h"
 #include "sched_util.h"
@@ -40,9 +41,13 @@
 #include "mdlparse_util.h"
 #include "strfunc.h"
 
-// XXX: This global state should be removed. Currently
-// we need it for cleanup via signals.
-static struct volume *global_state;
+/* Simulation flushed by the emergency hooks.  Hooks and signal handlers are
+ * per process, so each thread running a simulation keeps its own; fatal
+ * signals and exit() run the hooks in the thread that caused them. */
+static _Thread_local struct volume *global_state;
+
+/* Set once the process-wide hooks have been installed */
+static atomic_flag emergency_hooks_installed = ATOMIC_FLAG_INIT;
 
 /**************************************************************************
 truncate_output_file:
@@ -212,6 +217,7 @@ static int emergency_output(struct volume *world) {
   /* PANIC--delete everything we can get our pointers on! */
   delete_mem(world->coll_mem);
   delete_mem(world->exdv_mem);
+  delete_scratch_arena(world->scratch_mem);
   for (mem = world->storage_head; mem != NULL; mem = mem->next) {
     delete_mem(mem->store->list);
     delete_mem(mem->store->mol);
@@ -226,27 +232,21 @@ static int emergency_output(struct volume *world) {
   return flush_reaction_output(world);
 }
 
-/**************************************************************************
- emergency_output_hook_enabled:
-    Flag to disable emergency output hook when the program exits successfully.
-**************************************************************************/
-int emergency_output_hook_enabled = 1;
-
 /**************************************************************************
  emergency_output_hook:
     This is an atexit hook to flush reaction output to disk in case an error is
-    occurred.  Set emergency_output_hook_enabled to 0 to prevent it from being
-    called (say, on successful exit).
+    occurred.  Set world->emergency_output_hook_enabled to 0 to prevent it from
+    being called (say, on successful exit).
 
   In: No arguments.
   Out: None.
 
 **************************************************************************/
 static void emergency_output_hook(void) {
-  if (emergency_output_hook_enabled) {
+  if (global_state != NULL && global_state->emergency_output_hook_enabled) {
     /* Disable the emergency output hook in case a signal is received while
      * producing emergency output. */
-    emergency_output_hook_enabled = 0;
+    global_state->emergency_output_hook_enabled = 0;
 
     int n_errors = emergency_output(global_state);
     if (n_errors == 0)
@@ -278,8 +278,8 @@ static void emergency_output_signal_handler(int signo) {
           "*****************************\n",
           signo, PACKAGE_BUGREPORT);
 
-  if (emergency_output_hook_enabled) {
-    emergency_output_hook_enabled = 0;
+  if (global_state != NULL && global_state->emergency_output_hook_enabled) {
+    global_state->emergency_output_hook_enabled = 0;
 
     int n_errors = flush_reaction_output(global_state);
     if (n_errors == 0)
@@ -327,14 +327,18 @@ static void install_emergency_output_signal_handler(int signo) {
 /**************************************************************************
  install_emergency_output_hooks:
     Installs all relevant hooks for catching invalid program termination and
-    flushing output to disk, where possible.
+    flushing output to disk, where possible.  The hooks are installed once per
+    process; later calls only select the simulation of the calling thread.
 
-  In: No arguments.
+  In: world: simulation whose output the hooks flush
   Out: None.
 **************************************************************************/
 void install_emergency_output_hooks(struct volume *world) {
   global_state = world;
 
+  if (atomic_flag_test_and_set(&emergency_hooks_installed))
+    return;
+
   if (atexit(&emergency_output_hook) != 0)
     mcell_warn("Failed to install emergency output hook.");
 
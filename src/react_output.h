@@ -27,8 +27,6 @@
 
 /* Header file for reaction output routines */
 
-extern int emergency_output_hook_enabled;
-
 void install_emergency_output_hooks(struct volume *world);
 
 int truncate_output_file(char *name, double start_value);
@@ -148,7 +148,7 @@ int trigger_bimolecular(struct rxn **reaction_hash, int rx_hashsize,
   /*struct surf_class_list *scl, *scl2;*/
 
   // reactions between reacA and reacB only happen if both are in the same periodic box
-  if (!periodic_boxes_are_identical(reacA->periodic_box, reacB->periodic_box)) {
+  if (!periodic_boxes_are_identical(&reacA->periodic_box, &reacB->periodic_box)) {
     return 0;
   }
 
@@ -991,10 +991,6 @@ struct rxn *pick_unimolecular_reaction(struct volume *state,
   struct rxn *r = trigger_unimolecular(state->reaction_hash, state->rx_hashsize,
                                        am->properties->hashval, am);
 
-  if ((r != NULL) && (r->prob_t != NULL)) {
-    update_probs(state, r, (am->t + am->t2) * (1.0 + EPS_C));
-  }
-
   int can_surf_react = ((am->properties->flags & CAN_SURFWALL) != 0);
   if (can_surf_react) {
     num_matching_rxns =
@@ -1002,12 +998,6 @@ struct rxn *pick_unimolecular_reaction(struct volume *state,
             state->reaction_hash, state->rx_hashsize, state->all_mols,
             state->all_volume_mols, state->all_surface_mols, am, NULL,
             matching_rxns);
-    for (int jj = 0; jj < num_matching_rxns; jj++) {
-      if ((matching_rxns[jj] != NULL) && (matching_rxns[jj]->prob_t != NULL)) {
-        update_probs(
-            state, matching_rxns[jj], (am->t + am->t2) * (1.0 + EPS_C));
-      }
-    }
   }
 
   if (r != NULL) {
@@ -0,0 +1,530 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logging.h"
+#include "util.h"
+#include "vector.h"
+#include "region_query.h"
+
+/* Largest number of walls kept in a leaf of a wall hierarchy */
+#define BVH_LEAF_SIZE 4
+
+/* Deepest possible traversal (the hierarchy is split at the median, so this
+ * is enough for any number of walls that fits in an int) */
+#define BVH_MAX_DEPTH 64
+
+/* Barycentric coordinates closer than this to an edge count as grazing */
+#define BARYCENTRIC_EPS 1e-9
+
+/* Rays closer than this (cosine) to the plane of a wall count as parallel */
+#define PARALLEL_EPS 1e-9
+
+/* Ray directions, in the order in which they are tried. The first one points
+ * down the z axis, so that the crossings it finds are the same ones a ray
+ * coming up from the bottom of the world would find. The others are generic
+ * directions that are unlikely to line up with the edges of a mesh. */
+static const double containment_directions[N_CONTAINMENT_DIRECTIONS][3] = {
+  { 0.0, 0.0, -1.0 },
+  { 0.1237, 0.0773, -0.9893 },
+  { -0.3319, 0.5512, -0.7657 },
+  { 0.7071, -0.2113, 0.6746 },
+  { -0.5903, -0.6481, 0.4812 },
+  { 0.2642, 0.9120, 0.3140 },
+  { -0.9433, 0.1517, -0.2954 },
+  { 0.4387, -0.8329, -0.3376 }
+};
+
+/* A wall and its bounding box while a hierarchy is built */
+struct bvh_item {
+  struct wall *w;
+  struct vector3 llf;
+  struct vector3 urb;
+  struct vector3 center;
+};
+
+static int compare_center_x(void const *a, void const *b) {
+  double ca = ((struct bvh_item const *)a)->center.x;
+  double cb = ((struct bvh_item const *)b)->center.x;
+  return (ca < cb) ? -1 : (ca > cb);
+}
+
+static int compare_center_y(void const *a, void const *b) {
+  double ca = ((struct bvh_item const *)a)->center.y;
+  double cb = ((struct bvh_item const *)b)->center.y;
+  return (ca < cb) ? -1 : (ca > cb);
+}
+
+static int compare_center_z(void const *a, void const *b) {
+  double ca = ((struct bvh_item const *)a)->center.z;
+  double cb = ((struct bvh_item const *)b)->center.z;
+  return (ca < cb) ? -1 : (ca > cb);
+}
+
+/***************************************************************************
+ build_bvh_node:
+  In:  bvh: hierarchy under construction
+       items: walls of the object with their bounding boxes
+       first: index of the first wall of this node
+       count: number of walls in this node
+  Out: Index of the new node. Nodes with more than BVH_LEAF_SIZE walls are
+       split at the median along the axis in which the centers of their walls
+       are spread out the most.
+***************************************************************************/
+static int build_bvh_node(struct wall_bvh *bvh, struct bvh_item *items,
+                          int first, int count) {
+  int node = bvh->n_nodes++;
+  struct wall_bvh_node *np = &bvh->nodes[node];
+
+  struct vector3 c_llf = items[first].center, c_urb = items[first].center;
+  np->llf = items[first].llf;
+  np->urb = items[first].urb;
+  for (int i = first + 1; i < first + count; i++) {
+    np->llf.x = min2d(np->llf.x, items[i].llf.x);
+    np->llf.y = min2d(np->llf.y, items[i].llf.y);
+    np->llf.z = min2d(np->llf.z, items[i].llf.z);
+    np->urb.x = max2d(np->urb.x, items[i].urb.x);
+    np->urb.y = max2d(np->urb.y, items[i].urb.y);
+    np->urb.z = max2d(np->urb.z, items[i].urb.z);
+    c_llf.x = min2d(c_llf.x, items[i].center.x);
+    c_llf.y = min2d(c_llf.y, items[i].center.y);
+    c_llf.z = min2d(c_llf.z, items[i].center.z);
+    c_urb.x = max2d(c_urb.x, items[i].center.x);
+    c_urb.y = max2d(c_urb.y, items[i].center.y);
+    c_urb.z = max2d(c_urb.z, items[i].center.z);
+  }
+
+  double dx = c_urb.x - c_llf.x;
+  double dy = c_urb.y - c_llf.y;
+  double dz = c_urb.z - c_llf.z;
+  if (count <= BVH_LEAF_SIZE || (dx <= 0 && dy <= 0 && dz <= 0)) {
+    np->first = first;
+    np->count = count;
+    return node;
+  }
+
+  if (dx >= dy && dx >= dz)
+    qsort(items + first, count, sizeof(struct bvh_item), compare_center_x);
+  else if (dy >= dz)
+    qsort(items + first, count, sizeof(struct bvh_item), compare_center_y);
+  else
+    qsort(items + first, count, sizeof(struct bvh_item), compare_center_z);
+
+  int half = count / 2;
+  build_bvh_node(bvh, items, first, half);
+  int right = build_bvh_node(bvh, items, first + half, count - half);
+
+  /* The array of nodes is not reallocated, so np is still valid */
+  np->first = right;
+  np->count = 0;
+  return node;
+}
+
+/***************************************************************************
+ create_object_bvh:
+  In:  obj: a polygon or box object
+  Out: The hierarchy over the walls of the object. Boxes are padded a little,
+       so that points on a wall are found by the traversal.
+***************************************************************************/
+static struct wall_bvh *create_object_bvh(struct object *obj) {
+  struct wall_bvh *bvh =
+      CHECKED_MALLOC_STRUCT(struct wall_bvh, "wall hierarchy");
+  bvh->obj = obj;
+  bvh->n_walls = 0;
+  bvh->n_nodes = 0;
+  bvh->walls = NULL;
+  bvh->nodes = NULL;
+  bvh->eps = EPS_C;
+
+  for (int i = 0; i < obj->n_walls; i++) {
+    if (obj->wall_p[i] != NULL)
+      bvh->n_walls++;
+  }
+  if (bvh->n_walls == 0)
+    return bvh;
+
+  struct bvh_item *items = CHECKED_MALLOC_ARRAY(
+      struct bvh_item, bvh->n_walls, "wall hierarchy construction");
+  double extent = 1.0;
+  int n = 0;
+  for (int i = 0; i < obj->n_walls; i++) {
+    struct wall *w = obj->wall_p[i];
+    if (w == NULL)
+      continue;
+    struct bvh_item *it = &items[n++];
+    it->w = w;
+    it->llf = *w->vert[0];
+    it->urb = *w->vert[0];
+    for (int k = 1; k < 3; k++) {
+      it->llf.x = min2d(it->llf.x, w->vert[k]->x);
+      it->llf.y = min2d(it->llf.y, w->vert[k]->y);
+      it->llf.z = min2d(it->llf.z, w->vert[k]->z);
+      it->urb.x = max2d(it->urb.x, w->vert[k]->x);
+      it->urb.y = max2d(it->urb.y, w->vert[k]->y);
+      it->urb.z = max2d(it->urb.z, w->vert[k]->z);
+    }
+    it->center.x = 0.5 * (it->llf.x + it->urb.x);
+    it->center.y = 0.5 * (it->llf.y + it->urb.y);
+    it->center.z = 0.5 * (it->llf.z + it->urb.z);
+    extent = max2d(extent, max2d(fabs(it->llf.x), fabs(it->urb.x)));
+    extent = max2d(extent, max2d(fabs(it->llf.y), fabs(it->urb.y)));
+    extent = max2d(extent, max2d(fabs(it->llf.z), fabs(it->urb.z)));
+  }
+
+  /* Coordinates are only good to about EPS_C relative to their size */
+  bvh->eps = EPS_C * extent;
+  for (int i = 0; i < n; i++) {
+    items[i].llf.x -= bvh->eps;
+    items[i].llf.y -= bvh->eps;
+    items[i].llf.z -= bvh->eps;
+    items[i].urb.x += bvh->eps;
+    items[i].urb.y += bvh->eps;
+    items[i].urb.z += bvh->eps;
+  }
+
+  bvh->nodes = CHECKED_MALLOC_ARRAY(struct wall_bvh_node, 2 * n - 1,
+                                    "wall hierarchy nodes");
+  build_bvh_node(bvh, items, 0, n);
+
+  bvh->walls =
+      CHECKED_MALLOC_ARRAY(struct wall *, n, "wall hierarchy walls");
+  for (int i = 0; i < n; i++)
+    bvh->walls[i] = items[i].w;
+
+  free(items);
+  return bvh;
+}
+
+/***************************************************************************
+ collect_wall_objects:
+  In:  obj: an object in the instance tree
+       objects: array of objects with walls (may be NULL to just count them)
+       n_objects: number of objects found so far
+  Out: None. All the polygon and box objects below obj are added.
+***************************************************************************/
+static void collect_wall_objects(struct object *obj, struct object **objects,
+                                 int *n_objects) {
+  for (; obj != NULL; obj = obj->next) {
+    if (obj->object_type == META_OBJ)
+      collect_wall_objects(obj->first_child, objects, n_objects);
+    else if ((obj->object_type == POLY_OBJ || obj->object_type == BOX_OBJ) &&
+             obj->wall_p != NULL && obj->n_walls > 0) {
+      if (objects != NULL)
+        objects[*n_objects] = obj;
+      (*n_objects)++;
+    }
+  }
+}
+
+/***************************************************************************
+ get_wall_objects:
+  In:  world: simulation state
+       n_objects: number of objects is stored here
+  Out: All the instantiated objects that have walls.
+***************************************************************************/
+struct object **get_wall_objects(struct volume *world, int *n_objects) {
+  if (world->wall_bvhs == NULL) {
+    struct wall_bvh_index *index =
+        CHECKED_MALLOC_STRUCT(struct wall_bvh_index, "wall hierarchy index");
+    index->n_objects = 0;
+    collect_wall_objects(world->root_instance, NULL, &index->n_objects);
+    index->objects = CHECKED_MALLOC_ARRAY(
+        struct object *, index->n_objects + 1, "wall hierarchy index");
+    index->n_objects = 0;
+    collect_wall_objects(world->root_instance, index->objects,
+                         &index->n_objects);
+    world->wall_bvhs = index;
+  }
+
+  *n_objects = world->wall_bvhs->n_objects;
+  return world->wall_bvhs->objects;
+}
+
+/***************************************************************************
+ get_object_bvh:
+  In:  world: simulation state
+       obj: a polygon or box object
+  Out: The hierarchy over the walls of obj, built on first use.
+***************************************************************************/
+struct wall_bvh *get_object_bvh(struct volume *world, struct object *obj) {
+  if (obj->wall_bvh == NULL) {
+    /* Make sure the index exists, since that is where the hierarchies are
+     * released from */
+    int n_objects;
+    get_wall_objects(world, &n_objects);
+    obj->wall_bvh = create_object_bvh(obj);
+  }
+  return obj->wall_bvh;
+}
+
+/***************************************************************************
+ destroy_wall_bvhs:
+  In:  world: simulation state
+  Out: None. All the wall hierarchies are freed. This has to happen whenever
+       the walls change (dynamic geometry).
+***************************************************************************/
+void destroy_wall_bvhs(struct volume *world) {
+  struct wall_bvh_index *index = world->wall_bvhs;
+  if (index == NULL)
+    return;
+
+  for (int i = 0; i < index->n_objects; i++) {
+    struct wall_bvh *bvh = index->objects[i]->wall_bvh;
+    if (bvh == NULL)
+      continue;
+    free(bvh->walls);
+    free(bvh->nodes);
+    free(bvh);
+    index->objects[i]->wall_bvh = NULL;
+  }
+  free(index->objects);
+  free(index);
+  world->wall_bvhs = NULL;
+}
+
+/***************************************************************************
+ containment_direction:
+  In:  attempt: number of directions tried so far
+       dir: the unit direction of the next ray is stored here
+  Out: None.
+***************************************************************************/
+void containment_direction(int attempt, struct vector3 *dir) {
+  double const *d =
+      containment_directions[attempt % N_CONTAINMENT_DIRECTIONS];
+  dir->x = d[0];
+  dir->y = d[1];
+  dir->z = d[2];
+  normalize(dir);
+}
+
+void init_wall_crossing_list(struct wall_crossing_list *wcl) {
+  wcl->crossings = NULL;
+  wcl->n_crossings = 0;
+  wcl->max_crossings = 0;
+}
+
+void free_wall_crossing_list(struct wall_crossing_list *wcl) {
+  free(wcl->crossings);
+  init_wall_crossing_list(wcl);
+}
+
+/***************************************************************************
+ ray_hits_box:
+  In:  origin: start of the ray
+       dir: direction of the ray
+       llf, urb: corners of the box
+  Out: 1 if the ray (which goes on forever) passes through the box, 0 if not.
+***************************************************************************/
+static int ray_hits_box(struct vector3 const *origin, struct vector3 const *dir,
+                        struct vector3 const *llf, struct vector3 const *urb) {
+  double o[3] = { origin->x, origin->y, origin->z };
+  double d[3] = { dir->x, dir->y, dir->z };
+  double lo[3] = { llf->x, llf->y, llf->z };
+  double hi[3] = { urb->x, urb->y, urb->z };
+  double t_min = 0.0, t_max = GIGANTIC;
+
+  for (int i = 0; i < 3; i++) {
+    if (d[i] == 0.0) {
+      if (o[i] < lo[i] || o[i] > hi[i])
+        return 0;
+      continue;
+    }
+    double t1 = (lo[i] - o[i]) / d[i];
+    double t2 = (hi[i] - o[i]) / d[i];
+    if (t1 > t2) {
+      double tmp = t1;
+      t1 = t2;
+      t2 = tmp;
+    }
+    t_min = max2d(t_min, t1);
+    t_max = min2d(t_max, t2);
+    if (t_min > t_max)
+      return 0;
+  }
+  return 1;
+}
+
+/***************************************************************************
+ ray_wall_crossing:
+  In:  origin: start of the ray
+       dir: unit direction of the ray
+       w: wall
+       eps: distance below which the origin is considered to be on the wall
+       crossing: where the crossing is stored
+  Out: 1 if the ray crosses or grazes the wall, 0 if it misses.
+***************************************************************************/
+int ray_wall_crossing(struct vector3 const *origin, struct vector3 const *dir,
+                      struct wall *w, double eps,
+                      struct wall_crossing *crossing) {
+  struct vector3 const *n = &w->normal;
+  double dn = dir->x * n->x + dir->y * n->y + dir->z * n->z;
+  double dist = origin->x * n->x + origin->y * n->y + origin->z * n->z - w->d;
+
+  crossing->w = w;
+  if (fabs(dn) < PARALLEL_EPS) {
+    if (fabs(dist) > eps)
+      return 0;
+    /* The ray runs along the plane of the wall */
+    crossing->t = 0.0;
+    crossing->sign = 0;
+    return 1;
+  }
+
+  double t = -dist / dn;
+  if (t < -eps)
+    return 0;
+
+  /* Barycentric coordinates of the point where the ray meets the plane */
+  struct vector3 const *v0 = w->vert[0];
+  struct vector3 e1 = { w->vert[1]->x - v0->x, w->vert[1]->y - v0->y,
+                        w->vert[1]->z - v0->z };
+  struct vector3 e2 = { w->vert[2]->x - v0->x, w->vert[2]->y - v0->y,
+                        w->vert[2]->z - v0->z };
+  struct vector3 p = { origin->x + t * dir->x - v0->x,
+                       origin->y + t * dir->y - v0->y,
+                       origin->z + t * dir->z - v0->z };
+  double d00 = e1.x * e1.x + e1.y * e1.y + e1.z * e1.z;
+  double d01 = e1.x * e2.x + e1.y * e2.y + e1.z * e2.z;
+  double d11 = e2.x * e2.x + e2.y * e2.y + e2.z * e2.z;
+  double d20 = p.x * e1.x + p.y * e1.y + p.z * e1.z;
+  double d21 = p.x * e2.x + p.y * e2.y + p.z * e2.z;
+  double denom = d00 * d11 - d01 * d01;
+  if (denom <= 0.0)
+    return 0;
+  double b1 = (d11 * d20 - d01 * d21) / denom;
+  double b2 = (d00 * d21 - d01 * d20) / denom;
+  double b0 = 1.0 - b1 - b2;
+  double b_min = min2d(b0, min2d(b1, b2));
+  if (b_min < -BARYCENTRIC_EPS)
+    return 0;
+
+  if (t <= eps) {
+    /* The origin is on the wall */
+    crossing->t = 0.0;
+    crossing->sign = 0;
+  } else {
+    crossing->t = t;
+    crossing->sign = (b_min < BARYCENTRIC_EPS) ? 0 : ((dn > 0) ? 1 : -1);
+  }
+  return 1;
+}
+
+/***************************************************************************
+ object_ray_crossings:
+  In:  bvh: hierarchy over the walls of an object
+       origin: start of the ray
+       dir: unit direction of the ray
+       wcl: list the crossings are appended to
+  Out: None. Every wall of the object that the ray crosses or grazes is
+       added to wcl (in no particular order).
+***************************************************************************/
+void object_ray_crossings(struct wall_bvh *bvh, struct vector3 const *origin,
+                          struct vector3 const *dir,
+                          struct wall_crossing_list *wcl) {
+  if (bvh->n_nodes == 0)
+    return;
+
+  int stack[BVH_MAX_DEPTH];
+  int n_stack = 0;
+  stack[n_stack++] = 0;
+  while (n_stack > 0) {
+    struct wall_bvh_node *np = &bvh->nodes[stack[--n_stack]];
+    if (!ray_hits_box(origin, dir, &np->llf, &np->urb))
+      continue;
+
+    if (np->count == 0) {
+      stack[n_stack++] = np->first;
+      stack[n_stack++] = (int)(np - bvh->nodes) + 1;
+      continue;
+    }
+
+    for (int i = np->first; i < np->first + np->count; i++) {
+      if (wcl->n_crossings == wcl->max_crossings) {
+        int new_max = (wcl->max_crossings == 0) ? 16 : 2 * wcl->max_crossings;
+        struct wall_crossing *bigger = CHECKED_MALLOC_ARRAY(
+            struct wall_crossing, new_max, "wall crossings");
+        if (wcl->n_crossings > 0)
+          memcpy(bigger, wcl->crossings,
+                 wcl->n_crossings * sizeof(struct wall_crossing));
+        free(wcl->crossings);
+        wcl->crossings = bigger;
+        wcl->max_crossings = new_max;
+      }
+      if (ray_wall_crossing(origin, dir, bvh->walls[i], bvh->eps,
+                            &wcl->crossings[wcl->n_crossings]))
+        wcl->n_crossings++;
+    }
+  }
+}
+
+/***************************************************************************
+ region_winding_numbers:
+  In:  world: simulation state
+       r: region
+       n_points: number of points
+       points: the points to classify
+       winding: winding numbers of the points are stored here
+  Out: None. For a closed region with outward facing normals, the winding
+       number is 1 inside and 0 outside. WINDING_UNDECIDED is stored for
+       points that lie on a wall of the region.
+***************************************************************************/
+void region_winding_numbers(struct volume *world, struct region *r,
+                            int n_points, struct vector3 const *points,
+                            int *winding) {
+  struct wall_bvh *bvh = get_object_bvh(world, r->parent);
+  struct wall_crossing_list wcl;
+  init_wall_crossing_list(&wcl);
+
+  for (int i = 0; i < n_points; i++) {
+    winding[i] = WINDING_UNDECIDED;
+    for (int attempt = 0; attempt < N_CONTAINMENT_DIRECTIONS; attempt++) {
+      struct vector3 dir;
+      containment_direction(attempt, &dir);
+      wcl.n_crossings = 0;
+      object_ray_crossings(bvh, &points[i], &dir, &wcl);
+
+      int sum = 0, grazed = 0;
+      for (int k = 0; k < wcl.n_crossings; k++) {
+        struct wall_crossing *c = &wcl.crossings[k];
+        if (!get_bit(r->membership, c->w->side))
+          continue;
+        if (c->sign == 0) {
+          grazed = 1;
+          break;
+        }
+        sum += c->sign;
+      }
+      if (!grazed) {
+        winding[i] = sum;
+        break;
+      }
+    }
+  }
+
+  free_wall_crossing_list(&wcl);
+}
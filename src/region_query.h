@@ -0,0 +1,111 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#ifndef REGION_QUERY_H
+#define REGION_QUERY_H
+
+#include <limits.h>
+
+#include "mcell_structs.h"
+
+/* Point-in-region queries shared by releases, counting and dynamic geometry.
+ *
+ * Each object gets a bounding volume hierarchy over its walls. To find out
+ * whether a point is enclosed by a region, a ray is cast from the point to
+ * infinity and the crossings with the walls of the region are summed up,
+ * +1 for leaving through the front of a wall and -1 for leaving through the
+ * back. If the ray grazes a wall of interest (passes through an edge or a
+ * vertex, or lies in the plane of the wall), it is cast again in a different
+ * direction. */
+
+/* Number of directions tried before giving up on a point */
+#define N_CONTAINMENT_DIRECTIONS 8
+
+/* Winding number of a point for which no direction gave a clean answer (the
+ * point lies on a wall of the region) */
+#define WINDING_UNDECIDED INT_MIN
+
+/* Node of a wall hierarchy. Interior nodes are followed directly by their
+ * left child. */
+struct wall_bvh_node {
+  struct vector3 llf; /* Lower left front corner of the bounding box */
+  struct vector3 urb; /* Upper right back corner of the bounding box */
+  int first;          /* Leaf: index of first wall. Interior: right child */
+  int count;          /* Leaf: number of walls. Interior: 0 */
+};
+
+/* Bounding volume hierarchy over the walls of one object */
+struct wall_bvh {
+  struct object *obj;
+  int n_walls;
+  struct wall **walls; /* Walls of the object, in leaf order */
+  int n_nodes;
+  struct wall_bvh_node *nodes;
+  double eps; /* Points closer than this to a wall are considered on it */
+};
+
+/* Hierarchies of all the objects with walls */
+struct wall_bvh_index {
+  int n_objects;
+  struct object **objects;
+};
+
+/* A crossing of a containment ray with a wall */
+struct wall_crossing {
+  struct wall *w;
+  double t; /* Distance from the origin of the ray */
+  int sign; /* +1 if the ray leaves through the front of the wall, -1 if it
+               leaves through the back, 0 if it only grazes the wall */
+};
+
+struct wall_crossing_list {
+  struct wall_crossing *crossings;
+  int n_crossings;
+  int max_crossings;
+};
+
+struct object **get_wall_objects(struct volume *world, int *n_objects);
+
+struct wall_bvh *get_object_bvh(struct volume *world, struct object *obj);
+
+void destroy_wall_bvhs(struct volume *world);
+
+void containment_direction(int attempt, struct vector3 *dir);
+
+void init_wall_crossing_list(struct wall_crossing_list *wcl);
+
+void free_wall_crossing_list(struct wall_crossing_list *wcl);
+
+int ray_wall_crossing(struct vector3 const *origin, struct vector3 const *dir,
+                      struct wall *w, double eps,
+                      struct wall_crossing *crossing);
+
+void object_ray_crossings(struct wall_bvh *bvh, struct vector3 const *origin,
+                          struct vector3 const *dir,
+                          struct wall_crossing_list *wcl);
+
+void region_winding_numbers(struct volume *world, struct region *r,
+                            int n_points, struct vector3 const *points,
+                            int *winding);
+
+#endif
@@ -152,6 +152,24 @@ struct abstract_element *ae_list_sort(struct abstract_element *ae) {
   return stack[0];
 }
 
+/*************************************************************************
+ae_list_insert_sorted:
+  In: address of the head of a linked list sorted by time
+      element to insert
+  Out: No return value.  The element is linked in ahead of the first
+       element whose time is not earlier than its own, so building a list
+       this way gives the same order as pushing every element onto the
+       front and calling ae_list_sort.
+*************************************************************************/
+void ae_list_insert_sorted(struct abstract_element **head,
+                           struct abstract_element *ae) {
+  struct abstract_element **pp = head;
+  while (*pp != NULL && (*pp)->t < ae->t)
+    pp = &(*pp)->next;
+  ae->next = *pp;
+  *pp = ae;
+}
+
 /*************************************************************************
 create_scheduler:
   In: timestep per slot in this scheduler
@@ -60,6 +60,8 @@ struct schedule_helper {
 };
 
 struct abstract_element *ae_list_sort(struct abstract_element *ae);
+void ae_list_insert_sorted(struct abstract_element **head,
+                           struct abstract_element *ae);
 
 struct schedule_helper *create_scheduler(double dt_min, double dt_max,
                                          int maxlen, double start_iterations);
@@ -205,6 +205,9 @@ struct species *new_species(void) {
   specp->chkpt_species_id = 0;
   specp->sm_dat_head = NULL;
   specp->population = 0;
+  specp->vol_partners = NULL;
+  specp->n_vol_partners = 0;
+  specp->partner_bits = NULL;
   specp->D = 0.0;
   specp->space_step = 0.0;
   specp->time_step = 0.0;
@@ -250,6 +253,8 @@ struct object *new_object(void) {
   objp->periodic_x = 0;
   objp->periodic_y = 0;
   objp->periodic_z = 0;
+  objp->mesh_id = 0;
+  objp->wall_bvh = NULL;
   objp->n_tiles = 0;
   objp->n_occupied_tiles = 0;
   init_matrix(objp->t_matrix);
@@ -206,6 +206,45 @@ void set_bit_range(struct bit_array *ba, int idx1, int idx2, int value) {
   }
 }
 
+/*******************************************************************
+test_bit_range: check whether a run of bits all have the same value
+
+ In:
+    ba: pointer to a bit_array struct
+    idx1: the index of the first bit to check
+    idx2: the index of the last bit to check
+    value: 0 = check that all bits are off; nonzero = all bits are on
+
+ Out:
+    1 if every bit from idx1 through idx2 has the value, 0 otherwise.
+    Whole words are compared at once.
+*******************************************************************/
+int test_bit_range(struct bit_array *ba, int idx1, int idx2, int value) {
+  unsigned int *data = (unsigned int *)(&(ba->nints) + 1);
+  unsigned int want = value ? ~0u : 0u;
+
+  int ofs1 = idx1 & (8 * sizeof(int) - 1);
+  int ofs2 = idx2 & (8 * sizeof(int) - 1);
+  idx1 = idx1 / (8 * sizeof(int));
+  idx2 = idx2 / (8 * sizeof(int));
+
+  unsigned int mask1 = ~0u << ofs1;
+  unsigned int mask2 = ~0u >> (8 * sizeof(int) - 1 - ofs2);
+
+  if (idx1 == idx2) {
+    mask1 &= mask2;
+    return ((data[idx1] ^ want) & mask1) == 0;
+  }
+
+  if (((data[idx1] ^ want) & mask1) != 0)
+    return 0;
+  for (int i = idx1 + 1; i < idx2; i++) {
+    if (data[i] != want)
+      return 0;
+  }
+  return ((data[idx2] ^ want) & mask2) == 0;
+}
+
 /*******************************************************************
 set_all_bits: sets all values in a bit array
 
@@ -436,6 +475,86 @@ int bisect_high(double *list, int n, double val) {
   }
 }
 
+/*************************************************************************
+build_alias_table:
+  In: weights: array of n nonnegative weights (not all zero)
+      n: number of weights
+      prob: array of n doubles to fill in
+      alias: array of n ints to fill in
+  Out: 0 on success, 1 if out of memory. prob and alias hold Walker's alias
+       table for the weights (built with Vose's method), so that an index can
+       be drawn in constant time with sample_alias_table.
+*************************************************************************/
+int build_alias_table(double const *weights, int n, double *prob, int *alias) {
+  double total = 0;
+  for (int i = 0; i < n; i++)
+    total += weights[i];
+
+  int *small = (int *)malloc(2 * n * sizeof(int));
+  if (small == NULL)
+    return 1;
+  int *large = small + n;
+  int n_small = 0, n_large = 0;
+
+  for (int i = 0; i < n; i++) {
+    prob[i] = weights[i] * n / total;
+    alias[i] = i;
+    if (prob[i] < 1.0)
+      small[n_small++] = i;
+    else
+      large[n_large++] = i;
+  }
+
+  while (n_small > 0 && n_large > 0) {
+    int s = small[--n_small];
+    int l = large[n_large - 1];
+    alias[s] = l;
+    prob[l] -= 1.0 - prob[s];
+    if (prob[l] < 1.0) {
+      n_large--;
+      small[n_small++] = l;
+    }
+  }
+
+  /* Whatever is left over differs from 1 only by roundoff */
+  while (n_large > 0)
+    prob[large[--n_large]] = 1.0;
+  while (n_small > 0)
+    prob[small[--n_small]] = 1.0;
+
+  free(small);
+  return 0;
+}
+
+/*************************************************************************
+sample_alias_table:
+  In: prob: probabilities from build_alias_table
+      alias: aliases from build_alias_table
+      n: number of entries in the table
+      u: uniform random number in [0, 1)
+      residual: if not NULL, a second uniform number in [0, 1), independent
+                of the chosen index, is derived from u and stored here
+  Out: index drawn with probability proportional to its weight
+*************************************************************************/
+int sample_alias_table(double const *prob, int const *alias, int n, double u,
+                       double *residual) {
+  double scaled = u * n;
+  int i = (int)scaled;
+  if (i >= n)
+    i = n - 1;
+  double f = scaled - i;
+
+  if (f < prob[i]) {
+    if (residual != NULL)
+      *residual = f / prob[i];
+    return i;
+  }
+
+  if (residual != NULL)
+    *residual = (f - prob[i]) / (1.0 - prob[i]);
+  return alias[i];
+}
+
 /**********************************************************************
 distinguishable: reports whether two doubles are measurably different
 
@@ -60,6 +60,7 @@ struct bit_array *duplicate_bit_array(struct bit_array *old);
 int get_bit(struct bit_array *ba, int idx);
 void set_bit(struct bit_array *ba, int idx, int value);
 void set_bit_range(struct bit_array *ba, int idx1, int idx2, int value);
+int test_bit_range(struct bit_array *ba, int idx1, int idx2, int value);
 void set_all_bits(struct bit_array *ba, int value);
 void bit_operation(struct bit_array *ba, struct bit_array *bb, char op);
 int count_bits(struct bit_array *ba);
@@ -69,6 +70,10 @@ int bisect(double *list, int n, double val);
 int bisect_near(double *list, int n, double val);
 int bisect_high(double *list, int n, double val);
 
+int build_alias_table(double const *weights, int n, double *prob, int *alias);
+int sample_alias_table(double const *prob, int const *alias, int n, double u,
+                       double *residual);
+
 int distinguishable(double a, double b, double eps);
 int is_reverse_abbrev(char *abbrev, char *full);
 
@@ -560,7 +560,7 @@ static int output_cellblender_molecules(struct volume *world,
           struct vector3 pos_output = {0.0, 0.0, 0.0};
           if (!convert_relative_to_abs_PBC_coords(
               world->periodic_box_obj,
-              mp->periodic_box,
+              &mp->periodic_box,
               world->periodic_traditional,
               &mp->pos,
               &pos_output)) {
@@ -581,7 +581,7 @@ static int output_cellblender_molecules(struct volume *world,
           struct vector3 pos_output = {0.0, 0.0, 0.0};
           if (!convert_relative_to_abs_PBC_coords(
               world->periodic_box_obj,
-              gmp->periodic_box,
+              &gmp->periodic_box,
               world->periodic_traditional,
               &where,
               &pos_output)) {
@@ -616,13 +616,13 @@ static int output_cellblender_molecules(struct volume *world,
           float norm_z = orient * gmp->grid->surface->normal.z;
 
           if (world->periodic_box_obj && !(world->periodic_traditional)) {
-            if (gmp->periodic_box->x % 2 != 0) {
+            if (gmp->periodic_box.x % 2 != 0) {
               norm_x *= -1;
             }
-            if (gmp->periodic_box->y % 2 != 0) {
+            if (gmp->periodic_box.y % 2 != 0) {
               norm_y *= -1;
             }
-            if (gmp->periodic_box->z % 2 != 0) {
+            if (gmp->periodic_box.z % 2 != 0) {
               norm_z *= -1;
             }
           }
@@ -47,6 +47,8 @@
 #include "react.h"
 #include "wall_util.h"
 #include "grid_util.h"
+#include "region_query.h"
+#include "init.h"
 #include "diffuse.h"
 
 static int test_max_release(double num_to_release, char *name);
@@ -96,45 +98,115 @@ struct subvolume *find_coarse_subvol(struct volume *state,
   int i = bisect(state->x_partitions, state->nx_parts, loc->x);
   int j = bisect(state->y_partitions, state->ny_parts, loc->y);
   int k = bisect(state->z_partitions, state->nz_parts, loc->z);
-  return &(state->subvol
-               [k + (state->nz_parts - 1) * (j + (state->ny_parts - 1) * i)]);
+  return get_subvol(state,
+                    k + (state->nz_parts - 1) * (j + (state->ny_parts - 1) * i));
+}
+
+/*************************************************************************
+materialize_subvol:
+  In: state: simulation state
+      h: index of a subvolume that still points at the empty sentinel
+  Out: The new record of subvolume h.  Most subvolumes of a large world with
+       thin geometry never hold a wall or a molecule, so records are only
+       allocated once a subvolume is used.
+*************************************************************************/
+struct subvolume *materialize_subvol(struct volume *state, int h) {
+  struct storage *local = subvol_storage(state, h);
+  struct subvolume *sv = local->free_subvols;
+  if (sv != NULL)
+    local->free_subvols = sv->next;
+  else
+    sv = (struct subvolume *)CHECKED_MEM_GET(state->subvol_mem, "subvolume");
+  init_subvolume(state, sv, h);
+  sv->next = state->used_subvols;
+  state->used_subvols = sv;
+  state->subvol[h] = sv;
+  return sv;
+}
+
+/*************************************************************************
+release_empty_subvols:
+  In: state: simulation state, between iterations
+  Out: No return value.  Subvolumes which hold neither a wall nor a molecule
+       point at the empty sentinel again, so the records of subvolumes that
+       molecules only passed through do not pile up.
+  Note: Defunct molecules waiting in a scheduler still point at the record
+        they died in, and find their memory pool through its storage.  A
+        released record is therefore kept on the free list of its storage
+        and only reused for a subvolume of that storage.
+*************************************************************************/
+void release_empty_subvols(struct volume *state) {
+  struct subvolume **link = &state->used_subvols;
+  while (*link != NULL) {
+    struct subvolume *sv = *link;
+
+    /* Walls stay until the geometry is rebuilt, so stop checking */
+    if (sv->wall_head != NULL) {
+      *link = sv->next;
+      sv->next = NULL;
+      continue;
+    }
+
+    int empty = (sv->mol_count == 0);
+    for (int l = 0; empty && l < sv->n_species_lists; l++)
+      empty = (sv->species_lists[l]->head == NULL);
+    if (!empty) {
+      link = &sv->next;
+      continue;
+    }
+
+    for (int l = 0; l < sv->n_species_lists; l++)
+      mem_put(sv->local_storage->pslv, sv->species_lists[l]);
+    free(sv->species_lists);
+    sv->species_lists = NULL;
+    sv->n_species_lists = 0;
+    sv->max_species_lists = 0;
+
+    state->subvol[sv->index] = &state->empty_subvol;
+    *link = sv->next;
+    sv->next = sv->local_storage->free_subvols;
+    sv->local_storage->free_subvols = sv;
+  }
 }
 
 /*************************************************************************
 traverse_subvol:
-  In: pointer to our current subvolume
-      pointer to a vector3 of where we want to be
-      which direction we're traveling to get there
-  Out: subvolume that's closest to where we want to be in our direction
+  In: simulation state
+      pointer to our current subvolume
+      which direction we're traveling
+  Out: neighboring subvolume in that direction, or NULL at the edge of the
+       world
   Note: BSP trees traverse is not yet implemented
 *************************************************************************/
-struct subvolume *traverse_subvol(struct subvolume *here,
-                                  int which, int ny_parts, int nz_parts) {
+struct subvolume *traverse_subvol(struct volume *state,
+                                  struct subvolume *here, int which) {
+  int nz = state->nz_parts - 1;
+  int nyz = (state->ny_parts - 1) * nz;
   switch (which) {
   case X_NEG:
     if (here->world_edge & X_NEG_BIT)
       return NULL;
-    return here - (nz_parts - 1) * (ny_parts - 1);
+    return get_subvol(state, here->index - nyz);
   case X_POS:
     if (here->world_edge & X_POS_BIT)
       return NULL;
-    return here + (nz_parts - 1) * (ny_parts - 1);
+    return get_subvol(state, here->index + nyz);
   case Y_NEG:
     if (here->world_edge & Y_NEG_BIT)
       return NULL;
-    return here - (nz_parts - 1);
+    return get_subvol(state, here->index - nz);
   case Y_POS:
     if (here->world_edge & Y_POS_BIT)
       return NULL;
-    return here + (nz_parts - 1);
+    return get_subvol(state, here->index + nz);
   case Z_NEG:
     if (here->world_edge & Z_NEG_BIT)
       return NULL;
-    return here - 1;
+    return get_subvol(state, here->index - 1);
   case Z_POS:
     if (here->world_edge & Z_POS_BIT)
       return NULL;
-    return here + 1;
+    return get_subvol(state, here->index + 1);
   default:
     mcell_internal_error(
         "Invalid direction specified in traverse_subvol (dir=%d).", which);
@@ -211,17 +283,19 @@ double collide_sv_time(struct vector3 *here, struct vector3 *move,
 
 /*************************************************************************
 next_subvol:
-  In: pointer to a vector3 of where we are (*here)
+  In: simulation state
+      pointer to a vector3 of where we are (*here)
       pointer to a vector3 of where we want to be
       our current subvolume
   Out: next subvolume along that vector or NULL if the endpoint is
          in the current subvolume.  *here is updated to just inside
          the next subvolume.
 *************************************************************************/
-struct subvolume *next_subvol(struct vector3 *here, struct vector3 *move,
-                              struct subvolume *sv, double *x_fineparts,
-                              double *y_fineparts, double *z_fineparts,
-                              int ny_parts, int nz_parts) {
+struct subvolume *next_subvol(struct volume *state, struct vector3 *here,
+                              struct vector3 *move, struct subvolume *sv) {
+  double *x_fineparts = state->x_fineparts;
+  double *y_fineparts = state->y_fineparts;
+  double *z_fineparts = state->z_fineparts;
   double dx, dy, dz, tx, ty, tz, t;
   int which;
 
@@ -343,7 +417,7 @@ struct subvolume *next_subvol(struct vector3 *here, struct vector3 *move,
     move->y *= t;
     move->z *= t;
 
-    return traverse_subvol(sv, which, ny_parts, nz_parts);
+    return traverse_subvol(state, sv, which);
   }
 }
 
@@ -386,12 +460,12 @@ int is_defunct_molecule(struct abstract_element *e) {
 /*struct surface_molecule **/
 /*place_surface_molecule(struct volume *state, struct species *s,*/
 /*                       struct vector3 *loc, short orient, double search_diam,*/
-/*                       double t, struct subvolume **psv, char *mesh_name,*/
+/*                       double t, struct subvolume **psv, int mesh_id,*/
 /*                       struct string_buffer *reg_names,*/
 /*                       struct string_buffer *regions_to_ignore) {*/
 struct wall* find_closest_wall(
     struct volume *state, struct vector3 *loc, double search_diam,
-    struct vector2 *best_uv, int *grid_index, struct species *s, char *mesh_name,
+    struct vector2 *best_uv, int *grid_index, struct species *s, int mesh_id,
     struct string_buffer *reg_names, struct string_buffer *regions_to_ignore) {
 
   double d2;
@@ -420,8 +494,8 @@ struct wall* find_closest_wall(
   struct wall_list *wl;
   for (wl = sv->wall_head; wl != NULL; wl = wl->next) {
     if (verify_wall_regions_match(
-        mesh_name, reg_names, wl->this_wall, regions_to_ignore, mesh_transp,
-        species_name)) {
+        state, mesh_id, reg_names, wl->this_wall, regions_to_ignore,
+        mesh_transp, species_name)) {
       continue; 
     }
 
@@ -436,7 +510,7 @@ struct wall* find_closest_wall(
 
   if (search_d2 > EPS_C * EPS_C) /* Might need to look in adjacent subvolumes */
   {
-    const int sv_index = sv - state->subvol;
+    const int sv_index = sv->index;
     int sv_remain = sv_index;
 
     /* Turn linear sv_index into part_x, part_y, part_z triple. */
@@ -511,10 +585,10 @@ struct wall* find_closest_wall(
             if (this_sv == sv_index)
               continue;
 
-            for (wl = state->subvol[this_sv].wall_head; wl != NULL;
+            for (wl = state->subvol[this_sv]->wall_head; wl != NULL;
                  wl = wl->next) {
               if (verify_wall_regions_match(
-                  mesh_name, reg_names, wl->this_wall, regions_to_ignore,
+                  state, mesh_id, reg_names, wl->this_wall, regions_to_ignore,
                   mesh_transp, species_name)) {
                 continue; 
               }
@@ -563,7 +637,7 @@ struct wall* find_closest_wall(
         return NULL;
       } else {
         best_w = search_nbhd_for_free(
-            state, best_w, best_uv, d2, grid_index, NULL, NULL, mesh_name,
+            state, best_w, best_uv, d2, grid_index, NULL, NULL, mesh_id,
             reg_names);
         if (best_w == NULL) {
           return NULL;
@@ -598,7 +672,7 @@ place_surface_molecule
 struct surface_molecule *
 place_surface_molecule(struct volume *state, struct species *s,
                        struct vector3 *loc, short orient, double search_diam,
-                       double t, struct subvolume **psv, char *mesh_name,
+                       double t, struct subvolume **psv, int mesh_id,
                        struct string_buffer *reg_names,
                        struct string_buffer *regions_to_ignore,
                        struct periodic_image *periodic_box) {
@@ -608,7 +682,7 @@ place_surface_molecule(struct volume *state, struct species *s,
   int grid_index = 0;
   int *grid_index_p = &grid_index;
   struct wall *best_w = find_closest_wall(
-    state, loc, search_diam, &best_uv, grid_index_p, s, mesh_name, reg_names,
+    state, loc, search_diam, &best_uv, grid_index_p, s, mesh_id, reg_names,
     regions_to_ignore);
   if (best_w == NULL) {
     return NULL; 
@@ -635,7 +709,6 @@ place_surface_molecule(struct volume *state, struct species *s,
 
   struct surface_molecule *sm;
   sm = CHECKED_MEM_GET(sv->local_storage->smol, "surface molecule");
-  sm->mesh_name = NULL;
   sm->birthplace = sv->local_storage->smol;
   sm->birthday = convert_iterations_to_seconds(
       state->start_iterations, state->time_unit,
@@ -643,11 +716,9 @@ place_surface_molecule(struct volume *state, struct species *s,
   sm->id = state->current_mol_id++;
   sm->properties = s;
   s->population++;
-  sm->periodic_box = CHECKED_MALLOC_STRUCT(struct periodic_image,
-    "periodic image descriptor");
-  sm->periodic_box->x = periodic_box->x;
-  sm->periodic_box->y = periodic_box->y;
-  sm->periodic_box->z = periodic_box->z;
+  sm->periodic_box.x = periodic_box->x;
+  sm->periodic_box.y = periodic_box->y;
+  sm->periodic_box.z = periodic_box->z;
 
   sm->flags = TYPE_SURF | ACT_NEWBIE | IN_SCHEDULE;
   if (s->space_step > 0)
@@ -670,6 +741,7 @@ place_surface_molecule(struct volume *state, struct species *s,
     return NULL; 
   }
   sm->grid->sm_list[sm->grid_index] = sm_list;
+  update_tile_occupancy(sm->grid, sm->grid_index);
   
   sm->grid->n_occupied++;
   sm->flags |= IN_SURFACE;
@@ -695,22 +767,22 @@ double!)
 struct surface_molecule *
 insert_surface_molecule(struct volume *state, struct species *s,
                         struct vector3 *loc, short orient, double search_diam,
-                        double t, char *mesh_name,
+                        double t, int mesh_id,
                         struct string_buffer *reg_names,
                         struct string_buffer *regions_to_ignore,
                         struct periodic_image *periodic_box) {
   struct subvolume *sv = NULL;
   struct surface_molecule *sm =
       place_surface_molecule(
-          state, s, loc, orient, search_diam, t, &sv, mesh_name, reg_names,
+          state, s, loc, orient, search_diam, t, &sv, mesh_id, reg_names,
           regions_to_ignore, periodic_box);
   if (sm == NULL)
     return NULL;
 
   if (periodic_box != NULL) {
-    sm->periodic_box->x = periodic_box->x;
-    sm->periodic_box->y = periodic_box->y;
-    sm->periodic_box->z = periodic_box->z;
+    sm->periodic_box.x = periodic_box->x;
+    sm->periodic_box.y = periodic_box->y;
+    sm->periodic_box.z = periodic_box->z;
   }
 
   if (sm->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED))
@@ -762,28 +834,21 @@ struct volume_molecule *insert_volume_molecule(
   struct volume_molecule *new_vm;
   new_vm = CHECKED_MEM_GET(sv->local_storage->mol, "volume molecule");
   memcpy(new_vm, vm, sizeof(struct volume_molecule));
-  new_vm->mesh_name = NULL;
-  new_vm->birthplace = sv->local_storage->mol;
   new_vm->id = state->current_mol_id++;
   new_vm->prev_v = NULL;
   new_vm->next_v = NULL;
   new_vm->next = NULL;
   new_vm->subvol = sv;
-  ht_add_molecule_to_list(&sv->mol_by_species, new_vm);
+  add_molecule_to_list(new_vm);
   sv->mol_count++;
   new_vm->properties->population++;
-  new_vm->periodic_box = CHECKED_MALLOC_STRUCT(struct periodic_image,
-    "periodic image descriptor");
-  new_vm->periodic_box->x = vm->periodic_box->x;
-  new_vm->periodic_box->y = vm->periodic_box->y;
-  new_vm->periodic_box->z = vm->periodic_box->z;
 
   if ((new_vm->properties->flags & COUNT_SOME_MASK) != 0)
     new_vm->flags |= COUNT_ME;
   if (new_vm->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) {
     count_region_from_scratch(state, (struct abstract_molecule *)new_vm, NULL,
                               1, &(new_vm->pos), NULL, new_vm->t,
-                              new_vm->periodic_box);
+                              &new_vm->periodic_box);
   }
 
   if (schedule_add(sv->local_storage->timer, new_vm))
@@ -834,98 +899,96 @@ struct volume_molecule *migrate_volume_molecule(struct volume_molecule *vm,
   if (vm->subvol->local_storage == new_sv->local_storage) {
     if (remove_from_list(vm)) {
       vm->subvol = new_sv;
-      ht_add_molecule_to_list(&new_sv->mol_by_species, vm);
+      add_molecule_to_list(vm);
       return vm;
     }
   }
 
   new_vm = CHECKED_MEM_GET(new_sv->local_storage->mol, "volume molecule");
   memcpy(new_vm, vm, sizeof(struct volume_molecule));
-  new_vm->birthplace = new_sv->local_storage->mol;
-  new_vm->mesh_name = NULL;
   new_vm->prev_v = NULL;
   new_vm->next_v = NULL;
   new_vm->next = NULL;
   new_vm->subvol = new_sv;
 
-  ht_add_molecule_to_list(&new_sv->mol_by_species, new_vm);
+  add_molecule_to_list(new_vm);
 
   collect_molecule(vm);
 
   return new_vm;
 }
 
+/*************************************************************************
+collect_expr_regions:
+  In: an expression tree containing regions to release in
+      array the distinct regions are stored in (may be NULL to count them)
+      number of regions found so far
+  Out: None. Every region of the expression is stored once.
+*************************************************************************/
+static void collect_expr_regions(struct release_evaluator *expr,
+                                 struct region **regions, int *n_regions) {
+  void *sides[2] = { expr->left,
+                     (expr->op & REXP_NO_OP) ? NULL : expr->right };
+  int is_region[2] = { expr->op & REXP_LEFT_REGION,
+                       expr->op & REXP_RIGHT_REGION };
+
+  for (int i = 0; i < 2; i++) {
+    if (sides[i] == NULL)
+      continue;
+    if (!is_region[i]) {
+      collect_expr_regions((struct release_evaluator *)sides[i], regions,
+                           n_regions);
+      continue;
+    }
+    if (regions == NULL) {
+      (*n_regions)++;
+      continue;
+    }
+    int k;
+    for (k = 0; k < *n_regions; k++) {
+      if (regions[k] == sides[i])
+        break;
+    }
+    if (k == *n_regions)
+      regions[(*n_regions)++] = (struct region *)sides[i];
+  }
+}
+
 /*************************************************************************
 eval_rel_region_3d:
-  In: an expression tree containing regions to release on
-      the waypoint for the current subvolume
-      a list of regions entered from the waypoint to the release loc.
-      a list of regions exited from the waypoint to the release loc.
-  Out: 1 if the location chosen satisfies the expression, 0 if not.
+  In: an expression tree containing regions to release in
+      the distinct regions of the expression
+      number of regions
+      flags telling whether the point is inside each of the regions
+  Out: 1 if the point satisfies the expression, 0 if not.
 *************************************************************************/
-int eval_rel_region_3d(struct release_evaluator *expr, struct waypoint *wp,
-                       struct region_list *in_regions,
-                       struct region_list *out_regions) {
-  struct region *r;
-  struct region_list *rl;
-  int satisfies_l, satisfies_r;
-
-  satisfies_l = 0;
+static int eval_rel_region_3d(struct release_evaluator *expr,
+                              struct region **regions, int n_regions,
+                              int const *inside) {
+  int satisfies_l = 0, satisfies_r = 0;
+
   if (expr->op & REXP_LEFT_REGION) {
-    r = (struct region *)expr->left;
-    for (rl = wp->regions; rl != NULL; rl = rl->next) {
-      if (rl->reg == r) {
-        satisfies_l = 1;
+    for (int k = 0; k < n_regions; k++) {
+      if (regions[k] == expr->left) {
+        satisfies_l = inside[k];
         break;
       }
     }
-    if (satisfies_l) {
-      for (rl = out_regions; rl != NULL; rl = rl->next) {
-        if (rl->reg == r) {
-          satisfies_l = 0;
-          break;
-        }
-      }
-    } else {
-      for (rl = in_regions; rl != NULL; rl = rl->next) {
-        if (rl->reg == r) {
-          satisfies_l = 1;
-          break;
-        }
-      }
-    }
   } else
-    satisfies_l = eval_rel_region_3d(expr->left, wp, in_regions, out_regions);
+    satisfies_l = eval_rel_region_3d(expr->left, regions, n_regions, inside);
 
   if (expr->op & REXP_NO_OP)
     return satisfies_l;
 
-  satisfies_r = 0;
   if (expr->op & REXP_RIGHT_REGION) {
-    r = (struct region *)expr->right;
-    for (rl = wp->regions; rl != NULL; rl = rl->next) {
-      if (rl->reg == r) {
-        satisfies_r = 1;
+    for (int k = 0; k < n_regions; k++) {
+      if (regions[k] == expr->right) {
+        satisfies_r = inside[k];
         break;
       }
     }
-    if (satisfies_r) {
-      for (rl = out_regions; rl != NULL; rl = rl->next) {
-        if (rl->reg == r) {
-          satisfies_r = 0;
-          break;
-        }
-      }
-    } else {
-      for (rl = in_regions; rl != NULL; rl = rl->next) {
-        if (rl->reg == r) {
-          satisfies_r = 1;
-          break;
-        }
-      }
-    }
   } else
-    satisfies_r = eval_rel_region_3d(expr->right, wp, in_regions, out_regions);
+    satisfies_r = eval_rel_region_3d(expr->right, regions, n_regions, inside);
 
   if (expr->op & REXP_UNION)
     return (satisfies_l || satisfies_r);
@@ -937,6 +1000,88 @@ int eval_rel_region_3d(struct release_evaluator *expr, struct waypoint *wp,
   return 0;
 }
 
+/*************************************************************************
+ classify_points_in_region:
+    Check which of a batch of points are inside the specified region. The
+    walls of each region in the expression are tested against all the
+    points before moving on to the next region.
+
+    In: state: simulation state
+        n_points: number of points
+        points: the points to classify
+        expression: release expression
+        result: 1 (inside), 0 (outside) or -1 (on a wall of one of the
+                regions, so that it can't be told) is stored for each point
+    Out: None.
+*************************************************************************/
+static void classify_points_in_region(struct volume *state, int n_points,
+                                      struct vector3 const *points,
+                                      struct release_evaluator *expression,
+                                      int *result) {
+  if (n_points == 0)
+    return;
+
+  int n_regions = 0;
+  collect_expr_regions(expression, NULL, &n_regions);
+  struct region **regions = CHECKED_MALLOC_ARRAY(
+      struct region *, n_regions + 1, "regions of release expression");
+  n_regions = 0;
+  collect_expr_regions(expression, regions, &n_regions);
+
+  int *winding = CHECKED_MALLOC_ARRAY(int, n_regions * n_points + 1,
+                                      "region winding numbers");
+  for (int k = 0; k < n_regions; k++)
+    region_winding_numbers(state, regions[k], n_points, points,
+                           winding + k * n_points);
+
+  int *inside =
+      CHECKED_MALLOC_ARRAY(int, n_regions + 1, "regions containing point");
+  for (int i = 0; i < n_points; i++) {
+    result[i] = 0;
+    for (int k = 0; k < n_regions; k++) {
+      int wn = winding[k * n_points + i];
+      if (wn == WINDING_UNDECIDED) {
+        result[i] = -1;
+        break;
+      }
+      inside[k] = (wn > 0);
+    }
+    if (result[i] == 0)
+      result[i] = eval_rel_region_3d(expression, regions, n_regions, inside);
+  }
+
+  free(inside);
+  free(winding);
+  free(regions);
+}
+
+/*************************************************************************
+ classify_point_in_region:
+    Check if a given point is inside the specified region.
+
+    Out: 1 if the point is inside, 0 if it is outside, -1 if it lies on a
+         wall of one of the regions, so that it can't be told.
+*************************************************************************/
+static int classify_point_in_region(struct volume *state,
+                                    struct vector3 const *pos,
+                                    struct release_evaluator *expression) {
+  int result;
+  classify_points_in_region(state, 1, pos, expression, &result);
+  return result;
+}
+
+/*************************************************************************
+ is_point_inside_region:
+    Check if a given point is inside the specified region. Points for which
+    this can't be decided are treated as outside.
+
+*************************************************************************/
+static int is_point_inside_region(struct volume *state,
+                                  struct vector3 const *pos,
+                                  struct release_evaluator *expression) {
+  return classify_point_in_region(state, pos, expression) > 0;
+}
+
 /*************************************************************************
 vacuum_inside_regions:
   In: pointer to a release site object
@@ -950,25 +1095,7 @@ vacuum_inside_regions:
 static int vacuum_inside_regions(struct volume *state,
                                  struct release_site_obj *rso,
                                  struct volume_molecule *vm, int n) {
-  struct volume_molecule *mp;
-  struct release_region_data *rrd;
-  struct region_list *extra_in, *extra_out;
-  struct region_list *rl, *rl2;
-  struct waypoint *wp;
-  struct subvolume *sv = NULL;
-  struct mem_helper *mh;
-  struct void_list *vl;
-  struct void_list *vl_head = NULL;
-  int vl_num = 0;
-  double t;
-  struct vector3 hit, delta;
-  struct vector3 *origin;
-  struct wall_list *wl;
-
-  rrd = rso->region_data;
-  mh = create_mem(sizeof(struct void_list), 1024);
-  if (mh == NULL)
-    return 1;
+  struct release_region_data *rrd = rso->region_data;
 
   const int x_min = bisect(state->x_partitions, state->nx_parts, rrd->llf.x);
   const int x_max =
@@ -980,89 +1107,61 @@ static int vacuum_inside_regions(struct volume *state,
   const int z_max =
       bisect_high(state->z_partitions, state->nz_parts, rrd->urb.z);
 
+  /* Gather the molecules in the subvolumes overlapping the region, so that
+   * they can be classified in one batch */
+  int n_mols = 0, max_mols = 0;
+  struct volume_molecule **mols = NULL;
+  struct vector3 *pos = NULL;
   for (int px = x_min; px < x_max; px++) {
     for (int py = y_min; py < y_max; py++) {
       for (int pz = z_min; pz < z_max; pz++) {
         const int this_sv =
             pz + (state->nz_parts - 1) * (py + (state->ny_parts - 1) * px);
-        sv = &(state->subvol[this_sv]);
-
-        struct per_species_list *psl =
-            (struct per_species_list *)pointer_hash_lookup(
-                &sv->mol_by_species, vm->properties, vm->properties->hashval);
-
-        if (psl != NULL) {
-          for (mp = psl->head; mp != NULL; mp = mp->next_v) {
-            extra_in = extra_out = NULL;
-            wp = &(state->waypoints[this_sv]);
-            origin = &(wp->loc);
-            delta.x = mp->pos.x - origin->x;
-            delta.y = mp->pos.y - origin->y;
-            delta.z = mp->pos.z - origin->z;
-
-            for (wl = sv->wall_head; wl != NULL; wl = wl->next) {
-              int hitcode = collide_wall(origin, &delta, wl->this_wall, &t,
-                                         &hit, 0, state->rng, state->notify,
-                                         &(state->ray_polygon_tests));
-              if (hitcode != COLLIDE_MISS) {
-                state->ray_polygon_colls++;
-
-                for (rl = wl->this_wall->counting_regions; rl != NULL;
-                     rl = rl->next) {
-                  if (hitcode == COLLIDE_FRONT || hitcode == COLLIDE_BACK) {
-                    rl2 = (struct region_list *)CHECKED_MEM_GET(
-                        sv->local_storage->regl, "region list");
-                    rl2->reg = rl->reg;
-
-                    if (hitcode == COLLIDE_FRONT) {
-                      rl2->next = extra_in;
-                      extra_in = rl2;
-                    } else /*hitcode == COLLIDE_BACK*/
-                    {
-                      rl2->next = extra_out;
-                      extra_out = rl2;
-                    }
-                  }
-                }
-              }
-            }
-
-            for (rl = extra_in; rl != NULL; rl = rl->next) {
-              if (rl->reg == NULL)
-                continue;
-              for (rl2 = extra_out; rl2 != NULL; rl2 = rl2->next) {
-                if (rl2->reg == NULL)
-                  continue;
-                if (rl->reg == rl2->reg) {
-                  rl->reg = NULL;
-                  rl2->reg = NULL;
-                  break;
-                }
-              }
+        struct subvolume *sv = state->subvol[this_sv];
+
+        struct per_species_list *psl = find_species_list(sv, vm->properties);
+        if (psl == NULL)
+          continue;
+
+        for (struct volume_molecule *mp = psl->head; mp != NULL;
+             mp = mp->next_v) {
+          if (n_mols == max_mols) {
+            max_mols = (max_mols == 0) ? 1024 : 2 * max_mols;
+            struct volume_molecule **new_mols = CHECKED_MALLOC_ARRAY(
+                struct volume_molecule *, max_mols, "molecules to remove");
+            struct vector3 *new_pos = CHECKED_MALLOC_ARRAY(
+                struct vector3, max_mols, "molecules to remove");
+            if (n_mols > 0) {
+              memcpy(new_mols, mols, n_mols * sizeof(struct volume_molecule *));
+              memcpy(new_pos, pos, n_mols * sizeof(struct vector3));
             }
-
-            if (eval_rel_region_3d(rrd->expression, wp, extra_in, extra_out)) {
-              vl = (struct void_list *)CHECKED_MEM_GET(mh, "temporary list");
-              vl->data = mp;
-              vl->next = vl_head;
-              vl_head = vl;
-              vl_num++;
-            }
-
-            if (extra_in != NULL)
-              mem_put_list(sv->local_storage->regl, extra_in);
-            if (extra_out != NULL)
-              mem_put_list(sv->local_storage->regl, extra_out);
+            free(mols);
+            free(pos);
+            mols = new_mols;
+            pos = new_pos;
           }
+          mols[n_mols] = mp;
+          pos[n_mols] = mp->pos;
+          n_mols++;
         }
       }
     }
   }
 
-  for (vl = vl_head; n < 0 && vl_num > 0 && vl != NULL;
-       vl = vl->next, vl_num--) {
+  int *inside = CHECKED_MALLOC_ARRAY(int, n_mols + 1, "molecules to remove");
+  classify_points_in_region(state, n_mols, pos, rrd->expression, inside);
+  int vl_num = 0;
+  for (int i = 0; i < n_mols; i++) {
+    if (inside[i] > 0)
+      vl_num++;
+  }
+
+  /* Latest found first */
+  for (int i = n_mols - 1; n < 0 && vl_num > 0 && i >= 0; i--) {
+    if (inside[i] <= 0)
+      continue;
     if (rng_dbl(state->rng) < ((double)(-n)) / ((double)vl_num)) {
-      mp = (struct volume_molecule *)vl->data;
+      struct volume_molecule *mp = mols[i];
       mp->properties->population--;
       mp->subvol->mol_count--;
       if ((mp->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) != 0)
@@ -1076,113 +1175,275 @@ static int vacuum_inside_regions(struct volume *state,
 
       n++;
     }
+    vl_num--;
   }
 
-  delete_mem(mh);
+  free(inside);
+  free(pos);
+  free(mols);
   return 0;
 }
 
-/*************************************************************************
- is_point_inside_release_region:
-    Check if a given point is inside the specified region.
+/* Classification of the voxels of a release_voxel_map while it is built */
+enum voxel_class_t {
+  VOXEL_UNKNOWN,  /* Not classified yet */
+  VOXEL_BOUNDARY, /* A wall of the region passes through the voxel */
+  VOXEL_INSIDE,   /* Entirely inside the region */
+  VOXEL_OUTSIDE   /* Entirely outside the region */
+};
 
+/*************************************************************************
+ mark_boundary_voxels:
+  In: map: voxel map under construction
+      voxel_class: classification of each voxel
+      r: a region of the release expression
+  Out: None. Every voxel that one of the walls of r passes through is
+       marked as a boundary voxel.
 *************************************************************************/
-static int is_point_inside_region(struct volume *state,
-                                  struct vector3 const *pos,
-                                  struct release_evaluator *expression,
-                                  struct subvolume *sv) {
-  struct region_list *extra_in = NULL, *extra_out = NULL, *cur_region;
-  struct waypoint *wp;
-  struct vector3 delta;
-  struct vector3 *origin;
-  struct wall_list *wl;
-  int bad_location = 0;
-  int result;
-
-  /* If no subvolume hint was given, or the hint is incorrect, find the right
-   * subvolume
-   */
-  if (sv == NULL ||
-      !inside_subvolume((struct vector3 *)pos, sv, state->x_fineparts,
-                        state->y_fineparts, state->z_fineparts))
-    sv = find_subvolume(state, (struct vector3 *)pos, sv);
-
-  /* Find waypoint, compute trajectory from waypoint */
-  wp = &(state->waypoints[sv - state->subvol]);
-  origin = &(wp->loc);
-  delta.x = pos->x - origin->x;
-  delta.y = pos->y - origin->y;
-  delta.z = pos->z - origin->z;
+static void mark_boundary_voxels(struct release_voxel_map *map,
+                                 byte *voxel_class, struct region *r) {
+  /* Walls that just touch a voxel are counted as passing through it */
+  struct vector3 leeway = { .x = 1e-3 * map->voxel_size.x,
+                            .y = 1e-3 * map->voxel_size.y,
+                            .z = 1e-3 * map->voxel_size.z };
+
+  struct object *objp = r->parent;
+  for (int n_wall = 0; n_wall < r->membership->nbits; n_wall++) {
+    if (!get_bit(r->membership, n_wall))
+      continue;
+    struct wall *w = objp->wall_p[n_wall];
+    if (w == NULL)
+      continue;
 
-  for (wl = sv->wall_head; wl != NULL; wl = wl->next) {
-    struct vector3 hit_pos;
-    double hit_time;
-    int hit_check =
-        collide_wall(origin, &delta, wl->this_wall, &hit_time, &hit_pos, 0,
-                     state->rng, state->notify, &(state->ray_polygon_tests));
-
-    if (hit_check != COLLIDE_MISS) {
-      state->ray_polygon_colls++;
-
-      if ((hit_time > -EPS_C && hit_time < EPS_C) ||
-          (hit_time > 1.0 - EPS_C && hit_time < 1.0 + EPS_C)) {
-        bad_location = 1;
-        break;
-      }
+    struct vector3 w_llf = *w->vert[0], w_urb = *w->vert[0];
+    for (int i = 1; i < 3; i++) {
+      w_llf.x = min2d(w_llf.x, w->vert[i]->x);
+      w_llf.y = min2d(w_llf.y, w->vert[i]->y);
+      w_llf.z = min2d(w_llf.z, w->vert[i]->z);
+      w_urb.x = max2d(w_urb.x, w->vert[i]->x);
+      w_urb.y = max2d(w_urb.y, w->vert[i]->y);
+      w_urb.z = max2d(w_urb.z, w->vert[i]->z);
+    }
 
-      for (cur_region = wl->this_wall->counting_regions; cur_region != NULL;
-           cur_region = cur_region->next) {
-        struct region_list *crossed_region =
-            (struct region_list *)CHECKED_MEM_GET(sv->local_storage->regl,
-                                                  "region list");
-        crossed_region->reg = cur_region->reg;
-
-        if (hit_check == COLLIDE_FRONT) {
-          crossed_region->next = extra_in;
-          extra_in = crossed_region;
-        } else if (hit_check == COLLIDE_BACK) {
-          crossed_region->next = extra_out;
-          extra_out = crossed_region;
-        } else {
-          bad_location = 1;
-          break;
+    int x0 = (int)floor((w_llf.x - leeway.x - map->llf.x) / map->voxel_size.x);
+    int y0 = (int)floor((w_llf.y - leeway.y - map->llf.y) / map->voxel_size.y);
+    int z0 = (int)floor((w_llf.z - leeway.z - map->llf.z) / map->voxel_size.z);
+    int x1 = (int)floor((w_urb.x + leeway.x - map->llf.x) / map->voxel_size.x);
+    int y1 = (int)floor((w_urb.y + leeway.y - map->llf.y) / map->voxel_size.y);
+    int z1 = (int)floor((w_urb.z + leeway.z - map->llf.z) / map->voxel_size.z);
+    x0 = (x0 < 0) ? 0 : x0;
+    y0 = (y0 < 0) ? 0 : y0;
+    z0 = (z0 < 0) ? 0 : z0;
+    x1 = (x1 >= map->nx) ? map->nx - 1 : x1;
+    y1 = (y1 >= map->ny) ? map->ny - 1 : y1;
+    z1 = (z1 >= map->nz) ? map->nz - 1 : z1;
+
+    for (int z = z0; z <= z1; z++) {
+      for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+          int idx = x + map->nx * (y + map->ny * z);
+          if (voxel_class[idx] == VOXEL_BOUNDARY)
+            continue;
+          struct vector3 b0 = {
+            .x = map->llf.x + x * map->voxel_size.x - leeway.x,
+            .y = map->llf.y + y * map->voxel_size.y - leeway.y,
+            .z = map->llf.z + z * map->voxel_size.z - leeway.z };
+          struct vector3 b1 = {
+            .x = b0.x + map->voxel_size.x + 2 * leeway.x,
+            .y = b0.y + map->voxel_size.y + 2 * leeway.y,
+            .z = b0.z + map->voxel_size.z + 2 * leeway.z };
+          if (wall_in_box(w->vert, &w->normal, w->d, &b0, &b1))
+            voxel_class[idx] = VOXEL_BOUNDARY;
         }
       }
     }
   }
+}
 
-  if (bad_location) {
-    if (extra_in != NULL)
-      mem_put_list(sv->local_storage->regl, extra_in);
-    if (extra_out != NULL)
-      mem_put_list(sv->local_storage->regl, extra_out);
-    return 0;
+/*************************************************************************
+ mark_boundary_voxels_expr:
+  In: map: voxel map under construction
+      voxel_class: classification of each voxel
+      expr: release expression
+  Out: None. Boundary voxels of all regions in expr are marked.
+*************************************************************************/
+static void mark_boundary_voxels_expr(struct release_voxel_map *map,
+                                      byte *voxel_class,
+                                      struct release_evaluator *expr) {
+  if (expr->left != NULL) {
+    if (expr->op & REXP_LEFT_REGION)
+      mark_boundary_voxels(map, voxel_class, (struct region *)expr->left);
+    else
+      mark_boundary_voxels_expr(map, voxel_class, expr->left);
   }
+  if (expr->right != NULL && !(expr->op & REXP_NO_OP)) {
+    if (expr->op & REXP_RIGHT_REGION)
+      mark_boundary_voxels(map, voxel_class, (struct region *)expr->right);
+    else
+      mark_boundary_voxels_expr(map, voxel_class, expr->right);
+  }
+}
+
+/*************************************************************************
+ delete_release_voxel_map:
+  In: rrd: region data of a release site
+  Out: No return value.  The voxel map of the release region, if it was
+       built, is freed, so the next release builds it again from the walls
+       that exist then.
+*************************************************************************/
+void delete_release_voxel_map(struct release_region_data *rrd) {
+  if (rrd == NULL || rrd->voxel_map == NULL)
+    return;
 
-  for (cur_region = extra_in; cur_region != NULL;
-       cur_region = cur_region->next) {
-    struct region_list *out_region = NULL;
-    if (cur_region->reg == NULL)
+  free(rrd->voxel_map->candidates);
+  free(rrd->voxel_map);
+  rrd->voxel_map = NULL;
+}
+
+/*************************************************************************
+ create_release_voxel_map:
+  In: state: simulation state
+      rrd: region data of a 3D release site
+  Out: The voxel map for the release region.
+
+  The bounding box of the release region is cut into roughly cubic voxels.
+  Voxels that a wall of the region passes through are boundary voxels; the
+  others are grouped into face-connected components, and since no wall
+  separates neighboring voxels within a component, one point in each
+  component tells whether the whole component is inside or outside.
+*************************************************************************/
+static struct release_voxel_map *
+create_release_voxel_map(struct volume *state,
+                         struct release_region_data *rrd) {
+  const double target_voxels = 32768.0;
+  const int max_voxels_per_axis = 256;
+
+  struct release_voxel_map *map =
+      CHECKED_MALLOC_STRUCT(struct release_voxel_map, "release voxel map");
+  struct vector3 size = { .x = rrd->urb.x - rrd->llf.x,
+                          .y = rrd->urb.y - rrd->llf.y,
+                          .z = rrd->urb.z - rrd->llf.z };
+  double edge = cbrt(size.x * size.y * size.z / target_voxels);
+  map->llf = rrd->llf;
+  map->nx = (int)ceil(size.x / edge);
+  map->ny = (int)ceil(size.y / edge);
+  map->nz = (int)ceil(size.z / edge);
+  map->nx = (map->nx < 1) ? 1 : min2i(map->nx, max_voxels_per_axis);
+  map->ny = (map->ny < 1) ? 1 : min2i(map->ny, max_voxels_per_axis);
+  map->nz = (map->nz < 1) ? 1 : min2i(map->nz, max_voxels_per_axis);
+  map->voxel_size.x = size.x / map->nx;
+  map->voxel_size.y = size.y / map->ny;
+  map->voxel_size.z = size.z / map->nz;
+
+  const int n_voxels = map->nx * map->ny * map->nz;
+  byte *voxel_class =
+      CHECKED_MALLOC_ARRAY(byte, n_voxels, "release voxel classification");
+  memset(voxel_class, VOXEL_UNKNOWN, n_voxels);
+  mark_boundary_voxels_expr(map, voxel_class, rrd->expression);
+
+  /* Group the remaining voxels into face-connected components (breadth
+   * first). The voxels of component c are component[comp_start[c]] up to
+   * component[comp_start[c + 1] - 1]. VOXEL_OUTSIDE is used as a temporary
+   * "seen" mark. */
+  int *component = CHECKED_MALLOC_ARRAY(int, n_voxels, "release voxel queue");
+  int *comp_start =
+      CHECKED_MALLOC_ARRAY(int, n_voxels + 1, "release voxel components");
+  int n_components = 0, n_queued = 0;
+  for (int seed = 0; seed < n_voxels; seed++) {
+    if (voxel_class[seed] != VOXEL_UNKNOWN)
       continue;
-    for (out_region = extra_out; out_region != NULL;
-         out_region = out_region->next) {
-      if (out_region->reg == NULL)
-        continue;
-      if (cur_region->reg == out_region->reg) {
-        cur_region->reg = NULL;
-        out_region->reg = NULL;
-        break;
+
+    comp_start[n_components++] = n_queued;
+    component[n_queued++] = seed;
+    voxel_class[seed] = VOXEL_OUTSIDE;
+    for (int head = comp_start[n_components - 1]; head < n_queued; head++) {
+      int idx = component[head];
+      int x = idx % map->nx;
+      int y = (idx / map->nx) % map->ny;
+      int z = idx / (map->nx * map->ny);
+      int nbr[6] = { (x > 0) ? idx - 1 : -1,
+                     (x < map->nx - 1) ? idx + 1 : -1,
+                     (y > 0) ? idx - map->nx : -1,
+                     (y < map->ny - 1) ? idx + map->nx : -1,
+                     (z > 0) ? idx - map->nx * map->ny : -1,
+                     (z < map->nz - 1) ? idx + map->nx * map->ny : -1 };
+      for (int i = 0; i < 6; i++) {
+        if (nbr[i] >= 0 && voxel_class[nbr[i]] == VOXEL_UNKNOWN) {
+          voxel_class[nbr[i]] = VOXEL_OUTSIDE;
+          component[n_queued++] = nbr[i];
+        }
       }
     }
   }
+  comp_start[n_components] = n_queued;
+
+  /* Test the centers of a few voxels spread over each component, all
+   * components in one batch. If the answers are unclear or disagree, fall
+   * back to exact tests for every point released in the component. */
+  struct vector3 *centers = CHECKED_MALLOC_ARRAY(
+      struct vector3, 3 * n_components + 1, "release voxel probes");
+  int *probe_result = CHECKED_MALLOC_ARRAY(int, 3 * n_components + 1,
+                                           "release voxel probes");
+  for (int c = 0; c < n_components; c++) {
+    int first = comp_start[c];
+    int n_comp = comp_start[c + 1] - first;
+    int probes[3] = { component[first], component[first + n_comp / 2],
+                      component[first + n_comp - 1] };
+    for (int i = 0; i < 3; i++) {
+      int idx = probes[i];
+      struct vector3 *center = &centers[3 * c + i];
+      center->x = map->llf.x + (idx % map->nx + 0.5) * map->voxel_size.x;
+      center->y =
+          map->llf.y + ((idx / map->nx) % map->ny + 0.5) * map->voxel_size.y;
+      center->z =
+          map->llf.z + (idx / (map->nx * map->ny) + 0.5) * map->voxel_size.z;
+    }
+  }
+  classify_points_in_region(state, 3 * n_components, centers, rrd->expression,
+                            probe_result);
+
+  for (int c = 0; c < n_components; c++) {
+    int first = comp_start[c];
+    int n_comp = comp_start[c + 1] - first;
+    int n_probes = (n_comp < 3) ? n_comp : 3;
+    int inside = -1;
+    for (int i = 0; i < n_probes; i++) {
+      int result = probe_result[3 * c + i];
+      if (result < 0 || (i > 0 && result != inside)) {
+        inside = -1;
+        break;
+      }
+      inside = result;
+    }
 
-  result = eval_rel_region_3d(expression, wp, extra_in, extra_out);
-
-  if (extra_in != NULL)
-    mem_put_list(sv->local_storage->regl, extra_in);
-  if (extra_out != NULL)
-    mem_put_list(sv->local_storage->regl, extra_out);
-  return result;
+    byte cls = (inside < 0) ? VOXEL_BOUNDARY
+                            : (inside ? VOXEL_INSIDE : VOXEL_OUTSIDE);
+    for (int i = first; i < first + n_comp; i++)
+      voxel_class[component[i]] = cls;
+  }
+  free(probe_result);
+  free(centers);
+  free(comp_start);
+
+  /* Interior voxels first, then boundary voxels */
+  map->n_inside = 0;
+  map->n_candidates = 0;
+  for (int idx = 0; idx < n_voxels; idx++) {
+    if (voxel_class[idx] == VOXEL_INSIDE)
+      component[map->n_candidates++] = idx;
+  }
+  map->n_inside = map->n_candidates;
+  for (int idx = 0; idx < n_voxels; idx++) {
+    if (voxel_class[idx] == VOXEL_BOUNDARY)
+      component[map->n_candidates++] = idx;
+  }
+  map->candidates =
+      CHECKED_MALLOC_ARRAY(int, map->n_candidates + 1, "release voxels");
+  memcpy(map->candidates, component, map->n_candidates * sizeof(int));
+
+  free(component);
+  free(voxel_class);
+  return map;
 }
 
 /*************************************************************************
@@ -1213,14 +1474,43 @@ static int release_inside_regions(struct volume *state,
   if (n < 0)
     return vacuum_inside_regions(state, rso, vm, n);
 
+  if (rrd->voxel_map == NULL)
+    rrd->voxel_map = create_release_voxel_map(state, rrd);
+  struct release_voxel_map *map = rrd->voxel_map;
+  if (map->n_candidates == 0)
+    return 0;
+
+  /* Fraction of the bounding box that is covered by candidate voxels */
+  const double candidate_fraction =
+      (double)map->n_candidates / (double)(map->nx * map->ny * map->nz);
+
   struct volume_molecule *new_vm = NULL;
   struct subvolume *sv = NULL;
   while (n > 0) {
-    vm->pos.x = rrd->llf.x + (rrd->urb.x - rrd->llf.x) * rng_dbl(state->rng);
-    vm->pos.y = rrd->llf.y + (rrd->urb.y - rrd->llf.y) * rng_dbl(state->rng);
-    vm->pos.z = rrd->llf.z + (rrd->urb.z - rrd->llf.z) * rng_dbl(state->rng);
+    /* An approximate number is the number of trials in the whole bounding
+     * box, so trials that would land outside of the candidate voxels are
+     * rejected up front. */
+    if (rso->release_number_method == CCNNUM && !exactNumber &&
+        rng_dbl(state->rng) >= candidate_fraction) {
+      n--;
+      continue;
+    }
 
-    if (!is_point_inside_region(state, &vm->pos, rrd->expression, NULL)) {
+    /* Pick a candidate voxel and a point within it. Only points in boundary
+     * voxels need an exact test. */
+    int slot = (int)(rng_dbl(state->rng) * map->n_candidates);
+    if (slot >= map->n_candidates)
+      slot = map->n_candidates - 1;
+    int idx = map->candidates[slot];
+    vm->pos.x = map->llf.x + (idx % map->nx + rng_dbl(state->rng)) *
+                                 map->voxel_size.x;
+    vm->pos.y = map->llf.y + ((idx / map->nx) % map->ny + rng_dbl(state->rng)) *
+                                 map->voxel_size.y;
+    vm->pos.z = map->llf.z + (idx / (map->nx * map->ny) + rng_dbl(state->rng)) *
+                                 map->voxel_size.z;
+
+    if (slot >= map->n_inside &&
+        !is_point_inside_region(state, &vm->pos, rrd->expression)) {
       if (rso->release_number_method == CCNNUM && !exactNumber)
         n--;
       continue;
@@ -1228,9 +1518,9 @@ static int release_inside_regions(struct volume *state,
 
     /* Actually place the molecule */
     vm->subvol = sv;
-    vm->periodic_box->x = rso->periodic_box->x;
-    vm->periodic_box->y = rso->periodic_box->y;
-    vm->periodic_box->z = rso->periodic_box->z;
+    vm->periodic_box.x = rso->periodic_box->x;
+    vm->periodic_box.y = rso->periodic_box->y;
+    vm->periodic_box.z = rso->periodic_box->z;
     new_vm = insert_volume_molecule(state, vm, new_vm);
     if (new_vm == NULL)
       return 1;
@@ -1284,18 +1574,13 @@ int release_molecules(struct volume *state, struct release_event_queue *req) {
   }
 
   // Set molecule characteristics.
-  vm.mesh_name = NULL;
   vm.t = req->event_time;
   vm.properties = rso->mol_type;
   vm.t2 = 0.0;
   vm.birthday = convert_iterations_to_seconds(
       state->start_iterations, state->time_unit,
       state->simulation_start_seconds, vm.t);
-  struct periodic_image periodic_box = { .x = rso->periodic_box->x,
-                                         .y = rso->periodic_box->y,
-                                         .z = rso->periodic_box->z
-                                       };
-  vm.periodic_box = &periodic_box;
+  vm.periodic_box = *rso->periodic_box;
 
   struct abstract_molecule *ap = (struct abstract_molecule *)(&vm);
 
@@ -1366,9 +1651,9 @@ int release_molecules(struct volume *state, struct release_event_queue *req) {
         vm_guess = insert_volume_molecule(state, &vm, vm_guess);
         if (vm_guess == NULL)
           return 1;
-        vm.periodic_box->x = rso->periodic_box->x;
-        vm.periodic_box->y = rso->periodic_box->y;
-        vm.periodic_box->z = rso->periodic_box->z;
+        vm.periodic_box.x = rso->periodic_box->x;
+        vm.periodic_box.y = rso->periodic_box->y;
+        vm.periodic_box.z = rso->periodic_box->z;
       }
       if (state->notify->release_events == NOTIFY_FULL) {
         mcell_log("Released %d %s from \"%s\" at iteration %lld.", number,
@@ -1461,9 +1746,9 @@ int release_ellipsoid_or_rectcuboid(struct volume *state,
     vm->pos.z = location[0][2];
     struct volume_molecule *guess = NULL;
     /* Insert copy of vm into state */
-    vm->periodic_box->x = rso->periodic_box->x;
-    vm->periodic_box->y = rso->periodic_box->y;
-    vm->periodic_box->z = rso->periodic_box->z;
+    vm->periodic_box.x = rso->periodic_box->x;
+    vm->periodic_box.y = rso->periodic_box->y;
+    vm->periodic_box.z = rso->periodic_box->z;
     guess = insert_volume_molecule(state, vm, guess); 
     if (guess == NULL)
       return 1;
@@ -1522,9 +1807,9 @@ int release_by_list(struct volume *state, struct release_event_queue *req,
       i++;
       if (vm_guess == NULL)
         return 1;
-      vm_guess->periodic_box->x = rso->periodic_box->x;
-      vm_guess->periodic_box->y = rso->periodic_box->y;
-      vm_guess->periodic_box->z = rso->periodic_box->z;
+      vm_guess->periodic_box.x = rso->periodic_box->x;
+      vm_guess->periodic_box.y = rso->periodic_box->y;
+      vm_guess->periodic_box.z = rso->periodic_box->z;
       i++;
     } else {
       double diam;
@@ -1545,7 +1830,7 @@ int release_by_list(struct volume *state, struct release_event_queue *req,
       // Don't have to set flags, insert_surface_molecule takes care of it
       struct surface_molecule *sm;
       sm = insert_surface_molecule(state, rsm->mol_type, &vm->pos, orient,
-                                   diam, req->event_time, NULL, NULL, NULL,
+                                   diam, req->event_time, 0, NULL, NULL,
                                    rso->periodic_box);
       if (sm == NULL) {
         mcell_warn("Molecule release is unable to find surface upon which "
@@ -2068,6 +2353,32 @@ void path_bounding_box(struct vector3 *loc, struct vector3 *displacement,
   urb->z += R;
 }
 
+/************************************************************************
+   In: starting position of the molecule
+       displacement (random walk) vector
+       vector to store one corner of the bounding box
+       vector to store the opposite corner of the bounding box
+   Out: No return value. The vectors are set to define a bounding box
+        that holds every path of the same length as the displacement
+        from the starting position, extended for R_INT in all
+        directions.  Reflections only shorten what is left of a random
+        walk, so the box covers the rest of the walk however the
+        molecule bounces.
+************************************************************************/
+void reach_bounding_box(struct vector3 *loc, struct vector3 *displacement,
+                        struct vector3 *llf, struct vector3 *urb,
+                        double rx_radius_3d) {
+  double reach = vect_length(displacement) + rx_radius_3d;
+
+  llf->x = loc->x - reach;
+  llf->y = loc->y - reach;
+  llf->z = loc->z - reach;
+
+  urb->x = loc->x + reach;
+  urb->y = loc->y + reach;
+  urb->z = loc->z + reach;
+}
+
 /***************************************************************************
  collect_molecule:
     Perform garbage collection on a discarded molecule.  If the molecule is no
@@ -2106,45 +2417,107 @@ void collect_molecule(struct volume_molecule *vm) {
   vm->properties = NULL;
   vm->flags &= ~IN_VOLUME;
   if ((vm->flags & IN_MASK) == 0)
-    mem_put(vm->birthplace, vm);
+    mem_put(vm->subvol->local_storage->mol, vm);
+}
+
+/***************************************************************************
+ molecule_storage:
+    Find the memory pool a molecule was allocated from.  Volume molecules
+    always live in the pool of their subvolume's storage (they are copied
+    when they move into a subvolume with different storage), so only surface
+    molecules record their pool.
+
+ In: am: the molecule
+ Out: The memory pool the molecule should be returned to.
+***************************************************************************/
+struct mem_helper *molecule_storage(struct abstract_molecule *am) {
+  if (am->flags & TYPE_VOL)
+    return ((struct volume_molecule *)am)->subvol->local_storage->mol;
+  return ((struct surface_molecule *)am)->birthplace;
+}
+
+/***************************************************************************
+ species_list_slot:
+    Binary search of the per-species lists of a subvolume, which are kept
+    sorted by species_id.
+
+ In: sv: the subvolume
+     id: species_id to look for
+ Out: Position of the first list whose species_id is not below id.
+***************************************************************************/
+static int species_list_slot(struct subvolume *sv, u_int id) {
+  int lo = 0, hi = sv->n_species_lists;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (sv->species_lists[mid]->properties->species_id < id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
 }
 
 /***************************************************************************
- ht_add_molecule_to_list:
-    Add a molecule to the appropriate molecule list in a subvolume's pointer
-    hash.  It is assumed that the molecule's subvolume pointer is valid and
-    points to the right subvolume.
-
-    If the molecule takes part in any mol-mol interactions (including
-    trimolecular reactions involving two or more volume molecules), it is added
-    to a list containing only molecules of the same species.  If it does NOT
-    take part in any such interactions, it is added to a single molecule list
-    which keeps track of all molecules which do not interact with other volume
-    molecules.
-
- In: h: the pointer hash to which to add the molecule
-     vm: the molecule
+ find_species_list:
+
+ In: sv: the subvolume
+     spec: species of volume molecules
+ Out: The list of the molecules of spec in sv, or NULL if there is none.
+      The list may be empty.
+***************************************************************************/
+struct per_species_list *find_species_list(struct subvolume *sv,
+                                           struct species *spec) {
+  int slot = species_list_slot(sv, spec->species_id);
+  if (slot < sv->n_species_lists &&
+      sv->species_lists[slot]->properties == spec)
+    return sv->species_lists[slot];
+  return NULL;
+}
+
+/***************************************************************************
+ add_molecule_to_list:
+    Add a molecule to the list of molecules of its species in its subvolume,
+    creating the list if the subvolume has none for the species yet.  It is
+    assumed that the molecule's subvolume pointer is valid and points to the
+    right subvolume.
+
+ In: vm: the molecule
  Out: Nothing.  Molecule is added to the subvolume's molecule lists.
 ***************************************************************************/
-void ht_add_molecule_to_list(struct pointer_hash *h,
-                             struct volume_molecule *vm) {
+void add_molecule_to_list(struct volume_molecule *vm) {
+  struct subvolume *sv = vm->subvol;
+  struct species *spec = vm->properties;
   struct per_species_list *list = NULL;
 
   /* See if we have a list */
-  list = (struct per_species_list *)pointer_hash_lookup(h, vm->properties,
-                                                        vm->properties->hashval);
+  int slot = species_list_slot(sv, spec->species_id);
+  if (slot < sv->n_species_lists &&
+      sv->species_lists[slot]->properties == spec)
+    list = sv->species_lists[slot];
 
-  /* If not, create one and add it in */
+  /* If not, create one and insert it in order */
   if (list == NULL) {
+    if (sv->n_species_lists == sv->max_species_lists) {
+      int max_lists =
+          (sv->max_species_lists == 0) ? 4 : 2 * sv->max_species_lists;
+      struct per_species_list **lists = CHECKED_MALLOC_ARRAY(
+          struct per_species_list *, max_lists, "per-species molecule lists");
+      if (sv->n_species_lists > 0)
+        memcpy(lists, sv->species_lists,
+               sv->n_species_lists * sizeof(struct per_species_list *));
+      free(sv->species_lists);
+      sv->species_lists = lists;
+      sv->max_species_lists = max_lists;
+    }
+
     list = (struct per_species_list *)CHECKED_MEM_GET(
-        vm->subvol->local_storage->pslv, "per-species molecule list");
-    list->properties = vm->properties;
+        sv->local_storage->pslv, "per-species molecule list");
+    list->properties = spec;
     list->head = NULL;
-    if (pointer_hash_add(h, vm->properties, vm->properties->hashval, list))
-      mcell_allocfailed("Failed to add species to subvolume species table.");
-
-    list->next = vm->subvol->species_head;
-    vm->subvol->species_head = list;
+    memmove(&sv->species_lists[slot + 1], &sv->species_lists[slot],
+            (sv->n_species_lists - slot) * sizeof(struct per_species_list *));
+    sv->species_lists[slot] = list;
+    sv->n_species_lists++;
   }
 
   /* Link the molecule into the list */
@@ -2155,28 +2528,6 @@ void ht_add_molecule_to_list(struct pointer_hash *h,
   list->head = vm;
 }
 
-/***************************************************************************
- ht_remove:
-    Remove a species list from a pointer hash.  This is a fairly simple wrapper
-    around pointer_hash_remove, which simply looks up the key (the species),
-    and avoids trying to remove the non-interacting molecules list from the
-    pointer hash, since it should never be added in the first place.
-
-    Note that the per-species list must still be valid at this point -- it must
-    not have been freed, nor its 'properties' pointer nilled.
-
- In: h: the pointer hash to which to add the molecule
-     psl: the species list to remove
- Out: Nothing.  Molecule is added to the subvolume's molecule lists.
-***************************************************************************/
-void ht_remove(struct pointer_hash *h, struct per_species_list *psl) {
-  struct species *s = psl->properties;
-  if (s == NULL)
-    return;
-
-  (void)pointer_hash_remove(h, s, s->hashval);
-}
-
 /***************************************************************************
  test_max_release:
 
@@ -2541,7 +2892,7 @@ struct surface_molecule_list* add_surfmol_with_unique_pb_to_list(
   else {
     for (; sm_list != NULL; sm_list = sm_list->next) {
       if (sm && periodic_boxes_are_identical(
-          sm_list->sm->periodic_box, sm->periodic_box)) {
+          &sm_list->sm->periodic_box, &sm->periodic_box)) {
         free(sm_entry);
         return NULL;
       }
@@ -31,13 +31,21 @@ int inside_subvolume(struct vector3 *point, struct subvolume *subvol,
 
 struct subvolume *find_coarse_subvol(struct volume *world, struct vector3 *loc);
 
-struct subvolume *traverse_subvol(struct subvolume *here,
-                                  int which, int ny_parts, int nz_parts);
+struct subvolume *materialize_subvol(struct volume *state, int h);
 
-struct subvolume *next_subvol(struct vector3 *here, struct vector3 *move,
-                              struct subvolume *sv, double *x_fineparts,
-                              double *y_fineparts, double *z_fineparts,
-                              int ny_parts, int nz_parts);
+void release_empty_subvols(struct volume *state);
+
+/* The subvolume with index h; its record is allocated on first use */
+static inline struct subvolume *get_subvol(struct volume *state, int h) {
+  struct subvolume *sv = state->subvol[h];
+  return (sv != &state->empty_subvol) ? sv : materialize_subvol(state, h);
+}
+
+struct subvolume *traverse_subvol(struct volume *state,
+                                  struct subvolume *here, int which);
+
+struct subvolume *next_subvol(struct volume *state, struct vector3 *here,
+                              struct vector3 *move, struct subvolume *sv);
 
 struct subvolume *find_subvolume(struct volume *world, struct vector3 *loc,
                                  struct subvolume *guess);
@@ -50,13 +58,13 @@ int is_defunct_molecule(struct abstract_element *e);
 
 struct wall* find_closest_wall(
     struct volume *state, struct vector3 *loc, double search_diam,
-    struct vector2 *best_uv, int *grid_index, struct species *s, char *mesh_name,
+    struct vector2 *best_uv, int *grid_index, struct species *s, int mesh_id,
     struct string_buffer *reg_names, struct string_buffer *regions_to_ignore);
 
 struct surface_molecule *
 place_surface_molecule(struct volume *state, struct species *s,
                        struct vector3 *loc, short orient, double search_diam,
-                       double t, struct subvolume **psv, char *mesh_name,
+                       double t, struct subvolume **psv, int mesh_id,
                        struct string_buffer *reg_names,
                        struct string_buffer *regions_to_ignore,
                        struct periodic_image *periodic_box);
@@ -64,7 +72,7 @@ place_surface_molecule(struct volume *state, struct species *s,
 struct surface_molecule *
 insert_surface_molecule(struct volume *state, struct species *s,
                         struct vector3 *loc, short orient, double search_diam,
-                        double t, char *mesh_name,
+                        double t, int mesh_id,
                         struct string_buffer *reg_names,
                         struct string_buffer *regions_to_ignore,
                         struct periodic_image *periodic_box);
@@ -76,10 +84,6 @@ struct volume_molecule *insert_volume_molecule(struct volume *world,
 struct volume_molecule *migrate_volume_molecule(struct volume_molecule *vm,
                                                 struct subvolume *new_sv);
 
-int eval_rel_region_3d(struct release_evaluator *expr, struct waypoint *wp,
-                       struct region_list *in_regions,
-                       struct region_list *out_regions);
-
 int release_molecules(struct volume *world, struct release_event_queue *req);
 
 int release_by_list(struct volume *state, struct release_event_queue *req,
@@ -117,11 +121,20 @@ void path_bounding_box(struct vector3 *loc, struct vector3 *displacement,
                        struct vector3 *llf, struct vector3 *urb,
                        double rx_radius_3d);
 
-void ht_add_molecule_to_list(struct pointer_hash *h, struct volume_molecule *vm);
-void ht_remove(struct pointer_hash *h, struct per_species_list *psl);
+void reach_bounding_box(struct vector3 *loc, struct vector3 *displacement,
+                        struct vector3 *llf, struct vector3 *urb,
+                        double rx_radius_3d);
+
+struct per_species_list *find_species_list(struct subvolume *sv,
+                                           struct species *spec);
+void add_molecule_to_list(struct volume_molecule *vm);
+
+void delete_release_voxel_map(struct release_region_data *rrd);
 
 void collect_molecule(struct volume_molecule *vm);
 
+struct mem_helper *molecule_storage(struct abstract_molecule *am);
+
 bool periodic_boxes_are_identical(const struct periodic_image *b1,
   const struct periodic_image *b2);
 
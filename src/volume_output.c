@@ -43,8 +43,7 @@ static int produce_item_header(FILE *out_file, struct volume_output_item *vo);
 static int produce_mol_counts(struct volume *wrld, FILE *out_file,
                               struct volume_output_item *vo);
 
-static int find_species_in_array(struct species **mols, int num_mols,
-                                 struct species *ptr);
+static int produce_subvolume_load(struct volume *wrld, FILE *out_file);
 
 static int reschedule_volume_output_item(struct volume *wrld,
                                          struct volume_output_item *vo);
@@ -170,87 +169,42 @@ static int produce_mol_counts(struct volume *wrld, FILE *out_file,
       struct subvolume *cur_partition = cur_partition_y;
       while (cur_partition != NULL &&
              wrld->x_fineparts[cur_partition->llf.x] < x_lim) {
-        /* Count molecules */
-        struct per_species_list *psl;
-        int check_nonreacting = 0;
-        int i = 0;
-        for (i = 0; i < vo->num_molecules; ++i) {
-          if (!(vo->molecules[i]->flags & CAN_VOLVOL)) {
-            check_nonreacting = 1;
-            break;
-          }
-        }
-        for (psl = cur_partition->species_head; psl != NULL; psl = psl->next) {
-          if (psl->properties == NULL) {
-            if (!check_nonreacting)
+        /* Count molecules of the species we are interested in (the list
+         * is sorted, so a species given twice is next to itself) */
+        for (int i = 0; i < vo->num_molecules; ++i) {
+          if (i > 0 && vo->molecules[i] == vo->molecules[i - 1])
+            continue;
+
+          struct per_species_list *psl =
+              find_species_list(cur_partition, vo->molecules[i]);
+          if (psl == NULL)
+            continue;
+
+          for (curmol = psl->head; curmol != NULL; curmol = curmol->next_v) {
+            /* Skip molecules not in our slab */
+            if (curmol->pos.z < z || curmol->pos.z >= z_lim_slab)
+              continue;
+
+            /* Skip molecules outside our domain */
+            if (curmol->pos.x < x || curmol->pos.x >= x_lim ||
+                curmol->pos.y < y || curmol->pos.y >= y_lim)
               continue;
-            else {
-              for (curmol = psl->head; curmol != NULL;
-                   curmol = curmol->next_v) {
-                /* See if we're interested in this molecule */
-                if (vo->num_molecules == 1) {
-                  if (*vo->molecules != curmol->properties)
-                    continue;
-                } else {
-                  if ((find_species_in_array(vo->molecules, vo->num_molecules,
-                                             curmol->properties)) == -1)
-                    continue;
-                }
-
-                /* Skip molecules not in our slab */
-                if (curmol->pos.z < z || curmol->pos.z >= z_lim_slab)
-                  continue;
-
-                /* Skip molecules outside our domain */
-                if (curmol->pos.x < x || curmol->pos.x >= x_lim ||
-                    curmol->pos.y < y || curmol->pos.y >= y_lim)
-                  continue;
-
-                /* We've got a winner!  Add one to the appropriate voxel. */
-                ++counters[((int)floor((curmol->pos.y - y) * r_voxsz_y)) *
-                               vo->nvoxels_x +
-                           (int)floor((curmol->pos.x - x) * r_voxsz_x)];
-              }
-            }
-          } else {
-            /* See if we're interested in this molecule */
-            if (vo->num_molecules == 1) {
-              if (*vo->molecules != psl->properties)
-                continue;
-            } else {
-              if ((find_species_in_array(vo->molecules, vo->num_molecules,
-                                         psl->properties)) == -1)
-                continue;
-            }
-
-            for (curmol = psl->head; curmol != NULL; curmol = curmol->next_v) {
-              /* Skip molecules not in our slab */
-              if (curmol->pos.z < z || curmol->pos.z >= z_lim_slab)
-                continue;
-
-              /* Skip molecules outside our domain */
-              if (curmol->pos.x < x || curmol->pos.x >= x_lim ||
-                  curmol->pos.y < y || curmol->pos.y >= y_lim)
-                continue;
-
-              /* We've got a winner!  Add one to the appropriate voxel. */
-              ++counters[((int)floor((curmol->pos.y - y) * r_voxsz_y)) *
-                             vo->nvoxels_x +
-                         (int)floor((curmol->pos.x - x) * r_voxsz_x)];
-            }
+
+            /* We've got a winner!  Add one to the appropriate voxel. */
+            ++counters[((int)floor((curmol->pos.y - y) * r_voxsz_y)) *
+                           vo->nvoxels_x +
+                       (int)floor((curmol->pos.x - x) * r_voxsz_x)];
           }
         }
 
         /* Advance to next x-partition */
         cur_partition =
-            traverse_subvol(cur_partition, X_POS, wrld->ny_parts,
-                            wrld->nz_parts);
+            traverse_subvol(wrld, cur_partition, X_POS);
       }
 
       /* Advance to next y-partition */
       cur_partition_y =
-          traverse_subvol(cur_partition_y, Y_POS, wrld->ny_parts,
-                          wrld->nz_parts);
+          traverse_subvol(wrld, cur_partition_y, Y_POS);
     }
 
     /* If the slab crosses a Z boundary, keep on truckin' */
@@ -259,8 +213,7 @@ static int produce_mol_counts(struct volume *wrld, FILE *out_file,
        * spill!
        */
       cur_partition_z =
-          traverse_subvol(cur_partition_z, Z_POS, wrld->ny_parts,
-                          wrld->nz_parts);
+          traverse_subvol(wrld, cur_partition_z, Z_POS);
 
       if (cur_partition_z != NULL) {
         z_lim_part = wrld->z_fineparts[cur_partition_z->urb.z];
@@ -288,25 +241,90 @@ static int produce_mol_counts(struct volume *wrld, FILE *out_file,
 }
 
 /*
- * Binary search for a pointer in an array of pointers.
+ * Write the work done in each subvolume since the last output, one block per
+ * counter, laid out like the molecule counts with one voxel per subvolume.
+ * The counters are reset afterwards.
  */
-static int find_species_in_array(struct species **mols, int num_mols,
-                                 struct species *ptr) {
-  int lo = 0, hi = num_mols;
-  while (hi - lo > 1) {
-    int mid = (hi + lo) / 2;
-    if (mols[mid] > ptr)
-      hi = mid;
-    else if (mols[mid] < ptr)
-      lo = mid;
-    else
-      return mid;
+static int produce_subvolume_load(struct volume *wrld, FILE *out_file) {
+  static char const *names[] = { "diffusion_steps", "wall_collisions",
+                                 "mol_candidates", "reactions" };
+  int nx = wrld->nx_parts - 1, ny = wrld->ny_parts - 1, nz = wrld->nz_parts - 1;
+
+  if (fprintf(out_file, "# nx=%d ny=%d nz=%d time=%lld\n", nx, ny, nz,
+              wrld->current_iterations) < 0) {
+    mcell_perror_nodie(errno, "Couldn't write header of load output file.");
+    return 1;
+  }
+
+  for (int n = 0; n < 4; ++n) {
+    fprintf(out_file, "# %s\n", names[n]);
+    for (int k = 0; k < nz; ++k) {
+      for (int j = 0; j < ny; ++j) {
+        for (int i = 0; i < nx; ++i) {
+          struct subvolume_load *load =
+              &wrld->subvol_load[k + nz * (j + ny * i)];
+          long long value;
+          switch (n) {
+          case 0:
+            value = load->diffusion_steps;
+            break;
+          case 1:
+            value = load->wall_collisions;
+            break;
+          case 2:
+            value = load->mol_candidates;
+            break;
+          default:
+            value = load->reactions;
+            break;
+          }
+          fprintf(out_file, "%lld ", value);
+        }
+        fprintf(out_file, "\n");
+      }
+
+      /* Extra newline to put visual separation between slabs */
+      fprintf(out_file, "\n");
+    }
   }
 
-  if (mols[lo] == ptr)
-    return lo;
-  else
-    return -1;
+  memset(wrld->subvol_load, 0,
+         sizeof(struct subvolume_load) * wrld->n_subvols);
+  return 0;
+}
+
+/*
+ * Write the subvolume load output (-load_heatmap) if this iteration starts a
+ * new window of load_heatmap_step iterations.  The output covers the whole
+ * iterations of the window that just ended.
+ */
+int update_load_heatmap(struct volume *wrld) {
+  long long step = (wrld->load_heatmap_step > 0) ? wrld->load_heatmap_step
+                                                 : 1000;
+  if (wrld->subvol_load == NULL ||
+      wrld->current_iterations <= wrld->start_iterations ||
+      wrld->current_iterations % step != 0)
+    return 0;
+
+  char *filename = CHECKED_SPRINTF("%s.%lld.dat", wrld->load_heatmap_prefix,
+                                   wrld->current_iterations);
+  if (make_parent_dir(filename)) {
+    free(filename);
+    return 1;
+  }
+
+  FILE *f = fopen(filename, "w");
+  if (f == NULL) {
+    mcell_perror_nodie(errno, "Couldn't open load output file '%s'.",
+                       filename);
+    free(filename);
+    return 1;
+  }
+  free(filename);
+
+  int failure = produce_subvolume_load(wrld, f);
+  fclose(f);
+  return failure;
 }
 
 /*
@@ -28,3 +28,25 @@
 int update_volume_output(struct volume *wrld, struct volume_output_item *vo);
 int output_volume_output_item(struct volume *wrld, char const *filename,
                               struct volume_output_item *vo);
+int update_load_heatmap(struct volume *wrld);
+
+/* Add n to one counter of the work done in subvolume sv (see -load_heatmap) */
+#define COUNT_SUBVOL_LOAD(wrld, sv, field, n)                                 \
+  do {                                                                        \
+    if ((wrld)->subvol_load != NULL)                                          \
+      (wrld)->subvol_load[(sv)->index].field += (n);                         \
+  } while (0)
+
+/* Count a reaction in the subvolume of its first reactant */
+static inline void count_reaction_load(struct volume *wrld,
+                                       struct abstract_molecule *am) {
+  if (wrld->subvol_load == NULL)
+    return;
+  if ((am->flags & TYPE_VOL) != 0)
+    COUNT_SUBVOL_LOAD(wrld, ((struct volume_molecule *)am)->subvol, reactions,
+                      1);
+  else if ((am->flags & TYPE_SURF) != 0 &&
+           ((struct surface_molecule *)am)->grid != NULL)
+    COUNT_SUBVOL_LOAD(wrld, ((struct surface_molecule *)am)->grid->subvol,
+                      reactions, 1);
+}
@@ -1195,8 +1195,8 @@ wall_in_box:
       opposite corner of bounding box
   Out: 1 if the wall intersects the box.  0 otherwise.
 ***************************************************************************/
-static int wall_in_box(struct vector3 **vert, struct vector3 *normal, double d,
-                       struct vector3 *b0, struct vector3 *b1) {
+int wall_in_box(struct vector3 **vert, struct vector3 *normal, double d,
+                struct vector3 *b0, struct vector3 *b1) {
 #define n_vert 3
   int temp;
   int i, j, k;
@@ -1634,11 +1634,12 @@ static struct wall *distribute_wall(struct volume *world, struct wall *w) {
 
   if ((z_max - z_min) * (y_max - y_min) * (x_max - x_min) == 1) {
     h = z_min + (world->nz_parts - 1) * (y_min + (world->ny_parts - 1) * x_min);
-    where_am_i = localize_wall(w, world->subvol[h].local_storage);
+    struct subvolume *sv = get_subvol(world, h);
+    where_am_i = localize_wall(w, sv->local_storage);
     if (where_am_i == NULL)
       return NULL;
 
-    if (wall_to_vol(where_am_i, &(world->subvol[h])) == NULL)
+    if (wall_to_vol(where_am_i, sv) == NULL)
       return NULL;
 
     return where_am_i;
@@ -1659,7 +1660,7 @@ static struct wall *distribute_wall(struct volume *world, struct wall *w) {
 
   h = (k - 1) +
       (world->nz_parts - 1) * ((j - 1) + (world->ny_parts - 1) * (i - 1));
-  where_am_i = localize_wall(w, world->subvol[h].local_storage);
+  where_am_i = localize_wall(w, get_subvol(world, h)->local_storage);
   if (where_am_i == NULL)
     return NULL;
 
@@ -1667,15 +1668,18 @@ static struct wall *distribute_wall(struct volume *world, struct wall *w) {
     for (j = y_min; j < y_max; j++) {
       for (i = x_min; i < x_max; i++) {
         h = k + (world->nz_parts - 1) * (j + (world->ny_parts - 1) * i);
-        llf.x = world->x_fineparts[world->subvol[h].llf.x] - leeway;
-        llf.y = world->y_fineparts[world->subvol[h].llf.y] - leeway;
-        llf.z = world->z_fineparts[world->subvol[h].llf.z] - leeway;
-        urb.x = world->x_fineparts[world->subvol[h].urb.x] + leeway;
-        urb.y = world->y_fineparts[world->subvol[h].urb.y] + leeway;
-        urb.z = world->z_fineparts[world->subvol[h].urb.z] + leeway;
+        /* Only subvolumes the wall really intersects get a record */
+        struct subvolume box;
+        init_subvolume(world, &box, h);
+        llf.x = world->x_fineparts[box.llf.x] - leeway;
+        llf.y = world->y_fineparts[box.llf.y] - leeway;
+        llf.z = world->z_fineparts[box.llf.z] - leeway;
+        urb.x = world->x_fineparts[box.urb.x] + leeway;
+        urb.y = world->y_fineparts[box.urb.y] + leeway;
+        urb.z = world->z_fineparts[box.urb.z] + leeway;
 
         if (wall_in_box(w->vert, &(w->normal), w->d, &llf, &urb)) {
-          if (wall_to_vol(where_am_i, &(world->subvol[h])) == NULL)
+          if (wall_to_vol(where_am_i, get_subvol(world, h)) == NULL)
             return NULL;
         }
       }
@@ -1756,6 +1760,104 @@ int distribute_world(struct volume *world) {
   return 0;
 }
 
+/***************************************************************************
+wall_clearance_pass:
+  In: squared clearances of one row of subvolumes
+      distance between neighbors of the row in that array
+      number of subvolumes in the row
+      positions of the partitions bounding the row (n+1 values)
+      scratch space for n values
+  Out: No return value.  Each squared clearance becomes the smallest sum
+       of a squared clearance in the row and the squared gap between the
+       two subvolumes.
+***************************************************************************/
+static void wall_clearance_pass(double *d2, int stride, int n, double *parts,
+                                double *tmp) {
+  int any = 0;
+  for (int i = 0; i < n; i++) {
+    tmp[i] = d2[i * stride];
+    if (tmp[i] < GIGANTIC)
+      any = 1;
+  }
+  if (!any)
+    return;
+
+  for (int i = 0; i < n; i++) {
+    double best = tmp[i];
+    /* Gaps only grow away from i, so stop once they alone are too big */
+    for (int j = i + 1; j < n; j++) {
+      double gap = parts[j] - parts[i + 1];
+      gap *= gap;
+      if (gap >= best)
+        break;
+      if (tmp[j] + gap < best)
+        best = tmp[j] + gap;
+    }
+    for (int j = i - 1; j >= 0; j--) {
+      double gap = parts[i] - parts[j + 1];
+      gap *= gap;
+      if (gap >= best)
+        break;
+      if (tmp[j] + gap < best)
+        best = tmp[j] + gap;
+    }
+    d2[i * stride] = best;
+  }
+}
+
+/***************************************************************************
+init_wall_clearance:
+  In: simulation state with the walls distributed to the subvolumes
+  Out: No return value.  Sets wall_clearance of every subvolume to the
+       distance from its box to the nearest box of a subvolume that holds
+       walls (zero if it holds walls itself).  Every wall lies inside the
+       boxes of the subvolumes it was distributed to, so a molecule in an
+       empty subvolume is at least its distance to the subvolume boundary
+       plus wall_clearance away from any wall.
+***************************************************************************/
+void init_wall_clearance(struct volume *world) {
+  int nx = world->nx_parts - 1;
+  int ny = world->ny_parts - 1;
+  int nz = world->nz_parts - 1;
+  int n_max = nx;
+  if (ny > n_max)
+    n_max = ny;
+  if (nz > n_max)
+    n_max = nz;
+
+  double *d2 = CHECKED_MALLOC_ARRAY(double, world->n_subvols,
+                                    "subvolume wall clearances");
+  double *tmp = CHECKED_MALLOC_ARRAY(double, n_max, "wall clearance row");
+  for (int h = 0; h < world->n_subvols; h++)
+    d2[h] = (world->subvol[h]->wall_head != NULL) ? 0.0 : GIGANTIC;
+
+  /* The squared box distance is a sum over the axes, so one pass per axis
+     gives the exact distance transform over the grid */
+  for (int i = 0; i < nx; i++)
+    for (int j = 0; j < ny; j++)
+      wall_clearance_pass(d2 + nz * (j + ny * i), 1, nz, world->z_partitions,
+                          tmp);
+  for (int i = 0; i < nx; i++)
+    for (int k = 0; k < nz; k++)
+      wall_clearance_pass(d2 + k + nz * ny * i, nz, ny, world->y_partitions,
+                          tmp);
+  for (int j = 0; j < ny; j++)
+    for (int k = 0; k < nz; k++)
+      wall_clearance_pass(d2 + k + nz * j, nz * ny, nx, world->x_partitions,
+                          tmp);
+
+  /* Subvolumes without a record yet pick theirs up in init_subvolume */
+  for (int h = 0; h < world->n_subvols; h++) {
+    d2[h] = sqrt(d2[h]);
+    if (world->subvol[h] != &world->empty_subvol)
+      world->subvol[h]->wall_clearance = d2[h];
+  }
+
+  free(tmp);
+  free(world->subvol_clearance);
+  world->subvol_clearance = d2;
+}
+
 /***************************************************************************
 closest_pt_point_triangle:
   In:  p - point
@@ -1871,6 +1973,25 @@ int test_bounding_boxes(struct vector3 *llf1, struct vector3 *urb1,
   return 1;
 }
 
+/***************************************************************************
+box_contains_box:
+  In:  llf1 - lower left corner of the outer box
+       urb1 - upper right back corner of the outer box
+       llf2 - lower left corner of the inner box
+       urb2 - upper right back corner of the inner box
+  Out: Returns 1 if the 2nd box lies entirely within the 1st, 0 - otherwise
+***************************************************************************/
+int box_contains_box(struct vector3 *llf1, struct vector3 *urb1,
+                     struct vector3 *llf2, struct vector3 *urb2) {
+  if ((llf2->x < llf1->x) || (urb2->x > urb1->x))
+    return 0;
+  if ((llf2->y < llf1->y) || (urb2->y > urb1->y))
+    return 0;
+  if ((llf2->z < llf1->z) || (urb2->z > urb1->z))
+    return 0;
+  return 1;
+}
+
 /* Helper struct for release_onto_regions and vacuum_from_regions */
 struct reg_rel_helper_data {
   struct reg_rel_helper_data *next;
@@ -1954,6 +2075,7 @@ static int vacuum_from_regions(struct volume *world,
                                   -1, NULL, smp->grid->surface, smp->t, NULL);
       smp->properties = NULL;
       p->grid->sm_list[p->index]->sm = NULL;
+      update_tile_occupancy(p->grid, p->index);
       p->grid->n_occupied--;
       if (smp->flags & IN_SCHEDULE) {
         smp->grid->subvol->local_storage->timer->defunct_count++; /* Tally for
@@ -2018,17 +2140,21 @@ int release_onto_regions(struct volume *world, struct release_site_obj *rso,
           n * (((double)(success + failure + 2)) / ((double)(success + 1)));
     }
     if (seek_cost < pick_cost) {
-      A = rng_dbl(world->rng) * max_A;
-      i = bisect_high(rrd->cum_area_list, rrd->n_walls_included, A);
+      /* One random number picks both the wall (weighted by area) and the
+       * position on it */
+      double frac;
+      i = sample_alias_table(rrd->alias_prob, rrd->alias_index,
+                             rrd->n_walls_included, rng_dbl(world->rng), &frac);
       w = rrd->owners[rrd->obj_index[i]]->wall_p[rrd->wall_index[i]];
 
       if (w->grid == NULL) {
         if (create_grid(world, w, NULL))
           return 1;
+      } else if (w->grid->n_occupied == w->grid->n_tiles) {
+        failure++;
+        continue;
       }
-      if (i)
-        A -= rrd->cum_area_list[i - 1];
-      grid_index = (unsigned int)((w->grid->n * w->grid->n) * (A / w->area));
+      grid_index = (unsigned int)((w->grid->n * w->grid->n) * frac);
       if (grid_index >= w->grid->n_tiles) {
         grid_index = w->grid->n_tiles - 1;
       }
@@ -2041,7 +2167,7 @@ int release_onto_regions(struct volume *world, struct release_site_obj *rso,
         struct vector3 pos3d = {.x = 0, .y = 0, .z = 0};
         if (place_single_molecule(world, w, grid_index, sm->properties,
                                   sm->flags, rso->orientation, sm->t, sm->t2,
-                                  sm->birthday, sm->periodic_box, &pos3d) == NULL) {
+                                  sm->birthday, &sm->periodic_box, &pos3d) == NULL) {
           struct vector3 llf, urb;
           if (world->periodic_box_obj) {
             struct polygon_object *p = (struct polygon_object*)(world->periodic_box_obj->contents);
@@ -2119,7 +2245,7 @@ int release_onto_regions(struct volume *world, struct release_site_obj *rso,
           if (place_single_molecule(world, this_rrd->grid->surface,
                                     this_rrd->index, sm->properties, sm->flags,
                                     rso->orientation, sm->t, sm->t2,
-                                    sm->birthday, sm->periodic_box, &pos3d) == NULL) {
+                                    sm->birthday, &sm->periodic_box, &pos3d) == NULL) {
             return 1;
           }
 
@@ -2216,11 +2342,9 @@ struct surface_molecule *place_single_molecule(struct volume *state,
   new_sm->s_pos.u = s_pos.u;
   new_sm->s_pos.v = s_pos.v;
   new_sm->properties = spec;
-  new_sm->periodic_box = CHECKED_MALLOC_STRUCT(struct periodic_image,
-    "periodic image descriptor");
-  new_sm->periodic_box->x = periodic_box->x;
-  new_sm->periodic_box->y = periodic_box->y;
-  new_sm->periodic_box->z = periodic_box->z;
+  new_sm->periodic_box.x = periodic_box->x;
+  new_sm->periodic_box.y = periodic_box->y;
+  new_sm->periodic_box.z = periodic_box->z;
 
   if (orientation == 0)
     new_sm->orient = (rng_uint(state->rng) & 1) ? 1 : -1;
@@ -2236,6 +2360,7 @@ struct surface_molecule *place_single_molecule(struct volume *state,
     w->grid->sm_list[grid_index] = sm_entry;
   }
   w->grid->sm_list[grid_index]->sm = new_sm;
+  update_tile_occupancy(w->grid, grid_index);
   w->grid->n_occupied++;
   new_sm->properties->population++;
 
@@ -2250,7 +2375,7 @@ struct surface_molecule *place_single_molecule(struct volume *state,
   if (new_sm->properties->flags & (COUNT_CONTENTS | COUNT_ENCLOSED))
     count_region_from_scratch(state, (struct abstract_molecule *)new_sm, NULL,
                               1, NULL, new_sm->grid->surface, new_sm->t,
-                              new_sm->periodic_box);
+                              &new_sm->periodic_box);
 
   if (schedule_add(gsv->local_storage->timer, new_sm)) {
     mcell_allocfailed("Failed to add volume molecule '%s' to scheduler.",
@@ -2307,6 +2432,7 @@ find_nbr_walls_shared_one_vertex:
        array with information about which vertices of the origin wall
           are shared with neighbor wall (they are indices in the
           global "world->walls_using_vertex" array).
+       scratch arena the list is allocated from
    Out: linked list of the neighbor walls that have only one common
         vertex with the origin wall (not edge-to-edge walls, but
         vertex-to-vertex walls).
@@ -2314,7 +2440,8 @@ find_nbr_walls_shared_one_vertex:
 **************************************************************************/
 struct wall_list *find_nbr_walls_shared_one_vertex(struct volume *world,
                                                    struct wall *origin,
-                                                   long long int *shared_vert) {
+                                                   long long int *shared_vert,
+                                                   struct scratch_arena *sa) {
   int i;
   struct wall_list *wl;
   struct wall_list *head = NULL;
@@ -2331,7 +2458,10 @@ struct wall_list *find_nbr_walls_shared_one_vertex(struct volume *world,
           continue;
 
         if (!walls_share_full_edge(origin, wl->this_wall)) {
-          push_wall_to_list(&head, wl->this_wall);
+          struct wall_list *wlp = SCRATCH_GET_STRUCT(sa, struct wall_list);
+          wlp->this_wall = wl->this_wall;
+          wlp->next = head;
+          head = wlp;
         }
       }
     }
@@ -2365,15 +2495,36 @@ int walls_share_full_edge(struct wall *w1, struct wall *w2) {
 }
 
 /***********************************************************************
-find_region_by_wall:
-  In:  wall
+push_region_to_list:
+  In:  scratch arena to allocate from, or NULL to use the heap
+       head of a region list
+       region to add
+  Out: none. The region is pushed onto the head of the list.
+************************************************************************/
+static void push_region_to_list(struct scratch_arena *sa,
+                                struct region_list **head, struct region *rp) {
+  struct region_list *rlps;
+  if (sa != NULL)
+    rlps = SCRATCH_GET_STRUCT(sa, struct region_list);
+  else
+    rlps = CHECKED_MALLOC_STRUCT(struct region_list, "region_list");
+  rlps->reg = rp;
+  rlps->next = *head;
+  *head = rlps;
+}
+
+/***********************************************************************
+regions_by_wall:
+  In:  scratch arena to allocate the list from, or NULL to use the heap
+       wall
   Out: an object's region list if the wall belongs to one, NULL - otherwise.
   Note: regions called "ALL" or the ones that have ALL_ELEMENTS are not
         included in the return "region list".  This is done intentionally
         since the function is used to determine region border and the
         above regions do not have region borders.
 ************************************************************************/
-struct region_list *find_region_by_wall(struct wall *this_wall) {
+static struct region_list *regions_by_wall(struct scratch_arena *sa,
+                                           struct wall *this_wall) {
 
   struct region_list *rlp_head = NULL;
   for (struct region_list *rlp = this_wall->parent_object->regions; rlp != NULL;
@@ -2388,24 +2539,28 @@ struct region_list *find_region_by_wall(struct wall *this_wall) {
       mcell_internal_error("Missing region membership for '%s'.",
                            rp->sym->name);
 
-    if (get_bit(rp->membership, this_wall->side)) {
-      struct region_list *rlps = CHECKED_MALLOC_STRUCT(struct region_list,
-        "region_list");
-      rlps->reg = rp;
-
-      if (rlp_head == NULL) {
-        rlps->next = NULL;
-        rlp_head = rlps;
-      } else {
-        rlps->next = rlp_head;
-        rlp_head = rlps;
-      }
-    }
+    if (get_bit(rp->membership, this_wall->side))
+      push_region_to_list(sa, &rlp_head, rp);
   }
 
   return rlp_head;
 }
 
+/***********************************************************************
+find_region_by_wall, find_region_by_wall_scratch:
+  In:  wall (and the scratch arena to allocate from)
+  Out: the wall's region list as in regions_by_wall(). The first version
+       mallocs the list, which the caller has to free.
+************************************************************************/
+struct region_list *find_region_by_wall(struct wall *this_wall) {
+  return regions_by_wall(NULL, this_wall);
+}
+
+struct region_list *find_region_by_wall_scratch(struct scratch_arena *sa,
+                                                struct wall *this_wall) {
+  return regions_by_wall(sa, this_wall);
+}
+
 /************************************************************************
 find_regions_names_by_wall:
   In:  wall:
@@ -2457,8 +2612,9 @@ struct name_list *find_regions_names_by_wall(
 }
 
 /***********************************************************************
-find_restricted_regions_by_wall:
-  In: wall
+restricted_regions_by_wall:
+  In: scratch arena to allocate the list from, or NULL to use the heap
+      wall
       surface molecule
   Out: an object's region list if the wall belongs to the region
           that is restrictive (REFL/ABSORB) to the surface molecule
@@ -2466,9 +2622,10 @@ find_restricted_regions_by_wall:
   Note: regions called "ALL" or the ones that have ALL_ELEMENTS are not
         included in the return "region list".
 ************************************************************************/
-struct region_list *
-find_restricted_regions_by_wall(struct volume *world, struct wall *this_wall,
-                                struct surface_molecule *sm) {
+static struct region_list *
+restricted_regions_by_wall(struct volume *world, struct scratch_arena *sa,
+                           struct wall *this_wall,
+                           struct surface_molecule *sm) {
 
   if ((sm->properties->flags & CAN_REGION_BORDER) == 0)
     return NULL;
@@ -2516,16 +2673,7 @@ find_restricted_regions_by_wall(struct volume *world, struct wall *this_wall,
       /* is this region's boundary restricted for surface molecule? */
       for (int i = 0; i < num_res; ++i) {
         if (rp->surf_class == restricted_surf_class[i]) {
-          struct region_list *rlps = CHECKED_MALLOC_STRUCT(struct region_list,
-            "region_list");
-          rlps->reg = rp;
-          if (rlp_head == NULL) {
-            rlps->next = NULL;
-            rlp_head = rlps;
-          } else {
-            rlps->next = rlp_head;
-            rlp_head = rlps;
-          }
+          push_region_to_list(sa, &rlp_head, rp);
           break;
         }
       }
@@ -2535,8 +2683,31 @@ find_restricted_regions_by_wall(struct volume *world, struct wall *this_wall,
 }
 
 /***********************************************************************
-find_restricted_regions_by_object:
-  In: object
+find_restricted_regions_by_wall, find_restricted_regions_by_wall_scratch:
+  In: wall
+      surface molecule
+      (scratch arena to allocate from)
+  Out: the restricted regions of the wall as in restricted_regions_by_wall().
+       The first version mallocs the list, which the caller has to free.
+************************************************************************/
+struct region_list *
+find_restricted_regions_by_wall(struct volume *world, struct wall *this_wall,
+                                struct surface_molecule *sm) {
+  return restricted_regions_by_wall(world, NULL, this_wall, sm);
+}
+
+struct region_list *
+find_restricted_regions_by_wall_scratch(struct volume *world,
+                                        struct scratch_arena *sa,
+                                        struct wall *this_wall,
+                                        struct surface_molecule *sm) {
+  return restricted_regions_by_wall(world, sa, this_wall, sm);
+}
+
+/***********************************************************************
+restricted_regions_by_object:
+  In: scratch arena to allocate the list from, or NULL to use the heap
+      object
       surface molecule
   Out: an object's region list that are restrictive (REFL/ABSORB)
        to the surface molecule
@@ -2544,11 +2715,11 @@ find_restricted_regions_by_object:
   Note: regions called "ALL" or the ones that have ALL_ELEMENTS are not
         included in the return "region list".
 ************************************************************************/
-struct region_list *
-find_restricted_regions_by_object(struct volume *world, struct object *obj,
-                                  struct surface_molecule *sm) {
+static struct region_list *
+restricted_regions_by_object(struct volume *world, struct scratch_arena *sa,
+                             struct object *obj, struct surface_molecule *sm) {
   struct region *rp;
-  struct region_list *rlp, *rlps, *rlp_head = NULL;
+  struct region_list *rlp, *rlp_head = NULL;
   int kk, i, wall_idx = INT_MIN;
   struct rxn *matching_rxns[MAX_MATCHING_RXNS];
 
@@ -2593,16 +2764,7 @@ find_restricted_regions_by_object(struct volume *world, struct object *obj,
     for (kk = 0; kk < num_matching_rxns; kk++) {
       if ((matching_rxns[kk]->n_pathways == RX_REFLEC) ||
           (matching_rxns[kk]->n_pathways == RX_ABSORB_REGION_BORDER)) {
-        rlps = CHECKED_MALLOC_STRUCT(struct region_list, "region_list");
-        rlps->reg = rp;
-
-        if (rlp_head == NULL) {
-          rlps->next = NULL;
-          rlp_head = rlps;
-        } else {
-          rlps->next = rlp_head;
-          rlp_head = rlps;
-        }
+        push_region_to_list(sa, &rlp_head, rp);
       }
     }
   }
@@ -2610,6 +2772,30 @@ find_restricted_regions_by_object(struct volume *world, struct object *obj,
   return rlp_head;
 }
 
+/***********************************************************************
+find_restricted_regions_by_object,
+find_restricted_regions_by_object_scratch:
+  In: object
+      surface molecule
+      (scratch arena to allocate from)
+  Out: the restricted regions of the object as in
+       restricted_regions_by_object(). The first version mallocs the list,
+       which the caller has to free.
+************************************************************************/
+struct region_list *
+find_restricted_regions_by_object(struct volume *world, struct object *obj,
+                                  struct surface_molecule *sm) {
+  return restricted_regions_by_object(world, NULL, obj, sm);
+}
+
+struct region_list *
+find_restricted_regions_by_object_scratch(struct volume *world,
+                                          struct scratch_arena *sa,
+                                          struct object *obj,
+                                          struct surface_molecule *sm) {
+  return restricted_regions_by_object(world, sa, obj, sm);
+}
+
 /***********************************************************************
 are_restricted_regions_for_species_on_object:
   In: object
@@ -2678,22 +2864,29 @@ is_wall_edge_region_border:
         suffice
 ************************************************************************/
 int is_wall_edge_region_border(struct wall *this_wall, struct edge *this_edge) {
-  struct region_list *rlp, *rlp_head;
+  struct region_list *rlp;
   struct region *rp;
   void *key;
   unsigned int keyhash;
 
   int is_region_border = 0; /* flag */
 
-  rlp_head = find_region_by_wall(this_wall);
+  /* walk the wall's regions directly instead of collecting them with
+     find_region_by_wall() first (we do not consider region called ALL
+     here) */
+  for (rlp = this_wall->parent_object->regions; rlp != NULL;
+       rlp = rlp->next) {
+    rp = rlp->reg;
+    if ((strcmp(rp->region_last_name, "ALL") == 0) ||
+        (rp->region_has_all_elements))
+      continue;
 
-  /* If this wall is not a part of any region (note that we do not consider
-     region called ALL here) */
-  if (rlp_head == NULL)
-    return is_region_border;
+    if (rp->membership == NULL)
+      mcell_internal_error("Missing region membership for '%s'.",
+                           rp->sym->name);
 
-  for (rlp = rlp_head; rlp != NULL; rlp = rlp->next) {
-    rp = rlp->reg;
+    if (!get_bit(rp->membership, this_wall->side))
+      continue;
 
     if (rp->boundaries == NULL)
       mcell_internal_error("Region '%s' of the object '%s' has no boundaries.",
@@ -2709,9 +2902,6 @@ int is_wall_edge_region_border(struct wall *this_wall, struct edge *this_edge) {
     }
   }
 
-  if (rlp_head != NULL)
-    delete_void_list((struct void_list *)rlp_head);
-
   return is_region_border;
 }
 
@@ -2736,7 +2926,9 @@ int is_wall_edge_restricted_region_border(struct volume *world,
 
   int is_region_border = 0; /* flag */
 
-  rlp_head = find_restricted_regions_by_wall(world, this_wall, sm);
+  struct scratch_mark mark = scratch_mark(world->scratch_mem);
+  rlp_head = find_restricted_regions_by_wall_scratch(world, world->scratch_mem,
+                                                     this_wall, sm);
 
   /* If this wall is not a part of any region (note that we do not consider
      region called ALL here) */
@@ -2759,8 +2951,7 @@ int is_wall_edge_restricted_region_border(struct volume *world,
     }
   }
 
-  if (rlp_head != NULL)
-    delete_void_list((struct void_list *)rlp_head);
+  scratch_release(world->scratch_mem, mark);
 
   return is_region_border;
 }
@@ -2991,46 +3182,44 @@ int walls_belong_to_at_least_one_different_restricted_region(
   if ((w1 == NULL) || (w2 == NULL))
     return 0;
 
-  struct region_list *rl_1 = find_restricted_regions_by_wall(world, w1, sm1);
-  struct region_list *rl_2 = find_restricted_regions_by_wall(world, w2, sm2);
-
-  if ((rl_1 == NULL) && (rl_2 == NULL))
-    return 0;
+  struct scratch_mark mark = scratch_mark(world->scratch_mem);
+  struct region_list *rl_1 =
+      find_restricted_regions_by_wall_scratch(world, world->scratch_mem, w1,
+                                              sm1);
+  struct region_list *rl_2 =
+      find_restricted_regions_by_wall_scratch(world, world->scratch_mem, w2,
+                                              sm2);
 
   int error_code = 0;
-  if (rl_1 == NULL) {
+  if ((rl_1 == NULL) && (rl_2 == NULL)) {
+    error_code = 0;
+  } else if (rl_1 == NULL) {
     /* Is wall 1 part of all restricted regions rl_2, then these restricted
      * regions just encompass wall 1 */
     if (wall_belongs_to_all_regions_in_region_list(w1, rl_2))
       error_code = 0;
     else
       error_code = 1;
-    delete_region_list(rl_2);
-    return error_code;
-  }
-
-  if (rl_2 == NULL) {
+  } else if (rl_2 == NULL) {
     /* Is wall 2 part of all restricted regions rl_1, then these restricted
      * regions just encompass wall 2 */
     if (wall_belongs_to_all_regions_in_region_list(w2, rl_1))
       error_code = 0;
     else
       error_code = 1;
-    delete_region_list(rl_1);
-    return error_code;
-  }
-
-  for (struct region_list *rl_t1 = rl_1; rl_t1 != NULL; rl_t1 = rl_t1->next) {
-    struct region *rp_1 = rl_t1->reg;
+  } else {
+    for (struct region_list *rl_t1 = rl_1; rl_t1 != NULL;
+         rl_t1 = rl_t1->next) {
+      struct region *rp_1 = rl_t1->reg;
 
-    if (!region_belongs_to_region_list(rp_1, rl_2)) {
-      error_code = 1;
-      break;
+      if (!region_belongs_to_region_list(rp_1, rl_2)) {
+        error_code = 1;
+        break;
+      }
     }
   }
 
-  delete_region_list(rl_1);
-  delete_region_list(rl_2);
+  scratch_release(world->scratch_mem, mark);
   return error_code;
 }
 
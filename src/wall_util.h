@@ -101,6 +101,9 @@ int collide_mol(struct vector3 *point, struct vector3 *move,
 
 int intersect_box(struct vector3 *llf, struct vector3 *urb, struct wall *w);
 
+int wall_in_box(struct vector3 **vert, struct vector3 *normal, double d,
+                struct vector3 *b0, struct vector3 *b1);
+
 void init_tri_wall(struct object *objp, int side, struct vector3 *v0,
                    struct vector3 *v1, struct vector3 *v2);
 
@@ -112,6 +115,8 @@ int distribute_object(struct volume *world, struct object *parent);
 
 int distribute_world(struct volume *world);
 
+void init_wall_clearance(struct volume *world);
+
 void closest_pt_point_triangle(struct vector3 *p, struct vector3 *a,
                                struct vector3 *b, struct vector3 *c,
                                struct vector3 *final_result);
@@ -119,6 +124,9 @@ void closest_pt_point_triangle(struct vector3 *p, struct vector3 *a,
 int test_bounding_boxes(struct vector3 *llf1, struct vector3 *urb1,
                         struct vector3 *llf2, struct vector3 *urb2);
 
+int box_contains_box(struct vector3 *llf1, struct vector3 *urb1,
+                     struct vector3 *llf2, struct vector3 *urb2);
+
 int release_onto_regions(struct volume *world, struct release_site_obj *rso,
                          struct surface_molecule *sm, int n);
 
@@ -138,12 +146,16 @@ void delete_wall_list(struct wall_list *wl_head);
 
 struct wall_list *find_nbr_walls_shared_one_vertex(struct volume *world,
                                                    struct wall *origin,
-                                                   long long int *shared_vert);
+                                                   long long int *shared_vert,
+                                                   struct scratch_arena *sa);
 
 int walls_share_full_edge(struct wall *w1, struct wall *w2);
 
 struct region_list *find_region_by_wall(struct wall *this_wall);
 
+struct region_list *find_region_by_wall_scratch(struct scratch_arena *sa,
+                                                struct wall *this_wall);
+
 struct name_list *find_regions_names_by_wall(
     struct wall *w, struct string_buffer *ignore_regs);
 
@@ -151,10 +163,22 @@ struct region_list *
 find_restricted_regions_by_wall(struct volume *world, struct wall *this_wall,
                                 struct surface_molecule *sm);
 
+struct region_list *
+find_restricted_regions_by_wall_scratch(struct volume *world,
+                                        struct scratch_arena *sa,
+                                        struct wall *this_wall,
+                                        struct surface_molecule *sm);
+
 struct region_list *
 find_restricted_regions_by_object(struct volume *world, struct object *obj,
                                   struct surface_molecule *sm);
 
+struct region_list *
+find_restricted_regions_by_object_scratch(struct volume *world,
+                                          struct scratch_arena *sa,
+                                          struct object *obj,
+                                          struct surface_molecule *sm);
+
 int are_restricted_regions_for_species_on_object(struct volume *world,
                                                  struct object *obj,
                                                  struct surface_molecule *sm);
@@ -0,0 +1,782 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logging.h"
+#include "rng.h"
+#include "util.h"
+#include "count_util.h"
+#include "init.h"
+#include "react.h"
+#include "sched_util.h"
+#include "vol_util.h"
+#include "well_mixed.h"
+
+/* Below this mean, binomial counts are sampled exactly by inversion; above
+ * it, the normal approximation is used */
+#define BINOMIAL_EXACT_MEAN 10.0
+
+/* Ways out of a compartment: through one of its six faces, or through one of
+ * its twelve edges into a diagonal neighbor */
+#define N_HOPS 18
+
+/* The two faces crossed on the way out through each edge */
+static const int edge_dirs[12][2] = {
+  { X_NEG, Y_NEG }, { X_NEG, Y_POS }, { X_POS, Y_NEG }, { X_POS, Y_POS },
+  { X_NEG, Z_NEG }, { X_NEG, Z_POS }, { X_POS, Z_NEG }, { X_POS, Z_POS },
+  { Y_NEG, Z_NEG }, { Y_NEG, Z_POS }, { Y_POS, Z_NEG }, { Y_POS, Z_POS }
+};
+
+/*************************************************************************
+is_compartment:
+  In: sv: a subvolume
+  Out: 1 if well-mixed species are counted in this subvolume, 0 otherwise.
+       Compartments do not intersect any wall and are bounded on all sides.
+*************************************************************************/
+static int is_compartment(struct subvolume *sv) {
+  return sv->wall_head == NULL && sv->world_edge == 0;
+}
+
+/*************************************************************************
+is_compartment_at:
+  In: world: simulation state
+      h: index of a subvolume
+  Out: 1 if subvolume h is a compartment, 0 otherwise.  Subvolumes without
+       a record yet hold no walls, so only their place in the world is
+       checked and no record is allocated for them.
+*************************************************************************/
+static int is_compartment_at(struct volume *world, int h) {
+  struct subvolume *sv = world->subvol[h];
+  if (sv != &world->empty_subvol)
+    return is_compartment(sv);
+
+  int nz = world->nz_parts - 1;
+  int ny = world->ny_parts - 1;
+  int k = h % nz;
+  int j = (h / nz) % ny;
+  int i = h / (nz * ny);
+  return i > 0 && i < world->nx_parts - 2 && j > 0 && j < ny - 1 && k > 0 &&
+         k < nz - 1;
+}
+
+/*************************************************************************
+subvol_width:
+  In: world: simulation state
+      sv: a subvolume
+      axis: 0, 1 or 2 for x, y or z
+  Out: the extent of the subvolume along the axis
+*************************************************************************/
+static double subvol_width(struct volume *world, struct subvolume *sv,
+                           int axis) {
+  switch (axis) {
+  case 0:
+    return world->x_fineparts[sv->urb.x] - world->x_fineparts[sv->llf.x];
+  case 1:
+    return world->y_fineparts[sv->urb.y] - world->y_fineparts[sv->llf.y];
+  default:
+    return world->z_fineparts[sv->urb.z] - world->z_fineparts[sv->llf.z];
+  }
+}
+
+/*************************************************************************
+hop_target:
+  In: world: simulation state
+      sv: a compartment
+      hop: a way out of the compartment (0 ... N_HOPS-1): a direction
+           (X_NEG ... Z_POS), or 6 plus an index into edge_dirs
+  Out: the neighbor the hop leads to
+*************************************************************************/
+static struct subvolume *hop_target(struct volume *world, struct subvolume *sv,
+                                    int hop) {
+  if (hop <= Z_POS)
+    return traverse_subvol(world, sv, hop);
+  struct subvolume *nb = traverse_subvol(world, sv, edge_dirs[hop - 6][0]);
+  return traverse_subvol(world, nb, edge_dirs[hop - 6][1]);
+}
+
+/*************************************************************************
+hop_rates:
+  In: world: simulation state
+      sv: a compartment
+      D: diffusion constant per iteration
+      rate: array of N_HOPS rates, indexed like hop_target
+  Out: Fills in the rate (per molecule and iteration) at which molecules
+       hop out of the compartment each way.  Between compartments this is
+       the usual reaction-diffusion master equation rate D / (h * dist)
+       through each face, where h is the width of the compartment and dist
+       the distance between the centers of the compartment and its
+       neighbor.
+       Into a subvolume with individual molecules, the rate matches the
+       number of molecules which cross the face per time step (and are
+       absorbed) at equal concentration, sqrt(D / pi) / h.  Otherwise
+       molecules would pile up in the compartments.  A molecule crossing
+       two faces at once (at the product of their rates) is counted by
+       both, so that is taken off the two faces.  Individual molecules also
+       get absorbed across an edge from a diagonal neighbor whose two
+       subvolumes next to the compartment are compartments, so molecules
+       hop back across such edges at the product of the two face rates.
+*************************************************************************/
+static void hop_rates(struct volume *world, struct subvolume *sv, double D,
+                      double rate[N_HOPS]) {
+  double cross[6];
+  int open[6];
+  for (int dir = X_NEG; dir <= Z_POS; dir++) {
+    int axis = dir / 2;
+    double h = subvol_width(world, sv, axis);
+    struct subvolume *nb =
+        traverse_subvol(world, sv, dir);
+    cross[dir] = sqrt(D / MY_PI) / h;
+    open[dir] = !is_compartment(nb);
+    if (open[dir])
+      rate[dir] = cross[dir];
+    else
+      rate[dir] = D / (h * 0.5 * (h + subvol_width(world, nb, axis)));
+  }
+
+  for (int e = 0; e < 12; e++) {
+    int d1 = edge_dirs[e][0], d2 = edge_dirs[e][1];
+    double both = cross[d1] * cross[d2];
+    rate[6 + e] = 0.0;
+    if (open[d1] && open[d2]) {
+      rate[d1] -= 0.5 * both;
+      rate[d2] -= 0.5 * both;
+    } else if (!open[d1] && !open[d2] &&
+               !is_compartment(hop_target(world, sv, 6 + e))) {
+      rate[6 + e] = both;
+    }
+  }
+}
+
+/*************************************************************************
+binomial_dist:
+  In: rng: random number generator
+      n: number of trials
+      p: probability of success of each trial
+  Out: the number of successes.  Small means are sampled exactly by walking
+       up the CDF, large ones with the normal approximation.
+*************************************************************************/
+static u_int binomial_dist(struct rng_state *rng, u_int n, double p) {
+  if (n == 0 || p <= 0)
+    return 0;
+  if (p >= 1)
+    return n;
+  if (p > 0.5)
+    return n - binomial_dist(rng, n, 1.0 - p);
+
+  double mean = n * p;
+  if (mean < BINOMIAL_EXACT_MEAN) {
+    double odds = p / (1.0 - p);
+    double f = pow(1.0 - p, (double)n);
+    double u = rng_dbl(rng);
+    u_int k = 0;
+    while (u > f && k < n) {
+      u -= f;
+      f *= odds * (n - k) / (k + 1);
+      k++;
+    }
+    return k;
+  }
+
+  double k = floor(mean + sqrt(mean * (1.0 - p)) * rng_gauss(rng) + 0.5);
+  if (k < 0)
+    return 0;
+  if (k > n)
+    return n;
+  return (u_int)k;
+}
+
+/*************************************************************************
+find_well_mixed_species:
+  In: wm: well-mixed state
+      spec: a species with the WELL_MIXED flag
+  Out: the state of that species
+*************************************************************************/
+static struct well_mixed_species *
+find_well_mixed_species(struct well_mixed_data *wm, struct species *spec) {
+  for (int i = 0; i < wm->n_species; i++) {
+    if (wm->species[i].spec == spec)
+      return &wm->species[i];
+  }
+
+  mcell_internal_error("Species '%s' is flagged as well-mixed, but has no "
+                       "counts.", spec->sym->name);
+  return NULL;
+}
+
+/*************************************************************************
+random_point_in_subvol:
+  In: world: simulation state
+      sv: a bounded subvolume
+      pos: place to store the point
+  Out: pos is set to a point chosen uniformly inside the subvolume
+*************************************************************************/
+static void random_point_in_subvol(struct volume *world, struct subvolume *sv,
+                                   struct vector3 *pos) {
+  double x0 = world->x_fineparts[sv->llf.x];
+  double y0 = world->y_fineparts[sv->llf.y];
+  double z0 = world->z_fineparts[sv->llf.z];
+  pos->x = x0 + rng_dbl(world->rng) * (world->x_fineparts[sv->urb.x] - x0);
+  pos->y = y0 + rng_dbl(world->rng) * (world->y_fineparts[sv->urb.y] - y0);
+  pos->z = z0 + rng_dbl(world->rng) * (world->z_fineparts[sv->urb.z] - z0);
+}
+
+/*************************************************************************
+move_past_face:
+  In: world: simulation state
+      wms: the well-mixed species
+      sv: a compartment
+      nb: the subvolume the molecule is leaving into
+      dir: a face of the compartment (X_NEG ... Z_POS) the molecule crosses
+      pos: a point in the compartment
+      displacement: place to add the move past the face to
+  Out: pos is put on the face, nudged just outside of the compartment, and
+       the distance a freely diffusing molecule has gone past the face one
+       time step after crossing it is added to displacement.
+*************************************************************************/
+static void move_past_face(struct volume *world,
+                           struct well_mixed_species *wms,
+                           struct subvolume *sv, struct subvolume *nb, int dir,
+                           struct vector3 *pos, struct vector3 *displacement) {
+  /* The step across the face has a Rayleigh distribution, and the distance
+   * past the face is uniform along the step */
+  double step = sqrt(-4.0 * wms->D * log(rng_open_dbl(world->rng)));
+  double depth = rng_dbl(world->rng) * step;
+  double max_depth = 0.5 * subvol_width(world, nb, dir / 2);
+  if (depth > max_depth)
+    depth = max_depth;
+
+  double *coord;
+  double face;
+  double sign = (dir % 2 == 0) ? -1.0 : 1.0;
+  switch (dir / 2) {
+  case 0:
+    coord = &pos->x;
+    face = world->x_fineparts[(sign < 0) ? sv->llf.x : sv->urb.x];
+    displacement->x = sign * depth;
+    break;
+  case 1:
+    coord = &pos->y;
+    face = world->y_fineparts[(sign < 0) ? sv->llf.y : sv->urb.y];
+    displacement->y = sign * depth;
+    break;
+  default:
+    coord = &pos->z;
+    face = world->z_fineparts[(sign < 0) ? sv->llf.z : sv->urb.z];
+    displacement->z = sign * depth;
+    break;
+  }
+  *coord = face + sign * EPS_C * (1.0 + fabs(face));
+}
+
+/*************************************************************************
+leave_compartment:
+  In: world: simulation state
+      wms: the well-mixed species
+      sv: a compartment
+      hop: the way the molecule leaves, indexed like hop_target
+      pos: place to store the position of the molecule
+  Out: The subvolume the molecule ends up in.  pos is set to a point on the
+       face (or edge) it leaves through, moved past each face it crosses
+       (see move_past_face).  The move stops short of walls, so the
+       molecule stays on the same side of every wall as the compartment.
+*************************************************************************/
+static struct subvolume *leave_compartment(struct volume *world,
+                                           struct well_mixed_species *wms,
+                                           struct subvolume *sv, int hop,
+                                           struct vector3 *pos) {
+  struct subvolume *nb = hop_target(world, sv, hop);
+  struct vector3 displacement = { 0.0, 0.0, 0.0 };
+  random_point_in_subvol(world, sv, pos);
+  if (hop <= Z_POS) {
+    move_past_face(world, wms, sv, nb, hop, pos, &displacement);
+  } else {
+    move_past_face(world, wms, sv, nb, edge_dirs[hop - 6][0], pos,
+                   &displacement);
+    move_past_face(world, wms, sv, nb, edge_dirs[hop - 6][1], pos,
+                   &displacement);
+  }
+  tiny_diffuse_3D(world, nb, &displacement, pos, NULL);
+  return find_subvolume(world, pos, nb);
+}
+
+/*************************************************************************
+place_well_mixed_molecule:
+  In: world: simulation state
+      wms: the well-mixed species
+      sv: subvolume in which to place the molecule
+      pos: where to place it
+      t: time of the molecule
+      birthday: birthday of the molecule (in seconds)
+  Out: A new volume molecule, linked into the subvolume but not scheduled.
+       The molecule already belongs to the population of the species and
+       to every region count, so no count events are fired.
+*************************************************************************/
+static struct volume_molecule *
+place_well_mixed_molecule(struct volume *world, struct well_mixed_species *wms,
+                          struct subvolume *sv, struct vector3 *pos,
+                          double t, double birthday) {
+  struct volume_molecule *vm =
+      CHECKED_MEM_GET(sv->local_storage->mol, "volume molecule");
+  vm->next = NULL;
+  vm->t = t;
+  vm->t2 = 0.0;
+  vm->flags = TYPE_VOL | ACT_NEWBIE | ACT_DIFFUSE | IN_VOLUME;
+  if (wms->rx != NULL)
+    vm->flags |= ACT_REACT;
+  if ((wms->spec->flags & COUNT_SOME_MASK) != 0)
+    vm->flags |= COUNT_ME;
+  vm->properties = wms->spec;
+  vm->birthday = birthday;
+  vm->id = world->current_mol_id++;
+  vm->periodic_box.x = 0;
+  vm->periodic_box.y = 0;
+  vm->periodic_box.z = 0;
+  vm->pos = *pos;
+  vm->subvol = sv;
+  vm->previous_wall = NULL;
+  vm->index = -1;
+  vm->prev_v = NULL;
+  vm->next_v = NULL;
+  add_molecule_to_list(vm);
+  sv->mol_count++;
+  return vm;
+}
+
+/*************************************************************************
+schedule_well_mixed_molecule:
+  In: vm: a molecule created by place_well_mixed_molecule
+  Out: The molecule is added to the scheduler of its subvolume.
+*************************************************************************/
+static void schedule_well_mixed_molecule(struct volume_molecule *vm) {
+  vm->flags |= IN_SCHEDULE;
+  if (schedule_add(vm->subvol->local_storage->timer, vm))
+    mcell_allocfailed("Failed to add a '%s' volume molecule to scheduler.",
+                      vm->properties->sym->name);
+}
+
+/*************************************************************************
+init_well_mixed:
+  In: world: simulation state
+  Out: 0 on success, 1 if a species given with -well_mixed cannot be
+       treated as well-mixed.  The species are flagged and their counts are
+       allocated.
+  Note: Only volume molecules that diffuse and do not react with other
+        volume molecules are allowed, since counted molecules are invisible
+        to the collision detection.
+*************************************************************************/
+int init_well_mixed(struct volume *world) {
+  if (world->well_mixed_names == NULL)
+    return 0;
+
+  if (world->periodic_box_obj != NULL) {
+    mcell_error_nodie("Well-mixed species cannot be combined with periodic "
+                      "boundary conditions.");
+    return 1;
+  }
+
+  int n_names = 0;
+  for (struct name_list *nl = world->well_mixed_names; nl != NULL;
+       nl = nl->next)
+    n_names++;
+
+  struct well_mixed_data *wm =
+      CHECKED_MALLOC_STRUCT(struct well_mixed_data, "well-mixed state");
+  wm->species = CHECKED_MALLOC_ARRAY(struct well_mixed_species, n_names,
+                                     "well-mixed species");
+  wm->n_species = 0;
+  wm->n_subvols = 0;
+  wm->n_cells = 0;
+  wm->cells = NULL;
+  wm->incoming = NULL;
+  wm->incoming_born = NULL;
+  world->well_mixed = wm;
+
+  for (struct name_list *nl = world->well_mixed_names; nl != NULL;
+       nl = nl->next) {
+    struct species *spec =
+        get_species_by_name(nl->name, world->n_species, world->species_list);
+    if (spec == NULL) {
+      mcell_error_nodie("Well-mixed species '%s' is not defined.", nl->name);
+      return 1;
+    }
+    if (spec->flags & WELL_MIXED)
+      continue;
+
+    if ((spec->flags & NOT_FREE) != 0 || spec == world->all_mols ||
+        spec == world->all_volume_mols) {
+      mcell_error_nodie("Well-mixed species '%s' is not a volume molecule.",
+                        nl->name);
+      return 1;
+    }
+    if (spec->space_step <= 0) {
+      mcell_error_nodie("Well-mixed species '%s' does not diffuse.", nl->name);
+      return 1;
+    }
+    if (spec->flags & (CAN_VOLVOL | CAN_VOLVOLVOL | CAN_VOLVOLSURF)) {
+      mcell_error_nodie("Well-mixed species '%s' reacts with other volume "
+                        "molecules.", nl->name);
+      return 1;
+    }
+
+    struct volume_molecule probe;
+    probe.properties = spec;
+    struct well_mixed_species *wms = &wm->species[wm->n_species++];
+    wms->spec = spec;
+    wms->rx = trigger_unimolecular(world->reaction_hash, world->rx_hashsize,
+                                   spec->hashval,
+                                   (struct abstract_molecule *)&probe);
+    wms->D = spec->space_step * spec->space_step / (4.0 * spec->time_step);
+    wms->count = NULL;
+    wms->born = NULL;
+    wms->warned = 0;
+    spec->flags |= WELL_MIXED;
+  }
+
+  if (reset_well_mixed_compartments(world))
+    return 1;
+
+  if (world->notify->progress_report != NOTIFY_NONE)
+    mcell_log("Counting %d well-mixed species in %d of %d subvolumes.",
+              wm->n_species, wm->n_cells, world->n_subvols);
+
+  return 0;
+}
+
+/*************************************************************************
+reset_well_mixed_compartments:
+  In: world: simulation state
+  Out: 0 on success.  The compartments are found again and the counts are
+       reallocated for the current partitions (after a geometry change).
+  Note: All counts are dropped, so they must have been materialized with
+        well_mixed_materialize_all first.
+*************************************************************************/
+int reset_well_mixed_compartments(struct volume *world) {
+  struct well_mixed_data *wm = world->well_mixed;
+  if (wm == NULL)
+    return 0;
+
+  free(wm->cells);
+  free(wm->incoming);
+  free(wm->incoming_born);
+  for (int i = 0; i < wm->n_species; i++) {
+    free(wm->species[i].count);
+    free(wm->species[i].born);
+  }
+
+  wm->n_subvols = world->n_subvols;
+  wm->n_cells = 0;
+  for (int h = 0; h < world->n_subvols; h++) {
+    if (is_compartment_at(world, h))
+      wm->n_cells++;
+  }
+
+  wm->cells = CHECKED_MALLOC_ARRAY(int, wm->n_cells, "well-mixed compartments");
+  wm->n_cells = 0;
+  for (int h = 0; h < world->n_subvols; h++) {
+    if (is_compartment_at(world, h))
+      wm->cells[wm->n_cells++] = h;
+  }
+
+  wm->incoming = CHECKED_MALLOC_ARRAY(u_int, wm->n_subvols,
+                                      "well-mixed hop counts");
+  memset(wm->incoming, 0, wm->n_subvols * sizeof(u_int));
+  wm->incoming_born = CHECKED_MALLOC_ARRAY(double, wm->n_subvols,
+                                           "well-mixed birthdays");
+  memset(wm->incoming_born, 0, wm->n_subvols * sizeof(double));
+  for (int i = 0; i < wm->n_species; i++) {
+    struct well_mixed_species *wms = &wm->species[i];
+    wms->count = CHECKED_MALLOC_ARRAY(u_int, wm->n_subvols,
+                                      "well-mixed counts");
+    memset(wms->count, 0, wm->n_subvols * sizeof(u_int));
+    wms->born = CHECKED_MALLOC_ARRAY(double, wm->n_subvols,
+                                     "well-mixed birthdays");
+    memset(wms->born, 0, wm->n_subvols * sizeof(double));
+  }
+
+  return 0;
+}
+
+/*************************************************************************
+well_mixed_absorb:
+  In: world: simulation state
+      vm: a molecule of a well-mixed species, just taken off the scheduler
+  Out: 1 if the molecule was absorbed into the count of its subvolume (and
+       must not be touched again), 0 if it is not in a compartment or is due
+       to react before the end of this iteration.
+  Note: The population of the species and the region counts are left alone;
+        they keep including the counted molecule.  The molecule is where the
+        counts were when they were last advanced (at the start of this
+        iteration), so it first gets to hop over this iteration along with
+        them.  Reactions of counted molecules are drawn from the next
+        iteration on, which is fine for the remaining lifetime of a molecule
+        that has not reacted by then.
+*************************************************************************/
+int well_mixed_absorb(struct volume *world, struct volume_molecule *vm) {
+  struct subvolume *sv = vm->subvol;
+  if ((vm->flags & TYPE_VOL) == 0 || !is_compartment(sv))
+    return 0;
+  if ((vm->flags & ACT_REACT) != 0 && vm->t + vm->t2 < floor(vm->t) + 1.0)
+    return 0;
+
+  struct well_mixed_species *wms =
+      find_well_mixed_species(world->well_mixed, vm->properties);
+  wms->count[sv->index]++;
+  wms->born[sv->index] += vm->birthday;
+
+  sv->mol_count--;
+  collect_molecule(vm);
+  return 1;
+}
+
+/*************************************************************************
+hop_counts:
+  In: world: simulation state
+      wms: the well-mixed species
+      t_now: the current time
+  Out: No return value.  The counted molecules hop over the time step that
+       has just ended, each to a neighboring subvolume or not at all.
+       Molecules hopping into a subvolume which is not a compartment are
+       materialized just past the faces they cross, as they are at t_now;
+       those hopping into another compartment are added to wm->incoming.
+       Every molecule taken out of a count takes the mean birthday of the
+       count with it.
+  Note: The rates are expected numbers of hops per time step, so they are
+        used as probabilities.  Materializing at t_now, before the molecules
+        move and before reaction data is written, keeps the region counts in
+        step with the particle code.
+*************************************************************************/
+static void hop_counts(struct volume *world, struct well_mixed_species *wms,
+                       double t_now) {
+  struct well_mixed_data *wm = world->well_mixed;
+
+  for (int c = 0; c < wm->n_cells; c++) {
+    int h = wm->cells[c];
+    u_int n = wms->count[h];
+    if (n == 0)
+      continue;
+
+    struct subvolume *sv = get_subvol(world, h);
+    double rate[N_HOPS];
+    hop_rates(world, sv, wms->D, rate);
+    double hop_total = 0.0;
+    int last = 0;
+    for (int hop = 0; hop < N_HOPS; hop++) {
+      hop_total += rate[hop];
+      if (rate[hop] > 0.0)
+        last = hop;
+    }
+    if (hop_total > 1.0 && !wms->warned) {
+      mcell_warn("Well-mixed species '%s' leaves some subvolumes %.3g times "
+                 "per time step on average.  Counts are only advanced once "
+                 "per time step, so its diffusion will be too slow.  Use "
+                 "coarser partitions.",
+                 wms->spec->sym->name, hop_total);
+      wms->warned = 1;
+    }
+
+    double birthday = wms->born[h] / n;
+    u_int n_left = binomial_dist(world->rng, n, hop_total);
+    wms->count[h] -= n_left;
+    wms->born[h] =
+        (wms->count[h] > 0) ? wms->born[h] - n_left * birthday : 0.0;
+
+    for (int hop = 0; hop <= last && n_left > 0; hop++) {
+      u_int n_hop = (hop == last)
+                        ? n_left
+                        : binomial_dist(world->rng, n_left,
+                                        rate[hop] / hop_total);
+      n_left -= n_hop;
+      hop_total -= rate[hop];
+      if (n_hop == 0)
+        continue;
+
+      struct subvolume *nb = hop_target(world, sv, hop);
+      if (is_compartment(nb)) {
+        wm->incoming[nb->index] += n_hop;
+        wm->incoming_born[nb->index] += n_hop * birthday;
+        continue;
+      }
+      for (u_int j = 0; j < n_hop; j++) {
+        struct vector3 pos;
+        struct subvolume *dest = leave_compartment(world, wms, sv, hop, &pos);
+        schedule_well_mixed_molecule(place_well_mixed_molecule(
+            world, wms, dest, &pos, t_now, birthday));
+      }
+    }
+  }
+
+  for (int c = 0; c < wm->n_cells; c++) {
+    int h = wm->cells[c];
+    wms->count[h] += wm->incoming[h];
+    wms->born[h] += wm->incoming_born[h];
+    wm->incoming[h] = 0;
+    wm->incoming_born[h] = 0.0;
+  }
+}
+
+/*************************************************************************
+react_counts:
+  In: world: simulation state
+      wms: the well-mixed species
+      k: reaction rate per iteration
+      t_now: the current time
+  Out: No return value.  Each counted molecule reacts with the probability
+       of its unimolecular reaction over the coming time step.  Reacting
+       molecules are materialized at a random spot in their compartment and
+       handed to outcome_unimolecular, so products, reaction counts and
+       triggers are handled as usual.
+*************************************************************************/
+static void react_counts(struct volume *world, struct well_mixed_species *wms,
+                         double k, double t_now) {
+  struct well_mixed_data *wm = world->well_mixed;
+
+  for (int c = 0; c < wm->n_cells; c++) {
+    int h = wm->cells[c];
+    u_int n = wms->count[h];
+    if (n == 0)
+      continue;
+
+    double birthday = wms->born[h] / n;
+    u_int n_rx = binomial_dist(world->rng, n, 1.0 - exp(-k));
+    if (n_rx == 0)
+      continue;
+    wms->count[h] -= n_rx;
+    wms->born[h] = (wms->count[h] > 0) ? wms->born[h] - n_rx * birthday : 0.0;
+
+    struct subvolume *sv = get_subvol(world, h);
+    for (u_int j = 0; j < n_rx; j++) {
+      struct vector3 pos;
+      random_point_in_subvol(world, sv, &pos);
+      double t = t_now + rng_dbl(world->rng);
+      struct volume_molecule *vm =
+          place_well_mixed_molecule(world, wms, sv, &pos, t, birthday);
+      struct abstract_molecule *am = (struct abstract_molecule *)vm;
+      int path = which_unimolecular(wms->rx, am, world->rng);
+      if (outcome_unimolecular(world, wms->rx, path, am, t) != RX_DESTROY)
+        schedule_well_mixed_molecule(vm);
+    }
+  }
+}
+
+/*************************************************************************
+run_well_mixed:
+  In: world: simulation state
+      t_now: the current time
+  Out: No return value.  The counted molecules (including those absorbed
+       during the previous iteration) hop over the previous time step, and
+       those left in the compartments react over this one.
+*************************************************************************/
+void run_well_mixed(struct volume *world, double t_now) {
+  struct well_mixed_data *wm = world->well_mixed;
+  if (wm == NULL)
+    return;
+
+  for (int i = 0; i < wm->n_species; i++) {
+    struct well_mixed_species *wms = &wm->species[i];
+    hop_counts(world, wms, t_now);
+    if (wms->rx != NULL)
+      react_counts(world, wms, wms->rx->max_fixed_p, t_now);
+  }
+}
+
+/*************************************************************************
+well_mixed_materialize_all:
+  In: world: simulation state
+      t_now: the current time
+  Out: No return value.  Every counted molecule is turned back into a
+       scheduled volume molecule at a random spot in its compartment, and all
+       counts are zero.  Used before geometry changes, which only know about
+       individual molecules.
+*************************************************************************/
+void well_mixed_materialize_all(struct volume *world, double t_now) {
+  struct well_mixed_data *wm = world->well_mixed;
+  if (wm == NULL)
+    return;
+
+  for (int i = 0; i < wm->n_species; i++) {
+    struct well_mixed_species *wms = &wm->species[i];
+    for (int c = 0; c < wm->n_cells; c++) {
+      int h = wm->cells[c];
+      if (wms->count[h] == 0)
+        continue;
+
+      struct subvolume *sv = get_subvol(world, h);
+      double birthday = wms->born[h] / wms->count[h];
+      for (; wms->count[h] > 0; wms->count[h]--) {
+        struct vector3 pos;
+        random_point_in_subvol(world, sv, &pos);
+        schedule_well_mixed_molecule(
+            place_well_mixed_molecule(world, wms, sv, &pos, t_now, birthday));
+      }
+      wms->born[h] = 0.0;
+    }
+  }
+}
+
+/*************************************************************************
+well_mixed_restore_counts:
+  In: world: simulation state
+      wms: a well-mixed species
+      h: index of a subvolume
+      count: molecules to add to wms->count
+      born: sum of their birthdays
+  Out: 0 on success, 1 if subvolume h is not a compartment.  Used to read
+       the counts back from a checkpoint.  Counted molecules belong to the
+       population of the species and to the region counts, so they are
+       added there too.
+*************************************************************************/
+int well_mixed_restore_counts(struct volume *world,
+                              struct well_mixed_species *wms, int h,
+                              u_int count, double born) {
+  if (h < 0 || h >= world->well_mixed->n_subvols || !is_compartment_at(world, h))
+    return 1;
+
+  wms->count[h] += count;
+  wms->born[h] += born;
+  wms->spec->population += count;
+
+  if (wms->spec->flags & (COUNT_CONTENTS | COUNT_ENCLOSED)) {
+    /* A compartment has no walls, so one point stands for all of it */
+    struct subvolume *sv = get_subvol(world, h);
+    struct volume_molecule probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.properties = wms->spec;
+    probe.subvol = sv;
+    probe.pos.x = 0.5 * (world->x_fineparts[sv->llf.x] +
+                         world->x_fineparts[sv->urb.x]);
+    probe.pos.y = 0.5 * (world->y_fineparts[sv->llf.y] +
+                         world->y_fineparts[sv->urb.y]);
+    probe.pos.z = 0.5 * (world->z_fineparts[sv->llf.z] +
+                         world->z_fineparts[sv->urb.z]);
+    count_region_from_scratch(world, (struct abstract_molecule *)&probe, NULL,
+                              count, &probe.pos, NULL,
+                              world->start_iterations, &probe.periodic_box);
+  }
+
+  return 0;
+}
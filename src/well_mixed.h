@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2006-2017 by
+ * The Salk Institute for Biological Studies and
+ * Pittsburgh Supercomputing Center, Carnegie Mellon University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ *
+******************************************************************************/
+
+#ifndef WELL_MIXED_H
+#define WELL_MIXED_H
+
+#include "mcell_structs.h"
+
+/* Hybrid treatment of high-copy volume species (see -well_mixed).
+ *
+ * Subvolumes which are not intersected by any wall and are not at the edge of
+ * the world act as well-mixed compartments. A molecule of a well-mixed
+ * species which is scheduled inside such a compartment is absorbed into a
+ * per-compartment count. Once per iteration the counts are advanced by a
+ * tau-leap: each counted molecule either reacts through its unimolecular
+ * reaction, hops to a neighboring subvolume, or stays put. Reacting molecules
+ * and molecules hopping into subvolumes that contain walls (or lie at the
+ * edge of the world) are materialized as ordinary molecules, so everything
+ * that involves walls, surface molecules or reaction products is still
+ * handled by the particle code.  Every counted molecule carries its birthday
+ * into the sum kept for its compartment, and materialized molecules get the
+ * mean birthday of the molecules they are taken from.  Checkpoints save the
+ * counts as they are (see chkpt.c). */
+
+/* State of one well-mixed species */
+struct well_mixed_species {
+  struct species *spec;
+  struct rxn *rx; /* Unimolecular reaction of the species, or NULL */
+  double D;       /* Diffusion constant in length units^2 per iteration */
+  u_int *count;   /* Molecules counted in each subvolume (indexed like
+                     world->subvol; only compartments are nonzero) */
+  double *born;   /* Sum of the birthdays of the molecules in count */
+  int warned;     /* Already warned that the species hops too fast */
+};
+
+struct well_mixed_data {
+  int n_species;
+  struct well_mixed_species *species;
+  int n_subvols; /* Size of the count arrays */
+  int n_cells;
+  int *cells;       /* Indices of the subvolumes that act as compartments */
+  u_int *incoming;  /* Scratch space: molecules hopping into each subvolume */
+  double *incoming_born; /* Scratch space: their birthdays */
+};
+
+int init_well_mixed(struct volume *world);
+
+int reset_well_mixed_compartments(struct volume *world);
+
+int well_mixed_absorb(struct volume *world, struct volume_molecule *vm);
+
+void run_well_mixed(struct volume *world, double t_now);
+
+void well_mixed_materialize_all(struct volume *world, double t_now);
+
+int well_mixed_restore_counts(struct volume *world,
+                              struct well_mixed_species *wms, int h,
+                              u_int count, double born);
+
+#endif
@@ -92,7 +92,7 @@ CMD_MCELL_VERSION     = 5
 CMD_SPECIES_TABLE     = 6
 CMD_SCHEDULER_STATE   = 7
 CMD_BYTE_ORDER        = 8
-CMD_NUM_CHKPT_CMD     = 9
+CMD_WELL_MIXED        = 9
 CMD_CHECKPOINT_API    = 10
 
 
@@ -177,11 +177,13 @@ def read_scheduler(ub, spec):
     for i in range(num_molecules):
         species = ub.next_vint()
         newbie = ub.next_byte()
+        change = ub.next_byte()
         t, t2, bday, x, y, z = ub.next_struct('dddddd')
         orient = ub.next_svint()
         cmplx  = ub.next_vint()
         m = {'species':  spec[species],
              'newbie':   newbie != 0,
+             'change':   change != 0,
              't':        t,
              't2':       t2,
              'birthday': bday,
@@ -198,6 +200,24 @@ def read_scheduler(ub, spec):
     return {'molecules': molecules}
 
 
+def read_well_mixed(ub, spec):
+    nsp = ub.next_vint()
+    counts = {}
+    for i in range(nsp):
+        species = ub.next_vint()
+        ncells = ub.next_vint()
+        cells = []
+        for j in range(ncells):
+            subvol = ub.next_vint()
+            count = ub.next_vint()
+            born, = ub.next_struct('d')
+            cells.append({'subvol': subvol,
+                          'count':  count,
+                          'born':   born})
+        counts[spec[species]] = cells
+    return {'well_mixed': counts}
+
+
 def read_file(fname):
     ub = UnmarshalBuffer(open(fname, 'rb').read())
     data = {}
@@ -219,8 +239,8 @@ def read_file(fname):
             d = read_scheduler(ub, data['species'])
         elif cmd == CMD_BYTE_ORDER:
             d = read_byte_order(ub)
-        elif cmd == CMD_NUM_CHKPT_CMD:
-            print("CMD_NUM_CHKPT_CMD")
+        elif cmd == CMD_WELL_MIXED:
+            d = read_well_mixed(ub, data['species'])
         elif cmd == CMD_CHECKPOINT_API:
             d = read_api(ub)
         else:
@@ -276,6 +296,9 @@ def dump_data(data, annotate):
                        m['pos'][1],
                        m['pos'][2],)))
                        # ORIENTS[m['orient'] + 1])),
+        for c in data.get('well_mixed', {}).get(name, []):
+            print('           subvolume %d: %d counted' %
+                  (c['subvol'], c['count']))
 
 
 def setup_argparser():
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+
+###############################################################################
+#                                                                             #
+# Copyright (C) 2006-2017 by                                                  #
+# The Salk Institute for Biological Studies and                               #
+# Pittsburgh Supercomputing Center, Carnegie Mellon University                #
+#                                                                             #
+# This program is free software; you can redistribute it and/or               #
+# modify it under the terms of the GNU General Public License                 #
+# as published by the Free Software Foundation; either version 2              #
+# of the License, or (at your option) any later version.                      #
+#                                                                             #
+# This program is distributed in the hope that it will be useful,             #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of              #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               #
+# GNU General Public License for more details.                                #
+#                                                                             #
+# You should have received a copy of the GNU General Public License           #
+# along with this program; if not, write to the Free Software                 #
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,  #
+# USA.                                                                        #
+#                                                                             #
+###############################################################################
+
+# Regression check for the neighbor search of trimolecular collisions: fixed
+# reaction partners sit in a thin layer just across a partition boundary from
+# the diffusing molecules, once on the -Y side and once mirrored onto the +Y
+# side.  Partners in the neighboring subvolume must be found in both
+# directions, so the mean number of products has to agree.  Exits with 1 if
+# the means differ by more than the tolerance.
+
+import os
+import sys
+import random
+import shutil
+import argparse
+import tempfile
+
+from well_mixed_check import run_mcell, read_means, average
+
+
+# Partitions end close to the molecules, so that the first and last rows of
+# subvolumes (which have no neighbor on one side) are crossed as well.
+MODEL = """
+ITERATIONS = 100
+TIME_STEP = 1e-6
+PARTITION_X = [[-0.2 TO 0.2 STEP 0.05]]
+PARTITION_Y = [[-0.2 TO 0.2 STEP 0.05]]
+PARTITION_Z = [[-0.2 TO 0.2 STEP 0.05]]
+DEFINE_MOLECULES {
+  A { DIFFUSION_CONSTANT_3D = 1e-6 }
+  B { DIFFUSION_CONSTANT_3D = 0 }
+  C { DIFFUSION_CONSTANT_3D = 0 }
+  D { DIFFUSION_CONSTANT_3D = 0 }
+}
+DEFINE_REACTIONS { A + B + C -> D [1e15] }
+INSTANTIATE w OBJECT {
+  ra RELEASE_SITE { SHAPE = LIST MOLECULE_POSITIONS { %s } }
+  rb RELEASE_SITE { SHAPE = LIST MOLECULE_POSITIONS { %s } }
+  rc RELEASE_SITE { SHAPE = LIST MOLECULE_POSITIONS { %s } }
+}
+REACTION_DATA_OUTPUT {
+  STEP = 1e-5
+  { COUNT[D, WORLD] } => "./react_data/D.dat"
+}
+"""
+
+
+def positions(rng, species, n, y_from, y_to, sign):
+    return ' '.join('%s [%.5f,%.5f,%.5f]' %
+                    (species, rng.uniform(-0.1, 0.1),
+                     sign * rng.uniform(y_from, y_to), rng.uniform(-0.1, 0.1))
+                    for i in range(n))
+
+
+def write_model(path, sign, n):
+    # Same positions for both models, mirrored in Y when sign is -1
+    rng = random.Random(1)
+    with open(path, 'w') as f:
+        f.write(MODEL % (positions(rng, 'A', n, 0.0002, 0.02, sign),
+                         positions(rng, 'B', n, -0.004, -0.0002, sign),
+                         positions(rng, 'C', n, -0.004, -0.0002, sign)))
+
+
+def setup_argparser():
+    parser = argparse.ArgumentParser(
+        description="compare trimolecular reactions across the -Y and +Y "
+                    "faces of a subvolume")
+    parser.add_argument("mcell", help="mcell executable")
+    parser.add_argument(
+        "-n", "--seeds", type=int, default=8,
+        help="number of seeds to average over (default: 8)")
+    parser.add_argument(
+        "-m", "--molecules", type=int, default=3000,
+        help="molecules of each species (default: 3000)")
+    parser.add_argument(
+        "-t", "--tolerance", type=float, default=0.02,
+        help="largest accepted relative difference of the means "
+             "(default: 0.02)")
+    parser.add_argument(
+        "-k", "--keep", action='store_true',
+        help="keep the run directories")
+    return parser.parse_args()
+
+if __name__ == '__main__':
+
+    args = setup_argparser()
+
+    tmpdir = tempfile.mkdtemp(prefix='trimol_neighbor_check.')
+    models = {}
+    for name, sign in (('neg_y', 1), ('pos_y', -1)):
+        models[name] = os.path.join(tmpdir, name + '.mdl')
+        write_model(models[name], sign, args.molecules)
+
+    means = {}
+    try:
+        for name in sorted(models):
+            runs = []
+            for seed in range(1, args.seeds + 1):
+                d = os.path.join(tmpdir, '%s.%d' % (name, seed))
+                run_mcell(args.mcell, models[name], seed, None, d)
+                runs.append(read_means(d, 0.0))
+            means[name] = average(runs)
+    finally:
+        if args.keep:
+            print('Runs kept in %s' % tmpdir)
+        else:
+            shutil.rmtree(tmpdir)
+
+    key = 'react_data/D.dat:1'
+    neg, pos = means['neg_y'][key], means['pos_y'][key]
+    ok = abs(neg - pos) <= args.tolerance * max(abs(pos), 1.0)
+    print('%-40s %14.6g %14.6g  %s' %
+          ('partners across -Y / +Y', neg, pos, 'ok' if ok else 'FAIL'))
+
+    sys.exit(0 if ok else 1)
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+
+###############################################################################
+#                                                                             #
+# Copyright (C) 2006-2017 by                                                  #
+# The Salk Institute for Biological Studies and                               #
+# Pittsburgh Supercomputing Center, Carnegie Mellon University                #
+#                                                                             #
+# This program is free software; you can redistribute it and/or               #
+# modify it under the terms of the GNU General Public License                 #
+# as published by the Free Software Foundation; either version 2              #
+# of the License, or (at your option) any later version.                      #
+#                                                                             #
+# This program is distributed in the hope that it will be useful,             #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of              #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               #
+# GNU General Public License for more details.                                #
+#                                                                             #
+# You should have received a copy of the GNU General Public License           #
+# along with this program; if not, write to the Free Software                 #
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,  #
+# USA.                                                                        #
+#                                                                             #
+###############################################################################
+
+# Regression check for -well_mixed: runs a model over several seeds with and
+# without counting the given species in well-mixed compartments, and compares
+# the mean of every column of every reaction data output file.  Exits with 1
+# if any mean differs by more than the tolerance.
+
+import os
+import sys
+import shutil
+import argparse
+import tempfile
+import subprocess
+
+
+# Built-in model: a transparent box inside a closed one, partitioned so that
+# both particle subvolumes (next to walls) and compartments are crossed, and a
+# reversible conversion to a species which is not well-mixed.
+DEFAULT_MODEL = """
+ITERATIONS = 2000
+TIME_STEP = 1e-6
+PARTITION_X = [[-1.0 TO 1.0 STEP 0.2]]
+PARTITION_Y = [[-1.0 TO 1.0 STEP 0.2]]
+PARTITION_Z = [[-1.0 TO 1.0 STEP 0.2]]
+DEFINE_MOLECULES {
+  X { DIFFUSION_CONSTANT_3D = 1e-6 }
+  Y { DIFFUSION_CONSTANT_3D = 1e-6 }
+}
+DEFINE_REACTIONS {
+  X -> Y [1e3]
+  Y -> X [1e3]
+}
+DEFINE_SURFACE_CLASSES { tr { TRANSPARENT = X TRANSPARENT = Y } }
+box POLYGON_LIST {
+  VERTEX_LIST {
+    [-0.3,-0.3,-0.3] [0.3,-0.3,-0.3] [-0.3,0.3,-0.3] [0.3,0.3,-0.3]
+    [-0.3,-0.3,0.3] [0.3,-0.3,0.3] [-0.3,0.3,0.3] [0.3,0.3,0.3]
+  }
+  ELEMENT_CONNECTIONS {
+    [0,2,1] [1,2,3] [0,1,4] [1,5,4] [1,3,5] [3,7,5]
+    [3,2,7] [2,6,7] [2,0,6] [0,4,6] [4,5,6] [5,7,6]
+  }
+  DEFINE_SURFACE_REGIONS {
+    all { ELEMENT_LIST = [ALL_ELEMENTS] SURFACE_CLASS = tr }
+  }
+}
+big BOX { CORNERS = [-0.8,-0.8,-0.8],[0.8,0.8,0.8] }
+INSTANTIATE w OBJECT {
+  box OBJECT box {}
+  big OBJECT big {}
+  rel RELEASE_SITE { SHAPE = w.big MOLECULE = X NUMBER_TO_RELEASE = 40000 }
+}
+REACTION_DATA_OUTPUT {
+  STEP = 2e-5
+  { COUNT[X, w.box] } => "./react_data/X_box.dat"
+  { COUNT[Y, w.box] } => "./react_data/Y_box.dat"
+  { COUNT[X, WORLD] } => "./react_data/X.dat"
+}
+"""
+DEFAULT_SPECIES = "X"
+
+
+def run_mcell(mcell, model, seed, species, workdir):
+    # Output paths in models are relative, so each run gets its own directory
+    os.makedirs(workdir)
+    cmd = [mcell, '-seed', str(seed), '-quiet']
+    if species is not None:
+        cmd += ['-well_mixed', species]
+    cmd.append(os.path.abspath(model))
+    with open(os.path.join(workdir, 'mcell.log'), 'w') as log:
+        if subprocess.call(cmd, cwd=workdir, stdout=log,
+                           stderr=subprocess.STDOUT) != 0:
+            raise Exception('%s failed (see %s)' %
+                            (' '.join(cmd), log.name))
+
+
+def read_means(workdir, skip):
+    # Time averages of each column of each .dat file below workdir, over the
+    # times at or after skip (a fraction of the last time in the file)
+    means = {}
+    for root, dirs, files in os.walk(workdir):
+        for fname in files:
+            if not fname.endswith('.dat'):
+                continue
+            path = os.path.join(root, fname)
+            rows = [[float(v) for v in line.split()]
+                    for line in open(path) if line.strip()]
+            if not rows:
+                continue
+            t_from = skip * rows[-1][0]
+            rows = [r for r in rows if r[0] >= t_from]
+            for col in range(1, len(rows[0])):
+                key = '%s:%d' % (os.path.relpath(path, workdir), col)
+                means[key] = sum(r[col] for r in rows) / len(rows)
+    return means
+
+
+def average(runs):
+    keys = set(runs[0])
+    for r in runs[1:]:
+        keys &= set(r)
+    return dict((k, sum(r[k] for r in runs) / len(runs)) for k in keys)
+
+
+def setup_argparser():
+    parser = argparse.ArgumentParser(
+        description="compare mean counts of a model with and without "
+                    "-well_mixed")
+    parser.add_argument("mcell", help="mcell executable")
+    parser.add_argument(
+        "model", nargs='?',
+        help="MDL file to run (a built-in model by default)")
+    parser.add_argument(
+        "-w", "--well_mixed", default=None,
+        help="species to count in compartments (default: %s for the "
+             "built-in model)" % DEFAULT_SPECIES)
+    parser.add_argument(
+        "-n", "--seeds", type=int, default=4,
+        help="number of seeds to average over (default: 4)")
+    parser.add_argument(
+        "-t", "--tolerance", type=float, default=0.03,
+        help="largest accepted relative difference of a mean "
+             "(default: 0.03)")
+    parser.add_argument(
+        "-s", "--skip", type=float, default=0.25,
+        help="fraction of the run left out of the means (default: 0.25)")
+    parser.add_argument(
+        "-k", "--keep", action='store_true',
+        help="keep the run directories")
+    return parser.parse_args()
+
+if __name__ == '__main__':
+
+    args = setup_argparser()
+
+    tmpdir = tempfile.mkdtemp(prefix='well_mixed_check.')
+    model = args.model
+    species = args.well_mixed
+    if model is None:
+        model = os.path.join(tmpdir, 'well_mixed_check.mdl')
+        with open(model, 'w') as f:
+            f.write(DEFAULT_MODEL)
+        if species is None:
+            species = DEFAULT_SPECIES
+    if species is None:
+        sys.stderr.write('Give the well-mixed species with -w.\n')
+        sys.exit(2)
+
+    plain = []
+    mixed = []
+    try:
+        for seed in range(1, args.seeds + 1):
+            d = os.path.join(tmpdir, 'plain.%d' % seed)
+            run_mcell(args.mcell, model, seed, None, d)
+            plain.append(read_means(d, args.skip))
+            d = os.path.join(tmpdir, 'well_mixed.%d' % seed)
+            run_mcell(args.mcell, model, seed, species, d)
+            mixed.append(read_means(d, args.skip))
+    finally:
+        if args.keep:
+            print('Runs kept in %s' % tmpdir)
+        else:
+            shutil.rmtree(tmpdir)
+
+    plain = average(plain)
+    mixed = average(mixed)
+    if not plain:
+        sys.stderr.write('The model writes no reaction data.\n')
+        sys.exit(2)
+
+    failed = 0
+    for key in sorted(plain):
+        diff = abs(mixed.get(key, 0.0) - plain[key])
+        ok = diff <= args.tolerance * max(abs(plain[key]), 1.0)
+        if not ok:
+            failed += 1
+        print('%-40s %14.6g %14.6g  %s' %
+              (key, plain[key], mixed.get(key, 0.0), 'ok' if ok else 'FAIL'))
+
+    sys.exit(1 if failed else 0)